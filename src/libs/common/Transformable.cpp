@@ -467,3 +467,233 @@ void Parameters::read_par_file(ifstream &fin,  map<string, double> &offset, map<
 		}
 	}
 }
+
+
+TransformableSchema::TransformableSchema(const vector<string> &_names) : names(_names)
+{
+	index.reserve(names.size());
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		if (!index.insert(make_pair(names[i], int(i))).second)
+			throw PestError("TransformableSchema: duplicate name: " + names[i]);
+	}
+}
+
+int TransformableSchema::get_index(const string &name) const
+{
+	auto iter = index.find(name);
+	if (iter == index.end())
+		return -1;
+	return iter->second;
+}
+
+vector<int> TransformableSchema::get_indices(const vector<string> &_names) const
+{
+	vector<int> idxs;
+	idxs.reserve(_names.size());
+	for (auto &name : _names)
+	{
+		auto iter = index.find(name);
+		if (iter == index.end())
+			throw(Transformable_value_error(name));
+		idxs.push_back(iter->second);
+	}
+	return idxs;
+}
+
+
+DenseTransformable::DenseTransformable() : schema(make_shared<const TransformableSchema>())
+{
+}
+
+DenseTransformable::DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, double fill_value)
+	: schema(_schema), values(_schema->size(), fill_value)
+{
+}
+
+DenseTransformable::DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, const Eigen::VectorXd &_values)
+	: schema(_schema), values(_values.data(), _values.data() + _values.size())
+{
+	if (values.size() != schema->size())
+		throw PestIndexError("DenseTransformable::DenseTransformable(schema, Eigen::VectorXd &values)",
+			"size of the schema does not match the size of the values vector");
+}
+
+DenseTransformable::DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, const vector<double> &_values)
+	: schema(_schema), values(_values)
+{
+	if (values.size() != schema->size())
+		throw PestIndexError("DenseTransformable::DenseTransformable(schema, vector<double> &values)",
+			"size of the schema does not match the size of the values vector");
+}
+
+DenseTransformable::DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, const Transformable &copyin)
+	: schema(_schema), values(copyin.get_data_vec(_schema->get_names()))
+{
+}
+
+bool DenseTransformable::same_schema(const DenseTransformable &rhs) const
+{
+	return (schema == rhs.schema) || (*schema == *rhs.schema);
+}
+
+void DenseTransformable::scatter(const vector<int> &idxs, const Eigen::VectorXd &new_values)
+{
+	assert(idxs.size() == new_values.size());
+	size_t n_rec = idxs.size();
+	for (size_t i = 0; i < n_rec; ++i)
+	{
+		values[idxs[i]] = new_values[i];
+	}
+}
+
+Eigen::VectorXd DenseTransformable::gather(const vector<int> &idxs) const
+{
+	VectorXd vec(idxs.size());
+	size_t n_rec = idxs.size();
+	for (size_t i = 0; i < n_rec; ++i)
+	{
+		vec[i] = values[idxs[i]];
+	}
+	return vec;
+}
+
+void DenseTransformable::fill(double value)
+{
+	std::fill(values.begin(), values.end(), value);
+}
+
+bool DenseTransformable::operator==(const DenseTransformable &rhs) const
+{
+	return same_schema(rhs) && (values == rhs.values);
+}
+
+size_t DenseTransformable::checked_index(const string &name) const
+{
+	int idx = schema->get_index(name);
+	if (idx < 0)
+		throw(Transformable_value_error(name));
+	return idx;
+}
+
+double& DenseTransformable::operator[](const string &name)
+{
+	return values[checked_index(name)];
+}
+
+pair<DenseTransformable::iterator, bool> DenseTransformable::insert(const string &name, double value)
+{
+	size_t idx = checked_index(name);
+	values[idx] = value;
+	return make_pair(iterator(&schema->get_names(), values.data(), idx), true);
+}
+
+void DenseTransformable::insert(const vector<string> &name_vec, const vector<double> &value_vec)
+{
+	update_without_clear(name_vec, value_vec);
+}
+
+DenseTransformable::iterator DenseTransformable::find(const string &name)
+{
+	int idx = schema->get_index(name);
+	if (idx < 0)
+		return end();
+	return iterator(&schema->get_names(), values.data(), idx);
+}
+
+DenseTransformable::const_iterator DenseTransformable::find(const string &name) const
+{
+	int idx = schema->get_index(name);
+	if (idx < 0)
+		return end();
+	return const_iterator(&schema->get_names(), values.data(), idx);
+}
+
+const double* DenseTransformable::get_rec_ptr(const string &name) const
+{
+	int idx = schema->get_index(name);
+	if (idx < 0)
+		return 0;
+	return &values[idx];
+}
+
+double DenseTransformable::get_rec(const string &name) const
+{
+	return values[checked_index(name)];
+}
+
+void DenseTransformable::update_rec(const string &name, double value)
+{
+	values[checked_index(name)] = value;
+}
+
+void DenseTransformable::update_without_clear(const vector<string> &names, const vector<double> &new_values)
+{
+	assert(names.size() == new_values.size());
+	size_t n_rec = names.size();
+	for (size_t i = 0; i < n_rec; ++i)
+	{
+		values[checked_index(names[i])] = new_values[i];
+	}
+}
+
+void DenseTransformable::update_without_clear(const vector<string> &names, const Eigen::VectorXd &new_values)
+{
+	assert(names.size() == new_values.size());
+	size_t n_rec = names.size();
+	for (size_t i = 0; i < n_rec; ++i)
+	{
+		values[checked_index(names[i])] = new_values[i];
+	}
+}
+
+vector<double> DenseTransformable::get_data_vec(const vector<string> &keys) const
+{
+	vector<double> v;
+	v.reserve(keys.size());
+	for (auto &k : keys)
+	{
+		v.push_back(values[checked_index(k)]);
+	}
+	return v;
+}
+
+Eigen::VectorXd DenseTransformable::get_data_eigen_vec(const vector<string> &keys) const
+{
+	VectorXd vec(keys.size());
+	int i = 0;
+	for (auto &k : keys)
+	{
+		vec(i++) = values[checked_index(k)];
+	}
+	return vec;
+}
+
+void DenseTransformable::copy_to(Transformable &t) const
+{
+	t.update_without_clear(schema->get_names(), values);
+}
+
+DenseParameters::DenseParameters(const shared_ptr<const TransformableSchema> &_schema, const Parameters &copyin)
+	: DenseTransformable(_schema, static_cast<const Transformable&>(copyin))
+{
+}
+
+Parameters DenseParameters::to_parameters() const
+{
+	Parameters pars;
+	copy_to(pars);
+	return pars;
+}
+
+DenseObservations::DenseObservations(const shared_ptr<const TransformableSchema> &_schema, const Observations &copyin)
+	: DenseTransformable(_schema, static_cast<const Transformable&>(copyin))
+{
+}
+
+Observations DenseObservations::to_observations() const
+{
+	Observations obs;
+	copy_to(obs);
+	return obs;
+}
@@ -27,6 +27,8 @@
 #include <utility>
 #include <Eigen/Dense>
 #include <map>
+#include <memory>
+#include <iterator>
 #include "pest_error.h"
 
 using namespace std;
@@ -140,6 +142,158 @@ private:
 };
 
 
+class TransformableSchema
+{
+	// Immutable name to index table shared by DenseTransformable instances.  The names are stored in
+	// the order given to the constructor and that order defines the layout of the dense value arrays
+public:
+	TransformableSchema() {}
+	TransformableSchema(const vector<string> &_names);
+	size_t size() const { return names.size(); }
+	const vector<string>& get_names() const { return names; }
+	const string& get_name(size_t idx) const { return names[idx]; }
+	// returns -1 if name is not in the schema
+	int get_index(const string &name) const;
+	// throws Transformable_value_error if a name is not in the schema
+	vector<int> get_indices(const vector<string> &_names) const;
+	bool operator==(const TransformableSchema &rhs) const { return names == rhs.names; }
+	bool operator!=(const TransformableSchema &rhs) const { return names != rhs.names; }
+private:
+	vector<string> names;
+	unordered_map<string, int> index;
+};
+
+
+template <class V>
+class DenseIterator
+{
+	// iterator over the (name, value) records of a DenseTransformable.  Dereferencing returns a
+	// proxy with "first" and "second" members so code written against Transformable::iterator
+	// (it->first, it->second) works unchanged.  The proxy is returned by value, so range based for
+	// loops must use "auto" or "const auto &" rather than "auto &"
+public:
+	typedef std::forward_iterator_tag iterator_category;
+	typedef std::pair<const string, V> value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef value_type* pointer;
+	typedef value_type& reference;
+	struct Item
+	{
+		const string &first;
+		V &second;
+	};
+	struct ArrowProxy
+	{
+		Item item;
+		const Item* operator->() const { return &item; }
+	};
+	DenseIterator() : names(nullptr), values(nullptr), idx(0) {}
+	DenseIterator(const vector<string> *_names, V *_values, size_t _idx) : names(_names), values(_values), idx(_idx) {}
+	// allow conversion of an iterator to a const_iterator
+	operator DenseIterator<const V>() const { return DenseIterator<const V>(names, values, idx); }
+	Item operator*() const { return Item{ (*names)[idx], values[idx] }; }
+	ArrowProxy operator->() const { return ArrowProxy{ Item{ (*names)[idx], values[idx] } }; }
+	DenseIterator& operator++() { ++idx; return *this; }
+	DenseIterator operator++(int) { DenseIterator tmp(*this); ++idx; return tmp; }
+	bool operator==(const DenseIterator &rhs) const { return (idx == rhs.idx) && (values == rhs.values); }
+	bool operator!=(const DenseIterator &rhs) const { return !(*this == rhs); }
+	// position of the record in the schema
+	size_t index() const { return idx; }
+private:
+	const vector<string> *names;
+	V *values;
+	size_t idx;
+};
+
+
+class DenseTransformable
+{
+	// Schema backed alternative to Transformable.  The values are held in a dense array laid out in
+	// schema order and the name to index table is shared by every instance created from the same
+	// schema, so copies are a single contiguous copy and indexed access does not hash the names.
+	// The name based Transformable interface is provided for compatibility; every schema name is
+	// always present, so insert() assigns the value and names outside the schema are an error
+public:
+	typedef DenseIterator<double> iterator;
+	typedef DenseIterator<const double> const_iterator;
+	DenseTransformable();
+	DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, double fill_value = Transformable::no_data);
+	DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, const Eigen::VectorXd &_values);
+	DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, const vector<double> &_values);
+	// gather the values of the schema names from a Transformable
+	DenseTransformable(const shared_ptr<const TransformableSchema> &_schema, const Transformable &copyin);
+	const shared_ptr<const TransformableSchema>& get_schema() const { return schema; }
+	bool same_schema(const DenseTransformable &rhs) const;
+	size_t size() const { return values.size(); }
+	double& operator[](size_t idx) { return values[idx]; }
+	double operator[](size_t idx) const { return values[idx]; }
+	double* data() { return values.data(); }
+	const double* data() const { return values.data(); }
+	Eigen::Map<Eigen::VectorXd> get_eigen_map() { return Eigen::Map<Eigen::VectorXd>(values.data(), values.size()); }
+	Eigen::Map<const Eigen::VectorXd> get_eigen_map() const { return Eigen::Map<const Eigen::VectorXd>(values.data(), values.size()); }
+	// values[idxs[i]] = new_values[i]
+	void scatter(const vector<int> &idxs, const Eigen::VectorXd &new_values);
+	// returns values[idxs[i]]
+	Eigen::VectorXd gather(const vector<int> &idxs) const;
+	void fill(double value);
+	bool operator==(const DenseTransformable &rhs) const;
+	bool operator!=(const DenseTransformable &rhs) const { return !(*this == rhs); }
+
+	// name based interface
+	double& operator[](const string &name);
+	pair<iterator, bool> insert(const string &name, double value);
+	void insert(const vector<string> &name_vec, const vector<double> &value_vec);
+	iterator find(const string &name);
+	const_iterator find(const string &name) const;
+	const double* get_rec_ptr(const string &name) const;
+	double get_rec(const string &name) const;
+	void update_rec(const string &name, double value);
+	void update_without_clear(const vector<string> &names, const vector<double> &new_values);
+	void update_without_clear(const vector<string> &names, const Eigen::VectorXd &new_values);
+	const vector<string>& get_keys() const { return schema->get_names(); }
+	vector<double> get_data_vec(const vector<string> &keys) const;
+	Eigen::VectorXd get_data_eigen_vec(const vector<string> &keys) const;
+	// copy the records into a Transformable, adding any that are missing
+	void copy_to(Transformable &t) const;
+	iterator begin() { return iterator(&schema->get_names(), values.data(), 0); }
+	const_iterator begin() const { return const_iterator(&schema->get_names(), values.data(), 0); }
+	iterator end() { return iterator(&schema->get_names(), values.data(), values.size()); }
+	const_iterator end() const { return const_iterator(&schema->get_names(), values.data(), values.size()); }
+	virtual ~DenseTransformable() {}
+protected:
+	shared_ptr<const TransformableSchema> schema;
+	vector<double> values;
+	size_t checked_index(const string &name) const;
+};
+
+
+class DenseParameters : public DenseTransformable
+{
+public:
+	DenseParameters() : DenseTransformable() {}
+	DenseParameters(const shared_ptr<const TransformableSchema> &_schema, double fill_value = Transformable::no_data) : DenseTransformable(_schema, fill_value) {}
+	DenseParameters(const shared_ptr<const TransformableSchema> &_schema, const Eigen::VectorXd &_values) : DenseTransformable(_schema, _values) {}
+	DenseParameters(const shared_ptr<const TransformableSchema> &_schema, const vector<double> &_values) : DenseTransformable(_schema, _values) {}
+	DenseParameters(const shared_ptr<const TransformableSchema> &_schema, const Parameters &copyin);
+	Parameters to_parameters() const;
+	virtual ~DenseParameters() {}
+};
+
+
+class DenseObservations : public DenseTransformable
+{
+public:
+	DenseObservations() : DenseTransformable() {}
+	DenseObservations(const shared_ptr<const TransformableSchema> &_schema, double fill_value = Transformable::no_data) : DenseTransformable(_schema, fill_value) {}
+	DenseObservations(const shared_ptr<const TransformableSchema> &_schema, const Eigen::VectorXd &_values) : DenseTransformable(_schema, _values) {}
+	DenseObservations(const shared_ptr<const TransformableSchema> &_schema, const vector<double> &_values) : DenseTransformable(_schema, _values) {}
+	DenseObservations(const shared_ptr<const TransformableSchema> &_schema, const Observations &copyin);
+	Observations to_observations() const;
+	virtual ~DenseObservations() {}
+};
+
+
+
 template <class NameIterator>
 Transformable Transformable::get_subset (const NameIterator first, const NameIterator last) const
 {
@@ -0,0 +1,75 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include "counter_rng.h"
+#include <cmath>
+
+namespace
+{
+	const uint32_t philox_m0 = 0xD2511F53;
+	const uint32_t philox_m1 = 0xCD9E8D57;
+	const uint32_t philox_w0 = 0x9E3779B9;
+	const uint32_t philox_w1 = 0xBB67AE85;
+	const int philox_rounds = 10;
+	const double two_pi = 6.283185307179586476925286766559;
+
+	inline double to_unit(uint32_t hi, uint32_t lo)
+	{
+		//53 random bits mapped into the open interval (0, 1)
+		uint64_t x = ((uint64_t(hi) << 32) | lo) >> 11;
+		return (double(x) + 0.5) * (1.0 / 9007199254740992.0);
+	}
+}
+
+void CounterRNG::set_seed(uint64_t seed)
+{
+	key[0] = uint32_t(seed);
+	key[1] = uint32_t(seed >> 32);
+}
+
+void CounterRNG::bits(uint64_t c0, uint64_t c1, uint32_t out[4]) const
+{
+	uint32_t ctr[4] = { uint32_t(c0), uint32_t(c0 >> 32), uint32_t(c1), uint32_t(c1 >> 32) };
+	uint32_t k0 = key[0], k1 = key[1];
+	for (int r = 0; r < philox_rounds; r++)
+	{
+		if (r > 0)
+		{
+			k0 += philox_w0;
+			k1 += philox_w1;
+		}
+		uint64_t p0 = uint64_t(philox_m0) * ctr[0];
+		uint64_t p1 = uint64_t(philox_m1) * ctr[2];
+		uint32_t next[4] = { uint32_t(p1 >> 32) ^ ctr[1] ^ k0, uint32_t(p1),
+			uint32_t(p0 >> 32) ^ ctr[3] ^ k1, uint32_t(p0) };
+		for (int i = 0; i < 4; i++)
+			ctr[i] = next[i];
+	}
+	for (int i = 0; i < 4; i++)
+		out[i] = ctr[i];
+}
+
+void CounterRNG::normal_pair(uint64_t c0, uint64_t c1, double &z0, double &z1) const
+{
+	uint32_t b[4];
+	bits(c0, c1, b);
+	double r = std::sqrt(-2.0 * std::log(to_unit(b[0], b[1])));
+	double theta = two_pi * to_unit(b[2], b[3]);
+	z0 = r * std::cos(theta);
+	z1 = r * std::sin(theta);
+}
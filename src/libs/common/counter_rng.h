@@ -0,0 +1,41 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef COUNTER_RNG_H_
+#define COUNTER_RNG_H_
+
+#include <cstdint>
+
+class CounterRNG
+{
+	// Philox4x32-10 counter-based random number generator (Salmon et al., 2011, "Parallel random
+	// numbers: as easy as 1, 2, 3").  Every value is a pure function of the seed and a 128 bit
+	// counter, so any part of a random sequence can be generated on its own, in any order and on any
+	// thread, and always gives the same values.
+public:
+	CounterRNG(uint64_t seed = 0) { set_seed(seed); }
+	void set_seed(uint64_t seed);
+	// four independent uniformly distributed 32 bit values for counter (c0, c1)
+	void bits(uint64_t c0, uint64_t c1, uint32_t out[4]) const;
+	// two independent standard normal values for counter (c0, c1) (Box-Muller transform)
+	void normal_pair(uint64_t c0, uint64_t c1, double &z0, double &z1) const;
+private:
+	uint32_t key[2];
+};
+
+#endif /* COUNTER_RNG_H_ */
@@ -0,0 +1,205 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include "dense_binary.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include "pest_error.h"
+
+using namespace std;
+
+const char DenseBinaryFile::signature[8] = { 'P', 'S', 'T', 'D', 'E', 'N', 'S', 'E' };
+const int32_t DenseBinaryFile::version;
+
+void DenseBinaryFile::write(const string &filename, const vector<string> &row_names,
+	const vector<string> &col_names, const Eigen::MatrixXd &mat, bool single_precision)
+{
+	if ((mat.rows() != row_names.size()) || (mat.cols() != col_names.size()))
+		throw PestError("DenseBinaryFile::write() matrix shape does not match the number of row and column names");
+	ofstream out(filename, ofstream::binary);
+	if (!out.good())
+		throw PestFileError(filename);
+	int32_t value_bytes = single_precision ? 4 : 8;
+	int64_t n_rows = mat.rows();
+	int64_t n_cols = mat.cols();
+	int64_t names_size = 0;
+	for (auto &name : row_names)
+		names_size += sizeof(int32_t) + name.size();
+	for (auto &name : col_names)
+		names_size += sizeof(int32_t) + name.size();
+	int64_t header_size = sizeof(signature) + 2 * sizeof(int32_t) + 3 * sizeof(int64_t);
+	int64_t payload_offset = ((header_size + names_size + 7) / 8) * 8;
+
+	out.write(signature, sizeof(signature));
+	out.write((char*)&version, sizeof(version));
+	out.write((char*)&value_bytes, sizeof(value_bytes));
+	out.write((char*)&n_rows, sizeof(n_rows));
+	out.write((char*)&n_cols, sizeof(n_cols));
+	out.write((char*)&payload_offset, sizeof(payload_offset));
+	for (const vector<string> *names : { &row_names, &col_names })
+	{
+		for (auto &name : *names)
+		{
+			int32_t len = name.size();
+			out.write((char*)&len, sizeof(len));
+			out.write(name.data(), len);
+		}
+	}
+	const char pad[8] = { 0 };
+	out.write(pad, payload_offset - (header_size + names_size));
+
+	if (single_precision)
+	{
+		vector<float> fcol(n_rows);
+		for (int64_t j = 0; j < n_cols; j++)
+		{
+			for (int64_t i = 0; i < n_rows; i++)
+				fcol[i] = (float)mat(i, j);
+			out.write((char*)fcol.data(), n_rows * sizeof(float));
+		}
+	}
+	else
+	{
+		//Eigen matrices are column major so the values are written as they are stored
+		out.write((char*)mat.data(), n_rows * n_cols * sizeof(double));
+	}
+	if (!out.good())
+		throw PestError("DenseBinaryFile::write() error writing file " + filename);
+}
+
+bool DenseBinaryFile::is_dense_binary(const string &filename)
+{
+	ifstream in(filename, ifstream::binary);
+	char buf[sizeof(signature)];
+	if (!in.read(buf, sizeof(buf)))
+		return false;
+	return memcmp(buf, signature, sizeof(signature)) == 0;
+}
+
+DenseBinaryFile::DenseBinaryFile(const string &filename) : mfile(filename)
+{
+	const char *data = mfile.data();
+	size_t size = mfile.size();
+	size_t pos = 0;
+	auto read_bytes = [&](void *dest, size_t n)
+	{
+		if (pos + n > size)
+			throw_error("file is truncated");
+		memcpy(dest, data + pos, n);
+		pos += n;
+	};
+	char buf[sizeof(signature)];
+	read_bytes(buf, sizeof(buf));
+	if (memcmp(buf, signature, sizeof(signature)) != 0)
+		throw_error("file is not a dense binary file");
+	int32_t file_version;
+	read_bytes(&file_version, sizeof(file_version));
+	if (file_version != version)
+		throw_error("unsupported format version");
+	read_bytes(&value_bytes, sizeof(value_bytes));
+	if ((value_bytes != 4) && (value_bytes != 8))
+		throw_error("unsupported value size");
+	read_bytes(&n_rows, sizeof(n_rows));
+	read_bytes(&n_cols, sizeof(n_cols));
+	read_bytes(&payload_offset, sizeof(payload_offset));
+	if ((n_rows < 0) || (n_cols < 0) || (payload_offset % 8 != 0))
+		throw_error("invalid header");
+
+	int32_t len;
+	string name;
+	for (vector<string> *names : { &row_names, &col_names })
+	{
+		int64_t n = (names == &row_names) ? n_rows : n_cols;
+		names->reserve(n);
+		for (int64_t i = 0; i < n; i++)
+		{
+			read_bytes(&len, sizeof(len));
+			if ((len < 0) || (pos + len > size))
+				throw_error("invalid name table");
+			names->push_back(string(data + pos, len));
+			pos += len;
+		}
+	}
+	if ((pos > payload_offset) || (payload_offset + n_rows * n_cols * value_bytes > size))
+		throw_error("file is truncated");
+}
+
+const char* DenseBinaryFile::col_ptr(int64_t icol) const
+{
+	if ((icol < 0) || (icol >= n_cols))
+		throw_error("column index out of range");
+	return mfile.data() + payload_offset + icol * n_rows * value_bytes;
+}
+
+Eigen::MatrixXd DenseBinaryFile::read(const vector<int> &row_idxs, const vector<int> &col_idxs) const
+{
+	if (row_idxs.empty())
+		return read_rows(0, n_rows, col_idxs);
+	for (auto i : row_idxs)
+		if ((i < 0) || (i >= n_rows))
+			throw_error("row index out of range");
+	int64_t nc = col_idxs.empty() ? n_cols : col_idxs.size();
+	Eigen::MatrixXd mat(row_idxs.size(), nc);
+	for (int64_t j = 0; j < nc; j++)
+	{
+		const char *ptr = col_ptr(col_idxs.empty() ? j : col_idxs[j]);
+		if (value_bytes == 8)
+		{
+			const double *col = (const double*)ptr;
+			for (int i = 0; i < row_idxs.size(); i++)
+				mat(i, j) = col[row_idxs[i]];
+		}
+		else
+		{
+			const float *col = (const float*)ptr;
+			for (int i = 0; i < row_idxs.size(); i++)
+				mat(i, j) = col[row_idxs[i]];
+		}
+	}
+	return mat;
+}
+
+Eigen::MatrixXd DenseBinaryFile::read_rows(int64_t row_start, int64_t n, const vector<int> &col_idxs) const
+{
+	if ((row_start < 0) || (n < 0) || (row_start + n > n_rows))
+		throw_error("row range out of range");
+	int64_t nc = col_idxs.empty() ? n_cols : col_idxs.size();
+	Eigen::MatrixXd mat(n, nc);
+	for (int64_t j = 0; j < nc; j++)
+	{
+		const char *ptr = col_ptr(col_idxs.empty() ? j : col_idxs[j]);
+		if (value_bytes == 8)
+			mat.col(j) = Eigen::Map<const Eigen::VectorXd>((const double*)ptr + row_start, n);
+		else
+			mat.col(j) = Eigen::Map<const Eigen::VectorXf>((const float*)ptr + row_start, n).cast<double>();
+	}
+	return mat;
+}
+
+Eigen::Map<const Eigen::MatrixXd> DenseBinaryFile::get_map() const
+{
+	if (value_bytes != 8)
+		throw_error("get_map() is only available for float64 files");
+	return Eigen::Map<const Eigen::MatrixXd>((const double*)(mfile.data() + payload_offset), n_rows, n_cols);
+}
+
+void DenseBinaryFile::throw_error(const string &message) const
+{
+	throw PestError("DenseBinaryFile error: " + message + " (file: " + mfile.get_filename() + ")");
+}
@@ -0,0 +1,75 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef DENSE_BINARY_H_
+#define DENSE_BINARY_H_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <Eigen/Dense>
+#include "mapped_file.h"
+
+class DenseBinaryFile
+{
+	// Dense, column-major binary matrix file for ensembles.  Unlike the jco-type sparse triplet
+	// format, each value is stored once and each column is contiguous, so the file is memory
+	// mapped and only the columns (or rows) that are requested are read.  Layout, in native byte
+	// order:
+	//   char[8]  "PSTDENSE"
+	//   int32    format version
+	//   int32    bytes per value (8 = float64, 4 = float32)
+	//   int64    number of rows
+	//   int64    number of columns
+	//   int64    byte offset of the values (a multiple of 8)
+	//   the row names then the column names, each an int32 length followed by the characters
+	//   the values column by column
+public:
+	static void write(const std::string &filename, const std::vector<std::string> &row_names,
+		const std::vector<std::string> &col_names, const Eigen::MatrixXd &mat, bool single_precision = false);
+	// true if filename starts with the dense binary file signature
+	static bool is_dense_binary(const std::string &filename);
+	DenseBinaryFile(const std::string &filename);
+	const std::string& get_filename() const { return mfile.get_filename(); }
+	// names are returned as stored in the file
+	const std::vector<std::string>& get_row_names() const { return row_names; }
+	const std::vector<std::string>& get_col_names() const { return col_names; }
+	int64_t rows() const { return n_rows; }
+	int64_t cols() const { return n_cols; }
+	bool is_single_precision() const { return value_bytes == 4; }
+	// the values of col_idxs for row_idxs.  An empty index vector selects all rows or columns
+	Eigen::MatrixXd read(const std::vector<int> &row_idxs, const std::vector<int> &col_idxs) const;
+	// the values of col_idxs for the n rows starting at row_start
+	Eigen::MatrixXd read_rows(int64_t row_start, int64_t n, const std::vector<int> &col_idxs) const;
+	// view of the values without copying; only available for float64 files
+	Eigen::Map<const Eigen::MatrixXd> get_map() const;
+private:
+	static const char signature[8];
+	static const int32_t version = 1;
+	MappedFile mfile;
+	int32_t value_bytes;
+	int64_t n_rows;
+	int64_t n_cols;
+	int64_t payload_offset;
+	std::vector<std::string> row_names;
+	std::vector<std::string> col_names;
+	const char* col_ptr(int64_t icol) const;
+	void throw_error(const std::string &message) const;
+};
+
+#endif /* DENSE_BINARY_H_ */
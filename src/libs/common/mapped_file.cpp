@@ -0,0 +1,232 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include <sstream>
+#include <cstring>
+#include "mapped_file.h"
+#include "pest_error.h"
+
+#ifdef OS_WIN
+#include <Windows.h>
+#endif
+
+#ifdef OS_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
+
+using namespace std;
+
+MappedFile::MappedFile() : mode(Mode::READ_ONLY), map_ptr(nullptr), map_size(0)
+{
+#ifdef OS_WIN
+	file_handle = INVALID_HANDLE_VALUE;
+	mapping_handle = NULL;
+#endif
+#ifdef OS_LINUX
+	fd = -1;
+#endif
+}
+
+MappedFile::MappedFile(const string &_filename, Mode _mode, size_t min_size) : MappedFile()
+{
+	open(_filename, _mode, min_size);
+}
+
+bool MappedFile::is_valid_handle() const
+{
+#ifdef OS_WIN
+	return file_handle != INVALID_HANDLE_VALUE;
+#endif
+#ifdef OS_LINUX
+	return fd >= 0;
+#endif
+}
+
+void MappedFile::throw_error(const string &message) const
+{
+	stringstream ss;
+	ss << "MappedFile error: " << message << " (file: " << filename;
+#ifdef OS_WIN
+	ss << ", error code: " << GetLastError();
+#endif
+#ifdef OS_LINUX
+	ss << ", " << strerror(errno);
+#endif
+	ss << ")";
+	throw PestError(ss.str());
+}
+
+void MappedFile::open(const string &_filename, Mode _mode, size_t min_size)
+{
+	close();
+	filename = _filename;
+	mode = _mode;
+	size_t file_size = 0;
+#ifdef OS_WIN
+	DWORD access = (mode == Mode::READ_WRITE) ? (GENERIC_READ | GENERIC_WRITE) : GENERIC_READ;
+	DWORD disposition = (mode == Mode::READ_WRITE) ? OPEN_ALWAYS : OPEN_EXISTING;
+	file_handle = CreateFileA(filename.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+		disposition, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE)
+		throw PestFileError(filename);
+	LARGE_INTEGER li;
+	if (!GetFileSizeEx((HANDLE)file_handle, &li))
+		throw_error("unable to determine file size");
+	file_size = (size_t)li.QuadPart;
+#endif
+#ifdef OS_LINUX
+	int flags = (mode == Mode::READ_WRITE) ? (O_RDWR | O_CREAT) : O_RDONLY;
+	fd = ::open(filename.c_str(), flags, 0644);
+	if (fd < 0)
+		throw PestFileError(filename);
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+		throw_error("unable to determine file size");
+	file_size = (size_t)st.st_size;
+#endif
+	if ((mode == Mode::READ_WRITE) && (min_size > file_size))
+		file_size = min_size;
+	map(file_size);
+}
+
+void MappedFile::map(size_t new_size)
+{
+	unmap();
+	if ((mode == Mode::READ_WRITE) && (new_size > 0))
+	{
+#ifdef OS_WIN
+		LARGE_INTEGER li;
+		li.QuadPart = (LONGLONG)new_size;
+		if ((!SetFilePointerEx((HANDLE)file_handle, li, NULL, FILE_BEGIN)) || (!SetEndOfFile((HANDLE)file_handle)))
+			throw_error("unable to resize file");
+#endif
+#ifdef OS_LINUX
+		struct stat st;
+		if (fstat(fd, &st) != 0)
+			throw_error("unable to determine file size");
+		if (((size_t)st.st_size != new_size) && (ftruncate(fd, (off_t)new_size) != 0))
+			throw_error("unable to resize file");
+#endif
+	}
+	map_size = new_size;
+	//zero length files can be opened but not mapped
+	if (map_size == 0)
+		return;
+#ifdef OS_WIN
+	DWORD protect = (mode == Mode::READ_WRITE) ? PAGE_READWRITE : PAGE_READONLY;
+	DWORD access = (mode == Mode::READ_WRITE) ? FILE_MAP_WRITE : FILE_MAP_READ;
+	mapping_handle = CreateFileMappingA((HANDLE)file_handle, NULL, protect, 0, 0, NULL);
+	if (mapping_handle == NULL)
+		throw_error("unable to create file mapping");
+	map_ptr = (char*)MapViewOfFile((HANDLE)mapping_handle, access, 0, 0, map_size);
+	if (map_ptr == NULL)
+	{
+		map_ptr = nullptr;
+		throw_error("unable to map view of file");
+	}
+#endif
+#ifdef OS_LINUX
+	int prot = (mode == Mode::READ_WRITE) ? (PROT_READ | PROT_WRITE) : PROT_READ;
+	void *ptr = mmap(NULL, map_size, prot, MAP_SHARED, fd, 0);
+	if (ptr == MAP_FAILED)
+		throw_error("unable to map file");
+	map_ptr = (char*)ptr;
+#endif
+}
+
+void MappedFile::unmap()
+{
+	if (map_ptr != nullptr)
+	{
+#ifdef OS_WIN
+		UnmapViewOfFile(map_ptr);
+#endif
+#ifdef OS_LINUX
+		munmap(map_ptr, map_size);
+#endif
+	}
+#ifdef OS_WIN
+	if (mapping_handle != NULL)
+	{
+		CloseHandle((HANDLE)mapping_handle);
+		mapping_handle = NULL;
+	}
+#endif
+	map_ptr = nullptr;
+	map_size = 0;
+}
+
+void MappedFile::resize(size_t new_size)
+{
+	if (!is_valid_handle())
+		throw_error("resize() called on a file that is not open");
+	if (mode != Mode::READ_WRITE)
+		throw_error("resize() called on a read only mapping");
+	if (new_size == map_size)
+		return;
+	map(new_size);
+}
+
+void MappedFile::flush()
+{
+	if (map_ptr == nullptr || mode != Mode::READ_WRITE)
+		return;
+#ifdef OS_WIN
+	FlushViewOfFile(map_ptr, 0);
+#endif
+#ifdef OS_LINUX
+	msync(map_ptr, map_size, MS_ASYNC);
+#endif
+}
+
+void MappedFile::close(size_t final_size)
+{
+	if (!is_valid_handle())
+		return;
+	if (mode == Mode::READ_WRITE)
+	{
+		flush();
+		map(final_size);
+	}
+	close();
+}
+
+void MappedFile::close()
+{
+	unmap();
+#ifdef OS_WIN
+	if (file_handle != INVALID_HANDLE_VALUE)
+		CloseHandle((HANDLE)file_handle);
+	file_handle = INVALID_HANDLE_VALUE;
+#endif
+#ifdef OS_LINUX
+	if (fd >= 0)
+		::close(fd);
+	fd = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
@@ -0,0 +1,69 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include "config_os.h"
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+class MappedFile
+{
+	// Thin, platform independent wrapper around a memory mapped file.
+	// READ_ONLY maps an existing file as it is on disk.  READ_WRITE
+	// creates the file if required and allows the mapping to be grown with
+	// resize(); growing remaps the file so any pointers obtained from data()
+	// before the resize are no longer valid.
+public:
+	enum class Mode { READ_ONLY, READ_WRITE };
+	MappedFile();
+	MappedFile(const std::string &_filename, Mode _mode = Mode::READ_ONLY, size_t min_size = 0);
+	void open(const std::string &_filename, Mode _mode = Mode::READ_ONLY, size_t min_size = 0);
+	void resize(size_t new_size);
+	void flush();
+	void close(size_t final_size);
+	void close();
+	bool is_open() const { return is_valid_handle(); }
+	char* data() { return map_ptr; }
+	const char* data() const { return map_ptr; }
+	size_t size() const { return map_size; }
+	const std::string& get_filename() const { return filename; }
+	~MappedFile();
+private:
+	std::string filename;
+	Mode mode;
+	char *map_ptr;
+	size_t map_size;
+#ifdef OS_WIN
+	void *file_handle;
+	void *mapping_handle;
+#endif
+#ifdef OS_LINUX
+	int fd;
+#endif
+	MappedFile(const MappedFile &) = delete;
+	MappedFile& operator=(const MappedFile &) = delete;
+	bool is_valid_handle() const;
+	void map(size_t new_size);
+	void unmap();
+	void throw_error(const std::string &message) const;
+};
+
+#endif /* MAPPED_FILE_H_ */
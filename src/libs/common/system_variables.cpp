@@ -88,10 +88,12 @@ string OperSys::getcwd()
 void OperSys::chdir(const char *str)
 {
    #ifdef OS_WIN
-      _chdir(str);
+      if (_chdir(str) != 0)
+          throw std::runtime_error(std::string("OperSys::chdir() unable to change to directory: ") + str);
    #endif
    #ifdef OS_LINUX
-      //chdir(str);
+      if (::chdir(str) != 0)
+          throw std::runtime_error(std::string("OperSys::chdir() unable to change to directory: ") + str);
    #endif
 }
 
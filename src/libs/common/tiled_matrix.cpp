@@ -0,0 +1,111 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include "tiled_matrix.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "pest_error.h"
+
+using namespace std;
+
+TiledMatrix::TiledMatrix(const string &filename, const Eigen::MatrixXd &mat, int64_t _tile_cols, int _cache_tiles, bool _single_precision)
+	: n_rows(mat.rows()), n_cols(mat.cols()), tile_cols(_tile_cols), cache_tiles(_cache_tiles), single_precision(_single_precision)
+{
+	if (tile_cols < 1)
+		tile_cols = 1;
+	if (cache_tiles < 1)
+		cache_tiles = 1;
+	//start from an empty file so a stale scratch file is never reused
+	std::remove(filename.c_str());
+	size_t size = n_rows * n_cols * (single_precision ? sizeof(float) : sizeof(double));
+	mfile.open(filename, MappedFile::Mode::READ_WRITE, size);
+	//tiles hold whole columns so the column-major values of mat are written as they are stored
+	if (size == 0)
+		return;
+	if (single_precision)
+		Eigen::Map<Eigen::MatrixXf>((float*)mfile.data(), n_rows, n_cols) = mat.cast<float>();
+	else
+		memcpy(mfile.data(), mat.data(), size);
+}
+
+TiledMatrix::~TiledMatrix()
+{
+	string filename = mfile.get_filename();
+	mfile.close();
+	std::remove(filename.c_str());
+}
+
+const Eigen::MatrixXd& TiledMatrix::get_tile(int64_t itile)
+{
+	auto found = cache.find(itile);
+	if (found != cache.end())
+	{
+		lru.splice(lru.begin(), lru, found->second.second);
+		return found->second.first;
+	}
+	if ((int)cache.size() >= cache_tiles)
+	{
+		cache.erase(lru.back());
+		lru.pop_back();
+	}
+	int64_t col_start = itile * tile_cols;
+	int64_t nc = min(tile_cols, n_cols - col_start);
+	lru.push_front(itile);
+	auto &entry = cache[itile];
+	if (single_precision)
+		entry.first = Eigen::Map<const Eigen::MatrixXf>((const float*)mfile.data() + col_start * n_rows, n_rows, nc).cast<double>();
+	else
+		entry.first = Eigen::Map<const Eigen::MatrixXd>((const double*)mfile.data() + col_start * n_rows, n_rows, nc);
+	entry.second = lru.begin();
+	return entry.first;
+}
+
+Eigen::MatrixXd TiledMatrix::read(const vector<int> &row_idxs, const vector<int> &col_idxs)
+{
+	for (auto i : row_idxs)
+		if ((i < 0) || (i >= n_rows))
+			throw PestError("TiledMatrix::read() row index out of range");
+	for (auto j : col_idxs)
+		if ((j < 0) || (j >= n_cols))
+			throw PestError("TiledMatrix::read() column index out of range");
+	int64_t nr = row_idxs.empty() ? n_rows : row_idxs.size();
+	int64_t nc = col_idxs.empty() ? n_cols : col_idxs.size();
+	//visit the requested columns in storage order so each tile is loaded once
+	vector<pair<int, int>> order;
+	order.reserve(nc);
+	for (int j = 0; j < nc; j++)
+		order.push_back(pair<int, int>(col_idxs.empty() ? j : col_idxs[j], j));
+	sort(order.begin(), order.end());
+
+	Eigen::MatrixXd mat(nr, nc);
+	lock_guard<mutex> guard(cache_lock);
+	for (auto &o : order)
+	{
+		const Eigen::MatrixXd &tile = get_tile(o.first / tile_cols);
+		int64_t jj = o.first % tile_cols;
+		if (row_idxs.empty())
+			mat.col(o.second) = tile.col(jj);
+		else
+		{
+			for (int i = 0; i < nr; i++)
+				mat(i, o.second) = tile(row_idxs[i], jj);
+		}
+	}
+	return mat;
+}
@@ -0,0 +1,66 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef TILED_MATRIX_H_
+#define TILED_MATRIX_H_
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <cstdint>
+#include <Eigen/Dense>
+#include "mapped_file.h"
+
+class TiledMatrix
+{
+	// Dense matrix held in a memory mapped scratch file instead of in memory.  The
+	// columns are split into tiles of tile_cols columns; each tile is stored column-major and
+	// contiguously so reading a subset of columns only touches the tiles that hold them.  The
+	// most recently used tiles are kept in an LRU cache of at most cache_tiles decoded tiles.
+	// The values are written once, when the matrix is created, and are read-only afterward.  With
+	// single_precision the file holds float32 values, halving its size; tiles are promoted to double
+	// when they are loaded so callers always see double values.
+	// The scratch file is removed when the matrix is destroyed.
+public:
+	TiledMatrix(const std::string &filename, const Eigen::MatrixXd &mat, int64_t tile_cols, int cache_tiles = 4, bool single_precision = false);
+	~TiledMatrix();
+	int64_t rows() const { return n_rows; }
+	int64_t cols() const { return n_cols; }
+	int64_t get_tile_cols() const { return tile_cols; }
+	bool is_single_precision() const { return single_precision; }
+	const std::string& get_filename() const { return mfile.get_filename(); }
+	// the values of col_idxs for row_idxs.  An empty index vector selects all rows or columns
+	Eigen::MatrixXd read(const std::vector<int> &row_idxs, const std::vector<int> &col_idxs);
+private:
+	MappedFile mfile;
+	int64_t n_rows;
+	int64_t n_cols;
+	int64_t tile_cols;
+	int cache_tiles;
+	bool single_precision;
+	std::list<int64_t> lru;
+	std::unordered_map<int64_t, std::pair<Eigen::MatrixXd, std::list<int64_t>::iterator>> cache;
+	std::mutex cache_lock;
+	const Eigen::MatrixXd& get_tile(int64_t itile);
+	TiledMatrix(const TiledMatrix &) = delete;
+	TiledMatrix& operator=(const TiledMatrix &) = delete;
+};
+
+#endif /* TILED_MATRIX_H_ */
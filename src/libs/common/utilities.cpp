@@ -23,6 +23,12 @@
 
 #include "utilities.h"
 #include "system_variables.h"
+#ifdef OS_LINUX
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif
 
 
 using namespace std;
@@ -522,6 +528,101 @@ bool check_exist_out(std::string filename)
 	}
 }
 
+void make_dir(const string &dir_name)
+{
+#ifdef OS_WIN
+	if ((!CreateDirectoryA(dir_name.c_str(), NULL)) && (GetLastError() != ERROR_ALREADY_EXISTS))
+		throw PestError("unable to create directory: " + dir_name);
+#endif
+#ifdef OS_LINUX
+	if ((mkdir(dir_name.c_str(), 0777) != 0) && (errno != EEXIST))
+		throw PestError("unable to create directory: " + dir_name);
+#endif
+}
+
+void copy_dir_contents(const string &src_dir, const string &dest_dir, const vector<string> &skip_prefixes)
+{
+	auto skip = [&skip_prefixes](const string &name)
+	{
+		if (name == "." || name == "..")
+			return true;
+		for (auto &prefix : skip_prefixes)
+		{
+			if (name.compare(0, prefix.size(), prefix) == 0)
+				return true;
+		}
+		return false;
+	};
+	vector<string> sub_dirs;
+#ifdef OS_WIN
+	WIN32_FIND_DATAA find_data;
+	HANDLE h_find = FindFirstFileA((src_dir + "\\*").c_str(), &find_data);
+	if (h_find == INVALID_HANDLE_VALUE)
+		throw PestError("unable to read directory: " + src_dir);
+	do
+	{
+		string name(find_data.cFileName);
+		if (skip(name))
+			continue;
+		string src = src_dir + "\\" + name;
+		string dest = dest_dir + "\\" + name;
+		if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			sub_dirs.push_back(name);
+		}
+		else if (!CopyFileA(src.c_str(), dest.c_str(), FALSE))
+		{
+			FindClose(h_find);
+			throw PestError("unable to copy file " + src + " to " + dest);
+		}
+	} while (FindNextFileA(h_find, &find_data));
+	FindClose(h_find);
+#endif
+#ifdef OS_LINUX
+	DIR *dir = opendir(src_dir.c_str());
+	if (dir == NULL)
+		throw PestError("unable to read directory: " + src_dir);
+	struct dirent *entry;
+	while ((entry = readdir(dir)) != NULL)
+	{
+		string name(entry->d_name);
+		if (skip(name))
+			continue;
+		string src = src_dir + "/" + name;
+		string dest = dest_dir + "/" + name;
+		struct stat src_stat;
+		if (stat(src.c_str(), &src_stat) != 0)
+			continue;
+		if (S_ISDIR(src_stat.st_mode))
+		{
+			sub_dirs.push_back(name);
+		}
+		else if (S_ISREG(src_stat.st_mode))
+		{
+			ifstream f_in(src, ios::binary);
+			ofstream f_out(dest, ios::binary | ios::trunc);
+			//inserting the buffer of an empty file sets the failbit, so only copy non-empty files
+			if ((!f_in) || (!f_out) || ((src_stat.st_size > 0) && (!(f_out << f_in.rdbuf()))))
+			{
+				closedir(dir);
+				throw PestError("unable to copy file " + src + " to " + dest);
+			}
+			f_out.close();
+			//keep the permissions so model executables and scripts can still be run
+			chmod(dest.c_str(), src_stat.st_mode & 0777);
+		}
+	}
+	closedir(dir);
+#endif
+	for (auto &name : sub_dirs)
+	{
+		string src = src_dir + OperSys::DIR_SEP + name;
+		string dest = dest_dir + OperSys::DIR_SEP + name;
+		make_dir(dest);
+		copy_dir_contents(src, dest);
+	}
+}
+
 thread_flag::thread_flag(bool _flag)
 {
 	flag = _flag;
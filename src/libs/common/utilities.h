@@ -229,6 +229,14 @@ bool check_exist_in(std::string filename);
 
 bool check_exist_out(std::string filename);
 
+// create directory dir_name.  Does nothing if the directory already exists
+void make_dir(const std::string &dir_name);
+
+// recursively copy the contents of src_dir into dest_dir.  Existing files are overwritten.  Entries of
+// src_dir (but not of its sub directories) whose names start with one of skip_prefixes are not copied
+void copy_dir_contents(const std::string &src_dir, const std::string &dest_dir,
+	const std::vector<std::string> &skip_prefixes = std::vector<std::string>());
+
 //template <class dataType>
 //void read_twocol_ascii_to_map(std::map<std::string, dataType> &result,std::string filename, int header_lines=0, int data_col=1);
 
@@ -11,6 +11,9 @@
 #include <Eigen/Sparse>
 #include <Eigen/IterativeLinearSolvers>
 #include <Eigen/SparseCholesky>
+#include <list>
+#include <mutex>
+#include <algorithm>
 
 #include "SVDPackage.h"
 #include "Pest.h"
@@ -20,6 +23,32 @@
 
 using namespace std;
 
+namespace
+{
+	//sparse Cholesky factors of the most recently factored covariance matrices, most recent first
+	struct CholeskyCacheEntry
+	{
+		vector<string> names;
+		Eigen::SparseMatrix<double> matrix;
+		Eigen::SparseMatrix<double> lower;
+		Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> perm;
+	};
+	const size_t cholesky_cache_size = 4;
+	list<CholeskyCacheEntry> cholesky_cache;
+	mutex cholesky_cache_lock;
+
+	bool same_matrix(const Eigen::SparseMatrix<double> &a, const Eigen::SparseMatrix<double> &b)
+	{
+		//both matrices must be compressed
+		if ((a.rows() != b.rows()) || (a.cols() != b.cols()) || (a.nonZeros() != b.nonZeros()))
+			return false;
+		int64_t nnz = a.nonZeros();
+		return equal(a.outerIndexPtr(), a.outerIndexPtr() + a.outerSize() + 1, b.outerIndexPtr()) &&
+			equal(a.innerIndexPtr(), a.innerIndexPtr() + nnz, b.innerIndexPtr()) &&
+			equal(a.valuePtr(), a.valuePtr() + nnz, b.valuePtr());
+	}
+}
+
 //---------------------------------------
 //Mat constructors
 //---------------------------------------
@@ -1494,15 +1523,74 @@ void Covariance::to_uncertainty_file(const string &filename)
 	}
 }
 
-void Covariance::cholesky()
+double Covariance::get_density()
 {
-	Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> llt;
+	if ((matrix.rows() == 0) || (matrix.cols() == 0))
+		return 0.0;
+	return double(matrix.nonZeros()) / (double(matrix.rows()) * double(matrix.cols()));
+}
+
+bool Covariance::cholesky()
+{
+	Eigen::SparseMatrix<double> key = matrix;
+	key.makeCompressed();
+	{
+		lock_guard<mutex> guard(cholesky_cache_lock);
+		for (auto it = cholesky_cache.begin(); it != cholesky_cache.end(); ++it)
+		{
+			if ((it->names == row_names) && (same_matrix(it->matrix, key)))
+			{
+				lower_cholesky = it->lower;
+				cholesky_perm = it->perm;
+				cholesky_cache.splice(cholesky_cache.begin(), cholesky_cache, it);
+				return true;
+			}
+		}
+	}
+	//SimplicialLLT uses the lower triangle of the matrix and an AMD ordering by default
+	Eigen::SimplicialLLT<Eigen::SparseMatrix<double>> llt(key);
+	if (llt.info() != Eigen::Success)
+		return false;
 	lower_cholesky = llt.matrixL();
+	cholesky_perm = llt.permutationP();
+
+	lock_guard<mutex> guard(cholesky_cache_lock);
+	CholeskyCacheEntry entry;
+	entry.names = row_names;
+	entry.matrix = key;
+	entry.lower = lower_cholesky;
+	entry.perm = cholesky_perm;
+	cholesky_cache.push_front(entry);
+	if (cholesky_cache.size() > cholesky_cache_size)
+		cholesky_cache.pop_back();
+	return true;
+}
+
+Eigen::MatrixXd Covariance::cholesky_project(const Eigen::MatrixXd &z) const
+{
+	//x = P^T * L * z for each draw z, so the rows of z become z * L^T * P
+	if ((lower_cholesky.rows() != z.cols()) || (cholesky_perm.size() != z.cols()))
+		throw runtime_error("Covariance::cholesky_project() error: cholesky() has not been called or z has the wrong number of columns");
+	Eigen::MatrixXd x = z * lower_cholesky.transpose();
+	return x * cholesky_perm;
 }
 
 vector<Eigen::VectorXd> Covariance::draw(int ndraws)
 {
-	throw runtime_error("Covariance::draw() not implemented");
+	//ndraws draws from N(0, C)
+	default_random_engine gen;
+	normal_distribution<double> stanard_normal(0.0, 1.0);
+	if (!cholesky())
+		throw runtime_error("Covariance::draw() error: covariance matrix is not positive definite");
+	Eigen::MatrixXd z(ndraws, row_names.size());
+	for (int i = 0; i < ndraws; i++)
+		for (int j = 0; j < row_names.size(); j++)
+			z(i, j) = stanard_normal(gen);
+	Eigen::MatrixXd x = cholesky_project(z);
+	vector<Eigen::VectorXd> draws;
+	for (int i = 0; i < ndraws; i++)
+		draws.push_back(x.row(i).transpose());
+	return draws;
 }
 
 vector<double> Covariance::standard_normal(default_random_engine gen)
@@ -137,11 +137,20 @@ public:
 
 	vector<Eigen::VectorXd> draw(int ndraws);
 	vector<double> standard_normal(default_random_engine gen);
-	void cholesky();
+	//fraction of the elements of the matrix that are nonzero
+	double get_density();
+	//sparse Cholesky factorization P * C * P^T = L * L^T with a fill-reducing (AMD) ordering P.  The
+	//factors of recently factored matrices are cached on the names and values of the matrix.  Returns
+	//false if the matrix is not positive definite
+	bool cholesky();
+	//transform each row of standard normal values in z into a draw from N(0, C) using the factor
+	//from cholesky()
+	Eigen::MatrixXd cholesky_project(const Eigen::MatrixXd &z) const;
 
 
 private:
 	Eigen::SparseMatrix<double> lower_cholesky;
+	Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int> cholesky_perm;
 };
 
 ostream& operator<< (std::ostream &os, Mat mat);
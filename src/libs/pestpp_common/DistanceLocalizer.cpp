@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include "utilities.h"
+#include "DistanceLocalizer.h"
+
+KDTree::KDTree(const Eigen::MatrixXd &_points) : points(_points)
+{
+	idx.resize(points.rows());
+	split_dims.resize(points.rows(), 0);
+	for (int i = 0; i < idx.size(); i++)
+		idx[i] = i;
+	build(0, idx.size());
+}
+
+void KDTree::build(int lo, int hi)
+{
+	if (hi - lo <= 1)
+		return;
+	//split on the dimension with the largest spread
+	int ndim = points.cols();
+	Eigen::VectorXd mn = points.row(idx[lo]).transpose(), mx = mn;
+	for (int i = lo + 1; i < hi; i++)
+	{
+		mn = mn.cwiseMin(points.row(idx[i]).transpose());
+		mx = mx.cwiseMax(points.row(idx[i]).transpose());
+	}
+	int dim = 0;
+	(mx - mn).maxCoeff(&dim);
+	int mid = lo + (hi - lo) / 2;
+	const Eigen::MatrixXd &p = points;
+	nth_element(idx.begin() + lo, idx.begin() + mid, idx.begin() + hi,
+		[&p, dim](int a, int b) { return p(a, dim) < p(b, dim); });
+	split_dims[mid] = dim;
+	build(lo, mid);
+	build(mid + 1, hi);
+}
+
+void KDTree::radius_search(const double *query, double radius, vector<pair<int, double>> &results) const
+{
+	results.clear();
+	if (idx.size() == 0)
+		return;
+	search(0, idx.size(), query, radius * radius, results);
+}
+
+void KDTree::search(int lo, int hi, const double *query, double radius2, vector<pair<int, double>> &results) const
+{
+	if (hi <= lo)
+		return;
+	int mid = lo + (hi - lo) / 2;
+	int pidx = idx[mid];
+	double d2 = 0.0, d;
+	for (int j = 0; j < points.cols(); j++)
+	{
+		d = points(pidx, j) - query[j];
+		d2 += d * d;
+	}
+	if (d2 <= radius2)
+		results.push_back(pair<int, double>(pidx, sqrt(d2)));
+	if (hi - lo == 1)
+		return;
+	int dim = split_dims[mid];
+	double diff = query[dim] - points(pidx, dim);
+	//search the near side first, the far side only if the splitting plane is within the radius
+	if (diff <= 0.0)
+	{
+		search(lo, mid, query, radius2, results);
+		if (diff * diff <= radius2)
+			search(mid + 1, hi, query, radius2, results);
+	}
+	else
+	{
+		search(mid + 1, hi, query, radius2, results);
+		if (diff * diff <= radius2)
+			search(lo, mid, query, radius2, results);
+	}
+}
+
+
+DistanceLocalizer::DistanceLocalizer(Pest *_pest_scenario_ptr, PerformanceLog *_performance_log)
+{
+	pest_scenario_ptr = _pest_scenario_ptr;
+	performance_log = _performance_log;
+	const PestppOptions &ppo = pest_scenario_ptr->get_pestpp_options();
+	taper = get_taper(ppo.get_ies_loc_taper());
+	radius = ppo.get_ies_loc_radius();
+	if (radius <= 0.0)
+		throw runtime_error("DistanceLocalizer error: 'ies_loc_radius' must be greater than zero");
+	num_threads = max(1, ppo.get_ies_num_threads());
+}
+
+DistanceLocalizer::Taper DistanceLocalizer::get_taper(const string &taper_str)
+{
+	string t = pest_utils::upper_cp(taper_str);
+	if ((t == "GASPARI_COHN") || (t == "GC"))
+		return Taper::GASPARI_COHN;
+	else if (t == "LINEAR")
+		return Taper::LINEAR;
+	else if (t == "BOXCAR")
+		return Taper::BOXCAR;
+	throw runtime_error("DistanceLocalizer error: 'ies_loc_taper' must be 'gaspari_cohn', 'linear' or 'boxcar', not " + taper_str);
+}
+
+double DistanceLocalizer::taper_value(Taper taper, double dist, double radius)
+{
+	if (dist >= radius)
+		return 0.0;
+	switch (taper)
+	{
+	case Taper::BOXCAR:
+		return 1.0;
+	case Taper::LINEAR:
+		return 1.0 - (dist / radius);
+	case Taper::GASPARI_COHN:
+	{
+		//the 5th order piecewise rational of Gaspari and Cohn (1999) with compact support at radius
+		double z = dist / (0.5 * radius);
+		double z2 = z * z, z3 = z2 * z, z4 = z3 * z, z5 = z4 * z;
+		if (z <= 1.0)
+			return (-0.25 * z5) + (0.5 * z4) + (0.625 * z3) - ((5.0 / 3.0) * z2) + 1.0;
+		return ((1.0 / 12.0) * z5) - (0.5 * z4) + (0.625 * z3) + ((5.0 / 3.0) * z2) - (5.0 * z) + 4.0 - (2.0 / (3.0 * z));
+	}
+	}
+	return 0.0;
+}
+
+Eigen::MatrixXd DistanceLocalizer::read_coords(const string &filename, const vector<string> &names, int &ndim)
+{
+	ifstream csv(filename);
+	if (!csv.good())
+		throw runtime_error("DistanceLocalizer error: unable to open coordinate file " + filename);
+	string line;
+	vector<string> tokens;
+	if (!getline(csv, line))
+		throw runtime_error("DistanceLocalizer error: error reading header line of coordinate file " + filename);
+	pest_utils::strip_ip(line);
+	pest_utils::tokenize(line, tokens, ",", false);
+	ndim = tokens.size() - 1;
+	if (ndim < 1)
+		throw runtime_error("DistanceLocalizer error: coordinate file " + filename + " needs a name column and at least one coordinate column");
+
+	unordered_map<string, int> name_idx;
+	for (int i = 0; i < names.size(); i++)
+		name_idx[names[i]] = i;
+	Eigen::MatrixXd coords(names.size(), ndim);
+	vector<bool> found(names.size(), false);
+	unordered_map<string, int>::iterator it, end = name_idx.end();
+	int lcount = 1;
+	while (getline(csv, line))
+	{
+		lcount++;
+		pest_utils::strip_ip(line);
+		if (line.size() == 0)
+			continue;
+		tokens.clear();
+		pest_utils::tokenize(line, tokens, ",", false);
+		if (tokens.size() != ndim + 1)
+		{
+			stringstream ss;
+			ss << "DistanceLocalizer error: wrong number of entries on line " << lcount << " of coordinate file " << filename;
+			throw runtime_error(ss.str());
+		}
+		pest_utils::strip_ip(tokens[0]);
+		pest_utils::upper_ip(tokens[0]);
+		//names that are not adjustable/non-zero weight are skipped
+		if ((it = name_idx.find(tokens[0])) == end)
+			continue;
+		for (int j = 0; j < ndim; j++)
+		{
+			try
+			{
+				coords(it->second, j) = pest_utils::convert_cp<double>(pest_utils::strip_cp(tokens[j + 1]));
+			}
+			catch (...)
+			{
+				stringstream ss;
+				ss << "DistanceLocalizer error: error converting coordinate '" << tokens[j + 1] << "' on line " << lcount << " of coordinate file " << filename;
+				throw runtime_error(ss.str());
+			}
+		}
+		found[it->second] = true;
+	}
+	stringstream ss;
+	int nmissing = 0;
+	for (int i = 0; i < names.size(); i++)
+		if (!found[i])
+		{
+			ss << names[i] << ',';
+			nmissing++;
+		}
+	if (nmissing > 0)
+		throw runtime_error("DistanceLocalizer error: the following names were not found in coordinate file " + filename + ": " + ss.str());
+	return coords;
+}
+
+Mat DistanceLocalizer::generate()
+{
+	stringstream ss;
+	const PestppOptions &ppo = pest_scenario_ptr->get_pestpp_options();
+	vector<string> par_names = pest_scenario_ptr->get_ctl_ordered_adj_par_names();
+	vector<string> obs_names = pest_scenario_ptr->get_ctl_ordered_nz_obs_names();
+	int par_ndim, obs_ndim;
+	performance_log->log_event("reading localizer par coordinates from " + ppo.get_ies_loc_par_coords());
+	Eigen::MatrixXd par_coords = read_coords(ppo.get_ies_loc_par_coords(), par_names, par_ndim);
+	performance_log->log_event("reading localizer obs coordinates from " + ppo.get_ies_loc_obs_coords());
+	Eigen::MatrixXd obs_coords = read_coords(ppo.get_ies_loc_obs_coords(), obs_names, obs_ndim);
+	if (par_ndim != obs_ndim)
+	{
+		ss << "DistanceLocalizer error: par coordinates have " << par_ndim << " dimensions but obs coordinates have " << obs_ndim;
+		throw runtime_error(ss.str());
+	}
+
+	performance_log->log_event("building k-d tree of obs coordinates");
+	KDTree tree(obs_coords);
+	obs_coords.resize(0, 0);
+
+	//each thread takes blocks of pars and collects its own triplets
+	performance_log->log_event("generating distance-based localizer coefficients");
+	int npar = par_names.size();
+	const int block_size = 256;
+	atomic<int> next_block(0);
+	vector<vector<Eigen::Triplet<double>>> thread_triplets(num_threads);
+	vector<exception_ptr> eptrs(num_threads);
+	Taper _taper = taper;
+	double _radius = radius;
+	auto worker = [&](int tid)
+	{
+		try
+		{
+			vector<pair<int, double>> neighbors;
+			Eigen::VectorXd query(par_coords.cols());
+			while (true)
+			{
+				int start = (next_block++) * block_size;
+				if (start >= npar)
+					return;
+				int end = min(npar, start + block_size);
+				for (int j = start; j < end; j++)
+				{
+					query = par_coords.row(j).transpose();
+					tree.radius_search(query.data(), _radius, neighbors);
+					for (auto &n : neighbors)
+					{
+						double val = taper_value(_taper, n.second, _radius);
+						if (val != 0.0)
+							thread_triplets[tid].push_back(Eigen::Triplet<double>(n.first, j, val));
+					}
+				}
+			}
+		}
+		catch (...)
+		{
+			eptrs[tid] = current_exception();
+		}
+	};
+	vector<thread> threads;
+	for (int i = 1; i < num_threads; i++)
+		threads.push_back(thread(worker, i));
+	worker(0);
+	for (auto &t : threads)
+		t.join();
+	for (auto &eptr : eptrs)
+		if (eptr)
+			rethrow_exception(eptr);
+
+	size_t nnz = 0;
+	for (auto &t : thread_triplets)
+		nnz += t.size();
+	vector<Eigen::Triplet<double>> triplets;
+	triplets.reserve(nnz);
+	for (auto &t : thread_triplets)
+	{
+		triplets.insert(triplets.end(), t.begin(), t.end());
+		t.clear();
+		t.shrink_to_fit();
+	}
+	Eigen::SparseMatrix<double> loc(obs_names.size(), npar);
+	loc.setFromTriplets(triplets.begin(), triplets.end());
+	triplets.clear();
+	triplets.shrink_to_fit();
+
+	int empty_pars = 0;
+	for (int j = 0; j < loc.outerSize(); j++)
+		if (loc.col(j).nonZeros() == 0)
+			empty_pars++;
+	ss.str("");
+	ss << "distance-based localizer: " << loc.nonZeros() << " non-zero coefficients (density ";
+	ss << double(loc.nonZeros()) / (double(max(1, loc.rows())) * double(max(1, loc.cols()))) << ")";
+	if (empty_pars > 0)
+		ss << ", " << empty_pars << " pars have no obs within ies_loc_radius";
+	performance_log->log_event(ss.str());
+	return Mat(obs_names, par_names, loc);
+}
@@ -0,0 +1,51 @@
+#ifndef DISTANCELOCALIZER_H_
+#define DISTANCELOCALIZER_H_
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <Eigen/Dense>
+#include <Eigen/Sparse>
+#include "Pest.h"
+#include "covariance.h"
+#include "PerformanceLog.h"
+
+//a static k-d tree over a set of points (one point per row) that answers radius queries
+class KDTree
+{
+public:
+	KDTree() { ; }
+	KDTree(const Eigen::MatrixXd &_points);
+	//the (point index, distance) pairs of all points within radius of the query point
+	void radius_search(const double *query, double radius, vector<pair<int, double>> &results) const;
+	int size() const { return points.rows(); }
+private:
+	Eigen::MatrixXd points;
+	//the point index at each node - the tree is implicit in this ordering: the node
+	//for [lo,hi) sits at the median and its children cover [lo,mid) and (mid,hi)
+	vector<int> idx;
+	vector<int> split_dims;
+	void build(int lo, int hi);
+	void search(int lo, int hi, const double *query, double radius2, vector<pair<int, double>> &results) const;
+};
+
+//builds a sparse (nz obs by adj par) localizer from par and obs coordinates and a distance taper
+class DistanceLocalizer
+{
+public:
+	enum class Taper { GASPARI_COHN, LINEAR, BOXCAR };
+	DistanceLocalizer(Pest *_pest_scenario_ptr, PerformanceLog *_performance_log);
+	Mat generate();
+	static Taper get_taper(const string &taper_str);
+	static double taper_value(Taper taper, double dist, double radius);
+
+private:
+	Pest *pest_scenario_ptr;
+	PerformanceLog *performance_log;
+	Taper taper;
+	double radius;
+	int num_threads;
+	Eigen::MatrixXd read_coords(const string &filename, const vector<string> &names, int &ndim);
+};
+
+#endif
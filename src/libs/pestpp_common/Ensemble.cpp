@@ -1,7 +1,16 @@
 #include <random>
+#include <array>
 #include <iomanip>
 #include <unordered_set>
 #include <iterator>
+#include <numeric>
+#include <unordered_map>
+#include <thread>
+#include <exception>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
 #include "Ensemble.h"
 #include "RestartController.h"
 #include "utilities.h"
@@ -11,6 +20,94 @@
 #include "covariance.h"
 #include "PerformanceLog.h"
 #include "system_variables.h"
+#include "mapped_file.h"
+#include "dense_binary.h"
+#include "counter_rng.h"
+
+//csv files are split into chunks of at least this many bytes for concurrent reading and writing
+const size_t csv_min_chunk_bytes = 4 * 1024 * 1024;
+
+static int num_worker_threads(size_t work_size, size_t min_work_per_thread)
+{
+	//one thread per processor but no more threads than chunks of min_work_per_thread
+	size_t n = work_size / max(min_work_per_thread, size_t(1));
+	return (int)max(min(n, size_t(max((int)thread::hardware_concurrency(), 1))), size_t(1));
+}
+
+template<typename Func>
+void run_worker_threads(int num_threads, Func func)
+{
+	//call func(i) for i in [0, num_threads) concurrently and rethrow the first exception raised
+	if (num_threads <= 1)
+	{
+		func(0);
+		return;
+	}
+	vector<thread> threads;
+	vector<exception_ptr> exceptions(num_threads);
+	for (int i = 0; i < num_threads; i++)
+	{
+		threads.push_back(thread([&func, &exceptions, i]()
+		{
+			try
+			{
+				func(i);
+			}
+			catch (...)
+			{
+				exceptions[i] = current_exception();
+			}
+		}));
+	}
+	for (auto &t : threads)
+		t.join();
+	for (auto &e : exceptions)
+		if (e)
+			rethrow_exception(e);
+}
+
+//the parallel draws are split into blocks of at least this many values per thread
+const size_t draw_min_values_per_thread = 64 * 1024;
+//and project at most this many standard normal values at a time
+const size_t draw_max_chunk_values = 4 * 1024 * 1024;
+
+template<typename Func>
+void counter_normals(const CounterRNG &rng, int j, int r0, int r1, Func func)
+{
+	//call func(i, z) with the standard normal value z of realization i in [r0, r1) for draw variable j.
+	//z only depends on the seed of rng, i and j; realizations 2k and 2k+1 share one Box-Muller pair
+	double z[2];
+	for (int k = r0 / 2; 2 * k < r1; k++)
+	{
+		rng.normal_pair(k, j, z[0], z[1]);
+		for (int l = 0; l < 2; l++)
+		{
+			int i = 2 * k + l;
+			if ((i >= r0) && (i < r1))
+				func(i, z[l]);
+		}
+	}
+}
+
+static bool try_cholesky_draw(Covariance &cov, double max_density)
+{
+	//draw from the sparse Cholesky factor if the covariance is sparse enough and positive definite,
+	//otherwise the caller falls back to the eigen decomposition
+	return (max_density > 0.0) && (cov.get_density() <= max_density) && cov.cholesky();
+}
+
+static int format_csv_double(double val, char *buf, size_t buf_size)
+{
+	//the shortest of 15, 16 or 17 significant digits that reads back to val
+	int len = 0;
+	for (int precision = 15; precision <= 17; precision++)
+	{
+		len = snprintf(buf, buf_size, "%.*g", precision, val);
+		if (strtod(buf, nullptr) == val)
+			break;
+	}
+	return len;
+}
 
 mt19937_64 Ensemble::rand_engine = mt19937_64(1);
 
@@ -48,6 +145,7 @@ void Ensemble::check_for_dups()
 
 void Ensemble::reserve(vector<string> _real_names, vector<string> _var_names)
 {
+	disk_reals.reset();
 	reals.resize(_real_names.size(), _var_names.size());
 	var_names = _var_names;
 	real_names = _real_names;
@@ -64,6 +162,7 @@ Ensemble Ensemble::zero_like()
 
 void Ensemble::add_2_cols_ip(const vector<string> &other_var_names, const Eigen::MatrixXd &mat)
 {
+	to_memory();
 	
 	if (shape().first != mat.rows())
 		throw_ensemble_error("Ensemble::add_2_cols_ip(): first dimensions don't match");
@@ -114,6 +213,11 @@ void Ensemble::draw(int num_reals, Covariance cov, Transformable &tran, const ve
 	const map<string, vector<string>> &grouper, PerformanceLog *plog, int level)
 {
 	//draw names should be "active" var_names (nonzero weight obs and not fixed/tied pars)
+	if (pest_scenario_ptr->get_pestpp_options().get_ies_parallel_draws())
+	{
+		draw_parallel(num_reals, cov, tran, draw_names, grouper, plog, level);
+		return;
+	}
 	//just a quick sanity check...
 	//if ((draw_names.size() > 50000) && (!cov.isdiagonal()))
 	//	cout << "  ---  Ensemble::draw() warning: non-diagonal cov used to draw for lots of variables...this might run out of memory..." << endl << endl;
@@ -137,6 +241,7 @@ void Ensemble::draw(int num_reals, Covariance cov, Transformable &tran, const ve
 	}
 
 	Eigen::VectorXd std = cov.e_ptr()->diagonal().cwiseSqrt();
+	double chol_density = pest_scenario_ptr->get_pestpp_options().get_ies_cholesky_max_density();
 	//if diagonal cov, then scale by std
 	if (cov.isdiagonal())
 	{
@@ -202,6 +307,14 @@ void Ensemble::draw(int num_reals, Covariance cov, Transformable &tran, const ve
 				ss << "min variance for group " << gi.first << ": " << fac;
 				plog->log_event(ss.str());
 				Eigen::MatrixXd block = draws.block(0, idx[0], num_reals, idx.size());
+				if (try_cholesky_draw(gcov, chol_density))
+				{
+					ss.str("");
+					ss << "sparse Cholesky projection of group block, density: " << gcov.get_density();
+					plog->log_event(ss.str());
+					draws.block(0, idx[0], num_reals, idx.size()) = gcov.cholesky_project(block);
+					continue;
+				}
 				ss.str("");
 				ss << "Randomized Eigen decomposition of full cov for " << gi.second.size() << " element matrix" << endl;
 				plog->log_event(ss.str());
@@ -236,6 +349,13 @@ void Ensemble::draw(int num_reals, Covariance cov, Transformable &tran, const ve
 
 			}
 		}
+		else if (try_cholesky_draw(cov, chol_density))
+		{
+			stringstream ss;
+			ss << "sparse Cholesky projection of realizations, density: " << cov.get_density();
+			plog->log_event(ss.str());
+			draws = cov.cholesky_project(draws);
+		}
 		else
 		{
 			int ncomps = draw_names.size();
@@ -310,6 +430,7 @@ void Ensemble::draw(int num_reals, Covariance cov, Transformable &tran, const ve
 
 	//add the mean values - using the Transformable instance (initial par value or observed value)
 	plog->log_event("resizing reals matrix");
+	disk_reals.reset();
 	reals.resize(num_reals, var_names.size());
 	reals.setZero(); // zero-weighted obs and fixed/tied pars get zero values here.
 	plog->log_event("filling reals matrix and adding mean values");
@@ -341,9 +462,231 @@ void Ensemble::draw(int num_reals, Covariance cov, Transformable &tran, const ve
 	}
 }
 
+void Ensemble::draw_parallel(int num_reals, Covariance &cov, Transformable &tran, const vector<string> &draw_names,
+	const map<string, vector<string>> &grouper, PerformanceLog *plog, int level)
+{
+	//draw engine for ies_parallel_draws.  The standard normal value of realization i and draw variable j
+	//comes from a counter-based generator and only depends on (seed, i, j), so the covariance blocks and
+	//realizations can be processed concurrently, in any order, and give the same values for any number of
+	//threads.  The normals are generated one block at a time and the projected values are written
+	//straight into reals - there is no num_reals by draw_names matrix of standard normal values.
+	//Groups do not need to be contiguous in draw_names; draw names that are not in a group are drawn
+	//from their variance
+	if (cov.get_col_names() != draw_names)
+		cov = cov.get(draw_names);
+	CounterRNG rng(rand_engine());
+	int ndraw = draw_names.size();
+
+	real_names.clear();
+	stringstream ss;
+	for (int i = 0; i < num_reals; i++)
+	{
+		ss.str("");
+		ss << i;
+		real_names.push_back(ss.str());
+	}
+	plog->log_event("resizing reals matrix");
+	disk_reals.reset();
+	reals.resize(num_reals, var_names.size());
+	reals.setZero(); // zero-weighted obs and fixed/tied pars get zero values here.
+
+	//the reals column and mean value of each draw name.  Draw names that are not in var_names are skipped
+	unordered_map<string, int> col_map;
+	for (int j = 0; j < var_names.size(); j++)
+		col_map[var_names[j]] = j;
+	vector<int> draw_cols(ndraw, -1);
+	vector<double> draw_means(ndraw, 0.0);
+	for (int j = 0; j < ndraw; j++)
+	{
+		auto found = col_map.find(draw_names[j]);
+		if (found == col_map.end())
+			continue;
+		draw_cols[j] = found->second;
+		draw_means[j] = tran.get_rec(draw_names[j]);
+	}
+	Eigen::VectorXd std = cov.e_ptr()->diagonal().cwiseSqrt();
+	int num_threads = num_worker_threads(size_t(num_reals) * ndraw, draw_min_values_per_thread);
+
+	if (cov.isdiagonal())
+	{
+		//fused draw, scale and shift, one column at a time
+		plog->log_event("drawing and scaling by std");
+		run_worker_threads(num_threads, [&](int ithread)
+		{
+			for (int j = ithread; j < ndraw; j += num_threads)
+			{
+				if (draw_cols[j] < 0)
+					continue;
+				double *col = reals.col(draw_cols[j]).data();
+				double s = std(j), m = draw_means[j];
+				counter_normals(rng, j, 0, num_reals, [&](int i, double z) { col[i] = m + s * z; });
+			}
+		});
+	}
+	else
+	{
+		//the draw name indices of each block: one per group (or a single block) plus one per ungrouped name
+		vector<vector<int>> block_idxs;
+		vector<string> block_names;
+		if (grouper.size() > 0)
+		{
+			cout << "...drawing by group" << endl;
+			unordered_map<string, int> draw_map;
+			for (int j = 0; j < ndraw; j++)
+				draw_map[draw_names[j]] = j;
+			vector<bool> grouped(ndraw, false);
+			for (auto &gi : grouper)
+			{
+				vector<int> idxs;
+				for (auto &name : gi.second)
+				{
+					auto found = draw_map.find(name);
+					if ((found != draw_map.end()) && (!grouped[found->second]))
+					{
+						idxs.push_back(found->second);
+						grouped[found->second] = true;
+					}
+				}
+				if (idxs.size() == 0)
+					continue;
+				block_idxs.push_back(idxs);
+				block_names.push_back(gi.first);
+			}
+			for (int j = 0; j < ndraw; j++)
+				if (!grouped[j])
+				{
+					block_idxs.push_back(vector<int>(1, j));
+					block_names.push_back(draw_names[j]);
+				}
+		}
+		else
+		{
+			block_idxs.push_back(vector<int>(ndraw));
+			iota(block_idxs[0].begin(), block_idxs[0].end(), 0);
+			block_names.push_back("cov");
+		}
+
+		//projection matrix (or sparse Cholesky factor) of each block, largest blocks first
+		vector<Eigen::MatrixXd> projs(block_idxs.size());
+		vector<int> order(block_idxs.size());
+		iota(order.begin(), order.end(), 0);
+		sort(order.begin(), order.end(), [&](int a, int b) { return block_idxs[a].size() > block_idxs[b].size(); });
+		vector<Covariance> block_covs(block_idxs.size());
+		vector<int> use_chol(block_idxs.size(), 0);
+		for (int b = 0; b < block_idxs.size(); b++)
+		{
+			if (block_idxs[b].size() == 1)
+				continue;
+			vector<string> names;
+			for (auto j : block_idxs[b])
+				names.push_back(draw_names[j]);
+			block_covs[b] = cov.get(names);
+		}
+		double chol_density = pest_scenario_ptr->get_pestpp_options().get_ies_cholesky_max_density();
+		ss.str("");
+		ss << "sparse Cholesky or randomized Eigen decomposition of " << block_idxs.size() << " covariance blocks";
+		plog->log_event(ss.str());
+		int num_eig_threads = min(max((int)thread::hardware_concurrency(), 1), (int)block_idxs.size());
+		run_worker_threads(num_eig_threads, [&](int ithread)
+		{
+			for (int o = ithread; o < order.size(); o += num_eig_threads)
+			{
+				int b = order[o];
+				if (block_idxs[b].size() == 1)
+				{
+					projs[b] = Eigen::MatrixXd::Constant(1, 1, std(block_idxs[b][0]));
+					continue;
+				}
+				if (try_cholesky_draw(block_covs[b], chol_density))
+				{
+					use_chol[b] = 1;
+					continue;
+				}
+				const Eigen::SparseMatrix<double> *bcov = block_covs[b].e_ptr();
+				double fac = bcov->diagonal().minCoeff();
+				RedSVD::RedSymEigen<Eigen::SparseMatrix<double>> eig(*bcov * (1.0 / fac), block_idxs[b].size());
+				projs[b] = eig.eigenvectors() * (fac * eig.eigenvalues()).cwiseSqrt().asDiagonal();
+				block_covs[b] = Covariance();
+			}
+		});
+		if (level > 2)
+		{
+			for (int b = 0; b < block_idxs.size(); b++)
+			{
+				if ((block_idxs[b].size() == 1) || (use_chol[b]))
+					continue;
+				ofstream f(block_names[b] + "_proj.dat");
+				f << projs[b] << endl;
+				f.close();
+			}
+		}
+
+		//project chunks of realizations of each block.  Chunks hold an even number of realizations so a
+		//Box-Muller pair is never split across chunks
+		//(block, first realization, end realization) of each piece of work
+		vector<array<int, 3>> work;
+		for (auto b : order)
+		{
+			int chunk_rows = max(2, (int)min((size_t)num_reals, draw_max_chunk_values / block_idxs[b].size()));
+			chunk_rows += chunk_rows % 2;
+			for (int r0 = 0; r0 < num_reals; r0 += chunk_rows)
+				work.push_back(array<int, 3>{ {b, r0, min(r0 + chunk_rows, num_reals)} });
+		}
+		plog->log_event("drawing and projecting realizations");
+		int num_proj_threads = max(min(num_threads, (int)work.size()), 1);
+		run_worker_threads(num_proj_threads, [&](int ithread)
+		{
+			Eigen::MatrixXd z, proj_z;
+			for (int w = ithread; w < work.size(); w += num_proj_threads)
+			{
+				const vector<int> &idxs = block_idxs[work[w][0]];
+				int r0 = work[w][1], r1 = work[w][2];
+				z.resize(r1 - r0, idxs.size());
+				for (int jj = 0; jj < idxs.size(); jj++)
+					counter_normals(rng, idxs[jj], r0, r1, [&](int i, double val) { z(i - r0, jj) = val; });
+				if (use_chol[work[w][0]])
+					proj_z = block_covs[work[w][0]].cholesky_project(z);
+				else
+					proj_z.noalias() = z * projs[work[w][0]].transpose();
+				for (int jj = 0; jj < idxs.size(); jj++)
+				{
+					int c = draw_cols[idxs[jj]];
+					if (c < 0)
+						continue;
+					reals.col(c).segment(r0, r1 - r0).array() = proj_z.col(jj).array() + draw_means[idxs[jj]];
+				}
+			}
+		});
+	}
+
+	//check for invalid values
+	plog->log_event("checking realization for invalid values");
+	bool found_invalid = false;
+	for (int j = 0; j < ndraw; j++)
+	{
+		if (draw_cols[j] < 0)
+			continue;
+		int iv = 0;
+		for (int i = 0; i < num_reals; i++)
+			if (OperSys::double_is_invalid(reals(i, draw_cols[j])))
+				iv++;
+		if (iv > 0)
+		{
+			found_invalid = true;
+			if (level > 2)
+				cout << iv << " invalid values found for " << draw_names[j] << endl;
+		}
+	}
+	if (found_invalid)
+	{
+		to_csv("trouble.csv");
+		throw_ensemble_error("invalid values in realization draws - trouble.csv written");
+	}
+}
 
 Covariance Ensemble::get_diagonal_cov_matrix()
 {
+	to_memory();
 	//build an empirical diagonal covariance matrix from the realizations
 
 
@@ -386,7 +729,7 @@ Eigen::MatrixXd Ensemble::get_eigen_mean_diff(const vector<string> &_real_names,
 	//the new Eigen matrix
 	Eigen::MatrixXd _reals;
 	if ((_real_names.size() == 0) && (_var_names.size() == 0))
-		_reals = reals;
+		_reals = disk_reals ? read_disk(vector<int>(), vector<int>()) : reals;
 	else
 		_reals = get_eigen(_real_names, _var_names);
 
@@ -406,6 +749,7 @@ Eigen::MatrixXd Ensemble::get_eigen_mean_diff(const vector<string> &_real_names,
 
 vector<double> Ensemble::get_mean_stl_vector()
 {
+	to_memory();
 	vector<double> mean_vec;
 	mean_vec.reserve(var_names.size());
 	for (int j = 0; j < reals.cols(); j++)
@@ -420,7 +764,7 @@ pair<map<string, double>, map<string, double>>  Ensemble::get_moment_maps(const
 	Eigen::VectorXd mean, std;
 	if (_real_names.size() == 0)
 	{
-		mean = reals.colwise().mean();
+		mean = disk_reals ? read_disk(vector<int>(), vector<int>()).colwise().mean() : reals.colwise().mean();
 		Eigen::MatrixXd mean_diff = get_eigen_mean_diff();
 		std = mean_diff.array().pow(2).colwise().sum().sqrt();
 	}
@@ -432,7 +776,7 @@ pair<map<string, double>, map<string, double>>  Ensemble::get_moment_maps(const
 	}
 	map<string, double> mean_map, std_map;
 	string name;
-	for (int i = 0; i < reals.cols(); i++)
+	for (int i = 0; i < var_names.size(); i++)
 	{
 		name = var_names[i];
 		mean_map[name] = mean[i];
@@ -456,6 +800,7 @@ void Ensemble::from_eigen_mat(Eigen::MatrixXd _reals, const vector<string> &_rea
 		throw_ensemble_error("Ensemble.from_eigen_mat() rows != real_names.size");
 	if (_reals.cols() != _var_names.size())
 		throw_ensemble_error("Ensemble.from_eigen_mat() cols != var_names.size");
+	disk_reals.reset();
 	reals = _reals;
 	var_names = _var_names;
 	real_names = _real_names;
@@ -468,6 +813,7 @@ void Ensemble::set_eigen(Eigen::MatrixXd _reals)
 		throw_ensemble_error("Ensemble.set_reals() rows != real_names.size");
 	if (_reals.cols() != var_names.size())
 		throw_ensemble_error("Ensemble.set_reals() cols != var_names.size");
+	disk_reals.reset();
 	reals = _reals;
 }
 
@@ -475,7 +821,15 @@ void Ensemble::set_eigen(Eigen::MatrixXd _reals)
 void Ensemble::reorder(const vector<string> &_real_names, const vector<string> &_var_names)
 {
 	//reorder inplace
-	reals = get_eigen(_real_names, _var_names);
+	if (disk_reals)
+	{
+		if (_real_names.size() != 0)
+			keep_disk_rows(_real_names);
+		if (_var_names.size() != 0)
+			reorder_disk_cols(_var_names);
+	}
+	else
+		reals = get_eigen(_real_names, _var_names);
 	if (_var_names.size() != 0)
 		var_names = _var_names;
 	if (_real_names.size() != 0)
@@ -486,10 +840,12 @@ void Ensemble::drop_rows(const vector<int> &row_idxs)
 {
 	vector<int>::const_iterator start = row_idxs.begin(), end = row_idxs.end();
 	vector<string> keep_names;
-	for (int ireal = 0; ireal < reals.rows(); ireal++)
+	for (int ireal = 0; ireal < real_names.size(); ireal++)
 		if (find(start, end, ireal) == end)
 			keep_names.push_back(real_names[ireal]);
-	if (keep_names.size() == 0)
+	if (disk_reals)
+		keep_disk_rows(keep_names);
+	else if (keep_names.size() == 0)
 		reals = Eigen::MatrixXd();
 	else
 		reals = get_eigen(keep_names, vector<string>());
@@ -503,7 +859,9 @@ void Ensemble::drop_rows(const vector<string> &drop_names)
 	for (auto &n : real_names)
 		if (find(start, end, n) == end)
 			keep_names.push_back(n);
-	if (keep_names.size() == 0)
+	if (disk_reals)
+		keep_disk_rows(keep_names);
+	else if (keep_names.size() == 0)
 		reals = Eigen::MatrixXd();
 	else
 		reals = get_eigen(keep_names, vector<string>());
@@ -516,10 +874,13 @@ void Ensemble::keep_rows(const vector<int> &row_idxs)
 {
 	vector<int>::const_iterator start = row_idxs.begin(), end = row_idxs.end();
 	vector<string> keep_names;
-	for (int ireal = 0; ireal < reals.rows(); ireal++)
+	for (int ireal = 0; ireal < real_names.size(); ireal++)
 		if (find(start, end, ireal) != end)
 			keep_names.push_back(real_names[ireal]);
-	reals = get_eigen(keep_names, vector<string>());
+	if (disk_reals)
+		keep_disk_rows(keep_names);
+	else
+		reals = get_eigen(keep_names, vector<string>());
 	real_names = keep_names;
 }
 
@@ -533,7 +894,10 @@ void Ensemble::keep_rows(const vector<string> &keep_names)
 			missing.push_back(n);
 	if (missing.size() > 0)
 		throw_ensemble_error("Ensemble::keep_rows() error: the following real names not found: ", missing);
-	reals = get_eigen(keep_names, vector<string>());
+	if (disk_reals)
+		keep_disk_rows(keep_names);
+	else
+		reals = get_eigen(keep_names, vector<string>());
 	real_names = keep_names;
 }
 
@@ -584,6 +948,12 @@ Eigen::MatrixXd Ensemble::get_eigen(vector<string> row_names, vector<string> col
 			throw_ensemble_error("Ensemble.get_eigen() error: the following variable names were not found:", missing);
 	}
 
+	if (disk_reals)
+	{
+		if ((row_names.size() == 0) && (col_names.size() == 0))
+			return Eigen::MatrixXd(real_names.size(), 0);
+		return read_disk(row_idxs, col_idxs);
+	}
 
 	Eigen::MatrixXd mat;
 
@@ -648,20 +1018,10 @@ void Ensemble::to_csv(string file_name)
 	{
 		throw_ensemble_error("Ensemble.to_csv() error opening csv file " + file_name + " for writing");
 	}
-	csv << "real_name";
-	for (auto &vname : var_names)
-		csv << ',' << vname;
-	csv << endl;
-	for (int ireal = 0; ireal < reals.rows(); ireal++)
-	{
-		csv << real_names[ireal];
-		for (int ivar=0; ivar < reals.cols(); ivar++)
-		{
-			csv << ',' << reals.block(ireal, ivar,1,1);
-		}
-		csv << endl;
-	}
-
+	if (disk_reals)
+		write_csv(csv, var_names, real_names, read_disk(vector<int>(), vector<int>()));
+	else
+		write_csv(csv, var_names, real_names, reals);
 }
 
 const vector<string> Ensemble::get_real_names(vector<int> &indices)
@@ -684,6 +1044,8 @@ Eigen::VectorXd Ensemble::get_real_vector(int ireal)
 		ss << "Ensemble::get_real_vector() : ireal (" << ireal << ") >= reals.shape[0] (" << ireal << ")";
 		throw_ensemble_error(ss.str());
 	}
+	if (disk_reals)
+		return read_disk(vector<int>(1, ireal), vector<int>()).row(0);
 	return reals.row(ireal);
 }
 
@@ -707,6 +1069,102 @@ void Ensemble::update_var_map()
 		var_map[var_names[i]] = i;
 }
 
+pair<int, int> Ensemble::shape()
+{
+	if (disk_reals)
+		return pair<int, int>(disk_rows.size(), disk_cols.size());
+	return pair<int, int>(reals.rows(), reals.cols());
+}
+
+void Ensemble::to_disk(const string &file_name, int tile_cols, bool single_precision)
+{
+	to_memory();
+	disk_reals = make_shared<TiledMatrix>(file_name, reals, tile_cols, 4, single_precision);
+	disk_rows.resize(reals.rows());
+	iota(disk_rows.begin(), disk_rows.end(), 0);
+	disk_cols.resize(reals.cols());
+	iota(disk_cols.begin(), disk_cols.end(), 0);
+	reals.resize(0, 0);
+}
+
+void Ensemble::to_memory()
+{
+	if (!disk_reals)
+		return;
+	reals = read_disk(vector<int>(), vector<int>());
+	disk_reals.reset();
+	disk_rows.clear();
+	disk_cols.clear();
+}
+
+Eigen::MatrixXd Ensemble::read_disk(const vector<int> &row_idxs, const vector<int> &col_idxs) const
+{
+	//the values of the ensemble rows and columns row_idxs and col_idxs, empty selects all
+	vector<int> file_rows = disk_rows, file_cols = disk_cols;
+	if (row_idxs.size() > 0)
+	{
+		file_rows.clear();
+		for (auto i : row_idxs)
+			file_rows.push_back(disk_rows[i]);
+	}
+	if (col_idxs.size() > 0)
+	{
+		file_cols.clear();
+		for (auto j : col_idxs)
+			file_cols.push_back(disk_cols[j]);
+	}
+	//an empty index vector means all to TiledMatrix::read()
+	if ((file_rows.size() == 0) || (file_cols.size() == 0))
+		return Eigen::MatrixXd(file_rows.size(), file_cols.size());
+	return disk_reals->read(file_rows, file_cols);
+}
+
+void Ensemble::keep_disk_rows(const vector<string> &keep_names)
+{
+	//select the scratch file rows of keep_names, in keep_names order
+	unordered_map<string, int> real_map;
+	for (int i = 0; i < real_names.size(); i++)
+		real_map[real_names[i]] = i;
+	vector<int> new_rows;
+	vector<string> missing;
+	for (auto &name : keep_names)
+	{
+		auto found = real_map.find(name);
+		if (found == real_map.end())
+			missing.push_back(name);
+		else
+			new_rows.push_back(disk_rows[found->second]);
+	}
+	if (missing.size() > 0)
+		throw_ensemble_error("Ensemble.keep_disk_rows() error: the following realization names were not found:", missing);
+	disk_rows = new_rows;
+}
+
+void Ensemble::reorder_disk_cols(const vector<string> &_var_names)
+{
+	//select the scratch file columns of _var_names, in _var_names order
+	update_var_map();
+	vector<int> new_cols;
+	vector<string> missing;
+	for (auto &name : _var_names)
+	{
+		auto found = var_map.find(name);
+		if (found == var_map.end())
+			missing.push_back(name);
+		else
+			new_cols.push_back(disk_cols[found->second]);
+	}
+	if (missing.size() > 0)
+		throw_ensemble_error("Ensemble.reorder_disk_cols() error: the following variable names were not found:", missing);
+	disk_cols = new_cols;
+}
+
+void Ensemble::check_in_memory(const string &caller) const
+{
+	if (disk_reals)
+		throw runtime_error("Ensemble Error: Ensemble::" + caller + " is not available while the ensemble is stored on disk");
+}
+
 void Ensemble::throw_ensemble_error(string message, vector<string> vec)
 {
 	stringstream ss;
@@ -794,6 +1252,7 @@ map<string,int> Ensemble::prepare_csv(const vector<string> &names, ifstream &csv
 
 void Ensemble::extend_cols(Eigen::MatrixXd &_reals, const vector<string> &_var_names)
 {
+	to_memory();
 	//add new columns to reals
 	vector<string>::iterator start = var_names.begin(), end = var_names.end();
 	vector<string> missing;
@@ -819,6 +1278,7 @@ void Ensemble::extend_cols(Eigen::MatrixXd &_reals, const vector<string> &_var_n
 
 void Ensemble::append_other_rows(Ensemble &other)
 {
+	to_memory();
 	//append rows to the end of reals
 	if (other.shape().second != shape().second)
 		throw_ensemble_error("append_other_rows(): different number of var_names in other");
@@ -858,6 +1318,7 @@ void Ensemble::append_other_rows(Ensemble &other)
 
 void Ensemble::append(string real_name, const Transformable &trans)
 {
+	to_memory();
 	stringstream ss;
 	//make sure this real_name isn't ready used
 	if (find(real_names.begin(), real_names.end(), real_name) != real_names.end())
@@ -888,6 +1349,7 @@ void Ensemble::append(string real_name, const Transformable &trans)
 
 void Ensemble::to_binary_old(string file_name,bool transposed)
 {
+	to_memory();
 	ofstream fout(file_name, ios::binary);
 	if (!fout.good())
 	{
@@ -995,8 +1457,58 @@ void Ensemble::to_binary_old(string file_name,bool transposed)
 	fout.close();
 }
 
+void Ensemble::to_dense(string file_name, bool single_precision)
+{
+	//write the ensemble to a dense binary file
+	if (disk_reals)
+		DenseBinaryFile::write(file_name, real_names, var_names, read_disk(vector<int>(), vector<int>()), single_precision);
+	else
+		DenseBinaryFile::write(file_name, real_names, var_names, reals, single_precision);
+}
+
+map<string, int> Ensemble::read_dense(const string &file_name, const vector<string> &names, const vector<string> &required_names)
+{
+	//load the columns of a dense binary file that are in names.  var_names is set to names and the
+	//columns of names that are not in the file are zero.  Only the columns that are used are read.
+	//Returns the file column index of each name found
+	DenseBinaryFile dfile(file_name);
+	map<string, int> header_info;
+	unordered_map<string, int> file_cols;
+	for (int j = 0; j < dfile.get_col_names().size(); j++)
+		file_cols[pest_utils::upper_cp(pest_utils::strip_cp(dfile.get_col_names()[j]))] = j;
+	vector<string> missing;
+	for (auto &name : required_names)
+		if (file_cols.find(name) == file_cols.end())
+			missing.push_back(name);
+	if (missing.size() > 0)
+		throw_ensemble_error("the following names were not found in the dense binary file " + file_name + ":", missing);
+
+	vector<int> col_idxs, var_idxs;
+	for (int i = 0; i < names.size(); i++)
+	{
+		auto found = file_cols.find(names[i]);
+		if (found == file_cols.end())
+			continue;
+		header_info[names[i]] = found->second;
+		col_idxs.push_back(found->second);
+		var_idxs.push_back(i);
+	}
+	var_names = names;
+	real_names.clear();
+	for (auto &rname : dfile.get_row_names())
+		real_names.push_back(pest_utils::upper_cp(pest_utils::strip_cp(rname)));
+	disk_reals.reset();
+	reals.resize(real_names.size(), var_names.size());
+	reals.setZero();
+	Eigen::MatrixXd file_reals = dfile.read(vector<int>(), col_idxs);
+	for (int j = 0; j < var_idxs.size(); j++)
+		reals.col(var_idxs[j]) = file_reals.col(j);
+	return header_info;
+}
+
 void Ensemble::to_binary(string file_name, bool transposed)
 {
+	to_memory();
 	ofstream fout(file_name, ios::binary);
 	if (!fout.good())
 	{
@@ -1063,6 +1575,7 @@ map<string, int> Ensemble::from_binary(string file_name, vector<string> &names,
 {
 	var_names.clear();
 	real_names.clear();
+	disk_reals.reset();
 	reals.resize(0, 0);
 	bool is_new_format = pest_utils::read_binary(file_name, real_names, var_names, reals);
 	if ((!is_new_format) && (transposed))
@@ -1085,6 +1598,7 @@ map<string,int> Ensemble::from_binary_old(string file_name, vector<string> &name
 {
 	//load an ensemble from a binary jco-type file.  if transposed=true, reals is transposed and row/col names are swapped for var/real names.
 	//needed to store observation ensembles in binary since obs names are 20 chars and par names are 12 chars
+	disk_reals.reset();
 	var_names.clear();
 	real_names.clear();
 	ifstream in;
@@ -1254,63 +1768,168 @@ map<string,int> Ensemble::from_binary_old(string file_name, vector<string> &name
 
 
 
-void Ensemble::read_csv(int num_reals,ifstream &csv, map<string,int> header_info)
+void Ensemble::read_csv(const string &file_name, const map<string,int> &header_info)
 {
-	//read a csv file to an Ensmeble
-	int lcount = 0;
-	//vector<vector<double>> vectors;
-	double val;
-	string line;
-	vector<string> tokens;
-	string real_id;
+	//read the rows of a csv file to an Ensemble.  The header line has already been processed by
+	//prepare_csv().  The file is memory mapped and split into chunks on line boundaries - the line
+	//offsets of each chunk are found concurrently and then blocks of lines are parsed concurrently
+	//straight into reals
+	MappedFile mfile(file_name);
+	const char *data = mfile.data();
+	size_t size = mfile.size();
+	const char *eol = (size > 0) ? (const char*)memchr(data, '\n', size) : nullptr;
+	size_t start = (eol == nullptr) ? size : (eol - data) + 1;
 
-	real_names.clear();
-	reals.resize(num_reals, var_names.size());
-	reals.setZero();
-	int irow = 0;
-	while (getline(csv, line))
+	int num_threads = num_worker_threads(size - start, csv_min_chunk_bytes);
+	vector<size_t> bounds(1, start);
+	for (int i = 1; i < num_threads; i++)
 	{
-		pest_utils::strip_ip(line);
-		tokens.clear();
-		pest_utils::tokenize(line, tokens, ",", false);
-		if (tokens[tokens.size() - 1].size() == 0)
-			tokens.pop_back();
+		size_t b = max(start + ((size - start) / num_threads) * i, bounds.back());
+		eol = (b < size) ? (const char*)memchr(data + b, '\n', size - b) : nullptr;
+		bounds.push_back((eol == nullptr) ? size : (eol - data) + 1);
+	}
+	bounds.push_back(size);
 
-		try
-		{
-			pest_utils::convert_ip(tokens[0], real_id);
-		}
-		catch (exception &e)
+	//first pass: the [begin,end) offsets of the non-blank lines in each chunk, without leading
+	//and trailing white space
+	vector<vector<pair<size_t, size_t>>> chunk_lines(num_threads);
+	run_worker_threads(num_threads, [&](int ichunk)
+	{
+		size_t pos = bounds[ichunk], end = bounds[ichunk + 1];
+		while (pos < end)
 		{
-			stringstream ss;
-			ss << "error converting token '" << tokens[0] << "' to <int> run_id on line " << lcount << ": " << line << endl << e.what();
-			throw runtime_error(ss.str());
+			const char *next = (const char*)memchr(data + pos, '\n', end - pos);
+			size_t line_end = (next == nullptr) ? end : next - data;
+			size_t b = pos, e = line_end;
+			while ((b < e) && isspace((unsigned char)data[b]))
+				b++;
+			while ((e > b) && isspace((unsigned char)data[e - 1]))
+				e--;
+			if (e > b)
+				chunk_lines[ichunk].push_back(pair<size_t, size_t>(b, e));
+			pos = line_end + 1;
 		}
-		real_names.push_back(real_id);
-		map<string, int> var_map;
-		for (int i = 0; i < var_names.size(); i++)
-			var_map[var_names[i]] = i;
-
-		for (auto &hi : header_info)
+	});
+	vector<pair<size_t, size_t>> lines;
+	for (auto &cl : chunk_lines)
+	{
+		lines.insert(lines.end(), cl.begin(), cl.end());
+		vector<pair<size_t, size_t>>().swap(cl);
+	}
+
+	//the csv columns to read and the reals column for each, in csv column order so each line
+	//is parsed in a single pass
+	update_var_map();
+	vector<pair<int, int>> read_cols;
+	for (auto &hi : header_info)
+		read_cols.push_back(pair<int, int>(hi.second, var_map.at(hi.first)));
+	sort(read_cols.begin(), read_cols.end());
+	map<int, string> col_names;
+	for (auto &hi : header_info)
+		col_names[hi.second] = hi.first;
+
+	int num_reals = lines.size();
+	real_names.clear();
+	real_names.resize(num_reals);
+	disk_reals.reset();
+	reals.resize(num_reals, var_names.size());
+	reals.setZero();
+	num_threads = max(min(num_threads, num_reals), 1);
+	run_worker_threads(num_threads, [&](int ithread)
+	{
+		string token;
+		char *conv_end;
+		double val;
+		int row_start = (num_reals / num_threads) * ithread;
+		int row_end = (ithread == num_threads - 1) ? num_reals : row_start + (num_reals / num_threads);
+		for (int irow = row_start; irow < row_end; irow++)
 		{
-			try
+			const char *pos = data + lines[irow].first;
+			const char *end = data + lines[irow].second;
+			int itoken = 0;
+			auto icol = read_cols.begin();
+			while (true)
 			{
-				val = pest_utils::convert_cp<double>(tokens[hi.second]);
+				const char *next = (const char*)memchr(pos, ',', end - pos);
+				const char *tok_end = (next == nullptr) ? end : next;
+				if (itoken == 0)
+				{
+					token.assign(pos, tok_end);
+					pest_utils::strip_ip(token);
+					if ((token.size() == 0) || (token.find_first_of(" \t") != string::npos))
+					{
+						stringstream ss;
+						ss << "error converting token '" << token << "' to realization name on line " << irow << ": " << string(data + lines[irow].first, end);
+						throw runtime_error(ss.str());
+					}
+					real_names[irow] = token;
+				}
+				else if ((icol != read_cols.end()) && (icol->first == itoken))
+				{
+					token.assign(pos, tok_end);
+					val = strtod(token.c_str(), &conv_end);
+					if ((conv_end == token.c_str()) || (*conv_end != '\0') || (!isfinite(val)))
+					{
+						stringstream ss;
+						ss << "error converting token '" << token << "' to double for " << col_names[icol->first] << " on line " << irow;
+						throw runtime_error(ss.str());
+					}
+					reals(irow, icol->second) = val;
+					++icol;
+				}
+				if ((next == nullptr) || (icol == read_cols.end()))
+					break;
+				pos = next + 1;
+				itoken++;
 			}
-			catch (exception &e)
+			if (icol != read_cols.end())
 			{
 				stringstream ss;
-				ss << "error converting token '" << tokens[hi.second] << "' to double for " << hi.first << " on line " << lcount << " : " << e.what();
+				ss << "line " << irow << " has fewer entries than the csv file header: " << string(data + lines[irow].first, end);
 				throw runtime_error(ss.str());
 			}
-			reals(irow, var_map[hi.first]) = val;
 		}
-		lcount++;
-		irow++;
+	});
+}
 
+void Ensemble::write_csv(ofstream &csv, const vector<string> &col_names, const vector<string> &row_names, const Eigen::MatrixXd &mat)
+{
+	//write mat to a csv file with the shortest of 15, 16 or 17 significant digits that reads back
+	//to the same value.  The rows are written in batches; each thread formats a block of rows of
+	//the batch to a buffer and the buffers are then written in order
+	csv << "real_name";
+	for (auto &cname : col_names)
+		csv << ',' << cname;
+	csv << '\n';
+	int num_rows = mat.rows();
+	int rows_per_thread = max((int)(csv_min_chunk_bytes / (25 * (mat.cols() + 1))), 1);
+	int num_threads = max(min(num_worker_threads(num_rows, rows_per_thread), num_rows), 1);
+	vector<string> buffers(num_threads);
+	for (int batch_start = 0; batch_start < num_rows; batch_start += num_threads * rows_per_thread)
+	{
+		int batch_end = min(batch_start + num_threads * rows_per_thread, num_rows);
+		run_worker_threads(num_threads, [&](int ithread)
+		{
+			string &buf = buffers[ithread];
+			buf.clear();
+			char num_buf[32];
+			int row_start = batch_start + ithread * rows_per_thread;
+			int row_end = min(row_start + rows_per_thread, batch_end);
+			for (int irow = row_start; irow < row_end; irow++)
+			{
+				buf.append(row_names[irow]);
+				for (int j = 0; j < mat.cols(); j++)
+				{
+					buf.push_back(',');
+					buf.append(num_buf, format_csv_double(mat(irow, j), num_buf, sizeof(num_buf)));
+				}
+				buf.push_back('\n');
+			}
+		});
+		for (auto &buf : buffers)
+			csv.write(buf.data(), buf.size());
 	}
-	if (lcount != num_reals)
-		throw runtime_error("different number of reals found");
+	csv.flush();
 }
 
 
@@ -1420,6 +2039,7 @@ void ParameterEnsemble::set_pest_scenario(Pest *_pest_scenario)
 
 void ParameterEnsemble::set_zeros()
 {
+	to_memory();
 	reals.setZero();
 }
 
@@ -1465,6 +2085,34 @@ map<int,int> ParameterEnsemble::add_runs(RunManagerAbstract *run_mgr_ptr,const v
 
 	for (int i = 0; i < real_names.size(); i++)
 		rmap[real_names[i]] = i;
+
+	//transform all the realizations at once with the compiled transformation sequence
+	vector<int> row_idxs;
+	for (auto &rname : run_real_names)
+		row_idxs.push_back(rmap[rname]);
+	vector<string> in_names;
+	const vector<string> &model_par_names = run_mgr_ptr->get_par_name_vec();
+	CompiledParamTransform compiled;
+	Eigen::MatrixXd run_reals = get_transform_input(row_idxs, pars, in_names);
+	if (tstat == ParameterEnsemble::transStatus::CTL)
+		compiled = par_transform.compile_active_ctl2model(in_names, model_par_names);
+	else if (tstat == ParameterEnsemble::transStatus::NUM)
+		compiled = par_transform.compile_numeric2model(in_names, model_par_names);
+	else
+		compiled = CompiledParamTransform(in_names, model_par_names);
+	if (compiled.is_valid())
+	{
+		compiled.apply_ip(run_reals);
+		replace_fixed(run_real_names, model_par_names, run_reals);
+		for (int i = 0; i < row_idxs.size(); i++)
+		{
+			evec = run_reals.row(i);
+			run_id = run_mgr_ptr->add_run(evec, run_real_names[i]);
+			real_run_ids[row_idxs[i]] = run_id;
+		}
+		return real_run_ids;
+	}
+
 	for (auto &rname : run_real_names)
 	{
 		//idx = find(real_names.begin(), real_names.end(), rname) - real_names.begin();
@@ -1478,7 +2126,7 @@ map<int,int> ParameterEnsemble::add_runs(RunManagerAbstract *run_mgr_ptr,const v
 		else if (tstat == ParameterEnsemble::transStatus::NUM)
 			par_transform.numeric2model_ip(pars_real);
 		replace_fixed(rname, pars_real);
-		run_id = run_mgr_ptr->add_run(pars_real);
+		run_id = run_mgr_ptr->add_run(pars_real, rname);
 		real_run_ids[idx]  = run_id;
 	}
 	return real_run_ids;
@@ -1530,6 +2178,26 @@ void ParameterEnsemble::from_binary(string file_name)
 	tstat = transStatus::CTL;
 }
 
+void ParameterEnsemble::from_dense(string file_name)
+{
+	//load a par ensemble from a dense binary file - only the columns of control file parameters
+	//are read and all of the adjustable parameters must be present
+	vector<string> names = pest_scenario_ptr->get_ctl_ordered_par_names();
+	map<string, int> header_info = Ensemble::read_dense(file_name, names, pest_scenario_ptr->get_ctl_ordered_adj_par_names());
+	ParameterInfo pi = pest_scenario_ptr->get_ctl_parameter_info();
+	ParameterRec::TRAN_TYPE ft = ParameterRec::TRAN_TYPE::FIXED;
+	for (auto &name : var_names)
+	{
+		if (pi.get_parameter_rec_ptr(name)->tranform_type == ft)
+		{
+			fixed_names.push_back(name);
+		}
+	}
+	fill_fixed(header_info);
+	save_fixed();
+	tstat = transStatus::CTL;
+}
+
 //ParameterEnsemble ParameterEnsemble::get_new(const vector<string> &_real_names, const vector<string> &_var_names)
 //{
 //	
@@ -1549,11 +2217,6 @@ void ParameterEnsemble::from_csv(string file_name)
 	//var_names = pest_scenario_ptr->get_ctl_ordered_adj_par_names();
 	var_names = pest_scenario_ptr->get_ctl_ordered_par_names();
 	map<string,int>header_info = prepare_csv(var_names, csv, true);
-	//blast through the file to get number of reals
-	string line;
-	int num_reals = 0;
-	while (getline(csv, line))
-		num_reals++;
 	csv.close();
 
 	//make sure all adjustable parameters are present
@@ -1564,11 +2227,7 @@ void ParameterEnsemble::from_csv(string file_name)
 	if (missing.size() > 0)
 		throw_ensemble_error("ParameterEnsemble.from_csv() error: the following adjustable pars not in csv:",missing);
 
-	csv.open(file_name);
-	if (!csv.good())
-		throw runtime_error("error re-opening parameter csv " + file_name + " for reading");
-	getline(csv, line);
-	Ensemble::read_csv(num_reals, csv, header_info);
+	Ensemble::read_csv(file_name, header_info);
 	ParameterInfo pi = pest_scenario_ptr->get_ctl_parameter_info();
 	ParameterRec::TRAN_TYPE ft = ParameterRec::TRAN_TYPE::FIXED;
 	for (auto &name : var_names)
@@ -1587,6 +2246,7 @@ void ParameterEnsemble::from_csv(string file_name)
 
 void ParameterEnsemble::fill_fixed(const map<string, int> &header_info)
 {
+	to_memory();
 	if (fixed_names.size() == 0)
 		return;
 	map<string, int> var_map;
@@ -1642,6 +2302,7 @@ void ParameterEnsemble::save_fixed()
 
 void ParameterEnsemble::enforce_bounds()
 {
+	to_memory();
 	//reset parameters to be inbounds - very crude
 	if (tstat != ParameterEnsemble::transStatus::NUM)
 	{
@@ -1672,6 +2333,7 @@ void ParameterEnsemble::enforce_bounds()
 
 void ParameterEnsemble::to_binary(string file_name)
 {
+	to_memory();
 
 
 	ofstream fout(file_name, ios::binary);
@@ -1720,14 +2382,33 @@ void ParameterEnsemble::to_binary(string file_name)
 	//map<string, double>::const_iterator not_found_pi_par;
 	//icount = row_idxs + 1 + col_idxs * self.shape[0]
 	Parameters pars;
+	vector<string> in_names;
+	vector<int> row_idxs(n_real);
+	iota(row_idxs.begin(), row_idxs.end(), 0);
+	Eigen::MatrixXd ctl_reals = get_transform_input(row_idxs, pars, in_names);
+	CompiledParamTransform compiled;
+	if (tstat == transStatus::MODEL)
+		compiled = par_transform.compile_model2ctl(in_names, vnames);
+	else if (tstat == transStatus::NUM)
+		compiled = par_transform.compile_numeric2ctl(in_names, vnames);
+	else
+		compiled = CompiledParamTransform(in_names, vnames);
+	if (compiled.is_valid())
+	{
+		compiled.apply_ip(ctl_reals);
+		replace_fixed(real_names, vnames, ctl_reals);
+	}
 	for (int irow = 0; irow<n_real; ++irow)
 	{
-		pars.update_without_clear(var_names, reals.row(irow));
-		if (tstat == transStatus::MODEL)
-			par_transform.model2ctl_ip(pars);
-		else if (tstat == transStatus::NUM)
-			par_transform.numeric2ctl_ip(pars);
-		replace_fixed(real_names[irow], pars);
+		if (!compiled.is_valid())
+		{
+			pars.update_without_clear(var_names, reals.row(irow));
+			if (tstat == transStatus::MODEL)
+				par_transform.model2ctl_ip(pars);
+			else if (tstat == transStatus::NUM)
+				par_transform.numeric2ctl_ip(pars);
+			replace_fixed(real_names[irow], pars);
+		}
 
 		for (int jcol = 0; jcol<n_var; ++jcol)
 		{
@@ -1735,7 +2416,10 @@ void ParameterEnsemble::to_binary(string file_name)
 			fout.write((char*) &(n), sizeof(n));
 			n = jcol;
 			fout.write((char*) &(n), sizeof(n));
-			data = pars[vnames[jcol]];
+			if (compiled.is_valid())
+				data = ctl_reals(irow, jcol);
+			else
+				data = pars[vnames[jcol]];
 			fout.write((char*) &(data), sizeof(data));
 		}
 		/*int jcol = n_var;
@@ -1782,10 +2466,19 @@ void ParameterEnsemble::to_csv(string file_name)
 	{
 		throw_ensemble_error("ParameterEnsemble.to_csv() error opening csv file " + file_name + " for writing");
 	}
-	csv << "real_name";
-	for (auto &vname : names)
-		csv << ',' << vname;
-	csv << endl;
+	write_csv(csv, names, real_names, get_ctl_eigen(names));
+}
+
+void ParameterEnsemble::to_dense(string file_name)
+{
+	//write the par ensemble to a dense binary file - transformed back to CTL status
+	vector<string> names = pest_scenario_ptr->get_ctl_ordered_par_names();
+	DenseBinaryFile::write(file_name, real_names, names, get_ctl_eigen(names));
+}
+
+Eigen::MatrixXd ParameterEnsemble::get_ctl_eigen(const vector<string> &names)
+{
+	//the realizations transformed to CTL status with the columns ordered as names
 
 	//get the pars and transform to be in sync with ensemble trans status
 	Parameters pars = pest_scenario_ptr->get_ctl_parameters();
@@ -1799,9 +2492,28 @@ void ParameterEnsemble::to_csv(string file_name)
 	}
 
 
+	vector<string> in_names;
+	vector<int> row_idxs(shape().first);
+	iota(row_idxs.begin(), row_idxs.end(), 0);
+	Eigen::MatrixXd ctl_reals = get_transform_input(row_idxs, pars, in_names);
+	CompiledParamTransform compiled;
+	if (tstat == transStatus::MODEL)
+		compiled = par_transform.compile_model2ctl(in_names, names);
+	else if (tstat == transStatus::NUM)
+		compiled = par_transform.compile_numeric2ctl(in_names, names);
+	else
+		compiled = CompiledParamTransform(in_names, names);
+	if (compiled.is_valid())
+	{
+		compiled.apply_ip(ctl_reals);
+		replace_fixed(real_names, names, ctl_reals);
+		return ctl_reals;
+	}
+
+	to_memory();
+	ctl_reals.resize(reals.rows(), names.size());
 	for (int ireal = 0; ireal < reals.rows(); ireal++)
 	{
-		csv << real_names[ireal];
 		//evec = reals.row(ireal);
 		//svec.assign(evec.data(), evec.data() + evec.size());
 		pars.update_without_clear(var_names, reals.row(ireal));
@@ -1809,10 +2521,56 @@ void ParameterEnsemble::to_csv(string file_name)
 			par_transform.model2ctl_ip(pars);
 		else if (tstat == transStatus::NUM)
 			par_transform.numeric2ctl_ip(pars);
-		replace_fixed(real_names[ireal],pars);
-		for (auto &name : names)
-			csv << ',' << pars[name];
-		csv << endl;
+		replace_fixed(real_names[ireal], pars);
+		for (int j = 0; j < names.size(); j++)
+			ctl_reals(ireal, j) = pars[names[j]];
+	}
+	return ctl_reals;
+}
+
+Eigen::MatrixXd ParameterEnsemble::get_transform_input(const vector<int> &row_idxs, const Parameters &base_pars, vector<string> &in_names) const
+{
+	//the realizations in row_idxs with a column for each of var_names followed by a column for each
+	//of the base_pars not in var_names, which has the same value in every row
+	in_names = var_names;
+	set<string> vset(var_names.begin(), var_names.end());
+	vector<double> base_vals;
+	for (auto &name : base_pars.get_keys())
+	{
+		if (vset.find(name) == vset.end())
+		{
+			in_names.push_back(name);
+			base_vals.push_back(base_pars.get_rec(name));
+		}
+	}
+	Eigen::MatrixXd mat(row_idxs.size(), in_names.size());
+	if ((disk_reals) && (row_idxs.size() > 0))
+		mat.leftCols(var_names.size()) = read_disk(row_idxs, vector<int>());
+	for (int i = 0; (!disk_reals) && (i < row_idxs.size()); i++)
+		mat.block(i, 0, 1, var_names.size()) = reals.row(row_idxs[i]);
+	for (int j = 0; j < base_vals.size(); j++)
+		mat.col(var_names.size() + j).setConstant(base_vals[j]);
+	return mat;
+}
+
+void ParameterEnsemble::replace_fixed(const vector<string> &row_real_names, const vector<string> &names, Eigen::MatrixXd &mat)
+{
+	//same as replace_fixed() for rows of transformed parameter values ordered as names
+	if (fixed_names.size() == 0)
+		return;
+	unordered_map<string, int> name_map;
+	for (int j = 0; j < names.size(); j++)
+		name_map[names[j]] = j;
+	for (auto &fname : fixed_names)
+	{
+		auto found = name_map.find(fname);
+		if (found == name_map.end())
+			continue;
+		for (int i = 0; i < row_real_names.size(); i++)
+		{
+			pair<string, string> key(row_real_names[i], fname);
+			mat(i, found->second) = fixed_map.at(key);
+		}
 	}
 }
 
@@ -1836,12 +2594,21 @@ void ParameterEnsemble::transform_ip(transStatus to_tstat)
 	//transform the ensemble in place
 	if (to_tstat == tstat)
 		return;
+	to_memory();
 	if ((to_tstat == transStatus::NUM) && (tstat == transStatus::CTL))
 	{
 		Parameters pars = pest_scenario_ptr->get_ctl_parameters();
 		vector<string> adj_par_names = pest_scenario_ptr->get_ctl_ordered_adj_par_names();
-		Eigen::MatrixXd new_reals = Eigen::MatrixXd(shape().first, adj_par_names.size());
-		for (int ireal = 0; ireal < reals.rows(); ireal++)
+		vector<string> in_names;
+		vector<int> row_idxs(reals.rows());
+		iota(row_idxs.begin(), row_idxs.end(), 0);
+		Eigen::MatrixXd new_reals = get_transform_input(row_idxs, pars, in_names);
+		CompiledParamTransform compiled = par_transform.compile_ctl2numeric(in_names, adj_par_names);
+		if (compiled.is_valid())
+			compiled.apply_ip(new_reals);
+		else
+			new_reals = Eigen::MatrixXd(shape().first, adj_par_names.size());
+		for (int ireal = 0; (ireal < reals.rows()) && (!compiled.is_valid()); ireal++)
 		{
 			pars.update_without_clear(var_names, reals.row(ireal));
 			par_transform.ctl2numeric_ip(pars);
@@ -1903,6 +2670,7 @@ void ObservationEnsemble::draw(int num_reals, Covariance &cov, PerformanceLog *p
 
 void ObservationEnsemble::update_from_obs(int row_idx, Observations &obs)
 {
+	to_memory();
 	//update a row in reals from an int id
 	if (row_idx >= real_names.size())
 		throw_ensemble_error("ObservtionEnsemble.update_from_obs() obs_idx out of range");
@@ -1928,15 +2696,19 @@ void ObservationEnsemble::update_from_obs(string real_name, Observations &obs)
 
 vector<int> ObservationEnsemble::update_from_runs(map<int,int> &real_run_ids, RunManagerAbstract *run_mgr_ptr)
 {
+	to_memory();
 	//update the obs ensemble in place from the run manager
 	set<int> failed_runs = run_mgr_ptr->get_failed_run_ids();
 	vector<int> failed_real_idxs;
-	Parameters pars = pest_scenario_ptr->get_ctl_parameters();
-	Observations obs = pest_scenario_ptr->get_ctl_observations();
-	string real_name;
-	int ireal = 0;
+	//read the runs into dense arrays in run storage order and gather the ensemble columns by index
+	//so the observation names are only looked up once
+	DenseParameters pars(make_shared<const TransformableSchema>(run_mgr_ptr->get_par_name_vec()));
+	DenseObservations obs(make_shared<const TransformableSchema>(run_mgr_ptr->get_obs_name_vec()));
+	vector<int> var_idxs = obs.get_schema()->get_indices(var_names);
 	for (auto &real_run_id : real_run_ids)
 	{
+		if (real_run_id.first >= real_names.size())
+			throw_ensemble_error("ObservtionEnsemble.update_from_runs() obs_idx out of range");
 		if (failed_runs.find(real_run_id.second) != failed_runs.end())
 		{
 			failed_real_idxs.push_back(real_run_id.first);
@@ -1945,10 +2717,8 @@ vector<int> ObservationEnsemble::update_from_runs(map<int,int> &real_run_ids, Ru
 
 		else
 		{
-			run_mgr_ptr->get_run(real_run_id.second, pars, obs);
-			//real_name = real_names[real_run_id.first];
-			update_from_obs(real_run_id.first, obs);
-			//update_from_obs(ireal, obs);
+			run_mgr_ptr->get_run(real_run_id.second, pars.data(), pars.size(), obs.data(), obs.size());
+			reals.row(real_run_id.first) = obs.gather(var_idxs);
 		}
 	}
 	return failed_real_idxs;
@@ -1961,6 +2731,12 @@ void ObservationEnsemble::from_binary(string file_name)
 	Ensemble::from_binary(file_name, names, true);
 }
 
+void ObservationEnsemble::from_dense(string file_name)
+{
+	//load the obs en from a dense binary file - all of the non-zero weighted obs must be present
+	Ensemble::read_dense(file_name, pest_scenario_ptr->get_ctl_ordered_obs_names(), pest_scenario_ptr->get_ctl_ordered_nz_obs_names());
+}
+
 void ObservationEnsemble::from_csv(string file_name)
 {
 	//load the obs en from a csv file
@@ -1969,18 +2745,8 @@ void ObservationEnsemble::from_csv(string file_name)
 	if (!csv.good())
 		throw runtime_error("error opening observation csv " + file_name + " for reading");
 	map<string,int> header_info = prepare_csv(pest_scenario_ptr->get_ctl_ordered_nz_obs_names(), csv, false);
-	//blast through the file to get number of reals
-	string line;
-	int num_reals = 0;
-	while (getline(csv, line))
-		num_reals++;
 	csv.close();
-
-	csv.open(file_name);
-	if (!csv.good())
-		throw runtime_error("error re-opening observation csv " + file_name + " for reading");
-	getline(csv, line);
-	Ensemble::read_csv(num_reals, csv,header_info);
+	Ensemble::read_csv(file_name, header_info);
 }
 
 void ObservationEnsemble::from_eigen_mat(Eigen::MatrixXd mat, const vector<string> &_real_names, const vector<string> &_var_names)
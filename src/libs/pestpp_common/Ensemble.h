@@ -2,6 +2,7 @@
 #define ENSEMBLE_H_
 
 #include <map>
+#include <memory>
 #include <random>
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
@@ -13,6 +14,7 @@
 #include "covariance.h"
 #include "RunManagerAbstract.h"
 #include "PerformanceLog.h"
+#include "tiled_matrix.h"
 
 
 
@@ -30,8 +32,10 @@ public:
 	void to_csv(string file_name);
 	void to_binary_old(string file_name, bool transposed=false);
 	void to_binary(string file_name, bool transposed=false);
+	//single_precision writes the values as float32; read_dense() reads either precision
+	void to_dense(string file_name, bool single_precision=false);
 	void from_eigen_mat(Eigen::MatrixXd mat, const vector<string> &_real_names, const vector<string> &_var_names);
-	pair<int, int> shape() { return pair<int, int>(reals.rows(), reals.cols()); }
+	pair<int, int> shape();
 	void throw_ensemble_error(string message);
 	void throw_ensemble_error(string message,vector<string> vec);
 	const vector<string> get_var_names() const { return var_names; }
@@ -50,8 +54,8 @@ public:
 	Eigen::VectorXd get_real_vector(const string &real_name);
 
 	Eigen::MatrixXd get_eigen(vector<string> row_names, vector<string> col_names, bool update_vmap=true);
-	const Eigen::MatrixXd get_eigen() const { return reals; }
-	const Eigen::MatrixXd* get_eigen_ptr() const { return &reals; }
+	const Eigen::MatrixXd get_eigen() const { check_in_memory("get_eigen()"); return reals; }
+	const Eigen::MatrixXd* get_eigen_ptr() const { check_in_memory("get_eigen_ptr()"); return &reals; }
 	void set_eigen(Eigen::MatrixXd _reals);
 
 	Eigen::MatrixXd get_eigen_mean_diff();
@@ -79,6 +83,15 @@ public:
 
 	void draw(int num_reals, Covariance cov, Transformable &tran, const vector<string> &draw_names, const map<string,vector<string>> &grouper, PerformanceLog *plog, int level);
 	void update_var_map();
+
+	//move the realized values out of memory into a tiled scratch file (see TiledMatrix).  While on disk,
+	//shape(), get_eigen() by names, get_eigen_mean_diff(), get_moment_maps(), get_real_vector(), reorder(),
+	//drop_rows(), keep_rows() and ParameterEnsemble::add_runs() read only the tiles they need; any other
+	//operation that uses the values brings them back into memory first.  Copies share the scratch file.
+	//single_precision stores the values as float32; they are promoted to double as they are read back
+	void to_disk(const string &file_name, int tile_cols, bool single_precision=false);
+	void to_memory();
+	bool is_on_disk() const { return disk_reals != nullptr; }
 	~Ensemble();
 protected:
 	Pest* pest_scenario_ptr;
@@ -91,10 +104,21 @@ protected:
 	vector<string> var_names;
 	vector<string> real_names;	
 	map<string, int> var_map;
-	void read_csv(int num_reals,ifstream &csv, map<string,int> header_info);
+	shared_ptr<TiledMatrix> disk_reals;
+	//the rows and columns of disk_reals that make up the ensemble, in ensemble order
+	vector<int> disk_rows;
+	vector<int> disk_cols;
+	void draw_parallel(int num_reals, Covariance &cov, Transformable &tran, const vector<string> &draw_names, const map<string, vector<string>> &grouper, PerformanceLog *plog, int level);
+	void check_in_memory(const string &caller) const;
+	Eigen::MatrixXd read_disk(const vector<int> &row_idxs, const vector<int> &col_idxs) const;
+	void keep_disk_rows(const vector<string> &keep_names);
+	void reorder_disk_cols(const vector<string> &_var_names);
+	void read_csv(const string &file_name, const map<string,int> &header_info);
+	void write_csv(ofstream &csv, const vector<string> &col_names, const vector<string> &row_names, const Eigen::MatrixXd &mat);
 	map<string,int> from_binary_old(string file_name, vector<string> &names,  bool transposed);
 	map<string, int> from_binary(string file_name, vector<string> &names, bool transposed);
 	map<string,int> prepare_csv(const vector<string> &names, ifstream &csv, bool forgive);
+	map<string,int> read_dense(const string &file_name, const vector<string> &names, const vector<string> &required_names);
 };
 
 class ParameterEnsemble : public Ensemble
@@ -117,6 +141,7 @@ public:
 	//void from_csv(string file_name,const vector<string> &ordered_names);
 	void from_csv(string file_name);
 	void from_binary(string file_name);
+	void from_dense(string file_name);
 
 	void from_eigen_mat(Eigen::MatrixXd mat, const vector<string> &_real_names, const vector<string> &_var_names,
 		transStatus _tstat = transStatus::NUM);
@@ -133,6 +158,11 @@ public:
 	void draw(int num_reals, Parameters par, Covariance &cov, PerformanceLog *plog, int level);
 	Covariance get_diagonal_cov_matrix();
 	void to_binary(string filename);
+	void to_dense(string file_name);
+	//the per-realization values of fixed pars, keyed by (real name, par name)
+	const vector<string>& get_fixed_names() const { return fixed_names; }
+	const map<pair<string, string>, double>& get_fixed_map() const { return fixed_map; }
+	void set_fixed_info(const vector<string> &_fixed_names, const map<pair<string, string>, double> &_fixed_map) { fixed_names = _fixed_names; fixed_map = _fixed_map; }
 
 private:
 	ParamTransformSeq par_transform;
@@ -142,6 +172,9 @@ private:
 	vector<string> fixed_names;
 	map<pair<string, string>, double> fixed_map;
 	void replace_fixed(string real_name,Parameters &pars);
+	void replace_fixed(const vector<string> &row_real_names, const vector<string> &names, Eigen::MatrixXd &mat);
+	Eigen::MatrixXd get_transform_input(const vector<int> &row_idxs, const Parameters &base_pars, vector<string> &in_names) const;
+	Eigen::MatrixXd get_ctl_eigen(const vector<string> &names);
 };
 
 class ObservationEnsemble : public Ensemble
@@ -161,6 +194,7 @@ public:
 	void from_csv(string file_name);
 	void from_eigen_mat(Eigen::MatrixXd mat, const vector<string> &_real_names, const vector<string> &_var_names);
 	void from_binary(string file_name);// { Ensemble::from_binary(file_name, true); }
+	void from_dense(string file_name);
 	vector<int> update_from_runs(map<int,int> &real_run_ids, RunManagerAbstract *run_mgr_ptr);
 	void draw(int num_reals, Covariance &cov, PerformanceLog *plog, int level);
 
@@ -0,0 +1,261 @@
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include "dense_binary.h"
+#include "utilities.h"
+#include "EnsembleCheckpoint.h"
+
+const char EnsembleCheckpoint::signature[8] = { 'P', 'S', 'T', 'C', 'K', 'P', 'T', ' ' };
+const int32_t EnsembleCheckpoint::version;
+
+namespace
+{
+	//file names are stored relative to the directory of the state file so a checkpoint can be
+	//moved or copied as a set
+	string get_dir(const string &file_name)
+	{
+		size_t i = file_name.find_last_of("/\\");
+		if (i == string::npos)
+			return "";
+		return file_name.substr(0, i + 1);
+	}
+
+	string get_base(const string &file_name)
+	{
+		size_t i = file_name.find_last_of("/\\");
+		if (i == string::npos)
+			return file_name;
+		return file_name.substr(i + 1);
+	}
+
+	template <typename T>
+	void write_pod(ofstream &out, const T &val)
+	{
+		out.write((const char*)&val, sizeof(T));
+	}
+
+	void write_string(ofstream &out, const string &s)
+	{
+		int64_t n = s.size();
+		write_pod(out, n);
+		out.write(s.data(), n);
+	}
+
+	void write_strings(ofstream &out, const vector<string> &v)
+	{
+		int64_t n = v.size();
+		write_pod(out, n);
+		for (auto &s : v)
+			write_string(out, s);
+	}
+
+	template <typename T>
+	void write_vector(ofstream &out, const vector<T> &v)
+	{
+		int64_t n = v.size();
+		write_pod(out, n);
+		if (n > 0)
+			out.write((const char*)v.data(), n * sizeof(T));
+	}
+
+	class StateReader
+	{
+	public:
+		StateReader(const string &_file_name) : file_name(_file_name), in(_file_name, ifstream::binary)
+		{
+			if (!in.good())
+				throw runtime_error("EnsembleCheckpoint error: unable to open checkpoint file " + file_name);
+		}
+
+		void read_bytes(void *dest, size_t n)
+		{
+			if (!in.read((char*)dest, n))
+				throw runtime_error("EnsembleCheckpoint error: checkpoint file " + file_name + " is truncated");
+		}
+
+		template <typename T>
+		T read_pod()
+		{
+			T val;
+			read_bytes(&val, sizeof(T));
+			return val;
+		}
+
+		int64_t read_count()
+		{
+			int64_t n = read_pod<int64_t>();
+			if (n < 0)
+				throw runtime_error("EnsembleCheckpoint error: checkpoint file " + file_name + " is corrupt");
+			return n;
+		}
+
+		string read_string()
+		{
+			string s(read_count(), ' ');
+			if (s.size() > 0)
+				read_bytes(&s[0], s.size());
+			return s;
+		}
+
+		vector<string> read_strings()
+		{
+			vector<string> v(read_count());
+			for (auto &s : v)
+				s = read_string();
+			return v;
+		}
+
+		template <typename T>
+		vector<T> read_vector()
+		{
+			vector<T> v(read_count());
+			if (v.size() > 0)
+				read_bytes(v.data(), v.size() * sizeof(T));
+			return v;
+		}
+
+	private:
+		string file_name;
+		ifstream in;
+	};
+}
+
+void EnsembleCheckpoint::write_ensemble(EnsembleData &ed, const string &file_name)
+{
+	if ((ed.values.size() > 0) || (ed.file_name.size() == 0))
+	{
+		DenseBinaryFile::write(file_name, ed.real_names, ed.var_names, ed.values);
+		ed.file_name = file_name;
+	}
+}
+
+void EnsembleCheckpoint::write(const string &state_file, const string &latest_file)
+{
+	write_ensemble(pe, state_file + ".pe");
+	write_ensemble(oe, state_file + ".oe");
+	write_ensemble(pe_base, state_file + ".pe_base");
+	write_ensemble(oe_base, state_file + ".oe_base");
+	write_ensemble(weights, state_file + ".weights");
+
+	string tmp_file = state_file + ".tmp";
+	ofstream out(tmp_file, ofstream::binary);
+	if (!out.good())
+		throw runtime_error("EnsembleCheckpoint error: unable to open checkpoint file " + tmp_file + " for writing");
+	out.write(signature, sizeof(signature));
+	write_pod(out, version);
+	write_pod(out, (int32_t)iter);
+	write_pod(out, last_best_lam);
+	write_pod(out, last_best_mean);
+	write_pod(out, last_best_std);
+	write_pod(out, best_phi_yet);
+	write_pod(out, reg_factor);
+	write_pod(out, (int32_t)consec_bad_lambda_cycles);
+	write_vector(out, best_mean_phis);
+	write_vector(out, subset_idxs);
+	write_strings(out, oe_org_real_names);
+	write_strings(out, pe_org_real_names);
+	write_pod(out, (int32_t)pe_trans_status);
+	write_pod(out, (int32_t)pe_base_trans_status);
+	write_string(out, rng_state);
+	write_strings(out, fixed_names);
+	write_pod(out, (int64_t)fixed_map.size());
+	for (auto &f : fixed_map)
+	{
+		write_string(out, f.first.first);
+		write_string(out, f.first.second);
+		write_pod(out, f.second);
+	}
+	for (auto ed : { &pe, &oe, &pe_base, &oe_base, &weights })
+		write_string(out, get_base(ed->file_name));
+	out.close();
+	if (!out.good())
+		throw runtime_error("EnsembleCheckpoint error: error writing checkpoint file " + tmp_file);
+	std::remove(state_file.c_str());
+	if (std::rename(tmp_file.c_str(), state_file.c_str()) != 0)
+		throw runtime_error("EnsembleCheckpoint error: unable to rename " + tmp_file + " to " + state_file);
+
+	tmp_file = latest_file + ".tmp";
+	ofstream latest(tmp_file);
+	if (!latest.good())
+		throw runtime_error("EnsembleCheckpoint error: unable to open checkpoint file " + tmp_file + " for writing");
+	latest << get_base(state_file) << endl;
+	latest.close();
+	std::remove(latest_file.c_str());
+	if (std::rename(tmp_file.c_str(), latest_file.c_str()) != 0)
+		throw runtime_error("EnsembleCheckpoint error: unable to rename " + tmp_file + " to " + latest_file);
+}
+
+string EnsembleCheckpoint::get_state_file(const string &file_name)
+{
+	ifstream in(file_name, ifstream::binary);
+	if (!in.good())
+		throw runtime_error("EnsembleCheckpoint error: unable to open checkpoint file " + file_name);
+	char buf[sizeof(signature)];
+	if ((in.read(buf, sizeof(buf))) && (memcmp(buf, signature, sizeof(signature)) == 0))
+		return file_name;
+	//otherwise this should be a "latest" pointer file
+	in.clear();
+	in.seekg(0);
+	string line;
+	getline(in, line);
+	pest_utils::strip_ip(line);
+	if (line.size() == 0)
+		throw runtime_error("EnsembleCheckpoint error: " + file_name + " is not a checkpoint state file or a pointer to one");
+	return get_dir(file_name) + line;
+}
+
+void EnsembleCheckpoint::read_ensemble(EnsembleData &ed)
+{
+	DenseBinaryFile dbf(ed.file_name);
+	ed.real_names = dbf.get_row_names();
+	ed.var_names = dbf.get_col_names();
+	ed.values = dbf.get_map();
+}
+
+EnsembleCheckpoint EnsembleCheckpoint::read(const string &file_name)
+{
+	string state_file = get_state_file(file_name);
+	StateReader sr(state_file);
+	char buf[sizeof(signature)];
+	sr.read_bytes(buf, sizeof(buf));
+	if (memcmp(buf, signature, sizeof(signature)) != 0)
+		throw runtime_error("EnsembleCheckpoint error: " + state_file + " is not a checkpoint state file");
+	int32_t file_version = sr.read_pod<int32_t>();
+	if (file_version != version)
+	{
+		stringstream ss;
+		ss << "EnsembleCheckpoint error: checkpoint file " << state_file << " has unsupported version " << file_version;
+		throw runtime_error(ss.str());
+	}
+	EnsembleCheckpoint ckpt;
+	ckpt.iter = sr.read_pod<int32_t>();
+	ckpt.last_best_lam = sr.read_pod<double>();
+	ckpt.last_best_mean = sr.read_pod<double>();
+	ckpt.last_best_std = sr.read_pod<double>();
+	ckpt.best_phi_yet = sr.read_pod<double>();
+	ckpt.reg_factor = sr.read_pod<double>();
+	ckpt.consec_bad_lambda_cycles = sr.read_pod<int32_t>();
+	ckpt.best_mean_phis = sr.read_vector<double>();
+	ckpt.subset_idxs = sr.read_vector<int>();
+	ckpt.oe_org_real_names = sr.read_strings();
+	ckpt.pe_org_real_names = sr.read_strings();
+	ckpt.pe_trans_status = sr.read_pod<int32_t>();
+	ckpt.pe_base_trans_status = sr.read_pod<int32_t>();
+	ckpt.rng_state = sr.read_string();
+	ckpt.fixed_names = sr.read_strings();
+	int64_t nfixed = sr.read_count();
+	for (int64_t i = 0; i < nfixed; i++)
+	{
+		string rname = sr.read_string();
+		string pname = sr.read_string();
+		ckpt.fixed_map[pair<string, string>(rname, pname)] = sr.read_pod<double>();
+	}
+	string dir = get_dir(state_file);
+	for (auto ed : { &ckpt.pe, &ckpt.oe, &ckpt.pe_base, &ckpt.oe_base, &ckpt.weights })
+	{
+		ed->file_name = dir + sr.read_string();
+		read_ensemble(*ed);
+	}
+	return ckpt;
+}
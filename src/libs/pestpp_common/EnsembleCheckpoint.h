@@ -0,0 +1,65 @@
+#ifndef ENSEMBLECHECKPOINT_H_
+#define ENSEMBLECHECKPOINT_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <utility>
+#include <cstdint>
+#include <Eigen/Dense>
+
+using namespace std;
+
+//the state of an ensemble smoother at the end of an iteration.  A checkpoint is a small binary
+//state file plus one dense binary file (see DenseBinaryFile) per ensemble.  The state file is
+//written last (to a temp name then renamed) so it only exists once the ensemble files are
+//complete; the ensemble files of the prior par and obs ensembles and the weights, which don't
+//change after initialization, are written once and referenced by later checkpoints.  A
+//"latest" pointer file names the most recent complete state file.  Layout of the state file,
+//in native byte order:
+//   char[8]  "PSTCKPT "
+//   int32    format version
+//   then the fields in the order of write()/read(); strings are an int64 length followed by
+//   the characters, vectors are an int64 count followed by the items
+class EnsembleCheckpoint
+{
+public:
+	//the values and names of one ensemble.  If values is empty when written, file_name must name
+	//an existing dense binary file (from an earlier checkpoint) that holds the ensemble
+	struct EnsembleData
+	{
+		vector<string> real_names;
+		vector<string> var_names;
+		Eigen::MatrixXd values;
+		string file_name;
+	};
+
+	int iter;
+	double last_best_lam, last_best_mean, last_best_std, best_phi_yet, reg_factor;
+	int consec_bad_lambda_cycles;
+	vector<double> best_mean_phis;
+	vector<int> subset_idxs;
+	vector<string> oe_org_real_names, pe_org_real_names;
+	int pe_trans_status, pe_base_trans_status;
+	//the state of Ensemble::rand_engine, as written by operator<<
+	string rng_state;
+	//the per-realization values of fixed pars in the par ensemble
+	vector<string> fixed_names;
+	map<pair<string, string>, double> fixed_map;
+
+	EnsembleData pe, oe, pe_base, oe_base, weights;
+
+	//write the ensemble files then the state file, then point latest_file at the state file
+	void write(const string &state_file, const string &latest_file);
+	//read a state file or a "latest" pointer file.  The ensemble values are read through a
+	//memory mapping of their dense binary files
+	static EnsembleCheckpoint read(const string &file_name);
+	static string get_state_file(const string &file_name);
+private:
+	static const char signature[8];
+	static const int32_t version = 1;
+	static void write_ensemble(EnsembleData &ed, const string &file_name);
+	static void read_ensemble(EnsembleData &ed);
+};
+
+#endif
@@ -3,6 +3,8 @@
 #include <iomanip>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include "Ensemble.h"
 #include "RestartController.h"
 #include "utilities.h"
@@ -46,38 +48,59 @@ PhiHandler::PhiHandler(Pest *_pest_scenario, FileManager *_file_manager,
 	}
 
 
-	//build up obs group and par group idx maps for group reporting
+	//build up the obs group and par group indicator matrices for group reporting
 	vector<string> nnz_obs = oe_base->get_var_names();
 	ObservationInfo oinfo = pest_scenario->get_ctl_observation_info();
-	vector<int> idx;
+	map<string, int> group_idx;
+	vector<Eigen::Triplet<double>> triplets;
 	for (auto &og : pest_scenario->get_ctl_ordered_obs_group_names())
-	{
-		idx.clear();
-		for (int i = 0; i < nnz_obs.size(); i++)
+		group_idx[og] = -1;
+	for (int i = 0; i < nnz_obs.size(); i++)
+		group_idx.at(oinfo.get_group(nnz_obs[i])) = 0;
+	//only the groups that are present get a column, in ctl order
+	for (auto &og : pest_scenario->get_ctl_ordered_obs_group_names())
+		if (group_idx[og] != -1)
 		{
-			if (oinfo.get_group(nnz_obs[i]) == og)
-			{
-				idx.push_back(i);
-			}
+			group_idx[og] = obs_group_names.size();
+			obs_group_names.push_back(og);
 		}
-		if (idx.size() > 0)
-			obs_group_idx_map[og] = idx;
-	}
+	for (int i = 0; i < nnz_obs.size(); i++)
+		triplets.push_back(Eigen::Triplet<double>(i, group_idx.at(oinfo.get_group(nnz_obs[i])), 1.0));
+	obs_group_ind.resize(nnz_obs.size(), obs_group_names.size());
+	obs_group_ind.setFromTriplets(triplets.begin(), triplets.end());
 
 	vector<string> pars = pe_base->get_var_names();
 	ParameterInfo pi = pest_scenario->get_ctl_parameter_info();
+	group_idx.clear();
+	triplets.clear();
 	for (auto &pg : pest_scenario->get_ctl_ordered_par_group_names())
-	{
-		idx.clear();
-		for (int i = 0; i < pars.size(); i++)
+		group_idx[pg] = -1;
+	for (int i = 0; i < pars.size(); i++)
+		group_idx.at(pi.get_parameter_rec_ptr(pars[i])->group) = 0;
+	for (auto &pg : pest_scenario->get_ctl_ordered_par_group_names())
+		if (group_idx[pg] != -1)
 		{
-			if (pi.get_parameter_rec_ptr(pars[i])->group == pg)
-				idx.push_back(i);
+			group_idx[pg] = par_group_names.size();
+			par_group_names.push_back(pg);
 		}
-		if (idx.size() > 0)
-			par_group_idx_map[pg] = idx;
-	}
-
+	for (int i = 0; i < pars.size(); i++)
+		triplets.push_back(Eigen::Triplet<double>(i, group_idx.at(pi.get_parameter_rec_ptr(pars[i])->group), 1.0));
+	par_group_ind.resize(pars.size(), par_group_names.size());
+	par_group_ind.setFromTriplets(triplets.begin(), triplets.end());
+
+	//flag the inequality columns and grab the obs values in oe_base column order
+	obs_ineq_flags.assign(nnz_obs.size(), 0);
+	unordered_map<string, int> obs_idx;
+	for (int i = 0; i < nnz_obs.size(); i++)
+		obs_idx[nnz_obs[i]] = i;
+	unordered_map<string, int>::iterator oi_end = obs_idx.end(), oi_it;
+	for (auto &n : lt_obs_names)
+		if ((oi_it = obs_idx.find(n)) != oi_end)
+			obs_ineq_flags[oi_it->second] = 1;
+	for (auto &n : gt_obs_names)
+		if ((oi_it = obs_idx.find(n)) != oi_end)
+			obs_ineq_flags[oi_it->second] = -1;
+	obs_vals = pest_scenario->get_ctl_observations().get_data_eigen_vec(nnz_obs);
 
 	reg_factor = _reg_factor;
 	//save the org reg factor and org q vector
@@ -167,91 +190,30 @@ Eigen::VectorXd PhiHandler::get_q_vector()
 	return q;
 }
 
-map<string, double> PhiHandler::get_obs_group_contrib(Eigen::VectorXd &phi_vec)
-{
-	map<string, double> group_phi_map;
-	double sum;
-	for (auto &og : obs_group_idx_map)
-	{
-		sum = 0.0;
-		for (auto i : og.second)
-			sum += phi_vec[i];
-		group_phi_map[og.first] = sum;
-	}
-
-	return group_phi_map;
-}
-
-map<string, double> PhiHandler::get_par_group_contrib(Eigen::VectorXd &phi_vec)
-{
-	map<string, double> group_phi_map;
-	double sum;
-	for (auto &pg : par_group_idx_map)
-	{
-		sum = 0.0;
-		for (auto i : pg.second)
-			sum += phi_vec[i];
-		group_phi_map[pg.first] = sum;
-	}
-	return group_phi_map;
-}
-
 void PhiHandler::update(ObservationEnsemble & oe, ParameterEnsemble & pe)
 {
-	//update the various phi component vectors
+	//update the various phi component maps - only per-realization scalars are kept
 	meas.clear();
 	obs_group_phi_map.clear();
 	Eigen::VectorXd q = get_q_vector();
-	map<string, Eigen::VectorXd> meas_map = calc_meas(oe, q);
-	for (auto &pv : meas_map)
-	{
-		meas[pv.first] = pv.second.sum();
-
-	}
-	/*if (pest_scenario->get_control_info().pestmode == ControlInfo::PestMode::PARETO)
-	{
-		meas_map.clear();
-		meas_map = calc_meas(oe, org_q_vec);
-
-	}
-	for (auto &pv : meas_map)
-	{
-		obs_group_phi_map[pv.first] = get_obs_group_contrib(pv.second);
-	}*/
+	meas = calc_meas(oe, q);
 
 	regul.clear();
-	map<string, Eigen::VectorXd> reg_map = calc_regul(pe);//, *reg_factor);
-	//for (auto &pv : calc_regul(pe))
+	map<string, map<string, double>> reg_group_map;
+	map<string, double> reg_map = calc_regul(pe, reg_group_map);
 	string name;
 	//big assumption - if oe is a diff shape, then this
 	//must be a subset, so just use the first X rows of pe
+	vector<string> pe_real_names = pe.get_real_names();
 	for (int i=0;i<oe.shape().first;i++)
 	{
-		//name = preal_names[i];
-		name = pe.get_real_names()[i];
-		//cout << name << endl;
-		regul[name] = reg_map[name].sum();
-		par_group_phi_map[name] = get_par_group_contrib(reg_map[name]);
+		name = pe_real_names[i];
+		regul[name] = reg_map[name];
+		par_group_phi_map[name] = reg_group_map[name];
 	}
 
-	/*if (pest_scenario->get_control_info().pestmode == ControlInfo::PestMode::PARETO)
-	{
-		reg_map.clear();
-		reg_map = calc_regul(pe, org_reg_factor);
-	}
-
-	for (int i = 0; i<oe.shape().first; i++)
-	{
-		name = preal_names[i];
-		par_group_phi_map[name] = get_par_group_contrib(reg_map[name]);
-	}*/
-
 	actual.clear();
-	for (auto &pv : calc_actual(oe, q))
-	{
-		actual[pv.first] = pv.second.sum();
-		obs_group_phi_map[pv.first] = get_obs_group_contrib(pv.second);
-	}
+	actual = calc_actual(oe, q, obs_group_phi_map);
  	composite.clear();
 	composite = calc_composite(meas, regul);
 }
@@ -495,10 +457,8 @@ void PhiHandler::prepare_group_csv(ofstream &csv, vector<string> extra)
 
 vector<int> PhiHandler::get_idxs_greater_than(double bad_phi, ObservationEnsemble &oe)
 {
-	map<string, double> _meas;
 	Eigen::VectorXd q = get_q_vector();
-	for (auto &pv : calc_meas(oe, q))
-		_meas[pv.first] = pv.second.sum();
+	map<string, double> _meas = calc_meas(oe, q);
 	vector<int> idxs;
 	vector<string> names = oe.get_real_names();
 	for (int i=0;i<names.size();i++)
@@ -507,60 +467,99 @@ vector<int> PhiHandler::get_idxs_greater_than(double bad_phi, ObservationEnsembl
 	return idxs;
 }
 
-map<string, Eigen::VectorXd> PhiHandler::calc_meas(ObservationEnsemble & oe, Eigen::VectorXd &q_vec)
+Eigen::VectorXd PhiHandler::calc_obs_phi_vec(Eigen::MatrixXd &resid, const Eigen::VectorXd &q_vec,
+	const Eigen::MatrixXd *w_mat, const Eigen::VectorXd *ref_vals)
 {
-	map<string, Eigen::VectorXd> phi_map;
-	Eigen::VectorXd oe_base_vec, oe_vec, diff,w_vec;
-	//Eigen::VectorXd q = get_q_vector();
-	vector<string> act_obs_names = pest_scenario->get_ctl_ordered_nz_obs_names();
-	vector<string> base_real_names = oe_base->get_real_names(), oe_real_names = oe.get_real_names();
-	vector<string>::iterator start = base_real_names.begin(), end = base_real_names.end();
+	//one column-major pass over the residual matrix: subtract the reference values (if any),
+	//apply the inequality constraints, weight and square in place.  resid is left holding
+	//the squared weighted residuals and the phi of each row is returned
+	if ((resid.cols() != obs_ineq_flags.size()) || (resid.cols() != q_vec.size()))
+		throw runtime_error("PhiHandler::calc_obs_phi_vec(): resid cols != oe_base cols");
+	if ((w_mat) && ((w_mat->rows() < resid.rows()) || (w_mat->cols() != resid.cols())))
+		throw runtime_error("PhiHandler::calc_obs_phi_vec(): weights ensemble shape incompatible with resid");
+	int nrows = resid.rows();
+	for (int j = 0; j < resid.cols(); j++)
+	{
+		Eigen::Ref<Eigen::VectorXd> col = resid.col(j);
+		if (ref_vals)
+			col.array() -= (*ref_vals)(j);
+		if (obs_ineq_flags[j] == 1)
+			col = col.cwiseMax(0.0);
+		else if (obs_ineq_flags[j] == -1)
+			col = col.cwiseMin(0.0);
+		if (w_mat)
+			col.array() *= w_mat->col(j).head(nrows).array();
+		else
+			col *= q_vec(j);
+		col.array() = col.array().square();
+	}
+	return resid.rowwise().sum();
+}
 
-	Eigen::MatrixXd w_mat;
-	if (weights->shape().first > 0)
-		w_mat = weights->get_eigen(vector<string>(), oe_base->get_var_names());
-	double phi;
+map<string, double> PhiHandler::reduce_phi(Eigen::MatrixXd &sq_resid, Eigen::VectorXd &phi_vec, const vector<string> &real_names,
+	const Eigen::SparseMatrix<double> &group_ind, const vector<string> &group_names,
+	map<string, map<string, double>> *group_phi_map)
+{
+	//key the per-row phi by realization name, skipping rows that are not in the base ensemble
+	unordered_set<string> base_real_names;
+	for (auto &n : oe_base->get_real_names())
+		base_real_names.insert(n);
+	unordered_set<string>::iterator end = base_real_names.end();
+	Eigen::MatrixXd group_phi;
+	if (group_phi_map)
+		group_phi = sq_resid * group_ind;
+	map<string, double> phi_map;
 	string rname;
-
-	Eigen::MatrixXd resid = get_obs_resid(oe);
-	assert(oe_real_names.size() == resid.rows());
-	for (int i = 0; i<resid.rows(); i++)
+	for (int i = 0; i < phi_vec.size(); i++)
 	{
-		rname = oe_real_names[i];
-		if (find(start, end, rname) == end)
+		rname = real_names[i];
+		if (base_real_names.find(rname) == end)
 			continue;
-		diff = resid.row(i);
-
-		if (weights->shape().first == 0)
-			diff = diff.cwiseProduct(q_vec);
-		else
+		phi_map[rname] = phi_vec(i);
+		if (group_phi_map)
 		{
-			w_vec = w_mat.row(i);
-			diff = diff.cwiseProduct(w_vec);
+			map<string, double> &gmap = (*group_phi_map)[rname];
+			for (int j = 0; j < group_names.size(); j++)
+				gmap[group_names[j]] = group_phi(i, j);
 		}
-		phi = (diff.cwiseProduct(diff)).sum();
-		phi_map[rname] = diff.cwiseProduct(diff);
 	}
 	return phi_map;
 }
 
-map<string, Eigen::VectorXd> PhiHandler::calc_regul(ParameterEnsemble & pe)
+map<string, double> PhiHandler::calc_meas(ObservationEnsemble & oe, Eigen::VectorXd &q_vec)
+{
+	vector<string> oe_real_names = oe.get_real_names();
+	Eigen::MatrixXd w_mat;
+	if (weights->shape().first > 0)
+		w_mat = weights->get_eigen(vector<string>(), oe_base->get_var_names());
+
+	Eigen::MatrixXd resid = oe.get_eigen(vector<string>(), oe_base->get_var_names());
+	resid -= oe_base->get_eigen(oe_real_names, vector<string>());
+	assert(oe_real_names.size() == resid.rows());
+	Eigen::VectorXd phi_vec = calc_obs_phi_vec(resid, q_vec, (weights->shape().first > 0) ? &w_mat : nullptr, nullptr);
+	return reduce_phi(resid, phi_vec, oe_real_names, obs_group_ind, obs_group_names, nullptr);
+}
+
+map<string, double> PhiHandler::calc_regul(ParameterEnsemble & pe, map<string, map<string, double>> &group_phi_map)
 {
-	map<string, Eigen::VectorXd> phi_map;
 	vector<string> real_names = pe.get_real_names();
 	pe_base->transform_ip(ParameterEnsemble::transStatus::NUM);
 	pe.transform_ip(ParameterEnsemble::transStatus::NUM);
 	Eigen::MatrixXd diff_mat = get_par_resid(pe);
+	if (diff_mat.cols() != parcov_inv_diag.size())
+		throw runtime_error("PhiHandler::calc_regul(): par resid cols != parcov size");
+	for (int j = 0; j < diff_mat.cols(); j++)
+		diff_mat.col(j).array() = diff_mat.col(j).array().square() * parcov_inv_diag(j);
+	Eigen::VectorXd phi_vec = diff_mat.rowwise().sum();
+	Eigen::MatrixXd group_phi = diff_mat * par_group_ind;
 
-
-	Eigen::VectorXd diff;
+	map<string, double> phi_map;
 	for (int i = 0; i < real_names.size(); i++)
 	{
-		diff = diff_mat.row(i);
-		diff = diff.cwiseProduct(diff);
-		diff = diff.cwiseProduct(parcov_inv_diag);
-		//phi_map[real_names[i]] = _reg_fac * diff;
-		phi_map[real_names[i]] = diff;
+		phi_map[real_names[i]] = phi_vec(i);
+		map<string, double> &gmap = group_phi_map[real_names[i]];
+		for (int j = 0; j < par_group_names.size(); j++)
+			gmap[par_group_names[j]] = group_phi(i, j);
 	}
 	return phi_map;
 }
@@ -568,78 +567,35 @@ map<string, Eigen::VectorXd> PhiHandler::calc_regul(ParameterEnsemble & pe)
 
 void PhiHandler::apply_ineq_constraints(Eigen::MatrixXd &resid, vector<string> &names)
 {
-	
-	//vector<string> names = oe_base->get_var_names();
-	//vector<string> lt_names = get_lt_obs_names(), gt_names = get_gt_obs_names();
-	//vector<string> act_obs_names = pest_scenario->get_ctl_ordered_nz_obs_names();
-	
 	assert(names.size() == resid.cols());
-
-	map<string, double> lt_vals,gt_vals;
-	Observations obs = pest_scenario->get_ctl_observations();
-	for (auto &n : lt_obs_names)
-		lt_vals[n] = obs.get_rec(n);
-	for (auto &n : gt_obs_names)
-		gt_vals[n] = obs.get_rec(n);
-	if ((lt_vals.size() == 0) && (gt_vals.size() == 0))
+	if ((lt_obs_names.size() == 0) && (gt_obs_names.size() == 0))
 		return;
-	map<string, int> idxs;
-	//for (int i = 0; i < act_obs_names.size(); i++)
-	//	idxs[act_obs_names[i]] = i;
+	unordered_map<string, int> idxs;
 	for (int i = 0; i < names.size(); i++)
 		idxs[names[i]] = i;
-	int idx;
-	double val;
-	Eigen::VectorXd col;
+	unordered_map<string, int>::iterator end = idxs.end(), it;
 
-	for (auto iv : lt_vals)
+	for (auto &n : lt_obs_names)
 	{
-		idx = idxs[iv.first];
-		col = resid.col(idx);
-		val = iv.second;
-		//cout << resid.col(idx) << endl;
-		for (int i = 0; i < resid.rows(); i++)
-			col(i) = (col(i) < 0.0) ? 0.0 : col(i);
-		//cout << resid.col(idx) << endl;
-		resid.col(idx) = col;
-		//cout << resid.col(idx) << endl;
+		if ((it = idxs.find(n)) == end)
+			continue;
+		resid.col(it->second) = resid.col(it->second).cwiseMax(0.0);
 	}
 
-	for (auto iv : gt_vals)
+	for (auto &n : gt_obs_names)
 	{
-		idx = idxs[iv.first];
-		col = resid.col(idx);
-		val = iv.second;
-		for (int i = 0; i < resid.rows(); i++)
-			col(i) = (col(i) > 0.0) ? 0.0 : col(i);
-		resid.col(idx) = col;
+		if ((it = idxs.find(n)) == end)
+			continue;
+		resid.col(it->second) = resid.col(it->second).cwiseMin(0.0);
 	}
 }
 
 
-map<string, Eigen::VectorXd> PhiHandler::calc_actual(ObservationEnsemble & oe, Eigen::VectorXd &q_vec)
+map<string, double> PhiHandler::calc_actual(ObservationEnsemble & oe, Eigen::VectorXd &q_vec, map<string, map<string, double>> &group_phi_map)
 {
-	map<string, Eigen::VectorXd> phi_map;
-	Eigen::MatrixXd resid = get_actual_obs_resid(oe);
-	vector<string> base_real_names = oe_base->get_real_names(), oe_real_names = oe.get_real_names();
-	vector<string>::iterator start = base_real_names.begin(), end = base_real_names.end();
-	double phi;
-	string rname;
-
-	Eigen::MatrixXd oe_reals = oe.get_eigen(vector<string>(), oe_base->get_var_names());
-	Eigen::VectorXd diff;
-	for (int i = 0; i<oe.shape().first; i++)
-	{
-		rname = oe_real_names[i];
-		if (find(start, end, rname) == end)
-			continue;
-		//diff = (oe_vec - obs_val_vec).cwiseProduct(q);
-		diff = resid.row(i);
-		diff = diff.cwiseProduct(q_vec);
-		//phi = (diff.cwiseProduct(diff)).sum();
-		phi_map[rname] = diff.cwiseProduct(diff);
-	}
-	return phi_map;
+	Eigen::MatrixXd resid = oe.get_eigen(vector<string>(), oe_base->get_var_names());
+	Eigen::VectorXd phi_vec = calc_obs_phi_vec(resid, q_vec, nullptr, &obs_vals);
+	return reduce_phi(resid, phi_vec, oe.get_real_names(), obs_group_ind, obs_group_names, &group_phi_map);
 }
 
 
@@ -742,6 +698,8 @@ IterEnsembleSmoother::IterEnsembleSmoother(Pest &_pest_scenario, FileManager &_f
 	oe.set_pest_scenario(&pest_scenario);
 	weights.set_pest_scenario(&pest_scenario);
 	localizer.set_pest_scenario(&pest_scenario);
+	num_tile_files = 0;
+	single_precision_obs = pest_scenario.get_pestpp_options().get_obs_storage_precision() == "single";
 }
 
 void IterEnsembleSmoother::throw_ies_error(string message)
@@ -808,9 +766,26 @@ bool IterEnsembleSmoother::initialize_pe(Covariance &cov)
 				throw_ies_error(string("error processing par jcb"));
 			}
 		}
+		else if (par_ext.compare("bin") == 0)
+		{
+			message(1, "loading par ensemble from dense binary file", par_csv);
+			try
+			{
+				pe.from_dense(par_csv);
+			}
+			catch (const exception &e)
+			{
+				ss << "error processing par dense binary file: " << e.what();
+				throw_ies_error(ss.str());
+			}
+			catch (...)
+			{
+				throw_ies_error(string("error processing par dense binary file"));
+			}
+		}
 		else
 		{
-			ss << "unrecognized par csv extension " << par_ext << ", looking for csv, jcb, or jco";
+			ss << "unrecognized par csv extension " << par_ext << ", looking for csv, jcb, jco, or bin";
 			throw_ies_error(ss.str());
 		}
 
@@ -1032,9 +1007,27 @@ bool IterEnsembleSmoother::initialize_oe(Covariance &cov)
 				throw_ies_error(string("error processing obs binary file"));
 			}
 		}
+		else if (obs_ext.compare("bin") == 0)
+		{
+			message(1, "loading obs ensemble from dense binary file", obs_csv);
+			try
+			{
+				oe.from_dense(obs_csv);
+			}
+			catch (const exception &e)
+			{
+				stringstream ss;
+				ss << "error processing obs dense binary file: " << e.what();
+				throw_ies_error(ss.str());
+			}
+			catch (...)
+			{
+				throw_ies_error(string("error processing obs dense binary file"));
+			}
+		}
 		else
 		{
-			ss << "unrecognized obs ensemble extension " << obs_ext << ", looing for csv, jcb, or jco";
+			ss << "unrecognized obs ensemble extension " << obs_ext << ", looing for csv, jcb, jco, or bin";
 			throw_ies_error(ss.str());
 		}
 		if (pp_args.find("IES_NUM_REALS") != pp_args.end())
@@ -1280,9 +1273,26 @@ void IterEnsembleSmoother::initialize_restart_oe()
 			throw_ies_error(string("error processing restart obs binary file"));
 		}
 	}
+	else if (obs_ext.compare("bin") == 0)
+	{
+		message(1, "loading restart obs ensemble from dense binary file", obs_restart_csv);
+		try
+		{
+			oe.from_dense(obs_restart_csv);
+		}
+		catch (const exception &e)
+		{
+			ss << "error processing restart obs dense binary file: " << e.what();
+			throw_ies_error(ss.str());
+		}
+		catch (...)
+		{
+			throw_ies_error(string("error processing restart obs dense binary file"));
+		}
+	}
 	else
 	{
-		ss << "unrecognized restart obs ensemble extension " << obs_ext << ", looing for csv, jcb, or jco";
+		ss << "unrecognized restart obs ensemble extension " << obs_ext << ", looing for csv, jcb, jco, or bin";
 		throw_ies_error(ss.str());
 	}
 
@@ -1463,9 +1473,26 @@ void IterEnsembleSmoother::initialize_weights()
 			throw_ies_error(string("error processing weights binary file"));
 		}
 	}
+	else if (obs_ext.compare("bin") == 0)
+	{
+		message(1, "loading weights ensemble from dense binary file", weights_csv);
+		try
+		{
+			weights.from_dense(weights_csv);
+		}
+		catch (const exception &e)
+		{
+			ss << "error processing weights dense binary file: " << e.what();
+			throw_ies_error(ss.str());
+		}
+		catch (...)
+		{
+			throw_ies_error(string("error processing weights dense binary file"));
+		}
+	}
 	else
 	{
-		ss << "unrecognized weights ensemble extension " << obs_ext << ", looking for csv, jcb, or jco";
+		ss << "unrecognized weights ensemble extension " << obs_ext << ", looking for csv, jcb, jco, or bin";
 		throw_ies_error(ss.str());
 	}
 
@@ -1594,6 +1621,7 @@ void IterEnsembleSmoother::initialize()
 	//ofstream &frec = file_manager.rec_ofstream();
 	last_best_mean = 1.0E+30;
 	last_best_std = 1.0e+30;
+	best_phi_yet = 1.0e+30;
 	lambda_max = 1.0E+30;
 	lambda_min = 1.0E-30;
 	warn_min_reals = 10;
@@ -1678,6 +1706,12 @@ void IterEnsembleSmoother::initialize()
 			message(1, ss.str());
 
 		}
+		if (ppo->get_ies_loc_par_coords().size() > 0)
+		{
+			ss.str("");
+			ss << "using distance-based localizer with '" << ppo->get_ies_loc_taper() << "' taper and radius " << ppo->get_ies_loc_radius();
+			message(1, ss.str());
+		}
 		if (localizer.get_how() == Localizer::How::OBSERVATIONS)
 			message(1, "localizing by obseravtions");
 		else
@@ -1700,7 +1734,18 @@ void IterEnsembleSmoother::initialize()
 
 	int num_reals = pest_scenario.get_pestpp_options().get_ies_num_reals();
 
-	bool pe_drawn = initialize_pe(parcov);
+	string ckpt_file = ppo->get_ies_restart_checkpoint();
+	if (ckpt_file.size() > 0)
+	{
+		if (pest_scenario.get_control_info().pestmode == ControlInfo::PestMode::PARETO)
+			throw_ies_error("'ies_restart_checkpoint' is not supported in pareto mode");
+		if (ppo->get_ies_obs_restart_csv().size() > 0)
+			throw_ies_error("'ies_restart_checkpoint' and 'ies_obs_restart_csv' cannot both be used");
+	}
+	//the ensembles come from the checkpoint when restarting from one
+	bool pe_drawn = false;
+	if (ckpt_file.size() == 0)
+		pe_drawn = initialize_pe(parcov);
 
 	if (pest_scenario.get_pestpp_options().get_ies_use_prior_scaling())
 	{
@@ -1720,6 +1765,12 @@ void IterEnsembleSmoother::initialize()
 		message(1, "not using prior parameter covariance matrix scaling");
 	}
 
+	if (ckpt_file.size() > 0)
+	{
+		initialize_from_checkpoint(ckpt_file);
+		return;
+	}
+
 	bool oe_drawn = initialize_oe(obscov);
 
 	try
@@ -1825,7 +1876,12 @@ void IterEnsembleSmoother::initialize()
 			add_bases();
 
 	ss.str("");
-	if (pest_scenario.get_pestpp_options().get_ies_save_binary())
+	if (pest_scenario.get_pestpp_options().get_ies_save_dense())
+	{
+		ss << file_manager.get_base_filename() << ".0.par.bin";
+		pe.to_dense(ss.str());
+	}
+	else if (pest_scenario.get_pestpp_options().get_ies_save_binary())
 	{
 		ss << file_manager.get_base_filename() << ".0.par.jcb";
 		pe.to_binary(ss.str());
@@ -1838,7 +1894,12 @@ void IterEnsembleSmoother::initialize()
 	message(1, "saved initial parameter ensemble to ", ss.str());
 
 	ss.str("");
-	if (pest_scenario.get_pestpp_options().get_ies_save_binary())
+	if (pest_scenario.get_pestpp_options().get_ies_save_dense())
+	{
+		ss << file_manager.get_base_filename() << ".base.obs.bin";
+		oe.to_dense(ss.str(), single_precision_obs);
+	}
+	else if (pest_scenario.get_pestpp_options().get_ies_save_binary())
 	{
 		ss << file_manager.get_base_filename() << ".base.obs.jcb";
 		oe.to_binary(ss.str());
@@ -1874,15 +1935,7 @@ void IterEnsembleSmoother::initialize()
 		oe_base = _oe;
 		oe_base.reorder(vector<string>(), act_obs_names);
 		//initialize the phi handler
-		ph = PhiHandler(&pest_scenario, &file_manager, &oe_base, &pe_base, &parcov, &reg_factor, &weights);
-		if (ph.get_lt_obs_names().size() > 0)
-		{
-			message(1, "less_than inequality defined for observations: ", ph.get_lt_obs_names().size());
-		}
-		if (ph.get_gt_obs_names().size())
-		{
-			message(1, "greater_than inequality defined for observations: ", ph.get_gt_obs_names().size());
-		}
+		initialize_phi_handler();
 		message(1, "running mean parameter values");
 
 		vector<int> failed_idxs = run_ensemble(_pe, _oe);
@@ -1913,6 +1966,9 @@ void IterEnsembleSmoother::initialize()
 		message(1, "subset how: ", how);
 		use_subset = true;
 	}
+	stream_remaining_idx = -1;
+	if (pest_scenario.get_pestpp_options().get_ies_stream_lambdas())
+		message(1, "streaming lambda testing: dominated lambdas are canceled as runs finish");
 
 	oe_org_real_names = oe.get_real_names();
 	pe_org_real_names = pe.get_real_names();
@@ -1946,7 +2002,12 @@ void IterEnsembleSmoother::initialize()
 			throw_ies_error("all realizations failed during initial evaluation");
 
 		ss.str("");
-		if (pest_scenario.get_pestpp_options().get_ies_save_binary())
+		if (pest_scenario.get_pestpp_options().get_ies_save_dense())
+		{
+			ss << file_manager.get_base_filename() << ".0.obs.bin";
+			oe.to_dense(ss.str(), single_precision_obs);
+		}
+		else if (pest_scenario.get_pestpp_options().get_ies_save_binary())
 		{
 			ss << file_manager.get_base_filename() << ".0.obs.jcb";
 			oe.to_binary(ss.str());
@@ -1971,16 +2032,7 @@ void IterEnsembleSmoother::initialize()
 
 	performance_log->log_event("calc initial phi");
 	//initialize the phi handler
-	ph = PhiHandler(&pest_scenario, &file_manager, &oe_base, &pe_base, &parcov, &reg_factor, &weights);
-
-	if (ph.get_lt_obs_names().size() > 0)
-	{
-		message(1, "less_than inequality defined for observations: ", ph.get_lt_obs_names().size());
-	}
-	if (ph.get_gt_obs_names().size())
-	{
-		message(1, "greater_than inequality defined for observations: ", ph.get_gt_obs_names().size());
-	}
+	initialize_phi_handler();
 
 	ph.update(oe, pe);
 	message(0, "pre-drop initial phi summary");
@@ -2029,9 +2081,237 @@ void IterEnsembleSmoother::initialize()
 	message(0, "initialization complete");
 
 	pcs = ParChangeSummarizer(&pe_base, &file_manager);
+
+	if (ppo->get_ies_checkpoint())
+	{
+		if (pest_scenario.get_control_info().pestmode == ControlInfo::PestMode::PARETO)
+		{
+			message(1, "'ies_checkpoint' is not supported in pareto mode, no checkpoints will be written");
+			ppo->set_ies_checkpoint(false);
+		}
+		else
+			write_checkpoint();
+	}
+
+	move_priors_to_disk();
 	
 }
 
+void IterEnsembleSmoother::initialize_phi_handler()
+{
+	ph = PhiHandler(&pest_scenario, &file_manager, &oe_base, &pe_base, &parcov, &reg_factor, &weights);
+	if (ph.get_lt_obs_names().size() > 0)
+	{
+		message(1, "less_than inequality defined for observations: ", ph.get_lt_obs_names().size());
+	}
+	if (ph.get_gt_obs_names().size())
+	{
+		message(1, "greater_than inequality defined for observations: ", ph.get_gt_obs_names().size());
+	}
+}
+
+void IterEnsembleSmoother::move_priors_to_disk()
+{
+	if (!pest_scenario.get_pestpp_options().get_ies_out_of_core())
+		return;
+	//the prior ensembles and weights are only read a few columns or rows at a time from here on
+	message(1, "moving prior par, prior obs and weights ensembles to disk, tile columns: ", pest_scenario.get_pestpp_options().get_ies_tile_cols());
+	to_disk(pe_base, "pe_base");
+	to_disk(oe_base, "oe_base", single_precision_obs);
+	if (weights.shape().first > 0)
+		to_disk(weights, "weights", single_precision_obs);
+}
+
+void IterEnsembleSmoother::initialize_from_checkpoint(const string &file_name)
+{
+	stringstream ss;
+	message(1, "restarting from checkpoint ", file_name);
+	performance_log->log_event("reading checkpoint " + file_name);
+	EnsembleCheckpoint ckpt;
+	try
+	{
+		ckpt = EnsembleCheckpoint::read(file_name);
+	}
+	catch (const exception &e)
+	{
+		throw_ies_error(string("error reading checkpoint: ") + e.what());
+	}
+	if (ckpt.pe_base.var_names != act_par_names)
+		throw_ies_error("checkpoint prior parameter ensemble does not match the adjustable parameters in the control file");
+	if (ckpt.oe_base.var_names != act_obs_names)
+		throw_ies_error("checkpoint prior observation ensemble does not match the non-zero weighted observations in the control file");
+
+	try
+	{
+		pe = ParameterEnsemble(&pest_scenario);
+		pe.from_eigen_mat(ckpt.pe.values, ckpt.pe.real_names, ckpt.pe.var_names, ParameterEnsemble::transStatus(ckpt.pe_trans_status));
+		pe.set_fixed_info(ckpt.fixed_names, ckpt.fixed_map);
+		pe.update_var_map();
+		pe_base = ParameterEnsemble(&pest_scenario);
+		pe_base.from_eigen_mat(ckpt.pe_base.values, ckpt.pe_base.real_names, ckpt.pe_base.var_names, ParameterEnsemble::transStatus(ckpt.pe_base_trans_status));
+		pe_base.set_fixed_info(ckpt.fixed_names, ckpt.fixed_map);
+		pe_base.update_var_map();
+		oe = ObservationEnsemble(&pest_scenario);
+		oe.from_eigen_mat(ckpt.oe.values, ckpt.oe.real_names, ckpt.oe.var_names);
+		oe.update_var_map();
+		//the prior obs ensemble and weights only hold the non-zero weighted obs
+		oe_base = ObservationEnsemble(&pest_scenario);
+		oe_base.Ensemble::from_eigen_mat(ckpt.oe_base.values, ckpt.oe_base.real_names, ckpt.oe_base.var_names);
+		oe_base.update_var_map();
+		weights = ObservationEnsemble(&pest_scenario);
+		weights.Ensemble::from_eigen_mat(ckpt.weights.values, ckpt.weights.real_names, ckpt.weights.var_names);
+		weights.update_var_map();
+	}
+	catch (const exception &e)
+	{
+		throw_ies_error(string("error loading checkpoint ensembles: ") + e.what());
+	}
+
+	iter = ckpt.iter;
+	last_best_lam = ckpt.last_best_lam;
+	last_best_mean = ckpt.last_best_mean;
+	last_best_std = ckpt.last_best_std;
+	best_phi_yet = ckpt.best_phi_yet;
+	reg_factor = ckpt.reg_factor;
+	consec_bad_lambda_cycles = ckpt.consec_bad_lambda_cycles;
+	best_mean_phis = ckpt.best_mean_phis;
+	subset_idxs = ckpt.subset_idxs;
+	oe_org_real_names = ckpt.oe_org_real_names;
+	pe_org_real_names = ckpt.pe_org_real_names;
+	istringstream rng_is(ckpt.rng_state);
+	rng_is >> Ensemble::rand_engine;
+	if (rng_is.fail())
+		throw_ies_error("error restoring random number generator state from checkpoint");
+	ckpt = EnsembleCheckpoint();
+
+	ss << "restored state at the end of iteration " << iter << ": " << pe.shape().first << " active realizations";
+	message(1, ss.str());
+	//as in initialize(), this is based on the initial ensemble size
+	use_subset = subset_size <= pe_org_real_names.size();
+	if (use_subset)
+	{
+		message(1, "using subset in lambda testing, only first ", subset_size);
+		message(1, "subset how: ", pest_scenario.get_pestpp_options().get_ies_subset_how());
+	}
+	stream_remaining_idx = -1;
+	if (pest_scenario.get_pestpp_options().get_ies_stream_lambdas())
+		message(1, "streaming lambda testing: dominated lambdas are canceled as runs finish");
+
+	performance_log->log_event("calc restart phi");
+	initialize_phi_handler();
+	ph.update(oe, pe);
+	message(0, "restart phi summary");
+	ph.report();
+	ph.write(iter, run_mgr_ptr->get_total_runs());
+	if (!pest_scenario.get_pestpp_options().get_ies_use_approx())
+	{
+		message(1, "using full (MAP) update solution");
+	}
+	message(1, "current lambda:", last_best_lam);
+	message(0, "initialization complete");
+
+	pcs = ParChangeSummarizer(&pe_base, &file_manager);
+	move_priors_to_disk();
+}
+
+void IterEnsembleSmoother::write_checkpoint()
+{
+	wait_for_checkpoint();
+	stringstream ss;
+	ss << file_manager.get_base_filename() << "." << iter << ".ckpt";
+	string state_file = ss.str();
+	string latest_file = file_manager.get_base_filename() + ".ckpt";
+	performance_log->log_event("copying state for checkpoint " + state_file);
+
+	//copy the state here - the write happens on another thread while this one moves on
+	shared_ptr<EnsembleCheckpoint> ckpt = make_shared<EnsembleCheckpoint>();
+	ckpt->iter = iter;
+	ckpt->last_best_lam = last_best_lam;
+	ckpt->last_best_mean = last_best_mean;
+	ckpt->last_best_std = last_best_std;
+	ckpt->best_phi_yet = best_phi_yet;
+	ckpt->reg_factor = reg_factor;
+	ckpt->consec_bad_lambda_cycles = consec_bad_lambda_cycles;
+	ckpt->best_mean_phis = best_mean_phis;
+	ckpt->subset_idxs = subset_idxs;
+	ckpt->oe_org_real_names = oe_org_real_names;
+	ckpt->pe_org_real_names = pe_org_real_names;
+	ckpt->pe_trans_status = pe.get_trans_status();
+	ckpt->pe_base_trans_status = pe_base.get_trans_status();
+	stringstream rng_ss;
+	rng_ss << Ensemble::rand_engine;
+	ckpt->rng_state = rng_ss.str();
+	ckpt->fixed_names = pe.get_fixed_names();
+	ckpt->fixed_map = pe.get_fixed_map();
+
+	//the prior ensembles may have been moved to disk
+	auto get_values = [](Ensemble &en) -> Eigen::MatrixXd
+	{
+		if (en.is_on_disk())
+			return en.get_eigen(vector<string>(), en.get_var_names());
+		return *en.get_eigen_ptr();
+	};
+	ckpt->pe.real_names = pe.get_real_names();
+	ckpt->pe.var_names = pe.get_var_names();
+	ckpt->pe.values = get_values(pe);
+	ckpt->oe.real_names = oe.get_real_names();
+	ckpt->oe.var_names = oe.get_var_names();
+	ckpt->oe.values = get_values(oe);
+	ckpt->pe_base.real_names = pe_base.get_real_names();
+	ckpt->pe_base.var_names = pe_base.get_var_names();
+	ckpt->oe_base.real_names = oe_base.get_real_names();
+	ckpt->oe_base.var_names = oe_base.get_var_names();
+	ckpt->weights.real_names = weights.get_real_names();
+	ckpt->weights.var_names = weights.get_var_names();
+	if (ckpt_pe_base_file.size() == 0)
+	{
+		ckpt->pe_base.values = get_values(pe_base);
+		ckpt->oe_base.values = get_values(oe_base);
+		if (weights.shape().first > 0)
+			ckpt->weights.values = get_values(weights);
+		else
+			ckpt->weights.values.resize(0, ckpt->weights.var_names.size());
+		ckpt_pe_base_file = state_file + ".pe_base";
+		ckpt_oe_base_file = state_file + ".oe_base";
+		ckpt_weights_file = state_file + ".weights";
+	}
+	else
+	{
+		ckpt->pe_base.file_name = ckpt_pe_base_file;
+		ckpt->oe_base.file_name = ckpt_oe_base_file;
+		ckpt->weights.file_name = ckpt_weights_file;
+	}
+
+	message(1, "writing checkpoint ", state_file);
+	checkpoint_future = async(launch::async, [ckpt, state_file, latest_file]()
+	{
+		ckpt->write(state_file, latest_file);
+	});
+}
+
+void IterEnsembleSmoother::wait_for_checkpoint()
+{
+	if (!checkpoint_future.valid())
+		return;
+	try
+	{
+		checkpoint_future.get();
+	}
+	catch (const exception &e)
+	{
+		throw_ies_error(string("error writing checkpoint: ") + e.what());
+	}
+}
+
+void IterEnsembleSmoother::to_disk(Ensemble &en, const string &tag, bool single_precision)
+{
+	//each scratch file gets a new name since copies of an ensemble share its file
+	stringstream ss;
+	ss << file_manager.get_base_filename() << "." << tag << "." << num_tile_files << ".tiles";
+	num_tile_files++;
+	en.to_disk(ss.str(), pest_scenario.get_pestpp_options().get_ies_tile_cols(), single_precision);
+}
+
 Eigen::MatrixXd IterEnsembleSmoother::get_Am(const vector<string> &real_names, const vector<string> &par_names)
 {
 
@@ -2299,8 +2579,9 @@ void IterEnsembleSmoother::iterate_2_solution()
 		pareto_iterate_2_solution();
 	else
 	{
-		bool accept;
-		for (int i = 0; i < pest_scenario.get_control_info().noptmax; i++)
+		bool accept, done;
+		//iter is only non-zero here when restarting from a checkpoint
+		for (int i = iter; i < pest_scenario.get_control_info().noptmax; i++)
 		{
 			iter++;
 			message(0, "starting solve for iteration:", iter);
@@ -2319,7 +2600,10 @@ void IterEnsembleSmoother::iterate_2_solution()
 			else
 				consec_bad_lambda_cycles++;
 
-			if (should_terminate())
+			done = should_terminate();
+			if (pest_scenario.get_pestpp_options().get_ies_checkpoint())
+				write_checkpoint();
+			if (done)
 				break;
 		}
 	}
@@ -2675,24 +2959,95 @@ bool IterEnsembleSmoother::should_terminate()
 //}
 
 
-LocalUpgradeThread::LocalUpgradeThread(map<string, Eigen::VectorXd> &_par_resid_map, map<string, Eigen::VectorXd> &_par_diff_map,
-	map<string, Eigen::VectorXd> &_obs_resid_map, map<string, Eigen::VectorXd> &_obs_diff_map,
-	Localizer &_localizer, map<string, double> &_parcov_inv_map,map<string, double> &_weight_map, 
-	ParameterEnsemble &_pe_upgrade, map<string,pair<vector<string>,vector<string>>> &_cases,
-	map<string, Eigen::VectorXd> &_Am_map, Localizer::How &_how): par_resid_map(_par_resid_map),
-	par_diff_map(_par_diff_map), obs_resid_map(_obs_resid_map),obs_diff_map(_obs_diff_map),localizer(_localizer),
-	pe_upgrade(_pe_upgrade),cases(_cases), parcov_inv_map(_parcov_inv_map), weight_map(_weight_map), Am_map(_Am_map)
+LocalUpgradeThread::LocalUpgradeThread(const map<string, Eigen::VectorXd> &_par_resid_map, const map<string, Eigen::VectorXd> &_par_diff_map,
+	const map<string, Eigen::VectorXd> &_obs_resid_map, const map<string, Eigen::VectorXd> &_obs_diff_map,
+	Localizer &_localizer, const map<string, double> &_parcov_inv_map, const map<string, double> &_weight_map, 
+	ParameterEnsemble &_pe_upgrade, const map<string,pair<vector<string>,vector<string>>> &_cases,
+	const map<string, Eigen::VectorXd> &_Am_map, Localizer::How &_how): cases(_cases), pe_upgrade(_pe_upgrade),
+	localizer(_localizer), parcov_inv_map(_parcov_inv_map), weight_map(_weight_map), par_resid_map(_par_resid_map),
+	par_diff_map(_par_diff_map), Am_map(_Am_map), obs_resid_map(_obs_resid_map), obs_diff_map(_obs_diff_map)
 {
 	how = _how;
-	parcov_inv_map = _parcov_inv_map;
-	weight_map = _weight_map;
-	count = 0;
+	next_group = 0;
 	for (auto &c : cases)
 	{
 		keys.push_back(c.first);
 	}
 	random_shuffle(keys.begin(), keys.end());
 
+	//the control settings are read once here so the threads never touch the scenario
+	Pest *pest_scenario_ptr = pe_upgrade.get_pest_scenario_ptr();
+	maxsing = pest_scenario_ptr->get_svd_info().maxsing;
+	eigthresh = pest_scenario_ptr->get_svd_info().eigthresh;
+	use_approx = pest_scenario_ptr->get_pestpp_options().get_ies_use_approx();
+	use_prior_scaling = pest_scenario_ptr->get_pestpp_options().get_ies_use_prior_scaling();
+	verbose_level = pest_scenario_ptr->get_pestpp_options().get_ies_verbose_level();
+	use_propack = pest_scenario_ptr->get_pestpp_options().get_svd_pack() == PestppOptions::SVD_PACK::PROPACK;
+	num_reals = pe_upgrade.shape().first;
+
+	//assign each case its columns of the upgrade matrix
+	vector<string> upgrade_names = pe_upgrade.get_var_names();
+	map<string, int> upgrade_idx;
+	for (int i = 0; i < upgrade_names.size(); i++)
+		upgrade_idx[upgrade_names[i]] = i;
+	upgrade = pe_upgrade.get_eigen();
+	vector<int> col_count(upgrade_names.size(), 0);
+	vector<string> missing;
+	for (auto &k : keys)
+	{
+		vector<int> cols;
+		for (auto &name : cases.at(k).second)
+		{
+			auto found = upgrade_idx.find(name);
+			if (found == upgrade_idx.end())
+			{
+				missing.push_back(name);
+				continue;
+			}
+			cols.push_back(found->second);
+			col_count[found->second]++;
+		}
+		case_cols.push_back(cols);
+	}
+	if (missing.size() > 0)
+		pe_upgrade.throw_ensemble_error("LocalUpgradeThread: the following par names were not found in the upgrade ensemble", missing);
+	shared_col.resize(col_count.size());
+	for (int i = 0; i < col_count.size(); i++)
+		shared_col[i] = col_count[i] > 1;
+
+	//group the cases by their obs names so each distinct obs diff SVD is only done once.  A case
+	//that localizes the obs side has its own obs diff matrix so it is always a group of one
+	map<vector<string>, int> group_map;
+	for (int i = 0; i < keys.size(); i++)
+	{
+		const string &k = keys[i];
+		const pair<vector<string>, vector<string>> &p = cases.at(k);
+		bool use_loc = false;
+		bool loc_obs = false;
+		if (localizer.get_use())
+		{
+			if ((how != Localizer::How::PARAMETERS) && (p.second.size() == 1) && (k == p.second[0]))
+				use_loc = true;
+			else if ((how == Localizer::How::PARAMETERS) && (p.first.size() == 1) && (k == p.first[0]))
+			{
+				use_loc = true;
+				loc_obs = true;
+			}
+		}
+		case_loc.push_back(use_loc);
+		if (!loc_obs)
+		{
+			auto found = group_map.find(p.first);
+			if (found != group_map.end())
+			{
+				groups[found->second].push_back(i);
+				continue;
+			}
+			group_map[p.first] = groups.size();
+		}
+		groups.push_back(vector<int>(1, i));
+	}
+
 }
 
 
@@ -2701,7 +3056,7 @@ void LocalUpgradeThread::work(int thread_id, int iter, double cur_lam)
 	class local_utils
 	{
 	public:
-		static Eigen::DiagonalMatrix<double, Eigen::Dynamic> get_matrix_from_map(vector<string> &names, map<string, double> &dmap)
+		static Eigen::DiagonalMatrix<double, Eigen::Dynamic> get_matrix_from_map(const vector<string> &names, const map<string, double> &dmap)
 		{
 			Eigen::VectorXd vec(names.size());
 			int i = 0;
@@ -2713,14 +3068,14 @@ void LocalUpgradeThread::work(int thread_id, int iter, double cur_lam)
 			Eigen::DiagonalMatrix<double, Eigen::Dynamic> m = vec.asDiagonal();
 			return m;
 		}
-		static Eigen::MatrixXd get_matrix_from_map(int num_reals, vector<string> &names, map<string, Eigen::VectorXd> &emap)
+		static Eigen::MatrixXd get_matrix_from_map(int num_reals, const vector<string> &names, const map<string, Eigen::VectorXd> &emap)
 		{
 			Eigen::MatrixXd mat(num_reals, names.size());
 			mat.setZero();
 
 			for (int j = 0; j < names.size(); j++)
 			{
-				mat.col(j) = emap[names[j]];
+				mat.col(j) = emap.at(names[j]);
 			}
 
 			return mat;
@@ -2747,203 +3102,43 @@ void LocalUpgradeThread::work(int thread_id, int iter, double cur_lam)
 		}
 	};
 
-	unique_lock<mutex> ctrl_guard(ctrl_lock, defer_lock);
-	int maxsing, num_reals, verbose_level;
-	double eigthresh;
-	bool use_approx;
-	bool use_prior_scaling;
-	bool use_localizer = false;
 	bool loc_by_obs = true;
+	if (how == Localizer::How::PARAMETERS)
+		loc_by_obs = false;
 
+	Eigen::MatrixXd obs_resid, obs_diff;
+	Eigen::VectorXd loc;
+	Eigen::DiagonalMatrix<double, Eigen::Dynamic> weights;
 	while (true)
 	{
-		if (ctrl_guard.try_lock())
-		{
-			maxsing = pe_upgrade.get_pest_scenario_ptr()->get_svd_info().maxsing;
-			eigthresh = pe_upgrade.get_pest_scenario_ptr()->get_svd_info().eigthresh;
-			use_approx = pe_upgrade.get_pest_scenario_ptr()->get_pestpp_options().get_ies_use_approx();
-			use_prior_scaling = pe_upgrade.get_pest_scenario_ptr()->get_pestpp_options().get_ies_use_prior_scaling();
-			num_reals = pe_upgrade.shape().first;
-			verbose_level = pe_upgrade.get_pest_scenario_ptr()->get_pestpp_options().get_ies_verbose_level();
-			ctrl_guard.unlock();
-			//if (pe_upgrade.get_pest_scenario_ptr()->get_pestpp_options().get_ies_localize_how()[0] == 'P')
-			if (how == Localizer::How::PARAMETERS)
-				loc_by_obs = false;
-			break;
-		}
-	}
-
-	Eigen::MatrixXd par_resid, par_diff, Am;
-	Eigen::MatrixXd obs_resid, obs_diff, loc;
-	Eigen::DiagonalMatrix<double, Eigen::Dynamic> weights, parcov_inv;
-	vector<string> par_names, obs_names;
-	while (true)
-	{
-		unique_lock<mutex> next_guard(next_lock, defer_lock);
-		par_names.clear();
-		obs_names.clear();
-		use_localizer = false;
 		//the end condition
-		while (true)
-		{	
-			if (next_guard.try_lock())
-			{
-				if (count == keys.size())
-				{
-					return;
-				}
-				string k = keys[count];
-				pair<vector<string>, vector<string>> p = cases.at(k);
-				par_names = p.second;
-				obs_names = p.first;
-				if (localizer.get_use())
-				{
-					if ((loc_by_obs) && (par_names.size() == 1) && (k == par_names[0]))
-						use_localizer = true;
-					else if ((!loc_by_obs) && (obs_names.size() == 1) && (k == obs_names[0]))
-					{
-						use_localizer = true;
-						//loc_by_obs = false;
-					}
-				}
-				count++;
-				next_guard.unlock();
-				break;
-			}
-		}
-		
-		par_resid.resize(0, 0);
-		par_diff.resize(0, 0);
-		obs_resid.resize(0, 0);
-		obs_diff.resize(0, 0);
-		loc.resize(0, 0);
-		Am.resize(0, 0);
-		weights.resize(0);
-		parcov_inv.resize(0);
-		Am.resize(0, 0);
-
-		unique_lock<mutex> obs_diff_guard(obs_diff_lock, defer_lock);
-		unique_lock<mutex> obs_resid_guard(obs_resid_lock, defer_lock);
-		unique_lock<mutex> par_diff_guard(par_diff_lock, defer_lock);
-		unique_lock<mutex> par_resid_guard(par_resid_lock, defer_lock);
-		unique_lock<mutex> loc_guard(loc_lock, defer_lock);
-		unique_lock<mutex> weight_guard(weight_lock, defer_lock);
-		unique_lock<mutex> parcov_guard(parcov_lock, defer_lock);
-		unique_lock<mutex> am_guard(am_lock, defer_lock);
-
-		bool use_propack = false;
-
-		while (true)
-		{
-			if (((use_approx) || (par_resid.rows() > 0)) &&
-				(weights.size() > 0) &&
-				(parcov_inv.size() > 0) &&
-				(par_diff.rows() > 0) &&
-				(obs_resid.rows() > 0) &&
-				(obs_diff.rows() > 0) &&
-				((!use_localizer) || (loc.rows() > 0)) && 
-				((use_approx) || (Am.rows() > 0)))
-				break;
-			if ((use_localizer) && (loc.rows() == 0) && (loc_guard.try_lock()))
-			{
-				if (loc_by_obs)
-					loc = localizer.get_localizing_par_hadamard_matrix(num_reals, obs_names[0], par_names);
-				else
-					loc = localizer.get_localizing_obs_hadamard_matrix(num_reals, par_names[0], obs_names);
-				loc_guard.unlock();
-			}
-			if ((obs_diff.rows() == 0) && (obs_diff_guard.try_lock()))
-			{
-				//piggy back here for thread safety
-				if (pe_upgrade.get_pest_scenario_ptr()->get_pestpp_options().get_svd_pack() == PestppOptions::SVD_PACK::PROPACK)
-					use_propack = true;
-				obs_diff = local_utils::get_matrix_from_map(num_reals, obs_names, obs_diff_map);
-				obs_diff_guard.unlock();
-			}
-			if ((obs_resid.rows() == 0) && (obs_resid_guard.try_lock()))
-			{
-				obs_resid = local_utils::get_matrix_from_map(num_reals, obs_names, obs_resid_map);
-				obs_resid_guard.unlock();
-			}
-			if ((par_diff.rows() == 0) && (par_diff_guard.try_lock()))
-			{
-				par_diff = local_utils::get_matrix_from_map(num_reals, par_names, par_diff_map);
-				par_diff_guard.unlock();
-			}
-			if ((par_resid.rows() == 0) && (par_resid_guard.try_lock()))
-			{
-				par_resid = local_utils::get_matrix_from_map(num_reals, par_names, par_resid_map);
-				par_resid_guard.unlock();
-			}
-			if ((weights.rows() == 0) && (weight_guard.try_lock()))
-			{
-				weights = local_utils::get_matrix_from_map(obs_names, weight_map);
-				weight_guard.unlock();
-			}
-			if ((parcov_inv.rows() == 0) && (parcov_guard.try_lock()))
-			{
-				parcov_inv = local_utils::get_matrix_from_map(par_names, parcov_inv_map);
-				parcov_guard.unlock();
-			}
-			if ((!use_approx) && (Am.rows() == 0) && (am_guard.try_lock()))
-			{
-				//Am = local_utils::get_matrix_from_map(num_reals, par_names, Am_map).transpose();
-				int am_cols = Am_map[par_names[0]].size();
-				Am.resize(par_names.size(),am_cols);
-				Am.setZero();
+		int igroup = next_group++;
+		if (igroup >= (int)groups.size())
+			return;
+		const vector<int> &group = groups[igroup];
+		const vector<string> &obs_names = cases.at(keys[group[0]]).first;
 
-				for (int j = 0; j < par_names.size(); j++)
-				{
-					Am.row(j) = Am_map[par_names[j]];
-				}
-				am_guard.unlock();
-			}
-		}
-		
-		par_diff.transposeInPlace();
+		//the observation side of the solve is the same for every case in the group
+		obs_diff = local_utils::get_matrix_from_map(num_reals, obs_names, obs_diff_map);
+		obs_resid = local_utils::get_matrix_from_map(num_reals, obs_names, obs_resid_map);
+		weights = local_utils::get_matrix_from_map(obs_names, weight_map);
 		obs_diff.transposeInPlace();
 		obs_resid.transposeInPlace();
-		par_resid.transposeInPlace();
 
 		local_utils::save_mat(verbose_level, thread_id, iter, "obs_resid", obs_resid);
 		Eigen::MatrixXd scaled_residual = weights * obs_resid;
-		
-		
-
-		local_utils::save_mat(verbose_level, thread_id, iter, "par_resid", par_resid);
-		Eigen::MatrixXd scaled_par_resid;
-		if ((!use_approx) && (iter > 1))
-		{
-			if (use_prior_scaling)
-			{
-				scaled_par_resid = parcov_inv * par_resid;
-			}
-			else
-			{
-				scaled_par_resid = par_resid;
-			}
-		}
-
-		stringstream ss;
+		obs_resid.resize(0, 0);
 
 		double scale = (1.0 / (sqrt(double(num_reals - 1))));
 		local_utils::save_mat(verbose_level, thread_id, iter, "obs_diff", obs_diff);
-		if (use_localizer)
+		if ((case_loc[group[0]]) && (!loc_by_obs))
 		{
-			if (loc_by_obs)
-				par_diff = par_diff.cwiseProduct(loc);
-			else	
-				obs_diff = obs_diff.cwiseProduct(loc);
-
+			//localizing the obs side makes the group a single case
+			const vector<string> &par_names = cases.at(keys[group[0]]).second;
+			loc = localizer.get_obs_localizing_vector(par_names[0], obs_names);
+			obs_diff.array().colwise() *= loc.array();
 		}
-		
 		obs_diff = scale * (weights * obs_diff);
-		local_utils::save_mat(verbose_level, thread_id, iter, "par_diff", par_diff);
-		if (use_prior_scaling)
-			par_diff = scale * parcov_inv * par_diff;
-		else
-			par_diff = scale * par_diff;
-
 
 		//performance_log->log_event("SVD of obs diff");
 		Eigen::MatrixXd ivec, upgrade_1, s, V, Ut;
@@ -2977,72 +3172,141 @@ void LocalUpgradeThread::work(int thread_id, int iter, double cur_lam)
 		local_utils::save_mat(verbose_level, thread_id, iter, "X2", X2);
 		Eigen::MatrixXd X3 = V * s.asDiagonal() * X2;
 		X2.resize(0, 0);
-
 		local_utils::save_mat(verbose_level, thread_id, iter, "X3", X3);
-		if (use_prior_scaling)
-		{
-			upgrade_1 = -1.0 * parcov_inv * par_diff * X3;
-		}
-		else
+
+		bool use_upgrade_2 = (!use_approx) && (iter > 1);
+		Eigen::MatrixXd V_ivec_Vt;
+		if (use_upgrade_2)
+			V_ivec_Vt = V * ivec * V.transpose();
+
+		//stack the (scaled) par diff rows of every case in the group so the first upgrade
+		//term is a single product against X3
+		int total_pars = 0;
+		for (auto icase : group)
+			total_pars += case_cols[icase].size();
+		vector<Eigen::MatrixXd> par_diffs;
+		Eigen::MatrixXd par_diff_stack(total_pars, num_reals);
+		int offset = 0;
+		for (auto icase : group)
 		{
-			upgrade_1 = -1.0 * par_diff * X3;
+			const vector<string> &par_names = cases.at(keys[icase]).second;
+			Eigen::MatrixXd par_diff = local_utils::get_matrix_from_map(num_reals, par_names, par_diff_map);
+			par_diff.transposeInPlace();
+			if ((case_loc[icase]) && (loc_by_obs))
+			{
+				loc = localizer.get_par_localizing_vector(obs_names[0], par_names);
+				par_diff.array().colwise() *= loc.array();
+			}
+			local_utils::save_mat(verbose_level, thread_id, iter, "par_diff", par_diff);
+			if (use_prior_scaling)
+			{
+				Eigen::DiagonalMatrix<double, Eigen::Dynamic> parcov_inv = local_utils::get_matrix_from_map(par_names, parcov_inv_map);
+				par_diff = scale * parcov_inv * par_diff;
+				par_diff_stack.middleRows(offset, par_names.size()) = parcov_inv * par_diff;
+			}
+			else
+			{
+				par_diff = scale * par_diff;
+				par_diff_stack.middleRows(offset, par_names.size()) = par_diff;
+			}
+			offset += par_names.size();
+			if (use_upgrade_2)
+				par_diffs.push_back(par_diff);
 		}
+		upgrade_1 = -1.0 * par_diff_stack * X3;
+		par_diff_stack.resize(0, 0);
+		X3.resize(0, 0);
 		upgrade_1.transposeInPlace();
 		local_utils::save_mat(verbose_level, thread_id, iter, "upgrade_1",upgrade_1);
-		X3.resize(0, 0);
-
 
-		Eigen::MatrixXd upgrade_2;
-		if ((!use_approx) && (iter > 1))
+		if (use_upgrade_2)
 		{
-			local_utils::save_mat(verbose_level, thread_id, iter, "Am",Am);
-			Eigen::MatrixXd x4 = Am.transpose() * scaled_par_resid;
-			local_utils::save_mat(verbose_level, thread_id, iter, "X4", x4);
-			
-			par_resid.resize(0, 0);
+			offset = 0;
+			for (int i = 0; i < group.size(); i++)
+			{
+				const vector<string> &par_names = cases.at(keys[group[i]]).second;
+				Eigen::MatrixXd &par_diff = par_diffs[i];
+				Eigen::MatrixXd par_resid = local_utils::get_matrix_from_map(num_reals, par_names, par_resid_map);
+				par_resid.transposeInPlace();
+				local_utils::save_mat(verbose_level, thread_id, iter, "par_resid", par_resid);
+				Eigen::DiagonalMatrix<double, Eigen::Dynamic> parcov_inv = local_utils::get_matrix_from_map(par_names, parcov_inv_map);
+				Eigen::MatrixXd scaled_par_resid;
+				if (use_prior_scaling)
+				{
+					scaled_par_resid = parcov_inv * par_resid;
+				}
+				else
+				{
+					scaled_par_resid = par_resid;
+				}
+				par_resid.resize(0, 0);
 
-			Eigen::MatrixXd x5 = Am * x4;
-			x4.resize(0, 0);
-			Am.resize(0, 0);
+				int am_cols = Am_map.at(par_names[0]).size();
+				Eigen::MatrixXd Am(par_names.size(), am_cols);
+				for (int j = 0; j < par_names.size(); j++)
+				{
+					Am.row(j) = Am_map.at(par_names[j]);
+				}
+				local_utils::save_mat(verbose_level, thread_id, iter, "Am",Am);
+				Eigen::MatrixXd x4 = Am.transpose() * scaled_par_resid;
+				local_utils::save_mat(verbose_level, thread_id, iter, "X4", x4);
 
-			local_utils::save_mat(verbose_level, thread_id, iter, "X5", x5);
-			Eigen::MatrixXd x6 = par_diff.transpose() * x5;
-			x5.resize(0, 0);
+				Eigen::MatrixXd x5 = Am * x4;
+				x4.resize(0, 0);
+				Am.resize(0, 0);
 
-			local_utils::save_mat(verbose_level, thread_id, iter, "X6", x6);
-			Eigen::MatrixXd x7 = V * ivec *V.transpose() * x6;
-			x6.resize(0, 0);
+				local_utils::save_mat(verbose_level, thread_id, iter, "X5", x5);
+				Eigen::MatrixXd x6 = par_diff.transpose() * x5;
+				x5.resize(0, 0);
 
-			if (use_prior_scaling)
-			{
-				upgrade_2 = -1.0 * parcov_inv * par_diff * x7;
-			}
-			else
-			{
-				upgrade_2 = -1.0 * (par_diff * x7);
-			}
-			x7.resize(0, 0);
+				local_utils::save_mat(verbose_level, thread_id, iter, "X6", x6);
+				Eigen::MatrixXd x7 = V_ivec_Vt * x6;
+				x6.resize(0, 0);
 
-			upgrade_1 = upgrade_1 + upgrade_2.transpose();
-			local_utils::save_mat(verbose_level, thread_id, iter, "upgrade_2", upgrade_2);
-			upgrade_2.resize(0, 0);
+				Eigen::MatrixXd upgrade_2;
+				if (use_prior_scaling)
+				{
+					upgrade_2 = -1.0 * parcov_inv * par_diff * x7;
+				}
+				else
+				{
+					upgrade_2 = -1.0 * (par_diff * x7);
+				}
+				x7.resize(0, 0);
+				par_diff.resize(0, 0);
 
+				upgrade_1.middleCols(offset, par_names.size()) += upgrade_2.transpose();
+				local_utils::save_mat(verbose_level, thread_id, iter, "upgrade_2", upgrade_2);
+				offset += par_names.size();
+			}
 		}
 		
-		unique_lock<mutex> put_guard(put_lock, defer_lock);
-		while (true)
+		//the columns of a case are only written by this thread unless another case shares them
+		offset = 0;
+		for (auto icase : group)
 		{
-			if (put_guard.try_lock())
+			const vector<int> &cols = case_cols[icase];
+			for (int j = 0; j < cols.size(); j++)
 			{
-				pe_upgrade.add_2_cols_ip(par_names, upgrade_1);
-				put_guard.unlock();
-				break;
+				if (shared_col[cols[j]])
+				{
+					lock_guard<mutex> col_guard(col_locks[cols[j] % num_col_locks]);
+					upgrade.col(cols[j]) += upgrade_1.col(offset + j);
+				}
+				else
+					upgrade.col(cols[j]) += upgrade_1.col(offset + j);
 			}
+			offset += cols.size();
 		}
 	}
 
 }
 
+void LocalUpgradeThread::put_upgrade()
+{
+	pe_upgrade.set_eigen(upgrade);
+}
+
 
 
 void upgrade_thread_function(int id, int iter,double cur_lam, LocalUpgradeThread &worker, exception_ptr &eptr)
@@ -3065,7 +3329,7 @@ ParameterEnsemble IterEnsembleSmoother::calc_localized_upgrade_threaded(double c
 	stringstream ss;
 	
 	ObservationEnsemble oe_upgrade(oe.get_pest_scenario_ptr(), oe.get_eigen(vector<string>(), act_obs_names, false), oe.get_real_names(), act_obs_names);
-	ParameterEnsemble pe_upgrade(pe.get_pest_scenario_ptr(), pe.get_eigen(vector<string>(), act_par_names, false), pe.get_real_names(), act_par_names);
+	ParameterEnsemble pe_upgrade(pe.get_pest_scenario_ptr(), Eigen::MatrixXd::Zero(pe.shape().first, act_par_names.size()), pe.get_real_names(), act_par_names);
 	
 	//this copy of the localizer map will be consumed by the worker threads
 	map<string, pair<vector<string>, vector<string>>> loc_map;
@@ -3121,16 +3385,27 @@ ParameterEnsemble IterEnsembleSmoother::calc_localized_upgrade_threaded(double c
 	{
 		obs_diff_map[obs_names[i]] = mat.col(i);
 	}
-	mat = ph.get_par_resid_subset(pe_upgrade);
-	for (int i = 0; i <par_names.size(); i++)
-	{
-		par_resid_map[par_names[i]] = mat.col(i);
-	}	
-	mat = pe_upgrade.get_eigen_mean_diff();
-	for (int i = 0; i <par_names.size(); i++)
-	{
-		par_diff_map[par_names[i]] = mat.col(i);
+	//the par resid and diff vectors are formed a block of parameters at a time so that only one block
+	//of the (possibly very wide) dense par matrices is held alongside the maps
+	vector<string> real_names = pe.get_real_names();
+	pe_base.update_var_map();
+	int block_size = max(pest_scenario.get_pestpp_options().get_ies_tile_cols(), 1);
+	Eigen::MatrixXd resid;
+	double mean;
+	for (int start = 0; start < par_names.size(); start += block_size)
+	{
+		vector<string> block_names(par_names.begin() + start,
+			par_names.begin() + min(start + block_size, (int)par_names.size()));
+		mat = pe.get_eigen(vector<string>(), block_names, false);
+		resid = mat - pe_base.get_eigen(real_names, block_names, false);
+		for (int i = 0; i < block_names.size(); i++)
+		{
+			par_resid_map[block_names[i]] = resid.col(i);
+			mean = mat.col(i).mean();
+			par_diff_map[block_names[i]] = mat.col(i) - (Eigen::VectorXd::Ones(mat.rows()) * mean);
+		}
 	}
+	resid.resize(0, 0);
 	if (!pest_scenario.get_pestpp_options().get_ies_use_approx())
 	{
 		mat = get_Am(pe_upgrade.get_real_names(), pe_upgrade.get_var_names());
@@ -3140,8 +3415,6 @@ ParameterEnsemble IterEnsembleSmoother::calc_localized_upgrade_threaded(double c
 		}
 	}
 	mat.resize(0, 0);
-	// clear the upgrade ensemble
-	pe_upgrade.set_zeros();
 	Localizer::How _how = localizer.get_how();
 	LocalUpgradeThread worker(par_resid_map, par_diff_map, obs_resid_map, obs_diff_map,
 		localizer, parcov_inv_map, weight_map, pe_upgrade, loc_map, Am_map, _how);
@@ -3165,14 +3438,12 @@ ParameterEnsemble IterEnsembleSmoother::calc_localized_upgrade_threaded(double c
 
 		for (int i = 0; i < num_threads; i++)
 		{
-			//threads.push_back(thread(&LocalUpgradeThread::work, &worker, i, iter, cur_lam));
-			
 			threads.push_back(thread(upgrade_thread_function, i, iter, cur_lam, std::ref(worker),std::ref( exception_ptrs[i])));
-			
 		}
 		message(2, "waiting to join threads");
-		//for (auto &t : threads)
-		//	t.join();
+		//join all the threads before checking for exceptions so none are left running
+		for (auto &t : threads)
+			t.join();
 		for (int i = 0; i < num_threads; ++i)
 		{
 			if (exception_ptrs[i])
@@ -3188,10 +3459,10 @@ ParameterEnsemble IterEnsembleSmoother::calc_localized_upgrade_threaded(double c
 					throw runtime_error(ss.str());
 				}
 			}
-			threads[i].join();
 		}
 		message(2, "threaded localized upgrade calculation done");
 	}
+	worker.put_upgrade();
 	
 	return pe_upgrade;
 }
@@ -3280,6 +3551,9 @@ bool IterEnsembleSmoother::solve_new()
 			pe_lam_scale.set_eigen(*pe_lam_scale.get_eigen_ptr() + (*pe_upgrade.get_eigen_ptr() * sf));
 			if (pest_scenario.get_pestpp_options().get_ies_enforce_bounds())
 				pe_lam_scale.enforce_bounds();
+			//only one lambda ensemble is held in memory at a time, the rest wait on disk for their runs
+			if (pest_scenario.get_pestpp_options().get_ies_out_of_core())
+				to_disk(pe_lam_scale, "lambda");
 			pe_lams.push_back(pe_lam_scale);
 			lam_vals.push_back(cur_lam);
 			scale_vals.push_back(sf);
@@ -3288,7 +3562,12 @@ bool IterEnsembleSmoother::solve_new()
 			ss.str("");
 			ss << file_manager.get_base_filename() << "." << iter << "." << cur_lam << ".lambda." << sf << ".scale.par";
 
-			if (pest_scenario.get_pestpp_options().get_ies_save_binary())
+			if (pest_scenario.get_pestpp_options().get_ies_save_dense())
+			{
+				ss << ".bin";
+				pe_lam_scale.to_dense(ss.str());
+			}
+			else if (pest_scenario.get_pestpp_options().get_ies_save_binary())
 			{
 				ss << ".jcb";
 				pe_lam_scale.to_binary(ss.str());
@@ -3340,7 +3619,12 @@ bool IterEnsembleSmoother::solve_new()
 			ss.str("");
 			ss << file_manager.get_base_filename() << "." << iter << "." << lam_vals[i] << ".lambda." << scale_vals[i] << ".scale.obs";
 
-			if (pest_scenario.get_pestpp_options().get_ies_save_binary())
+			if (pest_scenario.get_pestpp_options().get_ies_save_dense())
+			{
+				ss << ".bin";
+				oe_lams[i].to_dense(ss.str(), single_precision_obs);
+			}
+			else if (pest_scenario.get_pestpp_options().get_ies_save_binary())
 			{
 				ss << ".jcb";
 				oe_lams[i].to_binary(ss.str());
@@ -3451,7 +3735,23 @@ bool IterEnsembleSmoother::solve_new()
 		org_pe_idxs = remaining_pe_lam.get_real_names();
 		org_oe_idxs = remaining_oe_lam.get_real_names();
 		///run
-		vector<int> fails = run_ensemble(remaining_pe_lam, remaining_oe_lam);
+		vector<int> fails;
+		if (best_idx == stream_remaining_idx)
+		{
+			//these runs were queued (and mostly made) while the lambdas were being tested, they only
+			//need to be reindexed to the rows of the remaining ensembles
+			message(1, "using the remaining realization runs made during streaming lambda testing");
+			map<int, int> real_run_ids;
+			int ireal = 0;
+			for (auto &rri : stream_remaining_run_ids)
+			{
+				real_run_ids[ireal] = rri.second;
+				ireal++;
+			}
+			fails = process_ensemble_runs(remaining_pe_lam, remaining_oe_lam, real_run_ids);
+		}
+		else
+			fails = run_ensemble(remaining_pe_lam, remaining_oe_lam);
 
 		//for testing
 		if (pest_scenario.get_pestpp_options().get_ies_debug_fail_remainder())
@@ -3525,6 +3825,7 @@ bool IterEnsembleSmoother::solve_new()
 		last_best_mean = best_mean;
 
 		pe = pe_lams[best_idx];
+		pe.to_memory();
 		oe = oe_lam_best;
 		if (best_std < last_best_std * acc_fac)
 		{
@@ -3567,7 +3868,12 @@ void IterEnsembleSmoother::report_and_save()
 	cout << "   number of model runs:            " << run_mgr_ptr->get_total_runs() << endl;
 
 	stringstream ss;
-	if (pest_scenario.get_pestpp_options().get_ies_save_binary())
+	if (pest_scenario.get_pestpp_options().get_ies_save_dense())
+	{
+		ss << file_manager.get_base_filename() << "." << iter << ".obs.bin";
+		oe.to_dense(ss.str(), single_precision_obs);
+	}
+	else if (pest_scenario.get_pestpp_options().get_ies_save_binary())
 	{
 		ss << file_manager.get_base_filename() << "." << iter << ".obs.jcb";
 		oe.to_binary(ss.str());
@@ -3580,7 +3886,12 @@ void IterEnsembleSmoother::report_and_save()
 	frec << "      current obs ensemble saved to " << ss.str() << endl;
 	cout << "      current obs ensemble saved to " << ss.str() << endl;
 	ss.str("");
-	if (pest_scenario.get_pestpp_options().get_ies_save_binary())
+	if (pest_scenario.get_pestpp_options().get_ies_save_dense())
+	{
+		ss << file_manager.get_base_filename() << "." << iter << ".par.bin";
+		pe.to_dense(ss.str());
+	}
+	else if (pest_scenario.get_pestpp_options().get_ies_save_binary())
 	{
 		ss << file_manager.get_base_filename() << "." << iter << ".par.jcb";
 		pe.to_binary(ss.str());
@@ -3748,6 +4059,8 @@ vector<ObservationEnsemble> IterEnsembleSmoother::run_lambda_ensembles(vector<Pa
 	ss << "queuing " << pe_lams.size() << " ensembles";
 	performance_log->log_event(ss.str());
 	run_mgr_ptr->reinitialize();
+	stream_remaining_idx = -1;
+	stream_remaining_run_ids.clear();
 	
 	set_subset_idx(pe_lams[0].shape().first);
 	vector<map<int, int>> real_run_ids_vec;
@@ -3771,10 +4084,13 @@ vector<ObservationEnsemble> IterEnsembleSmoother::run_lambda_ensembles(vector<Pa
 		}
 	}
 	performance_log->log_event("making runs");
+	vector<bool> canceled(pe_lams.size(), false);
 	try
 	{
-
-		run_mgr_ptr->run();
+		if (pest_scenario.get_pestpp_options().get_ies_stream_lambdas())
+			canceled = stream_lambda_runs(pe_lams, real_run_ids_vec, lam_vals, scale_vals);
+		else
+			run_mgr_ptr->run();
 	}
 	catch (const exception &e)
 	{
@@ -3797,6 +4113,12 @@ vector<ObservationEnsemble> IterEnsembleSmoother::run_lambda_ensembles(vector<Pa
 	//for (auto &real_run_ids : real_run_ids_vec)
 	for (int i=0;i<pe_lams.size();i++)
 	{
+		if (canceled[i])
+		{
+			//an empty obs ensemble takes the lambda out of the evaluation
+			obs_lams.push_back(ObservationEnsemble());
+			continue;
+		}
 		ObservationEnsemble _oe = oe;//copy
 		vector<double> rep_vals{ lam_vals[i],scale_vals[i] };
 		real_run_ids = real_run_ids_vec[i];
@@ -3875,6 +4197,181 @@ vector<ObservationEnsemble> IterEnsembleSmoother::run_lambda_ensembles(vector<Pa
 }
 
 
+map<string, double> IterEnsembleSmoother::get_finished_phis(ParameterEnsemble &pe_lam, const map<int, int> &real_run_ids, PhiHandler &_ph)
+{
+	//the composite phi of the realizations (keyed by obs real name) of pe_lam whose runs have finished
+	vector<string> pe_names = pe_lam.get_real_names(), oe_names = oe.get_real_names();
+	vector<string> done_pe_names, done_oe_names;
+	map<int, int> done_run_ids;
+	for (auto &rri : real_run_ids)
+	{
+		if (!run_mgr_ptr->run_finished(rri.second))
+			continue;
+		done_run_ids[done_pe_names.size()] = rri.second;
+		done_pe_names.push_back(pe_names[rri.first]);
+		done_oe_names.push_back(oe_names[rri.first]);
+	}
+	map<string, double> phis;
+	if (done_run_ids.size() == 0)
+		return phis;
+	ParameterEnsemble _pe(&pest_scenario, pe_lam.get_eigen(done_pe_names, vector<string>()), done_pe_names, pe_lam.get_var_names());
+	_pe.set_trans_status(pe_lam.get_trans_status());
+	ObservationEnsemble _oe(&pest_scenario, oe.get_eigen(done_oe_names, vector<string>()), done_oe_names, oe.get_var_names());
+	vector<int> failed = _oe.update_from_runs(done_run_ids, run_mgr_ptr);
+	if (failed.size() > 0)
+		return phis;
+	_ph.update(_oe, _pe);
+	PhiHandler::phiType pt = PhiHandler::phiType::COMPOSITE;
+	map<string, double> *phi_map = _ph.get_phi_map(pt);
+	for (auto &name : done_oe_names)
+	{
+		auto found = phi_map->find(name);
+		if (found != phi_map->end())
+			phis[name] = found->second;
+	}
+	return phis;
+}
+
+
+vector<bool> IterEnsembleSmoother::stream_lambda_runs(vector<ParameterEnsemble> &pe_lams, const vector<map<int, int>> &real_run_ids_vec, const vector<double> &lam_vals, const vector<double> &scale_vals)
+{
+	//make the lambda runs a poll interval at a time.  After each interval the phi of the realizations
+	//that have finished is compared between the lambdas still in the running.  A lambda that is worse
+	//than the leading lambda for every realization finished for both (and at least half the subset)
+	//is canceled.  Once one lambda is left and its phi so far is acceptable, the runs of the remaining
+	//(non-subset) realizations are queued for it so they overlap with the end of the subset testing.
+	//returns the canceled flag of each lambda
+	const double poll_sec = 2.0;
+	int nlam = pe_lams.size();
+	vector<bool> canceled(nlam, false);
+	int nsubset = real_run_ids_vec[0].size();
+	int min_common = max(2, (nsubset + 1) / 2);
+	bool has_remaining = (use_subset) && (subset_size < pe_lams[0].shape().first);
+	double acc_phi = last_best_mean * pest_scenario.get_pestpp_options().get_ies_accept_phi_fac();
+	PhiHandler ph_stream = ph;
+	int last_nfinished = -1;
+	while (true)
+	{
+		RunManagerAbstract::RUN_UNTIL_COND cond = run_mgr_ptr->run_until(RunManagerAbstract::RUN_UNTIL_COND::TIME, 0, poll_sec);
+		if (cond == RunManagerAbstract::RUN_UNTIL_COND::NORMAL)
+			break;
+		//nothing left to decide
+		if (stream_remaining_idx != -1)
+			continue;
+		int nfinished = 0;
+		for (int i = 0; i < nlam; i++)
+		{
+			if (canceled[i])
+				continue;
+			for (auto &rri : real_run_ids_vec[i])
+				if (run_mgr_ptr->run_finished(rri.second))
+					nfinished++;
+		}
+		if (nfinished == last_nfinished)
+			continue;
+		last_nfinished = nfinished;
+
+		vector<map<string, double>> phis(nlam);
+		vector<int> active;
+		for (int i = 0; i < nlam; i++)
+		{
+			if (canceled[i])
+				continue;
+			phis[i] = get_finished_phis(pe_lams[i], real_run_ids_vec[i], ph_stream);
+			active.push_back(i);
+		}
+
+		//the leader has the lowest mean phi over the realizations finished for every active lambda
+		int leader = -1;
+		double leader_mean = 1.0e+30;
+		if (active.size() > 1)
+		{
+			vector<string> common;
+			for (auto &p : phis[active[0]])
+			{
+				bool in_all = true;
+				for (auto i : active)
+					if (phis[i].find(p.first) == phis[i].end())
+					{
+						in_all = false;
+						break;
+					}
+				if (in_all)
+					common.push_back(p.first);
+			}
+			if (common.size() < min_common)
+				continue;
+			for (auto i : active)
+			{
+				double mean = 0.0;
+				for (auto &name : common)
+					mean += phis[i][name];
+				mean /= common.size();
+				if (mean < leader_mean)
+				{
+					leader_mean = mean;
+					leader = i;
+				}
+			}
+			for (auto i : active)
+			{
+				if (i == leader)
+					continue;
+				int ncommon = 0;
+				bool worse = true;
+				for (auto &p : phis[i])
+				{
+					auto found = phis[leader].find(p.first);
+					if (found == phis[leader].end())
+						continue;
+					ncommon++;
+					if (p.second <= found->second)
+					{
+						worse = false;
+						break;
+					}
+				}
+				if ((!worse) || (ncommon < min_common))
+					continue;
+				message(1, "canceling runs of dominated lambda, scale fac:", vector<double>({ lam_vals[i],scale_vals[i] }));
+				for (auto &rri : real_run_ids_vec[i])
+					if (!run_mgr_ptr->run_finished(rri.second))
+						run_mgr_ptr->cancel_run(rri.second);
+				canceled[i] = true;
+			}
+		}
+		
+		if (!has_remaining)
+			continue;
+		active.clear();
+		for (int i = 0; i < nlam; i++)
+			if (!canceled[i])
+				active.push_back(i);
+		if (active.size() != 1)
+			continue;
+		int ilam = active[0];
+		if (phis[ilam].size() < min_common)
+			continue;
+		double mean = 0.0;
+		for (auto &p : phis[ilam])
+			mean += p.second;
+		mean /= phis[ilam].size();
+		//wait for the rest of the subset if the subset so far would not be accepted
+		if (mean > acc_phi)
+			continue;
+		vector<int> remaining_idxs;
+		set<int> ssub(subset_idxs.begin(), subset_idxs.end());
+		for (int i = 0; i < pe_lams[ilam].shape().first; i++)
+			if (ssub.find(i) == ssub.end())
+				remaining_idxs.push_back(i);
+		message(1, "queuing remaining realizations for lambda, scale fac:", vector<double>({ lam_vals[ilam],scale_vals[ilam] }));
+		stream_remaining_run_ids = pe_lams[ilam].add_runs(run_mgr_ptr, remaining_idxs);
+		stream_remaining_idx = ilam;
+	}
+	return canceled;
+}
+
+
 vector<int> IterEnsembleSmoother::run_ensemble(ParameterEnsemble &_pe, ObservationEnsemble &_oe, const vector<int> &real_idxs)
 {
 	stringstream ss;
@@ -3912,6 +4409,12 @@ vector<int> IterEnsembleSmoother::run_ensemble(ParameterEnsemble &_pe, Observati
 		throw_ies_error(string("error running ensemble"));
 	}
 
+	return process_ensemble_runs(_pe, _oe, real_run_ids, real_idxs);
+}
+
+
+vector<int> IterEnsembleSmoother::process_ensemble_runs(ParameterEnsemble &_pe, ObservationEnsemble &_oe, map<int, int> &real_run_ids, const vector<int> &real_idxs)
+{
 	performance_log->log_event("processing runs");
 	if (real_idxs.size() > 0)
 	{
@@ -3959,5 +4462,6 @@ vector<int> IterEnsembleSmoother::run_ensemble(ParameterEnsemble &_pe, Observati
 
 void IterEnsembleSmoother::finalize()
 {
+	wait_for_checkpoint();
 
 }
@@ -4,7 +4,9 @@
 #include <map>
 #include <random>
 #include <mutex>
+#include <atomic>
 #include <thread>
+#include <future>
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
 #include "FileManager.h"
@@ -16,6 +18,7 @@
 #include "RunManagerAbstract.h"
 #include "ObjectiveFunc.h"
 #include "Localizer.h"
+#include "EnsembleCheckpoint.h"
 
 
 class PhiHandler
@@ -57,9 +60,14 @@ private:
 	void prepare_csv(ofstream &csv,vector<string> &names);
 	void prepare_group_csv(ofstream &csv, vector<string> extra = vector<string>());
 
-	map<string, Eigen::VectorXd> calc_meas(ObservationEnsemble &oe, Eigen::VectorXd &_q_vec);
-	map<string, Eigen::VectorXd> calc_regul(ParameterEnsemble &pe);// , double _reg_fac);
-	map<string, Eigen::VectorXd> calc_actual(ObservationEnsemble &oe, Eigen::VectorXd &_q_vec);
+	map<string, double> calc_meas(ObservationEnsemble &oe, Eigen::VectorXd &_q_vec);
+	map<string, double> calc_regul(ParameterEnsemble &pe, map<string, map<string, double>> &group_phi_map);// , double _reg_fac);
+	map<string, double> calc_actual(ObservationEnsemble &oe, Eigen::VectorXd &_q_vec, map<string, map<string, double>> &group_phi_map);
+	Eigen::VectorXd calc_obs_phi_vec(Eigen::MatrixXd &resid, const Eigen::VectorXd &q_vec,
+		const Eigen::MatrixXd *w_mat, const Eigen::VectorXd *ref_vals);
+	map<string, double> reduce_phi(Eigen::MatrixXd &sq_resid, Eigen::VectorXd &phi_vec, const vector<string> &real_names,
+		const Eigen::SparseMatrix<double> &group_ind, const vector<string> &group_names,
+		map<string, map<string, double>> *group_phi_map);
 	map<string, double> calc_composite(map<string,double> &_meas, map<string,double> &_regul);
 	//map<string, double>* get_phi_map(PhiHandler::phiType &pt);
 	void write_csv(int iter_num, int total_runs,ofstream &csv, phiType pt,
@@ -86,13 +94,16 @@ private:
 	vector<string> lt_obs_names;
 	vector<string> gt_obs_names;
 
-	map<string, vector<int>> obs_group_idx_map;
-	map<string, vector<int>> par_group_idx_map;
+	//var-by-group indicator matrices (columns ordered as the group names) used
+	//to reduce the squared weighted residuals to group contributions
+	Eigen::SparseMatrix<double> obs_group_ind, par_group_ind;
+	vector<string> obs_group_names, par_group_names;
+	//per oe_base column: 1 for less-than, -1 for greater-than, 0 otherwise
+	vector<int> obs_ineq_flags;
+	//control file obs values in oe_base column order
+	Eigen::VectorXd obs_vals;
 	map<string, map<string, double>> obs_group_phi_map, par_group_phi_map;
 
-	map<string, double> get_obs_group_contrib(Eigen::VectorXd &phi_vec);
-	map<string, double> get_par_group_contrib(Eigen::VectorXd &phi_vec);
-
 };
 
 class ParChangeSummarizer
@@ -114,45 +125,56 @@ private:
 
 class LocalUpgradeThread
 {
+	// Solves the localized upgrade for the cases (keys of the localizer map).  Cases with the same
+	// observation names (and no localizing of the observation side) are grouped so the SVD of the
+	// obs diff matrix is done once per group and the par diff rows of all the cases in the group are
+	// applied in a single product.  Threads take the next group from an atomic index, read the shared
+	// maps without locking (they are not modified while the threads run) and add their solution into
+	// the columns of the upgrade matrix that belong to the cases' parameters.  Only columns shared by
+	// more than one case are guarded, by a small set of striped locks.
 public:
 
-	LocalUpgradeThread(map<string, Eigen::VectorXd> &_par_resid_map, map<string, Eigen::VectorXd> &_par_diff_map,
-		map<string, Eigen::VectorXd> &_obs_resid_map, map<string, Eigen::VectorXd> &_obs_diff_map, 
-		Localizer &_localizer, map<string, double> &_parcov_inv_map,
-		map<string, double> &_weight_map, ParameterEnsemble &_pe_upgrade, 
-		map<string, pair<vector<string>, vector<string>>> &_cases,
-		map<string, Eigen::VectorXd> &_Am_map, Localizer::How &_how);
-
-	//Eigen::DiagonalMatrix<double, Eigen::Dynamic> get_matrix_from_map(vector<string> &names, map<string, double> &dmap);	
-	//Eigen::MatrixXd get_matrix_from_map(int num_reals, vector<string> &names, map<string, Eigen::VectorXd> &emap);
-
+	LocalUpgradeThread(const map<string, Eigen::VectorXd> &_par_resid_map, const map<string, Eigen::VectorXd> &_par_diff_map,
+		const map<string, Eigen::VectorXd> &_obs_resid_map, const map<string, Eigen::VectorXd> &_obs_diff_map, 
+		Localizer &_localizer, const map<string, double> &_parcov_inv_map,
+		const map<string, double> &_weight_map, ParameterEnsemble &_pe_upgrade, 
+		const map<string, pair<vector<string>, vector<string>>> &_cases,
+		const map<string, Eigen::VectorXd> &_Am_map, Localizer::How &_how);
 
 	void work(int thread_id, int iter, double cur_lam);
-
+	//copy the accumulated upgrade into pe_upgrade - call once all threads have been joined
+	void put_upgrade();
 
 private:
 	Localizer::How how;
 	vector<string> keys;
-	int count;
-	//double eigthresh, cur_lam;
-	//int maxsing, num_reals,iter, thread_id;
-	//bool use_approx, use_prior_scaling;
+	//the pe_upgrade column index of each par name of each case, in keys order
+	vector<vector<int>> case_cols;
+	//whether each case row-scales its diff matrix with the localizer, in keys order
+	vector<bool> case_loc;
+	//the case indices of each group of cases that share a solve
+	vector<vector<int>> groups;
+	atomic<int> next_group;
+	
+	int maxsing, num_reals, verbose_level;
+	double eigthresh;
+	bool use_approx, use_prior_scaling, use_propack;
 
-	map<string, pair<vector<string>, vector<string>>> &cases;
+	const map<string, pair<vector<string>, vector<string>>> &cases;
 
 	ParameterEnsemble &pe_upgrade;
-	//PhiHandler &ph;
+	Eigen::MatrixXd upgrade;
+	//true for the upgrade columns that more than one case adds to
+	vector<bool> shared_col;
+	static const int num_col_locks = 64;
+	mutex col_locks[num_col_locks];
+	
 	Localizer &localizer;
-	map<string, double> &parcov_inv_map;
-	map<string, double> &weight_map;
-
-	map<string, Eigen::VectorXd> &par_resid_map, &par_diff_map, &Am_map;
-	map<string, Eigen::VectorXd> &obs_resid_map, &obs_diff_map;
+	const map<string, double> &parcov_inv_map;
+	const map<string, double> &weight_map;
 
-	mutex ctrl_lock, weight_lock, loc_lock, parcov_lock;
-	mutex obs_resid_lock, obs_diff_lock, par_resid_lock;
-	mutex par_diff_lock, am_lock, put_lock;
-	mutex next_lock;
+	const map<string, Eigen::VectorXd> &par_resid_map, &par_diff_map, &Am_map;
+	const map<string, Eigen::VectorXd> &obs_resid_map, &obs_diff_map;
 	
 };
 
@@ -210,9 +232,23 @@ private:
 	vector<string> oe_org_real_names, pe_org_real_names;
 	vector<string> act_obs_names, act_par_names;
 	vector<int> subset_idxs;
+	//with ies_stream_lambdas the remaining (non-subset) realizations of the last lambda left standing
+	//are queued while the subset runs are still being made.  stream_remaining_idx is the index of that
+	//lambda ensemble (-1 if none) and stream_remaining_run_ids maps the remaining realization indices
+	//to their run ids
+	int stream_remaining_idx;
+	map<int, int> stream_remaining_run_ids;
 
 	ParameterEnsemble pe, pe_base;
 	ObservationEnsemble oe, oe_base, weights;
+	int num_tile_files;
+	//store observation ensembles in float32 where they are written to file (++obs_storage_precision(single))
+	bool single_precision_obs;
+	//with ies_checkpoint, the state at the end of each iteration is written on a separate thread while
+	//the next iteration proceeds.  The prior par and obs ensembles and weights are only written into
+	//the first checkpoint; later checkpoints reference those files
+	std::future<void> checkpoint_future;
+	string ckpt_pe_base_file, ckpt_oe_base_file, ckpt_weights_file;
 	//Eigen::MatrixXd prior_pe_diff;
 	//Eigen::MatrixXd Am;
 	Eigen::DiagonalMatrix<double,Eigen::Dynamic> obscov_inv_sqrt, parcov_inv_sqrt;
@@ -228,7 +264,10 @@ private:
 
 	//EnsemblePair run_ensemble(ParameterEnsemble &_pe, ObservationEnsemble &_oe);
 	vector<int> run_ensemble(ParameterEnsemble &_pe, ObservationEnsemble &_oe, const vector<int> &real_idxs=vector<int>());
+	vector<int> process_ensemble_runs(ParameterEnsemble &_pe, ObservationEnsemble &_oe, map<int, int> &real_run_ids, const vector<int> &real_idxs=vector<int>());
 	vector<ObservationEnsemble> run_lambda_ensembles(vector<ParameterEnsemble> &pe_lams, vector<double> &lam_vals, vector<double> &scale_vals);
+	vector<bool> stream_lambda_runs(vector<ParameterEnsemble> &pe_lams, const vector<map<int, int>> &real_run_ids_vec, const vector<double> &lam_vals, const vector<double> &scale_vals);
+	map<string, double> get_finished_phis(ParameterEnsemble &pe_lam, const map<int, int> &real_run_ids, PhiHandler &_ph);
 	//map<string, double> get_phi_vec_stats(map<string,PhiComponets> &phi_info);
 	//map<string,PhiComponets> get_phi_info(ObservationEnsemble &_oe);
 	void report_and_save();
@@ -239,7 +278,13 @@ private:
 	void initialize_weights();
 	void initialize_parcov();
 	void initialize_obscov();
+	void initialize_phi_handler();
+	void initialize_from_checkpoint(const string &file_name);
+	void move_priors_to_disk();
+	void write_checkpoint();
+	void wait_for_checkpoint();
 	void drop_bad_phi(ParameterEnsemble &_pe, ObservationEnsemble &_oe, bool is_subset=false);
+	void to_disk(Ensemble &en, const string &tag, bool single_precision=false);
 	//void check_ensembles(ObservationEnsemble &oe, ParameterEnsemble &pe);
 	template<typename T, typename A>
 	void message(int level, const string &_message, vector<T, A> _extras, bool echo=true);
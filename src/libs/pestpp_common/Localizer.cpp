@@ -12,20 +12,36 @@
 #include "PerformanceLog.h"
 #include "system_variables.h"
 #include "Localizer.h"
+#include "DistanceLocalizer.h"
 
 bool Localizer::initialize(PerformanceLog *performance_log)
 {
 	stringstream ss;
 	how == How::OBSERVATIONS; //set this for the case with no localization
 	string filename = pest_scenario_ptr->get_pestpp_options().get_ies_localizer();
-	if (filename.size() == 0)
+	string par_coords = pest_scenario_ptr->get_pestpp_options().get_ies_loc_par_coords();
+	string obs_coords = pest_scenario_ptr->get_pestpp_options().get_ies_loc_obs_coords();
+	bool use_distance = (par_coords.size() > 0) || (obs_coords.size() > 0);
+	if ((filename.size() == 0) && (!use_distance))
 	{
 		use = false;
 		return false;
 	}
 	use = true;
 	
-	mat.from_file(filename);
+	if (use_distance)
+	{
+		if (filename.size() > 0)
+			throw runtime_error("Localizer::initialize() error: 'ies_localizer' can't be used with 'ies_loc_par_coords'/'ies_loc_obs_coords'");
+		if ((par_coords.size() == 0) || (obs_coords.size() == 0))
+			throw runtime_error("Localizer::initialize() error: both 'ies_loc_par_coords' and 'ies_loc_obs_coords' are needed for distance-based localization");
+		//generate the localizer directly - the rows and cols are the nz obs and adj par names
+		DistanceLocalizer dist_loc(pest_scenario_ptr, performance_log);
+		mat = dist_loc.generate();
+		filename = "distance-based localizer";
+	}
+	else
+		mat.from_file(filename);
 	
 	string how_str = pest_scenario_ptr->get_pestpp_options().get_ies_localize_how();
 	if (how_str[0] == 'P')
@@ -47,29 +63,23 @@ bool Localizer::initialize(PerformanceLog *performance_log)
 	names = pest_scenario_ptr->get_ctl_ordered_nz_obs_names();
 	set<string> obs_names(names.begin(), names.end());
 
+	//one pass over the names to build the group membership (in sorted name order)
 	map<string, vector<string>> pargp_map;
 	ParameterGroupInfo *pi = pest_scenario_ptr->get_base_group_info_ptr();
-
 	for (auto &pg : pest_scenario_ptr->get_ctl_ordered_par_group_names())
-	{
-
-		names.clear();
-		for (auto &p : par_names)
-			if (pi->get_group_name(p) == pg)
-				names.push_back(p);
-		pargp_map[pg] = names;
-	}
+		pargp_map[pg] = vector<string>();
+	map<string, vector<string>>::iterator gp_it;
+	for (auto &p : par_names)
+		if ((gp_it = pargp_map.find(pi->get_group_name(p))) != pargp_map.end())
+			gp_it->second.push_back(p);
 
 	map<string, vector<string>> obgnme_map;
+	ObservationInfo *oi = pest_scenario_ptr->get_observation_info_ptr();
 	for (auto &og : pest_scenario_ptr->get_ctl_ordered_obs_group_names())
-	{
-		ObservationInfo *oi = pest_scenario_ptr->get_observation_info_ptr();
-		names.clear();
-		for (auto &o : obs_names)
-			if (oi->get_group(o) == og)
-				names.push_back(o);
-		obgnme_map[og] = names;
-	}
+		obgnme_map[og] = vector<string>();
+	for (auto &o : obs_names)
+		if ((gp_it = obgnme_map.find(oi->get_group(o))) != obgnme_map.end())
+			gp_it->second.push_back(o);
 
 	vector<string> missing, dups, not_allowed;
 	vector<vector<string>> obs_map;
@@ -80,6 +90,7 @@ bool Localizer::initialize(PerformanceLog *performance_log)
 	vector<string> row_names = mat.get_row_names();
 	for (int i=0;i<mat.nrow();i++)
 	{
+		row_idx_map[row_names[i]] = i;
 		o = row_names[i];
 		if (obs_names.find(o) != obs_names.end())
 		{
@@ -141,6 +152,7 @@ bool Localizer::initialize(PerformanceLog *performance_log)
 	//for (auto &p : mat.get_col_names())
 	for (int i=0;i<mat.ncol();++i)
 	{
+		col_idx_map[col_names[i]] = i;
 		p = col_names[i];
 		if (par_names.find(p) != par_names.end())
 		{
@@ -269,46 +281,31 @@ bool Localizer::initialize(PerformanceLog *performance_log)
 	return true;
 }
 
-Eigen::MatrixXd Localizer::get_localizing_obs_hadamard_matrix(int num_reals, string col_name, vector<string> &obs_names)
+Eigen::VectorXd Localizer::get_obs_localizing_vector(const string &col_name, const vector<string> &obs_names)
 {
-
-	vector<double> values;
-	vector<string> mat_cols = mat.get_col_names();
-	vector<string>::iterator it = find(mat_cols.begin(), mat_cols.end(), col_name);
-	if (it == mat_cols.end())
-		throw runtime_error("Localizer::get_localizing_obs_hadamard_matrix() error: col_name not found in localizer matrix: " + col_name);
-	int idx = it - mat_cols.begin();
-	Eigen::VectorXd mat_vec = mat.e_ptr()->col(idx);
-	int col_idx;
-	Eigen::MatrixXd loc(obs_names.size(), num_reals);
+	unordered_map<string, int>::iterator it = col_idx_map.find(col_name);
+	if (it == col_idx_map.end())
+		throw runtime_error("Localizer::get_obs_localizing_vector() error: col_name not found in localizer matrix: " + col_name);
+	int col_idx = it->second;
+	const Eigen::SparseMatrix<double> *e = mat.e_ptr();
+	Eigen::VectorXd loc(obs_names.size());
 	for (int i=0;i<obs_names.size();i++)
-	{
-		col_idx = obs2row_map[obs_names[i]];
-		loc.row(i).setConstant(mat_vec[col_idx]);
-
-	}
+		loc[i] = e->coeff(obs2row_map.at(obs_names[i]), col_idx);
 	return loc;
 
 }
 
 
-Eigen::MatrixXd Localizer::get_localizing_par_hadamard_matrix(int num_reals, string row_name, vector<string> &par_names)
+Eigen::VectorXd Localizer::get_par_localizing_vector(const string &row_name, const vector<string> &par_names)
 {
-
-	vector<double> values;
-	vector<string> mat_rows = mat.get_row_names();
-	vector<string>::iterator it = find(mat_rows.begin(), mat_rows.end(), row_name);
-	if (it == mat_rows.end())
-		throw runtime_error("Localizer::get_localizing_par_hadamard_matrix() error: row_name not found in localizer matrix: " + row_name);
-	int idx = it - mat_rows.begin();
-	Eigen::VectorXd mat_vec = mat.e_ptr()->row(idx);
-	int col_idx;
-	Eigen::MatrixXd loc(par_names.size(), num_reals);
+	unordered_map<string, int>::iterator it = row_idx_map.find(row_name);
+	if (it == row_idx_map.end())
+		throw runtime_error("Localizer::get_par_localizing_vector() error: row_name not found in localizer matrix: " + row_name);
+	int row_idx = it->second;
+	const Eigen::SparseMatrix<double> *e = mat.e_ptr();
+	Eigen::VectorXd loc(par_names.size());
 	for (int i = 0; i<par_names.size(); i++)
-	{
-		col_idx = par2col_map[par_names[i]];
-		loc.row(i).setConstant(mat_vec[col_idx]);
-	}
+		loc[i] = e->coeff(row_idx, par2col_map.at(par_names[i]));
 	return loc;
 
-}
\ No newline at end of file
+}
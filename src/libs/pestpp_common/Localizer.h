@@ -2,6 +2,7 @@
 #define LOCALIZER_H_
 
 #include <map>
+#include <unordered_map>
 #include <random>
 #include <Eigen/Dense>
 #include <Eigen/Sparse>
@@ -25,8 +26,10 @@ public:
 	bool initialize(PerformanceLog *performance_log);
 	map<string,pair<vector<string>, vector<string>>> get_localizer_map() { return localizer_map; }
 	void set_pest_scenario(Pest *_pest_scenario_ptr) { pest_scenario_ptr = _pest_scenario_ptr; }
-	Eigen::MatrixXd get_localizing_obs_hadamard_matrix(int num_reals,string col_name,vector<string> &obs_names);
-	Eigen::MatrixXd get_localizing_par_hadamard_matrix(int num_reals, string row_name, vector<string> &par_names);
+	//the localizing coefficients of a localizer col (row) for the given obs (par) names - these
+	//scale the rows of the obs (par) diff matrix
+	Eigen::VectorXd get_obs_localizing_vector(const string &col_name, const vector<string> &obs_names);
+	Eigen::VectorXd get_par_localizing_vector(const string &row_name, const vector<string> &par_names);
 	How get_how() { return how; }
 	bool get_use() { return use; }
 private:
@@ -35,7 +38,8 @@ private:
 	Pest * pest_scenario_ptr;
 	Mat mat;
 	map<string,pair<vector<string>, vector<string>>> localizer_map;
-	map<string, int> obs2row_map, par2col_map;
+	unordered_map<string, int> obs2row_map, par2col_map;
+	unordered_map<string, int> row_idx_map, col_idx_map;
 };
 
 #endif
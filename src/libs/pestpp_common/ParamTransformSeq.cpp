@@ -22,10 +22,13 @@
 #include <vector>
 #include <iterator>
 #include <algorithm>
+#include <thread>
+#include <unordered_map>
 #include "ParamTransformSeq.h"
 #include "Transformation.h"
 #include "Transformable.h"
 #include "Jacobian.h"
+#include "pest_error.h"
 
 using namespace std;
 
@@ -788,6 +791,300 @@ void ParamTransformSeq::jac_active_ctl_ip2numeric_ip(Jacobian &jac) const
 	}
 }
 
+CompiledParamTransform ParamTransformSeq::compile_numeric2model(const vector<string> &in_names, const vector<string> &out_names) const
+{
+	vector<TranStep> steps;
+	append_steps(steps, tranSeq_active_ctl2numeric, false);
+	append_steps(steps, tranSeq_ctl2active_ctl, false);
+	append_steps(steps, tranSeq_ctl2model, true);
+	return compile(steps, in_names, out_names);
+}
+
+CompiledParamTransform ParamTransformSeq::compile_numeric2ctl(const vector<string> &in_names, const vector<string> &out_names) const
+{
+	vector<TranStep> steps;
+	append_steps(steps, tranSeq_active_ctl2numeric, false);
+	append_steps(steps, tranSeq_ctl2active_ctl, false);
+	return compile(steps, in_names, out_names);
+}
+
+CompiledParamTransform ParamTransformSeq::compile_ctl2numeric(const vector<string> &in_names, const vector<string> &out_names) const
+{
+	vector<TranStep> steps;
+	append_steps(steps, tranSeq_ctl2active_ctl, true);
+	append_steps(steps, tranSeq_active_ctl2numeric, true);
+	return compile(steps, in_names, out_names);
+}
+
+CompiledParamTransform ParamTransformSeq::compile_active_ctl2model(const vector<string> &in_names, const vector<string> &out_names) const
+{
+	vector<TranStep> steps;
+	append_steps(steps, tranSeq_ctl2active_ctl, false);
+	append_steps(steps, tranSeq_ctl2model, true);
+	return compile(steps, in_names, out_names);
+}
+
+CompiledParamTransform ParamTransformSeq::compile_model2ctl(const vector<string> &in_names, const vector<string> &out_names) const
+{
+	vector<TranStep> steps;
+	append_steps(steps, tranSeq_ctl2model, false);
+	return compile(steps, in_names, out_names);
+}
+
+void ParamTransformSeq::append_steps(vector<TranStep> &steps, const vector<Transformation*> &tran_seq, bool forward)
+{
+	//reverse conversions apply the sequence back to front
+	if (forward)
+	{
+		for (auto &tran : tran_seq)
+			steps.push_back(TranStep(tran, true));
+	}
+	else
+	{
+		for (auto iter = tran_seq.rbegin(); iter != tran_seq.rend(); ++iter)
+			steps.push_back(TranStep(*iter, false));
+	}
+}
+
+CompiledParamTransform ParamTransformSeq::compile(const vector<TranStep> &steps, const vector<string> &in_names, const vector<string> &out_names)
+{
+	typedef CompiledParamTransform::OpType OpType;
+	typedef CompiledParamTransform::ColumnOp ColumnOp;
+	CompiledParamTransform ct;
+	ct.in_names = in_names;
+	ct.out_names = out_names;
+	ct.n_work_cols = in_names.size();
+
+	//track the column holding each parameter that is present after each step the same way the
+	//Transformations add and erase parameters from a Parameters instance
+	unordered_map<string, int> present;
+	for (int i = 0; i < in_names.size(); ++i)
+		present[in_names[i]] = i;
+	auto add_op = [&ct](OpType type, int col, double value, int src_col)
+	{
+		ColumnOp op;
+		op.type = type;
+		op.col = col;
+		op.src_col = src_col;
+		op.value = value;
+		ct.ops.push_back(op);
+	};
+	unordered_map<string, int>::iterator found;
+	for (auto &step : steps)
+	{
+		const Transformation *tran = step.first;
+		bool forward = step.second;
+		// TranFrozen derives from TranFixed so it is handled by the TranFixed case
+		if (const TranFixed *t = dynamic_cast<const TranFixed*>(tran))
+		{
+			for (auto &item : t->get_items())
+			{
+				found = present.find(item.first);
+				if (forward)
+				{
+					if (found != present.end())
+						present.erase(found);
+				}
+				else if (found == present.end())
+				{
+					present[item.first] = ct.n_work_cols;
+					add_op(OpType::FILL, ct.n_work_cols, item.second, -1);
+					ct.n_work_cols++;
+				}
+			}
+		}
+		else if (const TranTied *t = dynamic_cast<const TranTied*>(tran))
+		{
+			for (auto &item : t->get_items())
+			{
+				found = present.find(item.first);
+				if (forward)
+				{
+					if (found != present.end())
+						present.erase(found);
+					continue;
+				}
+				auto base_iter = present.find(item.second.first);
+				if (base_iter == present.end())
+					continue;
+				int col;
+				if (found != present.end())
+					col = found->second;
+				else
+				{
+					col = ct.n_work_cols++;
+					present[item.first] = col;
+				}
+				add_op(OpType::COPY_SCALED, col, item.second.second, base_iter->second);
+			}
+		}
+		else if (const TranOffset *t = dynamic_cast<const TranOffset*>(tran))
+		{
+			for (auto &item : t->get_items())
+			{
+				found = present.find(item.first);
+				if (found != present.end())
+					add_op(forward ? OpType::ADD : OpType::SUB, found->second, item.second, -1);
+			}
+		}
+		else if (const TranScale *t = dynamic_cast<const TranScale*>(tran))
+		{
+			for (auto &item : t->get_items())
+			{
+				found = present.find(item.first);
+				if (found != present.end())
+					add_op(forward ? OpType::MUL : OpType::DIV, found->second, item.second, -1);
+			}
+		}
+		else if (const TranLog10 *t = dynamic_cast<const TranLog10*>(tran))
+		{
+			for (auto &item : t->get_items())
+			{
+				found = present.find(item);
+				if (found != present.end())
+					add_op(forward ? OpType::LOG10 : OpType::POW10, found->second, 0.0, -1);
+			}
+		}
+		else if (const TranNormalize *t = dynamic_cast<const TranNormalize*>(tran))
+		{
+			for (auto &item : t->get_items())
+			{
+				found = present.find(item.first);
+				if (found == present.end())
+					continue;
+				if (forward)
+				{
+					add_op(OpType::ADD, found->second, item.second.offset, -1);
+					add_op(OpType::MUL, found->second, item.second.scale, -1);
+				}
+				else
+				{
+					add_op(OpType::DIV, found->second, item.second.scale, -1);
+					add_op(OpType::SUB, found->second, item.second.offset, -1);
+				}
+			}
+		}
+		else
+		{
+			//TranSVD and any other transformation mix parameters and can only be applied with a Parameters instance
+			return ct;
+		}
+	}
+	for (auto &oname : out_names)
+	{
+		found = present.find(oname);
+		if (found == present.end())
+			return ct;
+		ct.out_cols.push_back(found->second);
+	}
+	ct.valid = true;
+	return ct;
+}
+
+const int CompiledParamTransform::min_rows_per_thread;
+
+CompiledParamTransform::CompiledParamTransform(const vector<string> &_in_names, const vector<string> &_out_names)
+	: valid(false), in_names(_in_names), out_names(_out_names), n_work_cols(_in_names.size())
+{
+	unordered_map<string, int> in_map;
+	for (int i = 0; i < in_names.size(); ++i)
+		in_map[in_names[i]] = i;
+	for (auto &oname : out_names)
+	{
+		auto found = in_map.find(oname);
+		if (found == in_map.end())
+			return;
+		out_cols.push_back(found->second);
+	}
+	valid = true;
+}
+
+void CompiledParamTransform::apply_rows(Eigen::MatrixXd &work, int row_start, int n_rows) const
+{
+	//the columns of work are contiguous so each operation is applied to a contiguous block of rows.
+	//log10 and pow are applied with the same library calls used by TranLog10
+	for (auto &op : ops)
+	{
+		auto seg = work.col(op.col).segment(row_start, n_rows);
+		switch (op.type)
+		{
+		case OpType::ADD:
+			seg.array() += op.value;
+			break;
+		case OpType::SUB:
+			seg.array() -= op.value;
+			break;
+		case OpType::MUL:
+			seg.array() *= op.value;
+			break;
+		case OpType::DIV:
+			seg.array() /= op.value;
+			break;
+		case OpType::LOG10:
+			for (int i = 0; i < n_rows; ++i)
+				seg(i) = log10(seg(i));
+			break;
+		case OpType::POW10:
+			for (int i = 0; i < n_rows; ++i)
+				seg(i) = pow(10.0, seg(i));
+			break;
+		case OpType::FILL:
+			seg.setConstant(op.value);
+			break;
+		case OpType::COPY_SCALED:
+			seg = work.col(op.src_col).segment(row_start, n_rows) * op.value;
+			break;
+		}
+	}
+}
+
+void CompiledParamTransform::apply_ip(Eigen::MatrixXd &mat, int num_threads) const
+{
+	if (!valid)
+		throw PestError("CompiledParamTransform::apply_ip() transformation sequence could not be compiled");
+	if (mat.cols() != in_names.size())
+		throw PestError("CompiledParamTransform::apply_ip() number of matrix columns not equal to number of parameters");
+	int n_rows = mat.rows();
+	int n_in = in_names.size();
+	if (n_work_cols > n_in)
+	{
+		//fixed and tied parameters are added as new columns
+		mat.conservativeResize(Eigen::NoChange, n_work_cols);
+	}
+	if (num_threads <= 0)
+		num_threads = max((int)thread::hardware_concurrency(), 1);
+	num_threads = max(min(num_threads, n_rows / min_rows_per_thread), 1);
+	if ((num_threads == 1) || ops.empty())
+	{
+		apply_rows(mat, 0, n_rows);
+	}
+	else
+	{
+		vector<thread> threads;
+		int block_size = n_rows / num_threads;
+		int row_start = 0;
+		for (int i = 0; i < num_threads; ++i)
+		{
+			int n_block = (i == num_threads - 1) ? n_rows - row_start : block_size;
+			threads.push_back(thread(&CompiledParamTransform::apply_rows, this, std::ref(mat), row_start, n_block));
+			row_start += n_block;
+		}
+		for (auto &t : threads)
+			t.join();
+	}
+
+	bool same_order = (out_cols.size() == mat.cols());
+	for (int i = 0; (i < out_cols.size()) && same_order; ++i)
+		same_order = (out_cols[i] == i);
+	if (!same_order)
+	{
+		Eigen::MatrixXd out(n_rows, out_cols.size());
+		for (int i = 0; i < out_cols.size(); ++i)
+			out.col(i) = mat.col(out_cols[i]);
+		mat.swap(out);
+	}
+}
+
 ostream& operator<< (ostream &os, const ParamTransformSeq& val)
 {
 	val.print(os);
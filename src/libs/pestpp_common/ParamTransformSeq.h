@@ -35,6 +35,51 @@ class JacobianAnalytic;
 
 using namespace std;
 
+/**
+ @brief Transformation sequence compiled to column operations
+
+ A CompiledParamTransform holds the operations of a ParamTransformSeq conversion as a
+ list of operations on the columns of a matrix that has one parameter per column and one
+ set of parameter values (e.g. a realization) per row.  This allows a whole ensemble to be
+ transformed without building a Parameters object for each row.  The operations are the
+ same floating point operations as the Transformation classes so the results are identical
+ to transforming each row with the ParamTransformSeq.  Instances are created with the
+ ParamTransformSeq::compile_*() methods; a default constructed instance is not valid.
+*/
+class CompiledParamTransform {
+	friend class ParamTransformSeq;
+public:
+	CompiledParamTransform() : valid(false), n_work_cols(0) {}
+	// identity transform that only reorders the columns from in_names to out_names
+	CompiledParamTransform(const vector<string> &_in_names, const vector<string> &_out_names);
+	/** @brief false if the sequence contains transformations that can not be compiled (e.g. TranSVD)
+	or if the transformed values do not include all of out_names */
+	bool is_valid() const { return valid; }
+	const vector<string>& get_in_names() const { return in_names; }
+	const vector<string>& get_out_names() const { return out_names; }
+	/** @brief transform the rows of mat in place.  On entry the columns of mat are ordered as in_names
+	and on exit they are ordered as out_names.  The rows are split into blocks that are transformed
+	concurrently by num_threads threads (num_threads <= 0 uses one thread per processor) */
+	void apply_ip(Eigen::MatrixXd &mat, int num_threads = 0) const;
+private:
+	enum class OpType { ADD, SUB, MUL, DIV, LOG10, POW10, FILL, COPY_SCALED };
+	struct ColumnOp
+	{
+		OpType type;
+		int col;
+		int src_col;
+		double value;
+	};
+	static const int min_rows_per_thread = 64;
+	bool valid;
+	vector<string> in_names;
+	vector<string> out_names;
+	int n_work_cols;
+	vector<ColumnOp> ops;
+	vector<int> out_cols;
+	void apply_rows(Eigen::MatrixXd &work, int row_start, int n_rows) const;
+};
+
 /**
  @brief ParamTransformSeq class
 
@@ -109,7 +154,17 @@ public:
 	void jac_numeric2active_ctl_ip(Jacobian &jac) const;
 	void jac_active_ctl_ip2numeric_ip(Jacobian &jac) const;
 	void jac_test_ip(Jacobian &jac) const;
+	/** @brief compile the numeric2model_ip() conversion of parameters in_names to a CompiledParamTransform
+	that returns the parameters out_names.  The other compile_* methods are the same for the
+	corresponding *_ip() conversion */
+	CompiledParamTransform compile_numeric2model(const vector<string> &in_names, const vector<string> &out_names) const;
+	CompiledParamTransform compile_numeric2ctl(const vector<string> &in_names, const vector<string> &out_names) const;
+	CompiledParamTransform compile_ctl2numeric(const vector<string> &in_names, const vector<string> &out_names) const;
+	CompiledParamTransform compile_active_ctl2model(const vector<string> &in_names, const vector<string> &out_names) const;
+	CompiledParamTransform compile_model2ctl(const vector<string> &in_names, const vector<string> &out_names) const;
 private:
+	// a transformation and whether it is applied forward (true) or reverse (false)
+	typedef pair<const Transformation*, bool> TranStep;
 	vector<Transformation*> tranSeq_ctl2model;
 	vector<Transformation*> tranSeq_ctl2active_ctl;
 	vector<Transformation*> tranSeq_active_ctl2numeric;
@@ -124,6 +179,8 @@ private:
 	vector<Transformation*>::const_iterator find_in_ctl2active_ctl(const string &name) const;
 	vector<Transformation*>::iterator find_in_active_ctl2numeric(const string &name);
 	vector<Transformation*>::const_iterator find_in_active_ctl2numeric(const string &name) const;
+	static void append_steps(vector<TranStep> &steps, const vector<Transformation*> &tran_seq, bool forward);
+	static CompiledParamTransform compile(const vector<TranStep> &steps, const vector<string> &in_names, const vector<string> &out_names);
 	string name;
 };
 
@@ -833,11 +833,23 @@ int Pest::process_ctl_file(ifstream &fin, string pst_filename)
 	pestpp_options.set_ies_include_base(true);
 	pestpp_options.set_ies_use_empirical_prior(false);
 	pestpp_options.set_ies_group_draws(true);
+	pestpp_options.set_ies_parallel_draws(false);
+	pestpp_options.set_ies_cholesky_max_density(0.1);
+	pestpp_options.set_ies_stream_lambdas(false);
 	//pestpp_options.set_ies_num_reals_passed(false);
 	pestpp_options.set_ies_enforce_bounds(true);
 	pestpp_options.set_par_sigma_range(4.0);
 	pestpp_options.set_ies_save_binary(false);
+	pestpp_options.set_ies_save_dense(false);
+	pestpp_options.set_ies_out_of_core(false);
+	pestpp_options.set_ies_tile_cols(1000);
 	pestpp_options.set_ies_localizer("");
+	pestpp_options.set_ies_loc_par_coords("");
+	pestpp_options.set_ies_loc_obs_coords("");
+	pestpp_options.set_ies_loc_taper("GASPARI_COHN");
+	pestpp_options.set_ies_loc_radius(0.0);
+	pestpp_options.set_ies_checkpoint(false);
+	pestpp_options.set_ies_restart_checkpoint("");
 	pestpp_options.set_ies_accept_phi_fac(1.05);
 	pestpp_options.set_ies_lambda_inc_fac(10.0);
 	pestpp_options.set_ies_lambda_dec_fac(0.75);
@@ -853,6 +865,15 @@ int Pest::process_ctl_file(ifstream &fin, string pst_filename)
 
 	pestpp_options.set_condor_submit_file(string());
 	pestpp_options.set_overdue_giveup_minutes(1.0e+30);
+	pestpp_options.set_run_storage_mmap(false);
+	pestpp_options.set_run_storage_write_behind(false);
+	pestpp_options.set_panther_prefetch_depth(0);
+	pestpp_options.set_panther_cost_scheduling(false);
+	pestpp_options.set_panther_overdue_quantile(0.9);
+	pestpp_options.set_tpl_writer("mio");
+	pestpp_options.set_ins_reader("mio");
+	pestpp_options.set_obs_storage_precision("double");
+	pestpp_options.set_local_num_workers(1);
 
 	for(vector<string>::const_iterator b=pestpp_input.begin(),e=pestpp_input.end();
 		b!=e; ++b) {
@@ -115,6 +115,7 @@ public:
 	false if the items is not part of the transformation and true if it is
 	 */
 	pair<bool, double> get_value(const string &name) const;
+	const map<string, double>& get_items() const {return items;}
 	virtual void print(ostream &os) const;
 	virtual bool is_one_to_one() const {return false;}
 	virtual TranMapBase* clone() const = 0;
@@ -275,6 +276,7 @@ public:
 	virtual void print(ostream &os) const;
 	virtual bool is_one_to_one() const {return true;}
 	virtual TranTied* clone() const {return new TranTied(*this);}
+	const map<string, pair_string_double>& get_items() const {return items;}
 protected:
 	map<string, pair_string_double> items;
 };
@@ -352,6 +354,7 @@ public:
 	virtual void print(ostream &os) const;
 	virtual bool is_one_to_one() const {return true;}
 	virtual TranNormalize* clone() const {return new TranNormalize(*this);}
+	const map<string, NormData>& get_items() const {return items;}
 protected:
 	map<string, NormData> items;
 };
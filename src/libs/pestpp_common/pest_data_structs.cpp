@@ -330,6 +330,15 @@ ostream& operator<< (ostream &os, const PestppOptions& val)
 	os << "    derivative run failure forgive = " << left << setw(15) << val.get_der_forgive() << endl;
 	os << "    run overdue reschedule factor = " << left << setw(20) << val.get_overdue_reched_fac() << endl;
 	os << "    run overdue giveup factor = " << left << setw(20) << val.get_overdue_giveup_fac() << endl;
+	os << "    memory mapped run storage = " << left << setw(20) << val.get_run_storage_mmap() << endl;
+	os << "    write behind run storage = " << left << setw(20) << val.get_run_storage_write_behind() << endl;
+	os << "    panther prefetch depth = " << left << setw(20) << val.get_panther_prefetch_depth() << endl;
+	os << "    panther cost scheduling = " << left << setw(20) << val.get_panther_cost_scheduling() << endl;
+	os << "    panther overdue quantile = " << left << setw(20) << val.get_panther_overdue_quantile() << endl;
+	os << "    template file writer = " << left << setw(20) << val.get_tpl_writer() << endl;
+	os << "    instruction file reader = " << left << setw(20) << val.get_ins_reader() << endl;
+	os << "    observation storage precision = " << left << setw(20) << val.get_obs_storage_precision() << endl;
+	os << "    local num workers = " << left << setw(20) << val.get_local_num_workers() << endl;
 	os << "    base parameter jacobian filename = " << left << setw(20) << val.get_basejac_filename() << endl;
 	os << "    prior parameter covariance upgrade scaling factor = " << left << setw(10) << val.get_parcov_scale_fac() << endl;
 	if (val.get_global_opt() == PestppOptions::GLOBAL_OPT::OPT_DE)
@@ -532,6 +541,61 @@ void PestppOptions::parce_line(const string &line)
 		{
 			convert_ip(value, overdue_giveup_minutes);
 		}
+		else if (key == "RUN_STORAGE_MMAP")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> run_storage_mmap;
+		}
+		else if (key == "RUN_STORAGE_WRITE_BEHIND")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> run_storage_write_behind;
+		}
+		else if (key == "PANTHER_PREFETCH_DEPTH")
+		{
+			convert_ip(value, panther_prefetch_depth);
+		}
+		else if (key == "PANTHER_COST_SCHEDULING")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> panther_cost_scheduling;
+		}
+		else if (key == "PANTHER_OVERDUE_QUANTILE")
+		{
+			convert_ip(value, panther_overdue_quantile);
+			if ((panther_overdue_quantile <= 0.0) || (panther_overdue_quantile > 1.0))
+				throw PestParsingError(line, "PANTHER_OVERDUE_QUANTILE must be greater than 0.0 and less than or equal to 1.0");
+		}
+		else if (key == "TPL_WRITER")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			if ((value != "mio") && (value != "cpp"))
+				throw PestParsingError(line, "TPL_WRITER must be 'mio' or 'cpp'");
+			tpl_writer = value;
+		}
+		else if (key == "INS_READER")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			if ((value != "mio") && (value != "cpp"))
+				throw PestParsingError(line, "INS_READER must be 'mio' or 'cpp'");
+			ins_reader = value;
+		}
+		else if (key == "OBS_STORAGE_PRECISION")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			if ((value != "double") && (value != "single"))
+				throw PestParsingError(line, "OBS_STORAGE_PRECISION must be 'double' or 'single'");
+			obs_storage_precision = value;
+		}
+		else if (key == "LOCAL_NUM_WORKERS")
+		{
+			convert_ip(value, local_num_workers);
+			if (local_num_workers < 0)
+				throw PestParsingError(line, "LOCAL_NUM_WORKERS must be greater than or equal to 0");
+		}
 		else if (key == "CONDOR_SUBMIT_FILE")
 		{
 			//convert_ip(value, condor_submit_file);
@@ -837,6 +901,22 @@ void PestppOptions::parce_line(const string &line)
 			istringstream is(value);
 			is >> boolalpha >> ies_group_draws;
 		}
+		else if (key == "IES_PARALLEL_DRAWS")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> ies_parallel_draws;
+		}
+		else if (key == "IES_CHOLESKY_MAX_DENSITY")
+		{
+			convert_ip(value, ies_cholesky_max_density);
+		}
+		else if (key == "IES_STREAM_LAMBDAS")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> ies_stream_lambdas;
+		}
 		else if (key == "IES_ENFORCE_BOUNDS")
 		{
 			transform(value.begin(), value.end(), value.begin(), ::tolower);
@@ -849,6 +929,22 @@ void PestppOptions::parce_line(const string &line)
 			istringstream is(value);
 			is >> boolalpha >> ies_save_binary;
 		}
+		else if (key == "IES_SAVE_DENSE")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> ies_save_dense;
+		}
+		else if (key == "IES_OUT_OF_CORE")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> ies_out_of_core;
+		}
+		else if (key == "IES_TILE_COLS")
+		{
+			convert_ip(value, ies_tile_cols);
+		}
 		else if (key == "PAR_SIGMA_RANGE")
 		{
 			convert_ip(value, par_sigma_range);
@@ -856,11 +952,40 @@ void PestppOptions::parce_line(const string &line)
 		else if (key == "YAMR_POLL_INTERVAL") {
 			//doesn't apply here
 		}
+		else if (key == "PANTHER_AGENT_SLOTS") {
+			//only used by the agents
+		}
 		else if (key == "IES_LOCALIZER")
 		{
 			//convert_ip(value, ies_localizer);
 			ies_localizer = org_value;
 		}
+		else if (key == "IES_LOC_PAR_COORDS")
+		{
+			ies_loc_par_coords = org_value;
+		}
+		else if (key == "IES_LOC_OBS_COORDS")
+		{
+			ies_loc_obs_coords = org_value;
+		}
+		else if (key == "IES_LOC_TAPER")
+		{
+			convert_ip(value, ies_loc_taper);
+		}
+		else if (key == "IES_LOC_RADIUS")
+		{
+			convert_ip(value, ies_loc_radius);
+		}
+		else if (key == "IES_CHECKPOINT")
+		{
+			transform(value.begin(), value.end(), value.begin(), ::tolower);
+			istringstream is(value);
+			is >> boolalpha >> ies_checkpoint;
+		}
+		else if (key == "IES_RESTART_CHECKPOINT")
+		{
+			ies_restart_checkpoint = org_value;
+		}
 		else if (key == "IES_ACCEPT_PHI_FAC")
 		{
 			convert_ip(value, ies_accept_phi_fac);
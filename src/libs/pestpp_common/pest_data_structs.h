@@ -363,6 +363,12 @@ public:
 	void set_ies_use_empirical_prior(bool _ies_use_empirical_prior) { ies_use_empirical_prior = _ies_use_empirical_prior; }
 	bool get_ies_group_draws() const { return ies_group_draws; }
 	void set_ies_group_draws(bool _ies_group_draws) { ies_group_draws = _ies_group_draws; }
+	bool get_ies_parallel_draws() const { return ies_parallel_draws; }
+	void set_ies_parallel_draws(bool _ies_parallel_draws) { ies_parallel_draws = _ies_parallel_draws; }
+	double get_ies_cholesky_max_density() const { return ies_cholesky_max_density; }
+	void set_ies_cholesky_max_density(double _density) { ies_cholesky_max_density = _density; }
+	bool get_ies_stream_lambdas() const { return ies_stream_lambdas; }
+	void set_ies_stream_lambdas(bool _ies_stream_lambdas) { ies_stream_lambdas = _ies_stream_lambdas; }
 	//bool get_ies_num_reals_passed() const { return ies_num_reals_passed; }
 	//void set_ies_num_reals_passed(bool _ies_num_reals_passed) { ies_num_reals_passed = _ies_num_reals_passed; }
 	bool get_ies_enforce_bounds() const { return ies_enforce_bounds; }
@@ -372,8 +378,26 @@ public:
 	void set_par_sigma_range(double _par_sigma_range) { par_sigma_range = _par_sigma_range; }
 	bool get_ies_save_binary() const { return ies_save_binary; }
 	void set_ies_save_binary(bool _ies_save_binary) { ies_save_binary = _ies_save_binary; }
+	bool get_ies_save_dense() const { return ies_save_dense; }
+	void set_ies_save_dense(bool _ies_save_dense) { ies_save_dense = _ies_save_dense; }
+	bool get_ies_out_of_core() const { return ies_out_of_core; }
+	void set_ies_out_of_core(bool _ies_out_of_core) { ies_out_of_core = _ies_out_of_core; }
+	int get_ies_tile_cols() const { return ies_tile_cols; }
+	void set_ies_tile_cols(int _ies_tile_cols) { ies_tile_cols = _ies_tile_cols; }
 	string get_ies_localizer() const { return ies_localizer; }
 	void set_ies_localizer(string _ies_localizer) { ies_localizer = _ies_localizer; }
+	string get_ies_loc_par_coords() const { return ies_loc_par_coords; }
+	void set_ies_loc_par_coords(string _ies_loc_par_coords) { ies_loc_par_coords = _ies_loc_par_coords; }
+	string get_ies_loc_obs_coords() const { return ies_loc_obs_coords; }
+	void set_ies_loc_obs_coords(string _ies_loc_obs_coords) { ies_loc_obs_coords = _ies_loc_obs_coords; }
+	string get_ies_loc_taper() const { return ies_loc_taper; }
+	void set_ies_loc_taper(string _ies_loc_taper) { ies_loc_taper = _ies_loc_taper; }
+	double get_ies_loc_radius() const { return ies_loc_radius; }
+	void set_ies_loc_radius(double _ies_loc_radius) { ies_loc_radius = _ies_loc_radius; }
+	bool get_ies_checkpoint() const { return ies_checkpoint; }
+	void set_ies_checkpoint(bool _ies_checkpoint) { ies_checkpoint = _ies_checkpoint; }
+	string get_ies_restart_checkpoint() const { return ies_restart_checkpoint; }
+	void set_ies_restart_checkpoint(string _ies_restart_checkpoint) { ies_restart_checkpoint = _ies_restart_checkpoint; }
 	double get_ies_accept_phi_fac() const { return ies_accept_phi_fac; }
 	void set_ies_accept_phi_fac(double _acc_phi_fac) { ies_accept_phi_fac = _acc_phi_fac; }
 	double get_ies_lambda_inc_fac() const { return ies_lambda_inc_fac; }
@@ -391,6 +415,24 @@ public:
 
 	double get_overdue_giveup_minutes() const { return overdue_giveup_minutes; }
 	void set_overdue_giveup_minutes(double overdue_minutes) { overdue_giveup_minutes = overdue_minutes; }
+	bool get_run_storage_mmap() const { return run_storage_mmap; }
+	void set_run_storage_mmap(bool _mmap) { run_storage_mmap = _mmap; }
+	bool get_run_storage_write_behind() const { return run_storage_write_behind; }
+	void set_run_storage_write_behind(bool _write_behind) { run_storage_write_behind = _write_behind; }
+	int get_panther_prefetch_depth() const { return panther_prefetch_depth; }
+	void set_panther_prefetch_depth(int _depth) { panther_prefetch_depth = _depth; }
+	bool get_panther_cost_scheduling() const { return panther_cost_scheduling; }
+	void set_panther_cost_scheduling(bool _cost_scheduling) { panther_cost_scheduling = _cost_scheduling; }
+	double get_panther_overdue_quantile() const { return panther_overdue_quantile; }
+	void set_panther_overdue_quantile(double _quantile) { panther_overdue_quantile = _quantile; }
+	string get_tpl_writer() const { return tpl_writer; }
+	void set_tpl_writer(const string &_tpl_writer) { tpl_writer = _tpl_writer; }
+	string get_ins_reader() const { return ins_reader; }
+	void set_ins_reader(const string &_ins_reader) { ins_reader = _ins_reader; }
+	string get_obs_storage_precision() const { return obs_storage_precision; }
+	void set_obs_storage_precision(const string &_precision) { obs_storage_precision = _precision; }
+	int get_local_num_workers() const { return local_num_workers; }
+	void set_local_num_workers(int _num_workers) { local_num_workers = _num_workers; }
 
 	int get_ies_num_threads() const { return ies_num_threads; }
 	void set_ies_num_threads(int _threads) { ies_num_threads = _threads; }
@@ -431,6 +473,15 @@ private:
 	double overdue_reched_fac;
 	double overdue_giveup_fac;
 	double overdue_giveup_minutes;
+	bool run_storage_mmap;
+	bool run_storage_write_behind;
+	int panther_prefetch_depth;
+	bool panther_cost_scheduling;
+	double panther_overdue_quantile;
+	string tpl_writer;
+	string ins_reader;
+	string obs_storage_precision;
+	int local_num_workers;
 	string condor_submit_file;
 	double reg_frac;
 
@@ -482,11 +533,23 @@ private:
 	bool ies_include_base;
 	bool ies_use_empirical_prior;
 	bool ies_group_draws;
+	bool ies_parallel_draws;
+	double ies_cholesky_max_density;
+	bool ies_stream_lambdas;
 	//bool ies_num_reals_passed;
 	bool ies_enforce_bounds;
 	double par_sigma_range;
 	bool ies_save_binary;
+	bool ies_save_dense;
+	bool ies_out_of_core;
+	int ies_tile_cols;
 	string ies_localizer;
+	string ies_loc_par_coords;
+	string ies_loc_obs_coords;
+	string ies_loc_taper;
+	double ies_loc_radius;
+	bool ies_checkpoint;
+	string ies_restart_checkpoint;
 	double ies_accept_phi_fac;
 	double ies_lambda_inc_fac;
 	double ies_lambda_dec_fac;
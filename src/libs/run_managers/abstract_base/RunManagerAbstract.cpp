@@ -235,6 +235,11 @@ bool RunManagerAbstract::get_observations_vec(int run_id, vector<double> &data_v
 	return success;
 }
 
+RunStorage::RunView RunManagerAbstract::get_run_view(int run_id)
+{
+	return file_stor.get_run_view(run_id);
+}
+
  Observations RunManagerAbstract::get_obs_template(double value) const
  {
 	Observations ret_obs;
@@ -255,7 +260,7 @@ bool RunManagerAbstract::get_observations_vec(int run_id, vector<double> &data_v
  {
 	 bool ret_val;
 	 int istatus = file_stor.get_run_status(run_id);
-	 if (istatus <=0 && istatus > -max_n_failure)
+	 if (istatus <=0 && istatus > -max_n_failure && istatus > -100)
 	 {
 		 ret_val = true;
 	 }
@@ -280,6 +285,12 @@ bool RunManagerAbstract::get_observations_vec(int run_id, vector<double> &data_v
 	 return run_ids;
  }
 
+ void RunManagerAbstract::cancel_run(int run_id)
+ {
+	 //a run status of -100 flags a canceled run in the run storage
+	 file_stor.set_run_nfailed(run_id, 100);
+ }
+
  void  RunManagerAbstract::update_run_failed(int run_id)
  {
 	 file_stor.update_run_failed(run_id);
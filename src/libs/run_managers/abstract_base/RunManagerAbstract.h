@@ -49,6 +49,9 @@ public:
 	virtual int add_run(const std::vector<double> &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
 	virtual int add_run(const Eigen::VectorXd &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
 	virtual void update_run(int run_id, const Parameters &pars, const Observations &obs);
+	// marks the run as canceled so it is not made (or retried).  Run managers that have already
+	// started the run stop it where they can
+	virtual void cancel_run(int run_id);
 	virtual void run() = 0;
 	virtual RunManagerAbstract::RUN_UNTIL_COND run_until(RUN_UNTIL_COND condition, int n_nops = 0, double sec = 0.0);
 	virtual const std::vector<std::string> &get_par_name_vec() const;
@@ -64,6 +67,14 @@ public:
 	virtual const std::set<int> get_failed_run_ids();
 	virtual bool get_model_parameters(int run_num, Parameters &pars);
 	virtual bool get_observations_vec(int run_id, std::vector<double> &data_vec);
+	virtual RunStorage::RunView get_run_view(int run_id);
+	virtual void set_run_storage_mmap(bool use_mmap) { file_stor.set_use_mmap(use_mmap); }
+	virtual void set_run_storage_write_behind(bool write_behind) { file_stor.set_write_behind(write_behind); }
+	// must be called before initialize() to take effect
+	virtual void set_run_storage_single_precision_obs(bool single_precision_obs) { file_stor.set_single_precision_obs(single_precision_obs); }
+	// only used by run managers that write the model input files themselves
+	virtual void set_cpp_tpl_writer(bool use_cpp_tpl_writer) {}
+	virtual void set_cpp_ins_reader(bool use_cpp_ins_reader) {}
 	virtual Observations get_obs_template(double value = -9999.0) const;
 	virtual int get_total_runs(void) const {return total_runs;}
 	virtual int get_num_good_runs(void);
@@ -24,6 +24,8 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <cstring>
+#include <chrono>
 #include "RunStorage.h"
 #include "Serialization.h"
 #include "Transformable.h"
@@ -34,34 +36,315 @@ using std::numeric_limits;
 using namespace std;
 
 const double RunStorage::no_data = -9999.0;
+const std::streamoff RunStorage::mmap_min_extent = 16 * 1024 * 1024;
+const std::streamoff RunStorage::mmap_max_extent = 1024 * 1024 * 1024;
+const size_t RunStorage::write_behind_max_bytes = 64 * 1024 * 1024;
 
-RunStorage::RunStorage(const string &_filename) :filename(_filename), run_byte_size(0)
+RunStorage::RunStorage(const string &_filename, bool _use_mmap) :filename(_filename), use_mmap(_use_mmap), mmap_used_bytes(0),
+	single_precision_obs(false), write_behind(false), io_stop(false), pending_bytes(0), run_byte_size(0)
 {
 }
 
-void RunStorage::reset(const vector<string> &_par_names, const vector<string> &_obs_names, const string &_filename)
+void RunStorage::set_use_mmap(bool _use_mmap)
 {
-	par_names = _par_names;
-	obs_names = _obs_names;
-	// a file needs to exist before it can be opened it with read and write
-	// permission.   So open it with write permission to crteate it, close
-	// and then reopen it with read and write permisssion.
-	if (_filename.size() > 0)
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	if (_use_mmap == use_mmap)
+		return;
+	if (stor_is_open())
 	{
-		filename = _filename;
+		throw PestError("RunStorage::set_use_mmap(): storage mode can not be changed once the run storage file is open");
 	}
-	if (buf_stream.is_open())
+	use_mmap = _use_mmap;
+}
+
+bool RunStorage::stor_is_open() const
+{
+	if (use_mmap)
+		return mmap_file.is_open();
+	return buf_stream.is_open();
+}
+
+void RunStorage::open_stor(bool truncate)
+{
+	close_stor();
+	if (use_mmap)
+	{
+		if (truncate)
+		{
+			remove(filename.c_str());
+			mmap_file.open(filename, MappedFile::Mode::READ_WRITE, mmap_min_extent);
+			mmap_used_bytes = 0;
+		}
+		else
+		{
+			mmap_file.open(filename, MappedFile::Mode::READ_WRITE);
+			mmap_used_bytes = mmap_file.size();
+		}
+		return;
+	}
+	if (truncate)
 	{
+		// a file needs to exist before it can be opened it with read and write
+		// permission.   So open it with write permission to crteate it, close
+		// and then reopen it with read and write permisssion.
+		// std::ofstream::trunc will delete the file if it already exist
+		buf_stream.open(filename.c_str(), ios_base::out | ios_base::binary | std::ofstream::trunc);
 		buf_stream.close();
+		buf_stream.open(filename.c_str(), ios_base::out | ios_base::in | ios_base::binary);
+	}
+	else
+	{
+		buf_stream.open(filename.c_str(), ios_base::out | ios_base::in | ios_base::binary | ios_base::ate);
 	}
-	buf_stream.open(filename.c_str(), ios_base::out |  ios_base::binary);
-        buf_stream.close();
-	buf_stream.open(filename.c_str(), ios_base::out | ios_base::in | ios_base::binary);
 	assert(buf_stream.good() == true);
 	if (!buf_stream.good())
 	{
 		throw PestFileError(filename);
 	}
+}
+
+void RunStorage::set_write_behind(bool _write_behind)
+{
+	if (_write_behind == write_behind)
+		return;
+	if (_write_behind)
+	{
+		std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+		write_behind = true;
+		io_stop = false;
+		io_error = nullptr;
+		io_thread = std::thread(&RunStorage::io_thread_main, this);
+	}
+	else
+	{
+		stop_io_thread();
+		std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+		write_behind = false;
+		write_pending();
+	}
+}
+
+void RunStorage::sync()
+{
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	if (io_error)
+	{
+		std::rethrow_exception(io_error);
+	}
+	write_pending();
+}
+
+void RunStorage::stop_io_thread()
+{
+	{
+		std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+		io_stop = true;
+	}
+	io_cv.notify_all();
+	if (io_thread.joinable())
+	{
+		io_thread.join();
+	}
+}
+
+void RunStorage::io_thread_main()
+{
+	std::unique_lock<std::recursive_mutex> stor_lock(stor_mutex);
+	while (true)
+	{
+		io_cv.wait(stor_lock, [this]() { return io_stop || !pending_updates.empty(); });
+		if (io_stop && pending_updates.empty())
+		{
+			break;
+		}
+		// give the caller a short window to queue more completed runs so they are written as a single batch
+		io_cv.wait_for(stor_lock, std::chrono::milliseconds(write_behind_delay_ms),
+			[this]() { return io_stop || pending_bytes >= write_behind_max_bytes / 2; });
+		try
+		{
+			write_pending();
+		}
+		catch (...)
+		{
+			// leave the queue intact and report the error on the next call from the owning thread
+			io_error = std::current_exception();
+			break;
+		}
+	}
+}
+
+void RunStorage::queue_update(int run_id, std::int8_t r_status, bool has_pars, const char *data, size_t n_bytes)
+{
+	if (io_error)
+	{
+		std::rethrow_exception(io_error);
+	}
+	auto it = pending_updates.find(run_id);
+	if (it != pending_updates.end() && it->second.has_pars && !has_pars)
+	{
+		// only the observations are being replaced.  Keep the queued parameter values
+		it->second.status = r_status;
+		copy_n(data, n_bytes, it->second.data.begin() + run_par_byte_size);
+	}
+	else
+	{
+		if (it != pending_updates.end())
+		{
+			pending_bytes -= it->second.data.size();
+		}
+		PendingUpdate &rec = pending_updates[run_id];
+		rec.status = r_status;
+		rec.has_pars = has_pars;
+		rec.data.assign(data, data + n_bytes);
+		pending_bytes += n_bytes;
+	}
+	if (pending_bytes >= write_behind_max_bytes || io_error)
+	{
+		// the I/O thread is not keeping up.  Write the queue from this thread to bound the memory used
+		write_pending();
+	}
+	else
+	{
+		io_cv.notify_one();
+	}
+}
+
+void RunStorage::apply_pending(int run_id, char *rec_buf) const
+{
+	auto it = pending_updates.find(run_id);
+	if (it == pending_updates.end())
+		return;
+	const PendingUpdate &rec = it->second;
+	memcpy(rec_buf, &rec.status, sizeof(rec.status));
+	char *data_ptr = rec_buf + sizeof(std::int8_t) + sizeof(char)*info_txt_length + sizeof(double);
+	if (!rec.has_pars)
+	{
+		data_ptr += run_par_byte_size;
+	}
+	memcpy(data_ptr, rec.data.data(), rec.data.size());
+}
+
+void RunStorage::write_pending()
+{
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	if (pending_updates.empty() || !stor_is_open())
+		return;
+	// The batch is written in two passes so that a run is only flagged as complete once its data is
+	// in the file.  Runs that were previously flagged as complete are first reset to 0.
+	std::int8_t r_status = 0;
+	bool status_reset = false;
+	for (auto &ipend : pending_updates)
+	{
+		std::streamoff pos = get_stream_pos(ipend.first);
+		read_bytes(pos, &r_status, sizeof(r_status));
+		if (r_status > 0)
+		{
+			r_status = 0;
+			write_bytes(pos, &r_status, sizeof(r_status));
+			status_reset = true;
+		}
+	}
+	if (status_reset)
+	{
+		flush_stor();
+	}
+	for (auto &ipend : pending_updates)
+	{
+		std::streamoff pos = get_stream_pos(ipend.first) + sizeof(std::int8_t) + sizeof(char)*info_txt_length + sizeof(double);
+		if (!ipend.second.has_pars)
+		{
+			pos += run_par_byte_size;
+		}
+		write_bytes(pos, ipend.second.data.data(), ipend.second.data.size());
+	}
+	flush_stor();
+	for (auto &ipend : pending_updates)
+	{
+		write_bytes(get_stream_pos(ipend.first), &ipend.second.status, sizeof(ipend.second.status));
+	}
+	flush_stor();
+	pending_updates.clear();
+	pending_bytes = 0;
+}
+
+void RunStorage::close_stor()
+{
+	if (stor_is_open())
+	{
+		write_pending();
+	}
+	if (buf_stream.is_open())
+	{
+		buf_stream.close();
+	}
+	if (mmap_file.is_open())
+	{
+		//trim the extent that was reserved beyond the logical end of the file
+		mmap_file.close(mmap_used_bytes);
+	}
+}
+
+void RunStorage::reserve_mmap(std::streamoff end_pos)
+{
+	std::streamoff cur_size = mmap_file.size();
+	if (end_pos <= cur_size)
+		return;
+	std::streamoff extent = max(mmap_min_extent, min(cur_size, mmap_max_extent));
+	mmap_file.resize(max(end_pos, cur_size + extent));
+}
+
+void RunStorage::write_bytes(std::streamoff pos, const void *data, size_t n_bytes)
+{
+	if (use_mmap)
+	{
+		reserve_mmap(pos + n_bytes);
+		memcpy(mmap_file.data() + pos, data, n_bytes);
+		mmap_used_bytes = max(mmap_used_bytes, pos + (std::streamoff)n_bytes);
+	}
+	else
+	{
+		buf_stream.seekp(pos, ios_base::beg);
+		buf_stream.write(reinterpret_cast<const char*>(data), n_bytes);
+	}
+}
+
+void RunStorage::read_bytes(std::streamoff pos, void *data, size_t n_bytes)
+{
+	if (use_mmap)
+	{
+		if (pos + (std::streamoff)n_bytes > (std::streamoff)mmap_file.size())
+		{
+			throw PestError("Error in RunStorage routine: attempt to read beyond the end of file " + filename);
+		}
+		memcpy(data, mmap_file.data() + pos, n_bytes);
+	}
+	else
+	{
+		buf_stream.seekg(pos, ios_base::beg);
+		buf_stream.read(reinterpret_cast<char*>(data), n_bytes);
+	}
+}
+
+void RunStorage::flush_stor()
+{
+	// a memory mapped file is written back by the OS.  The data is safe if the
+	// process terminates, so there is no need to pay for a sync on every update
+	if (!use_mmap)
+	{
+		buf_stream.flush();
+	}
+}
+
+void RunStorage::reset(const vector<string> &_par_names, const vector<string> &_obs_names, const string &_filename)
+{
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	par_names = _par_names;
+	obs_names = _obs_names;
+	if (_filename.size() > 0)
+	{
+		filename = _filename;
+	}
+	open_stor(true);
 	// calculate the number of bytes required to store parameter names
 	vector<int8_t> serial_pnames(Serialization::serialize(par_names));
 	std::int64_t p_name_size_64 = serial_pnames.size() * sizeof(char);
@@ -70,7 +353,7 @@ void RunStorage::reset(const vector<string> &_par_names, const vector<string> &_
 	std::int64_t o_name_size_64 = serial_onames.size() * sizeof(char);
 	// calculate the number of bytes required to store a model run
 	run_par_byte_size = par_names.size() * sizeof(double);
-	run_data_byte_size = run_par_byte_size + obs_names.size() * sizeof(double);
+	run_data_byte_size = run_par_byte_size + obs_names.size() * obs_value_size();
 	//compute the amount of memeory required to store a single model run
 	// run_byte_size = size of run_status + size of info_txt + size of info_value + size of parameter oand observation data
 	run_byte_size =  sizeof(std::int8_t) + 41*sizeof(char) * sizeof(double) + run_data_byte_size;
@@ -78,68 +361,70 @@ void RunStorage::reset(const vector<string> &_par_names, const vector<string> &_
 	beg_run0 = 4 * sizeof(std::int64_t) + serial_pnames.size() + serial_onames.size();
 	std::int64_t n_runs_64=0;
 	// write header to file
-	buf_stream.seekp(0, ios_base::beg);
-	buf_stream.write((char*) &n_runs_64, sizeof(n_runs_64));
-	buf_stream.write((char*) &run_size_64, sizeof(run_size_64));
-	buf_stream.write((char*) &p_name_size_64, sizeof(p_name_size_64));
-	buf_stream.write((char*) &o_name_size_64, sizeof(o_name_size_64));
-	buf_stream.write((char*)serial_pnames.data(), serial_pnames.size());
-	buf_stream.write((char*)serial_onames.data(), serial_onames.size());
+	std::streamoff pos = 0;
+	write_bytes(pos, &n_runs_64, sizeof(n_runs_64));
+	pos += sizeof(n_runs_64);
+	write_bytes(pos, &run_size_64, sizeof(run_size_64));
+	pos += sizeof(run_size_64);
+	write_bytes(pos, &p_name_size_64, sizeof(p_name_size_64));
+	pos += sizeof(p_name_size_64);
+	write_bytes(pos, &o_name_size_64, sizeof(o_name_size_64));
+	pos += sizeof(o_name_size_64);
+	write_bytes(pos, serial_pnames.data(), serial_pnames.size());
+	pos += serial_pnames.size();
+	write_bytes(pos, serial_onames.data(), serial_onames.size());
 	//add flag for double buffering
 	std::int8_t buf_status = 0;
 	int end_of_runs = get_nruns();
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 }
 
 
 void RunStorage::init_restart(const std::string &_filename)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	filename = _filename;
 	par_names.clear();
 	obs_names.clear();
 
-	if (buf_stream.is_open())
-	{
-		buf_stream.close();
-	}
-
-	buf_stream.open(filename.c_str(), ios_base::out | ios_base::in | ios_base::binary | ios_base::ate);
-	assert(buf_stream.good() == true);
-	if (!buf_stream.good())
-	{
-		throw PestFileError(filename);
-	}
+	open_stor(false);
 	// read header
-	buf_stream.seekg(0, ios_base::beg);
-
+	std::streamoff pos = 0;
 	std::int64_t n_runs_64;
-	buf_stream.read((char*) &n_runs_64, sizeof(n_runs_64));
+	read_bytes(pos, &n_runs_64, sizeof(n_runs_64));
+	pos += sizeof(n_runs_64);
 
 	std::int64_t  run_size_64;
-	buf_stream.read((char*) &run_size_64, sizeof(run_size_64));
+	read_bytes(pos, &run_size_64, sizeof(run_size_64));
+	pos += sizeof(run_size_64);
 	run_byte_size = run_size_64;
 
 	std::int64_t p_name_size_64;
-	buf_stream.read((char*) &p_name_size_64, sizeof(p_name_size_64));
+	read_bytes(pos, &p_name_size_64, sizeof(p_name_size_64));
+	pos += sizeof(p_name_size_64);
 
 	std::int64_t o_name_size_64;
-	buf_stream.read((char*) &o_name_size_64, sizeof(o_name_size_64));
+	read_bytes(pos, &o_name_size_64, sizeof(o_name_size_64));
+	pos += sizeof(o_name_size_64);
 
 	vector<int8_t> serial_pnames;
 	serial_pnames.resize(p_name_size_64);
-	buf_stream.read((char *)serial_pnames.data(), serial_pnames.size());
+	read_bytes(pos, serial_pnames.data(), serial_pnames.size());
+	pos += serial_pnames.size();
 	Serialization::unserialize(serial_pnames, par_names);
 
 	vector<int8_t> serial_onames;
 	serial_onames.resize(o_name_size_64);
-	buf_stream.read((char *)serial_onames.data(), serial_onames.size());
+	read_bytes(pos, serial_onames.data(), serial_onames.size());
 	Serialization::unserialize(serial_onames, obs_names);
 
 	beg_run0 = 4 * sizeof(std::int64_t) + serial_pnames.size() + serial_onames.size();
 	run_par_byte_size = par_names.size() * sizeof(double);
-	run_data_byte_size = run_par_byte_size + obs_names.size() * sizeof(double);
+	// the precision of the observation values is not recorded in the header.  Recover it from the record size
+	std::streamoff run_obs_byte_size = run_byte_size - (sizeof(std::int8_t) + 41 * sizeof(char) * sizeof(double)) - run_par_byte_size;
+	single_precision_obs = (obs_names.size() > 0) && (run_obs_byte_size == (std::streamoff)(obs_names.size() * sizeof(float)));
+	run_data_byte_size = run_par_byte_size + obs_names.size() * obs_value_size();
 
 	//check buffer to see if a write was improperly terminated
 	std::int8_t r_status = 0;
@@ -147,42 +432,45 @@ void RunStorage::init_restart(const std::string &_filename)
 	std::int32_t buf_run_id = 0;
 
 	int end_of_runs = get_nruns();
-	buf_stream.seekg(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
+	pos = get_stream_pos(end_of_runs);
+	read_bytes(pos, &buf_status, sizeof(buf_status));
+	pos += sizeof(buf_status);
 	if (buf_status == 1 || buf_status == 2)
 	{
-		buf_stream.read(reinterpret_cast<char*>(&buf_run_id), sizeof(buf_run_id));
-		buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
+		read_bytes(pos, &buf_run_id, sizeof(buf_run_id));
+		pos += sizeof(buf_run_id);
+		read_bytes(pos, &r_status, sizeof(r_status));
+		pos += sizeof(r_status);
 		check_rec_id(buf_run_id);
-		size_t n_par = par_names.size();
-		size_t n_obs = obs_names.size();
-		vector<double> pars_vec(n_par, Parameters::no_data);
-		vector<double> obs_vec(n_obs, Observations::no_data);
-
-		buf_stream.read(reinterpret_cast<char*>(pars_vec.data()), n_par * sizeof(double));
-		buf_stream.read(reinterpret_cast<char*>(obs_vec.data()), n_obs * sizeof(double));
+		// the parameter and observation values are copied as they are stored
+		vector<char> run_data(run_data_byte_size);
+		read_bytes(pos, run_data.data(), run_data.size());
 
 		//write data
-		buf_stream.seekp(get_stream_pos(buf_run_id), ios_base::beg);
-		buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
+		pos = get_stream_pos(buf_run_id);
+		write_bytes(pos, &r_status, sizeof(r_status));
 		//skip over info_txt and info_value fields
-		buf_stream.seekp(sizeof(char)*info_txt_length + sizeof(double), ios_base::cur);
-		buf_stream.write(reinterpret_cast<char*>(pars_vec.data()), pars_vec.size() * sizeof(double));
-		buf_stream.write(reinterpret_cast<char*>(obs_vec.data()), obs_vec.size() * sizeof(double));
-		buf_stream.flush();
+		pos += sizeof(r_status) + sizeof(char)*info_txt_length + sizeof(double);
+		write_bytes(pos, run_data.data(), run_data.size());
+		flush_stor();
 		//reset flag for buffer at end of file to 0 to signal it is no longer relavent
 		buf_status = 0;
-		buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-		buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-		buf_stream.flush();
+		write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+		flush_stor();
 	}
 }
 
 int RunStorage::get_nruns()
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	std::int64_t n_runs_64;
+	if (use_mmap)
+	{
+		read_bytes(0, &n_runs_64, sizeof(n_runs_64));
+		return n_runs_64;
+	}
 	streamoff init_pos = buf_stream.tellg();
 	buf_stream.seekg(0, ios_base::beg);
-	std::int64_t n_runs_64;
 	buf_stream.read((char*) &n_runs_64, sizeof(n_runs_64));
 	int n_runs = n_runs_64;
 	buf_stream.seekg(init_pos);
@@ -191,6 +479,7 @@ int RunStorage::get_nruns()
 
 int RunStorage::get_num_good_runs()
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	int n_ok = 0;
 	int n_runs = get_nruns();
 	for (int id = 0; id<n_runs; ++id)
@@ -205,14 +494,13 @@ int RunStorage::get_num_good_runs()
 }
 int RunStorage::increment_nruns()
 {
-	buf_stream.seekg(0, ios_base::beg);
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	std::int64_t n_runs_64;
-	buf_stream.read((char*) &n_runs_64, sizeof(n_runs_64));
+	read_bytes(0, &n_runs_64, sizeof(n_runs_64));
 	++n_runs_64;
-	buf_stream.seekp(0, ios_base::beg);
-	buf_stream.write((char*) &n_runs_64, sizeof(n_runs_64));
+	write_bytes(0, &n_runs_64, sizeof(n_runs_64));
 	int n_runs = n_runs_64;
-	buf_stream.flush();
+	flush_stor();
 	return n_runs;
 }
 const std::vector<string>& RunStorage::get_par_name_vec()const
@@ -233,43 +521,49 @@ streamoff RunStorage::get_stream_pos(int run_id)
 
  int RunStorage::add_run(const vector<double> &model_pars, const string &info_txt, double info_value)
  {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	std::int8_t r_status = 0;
 	int run_id = increment_nruns() - 1;
 	vector<char> info_txt_buf;
 	info_txt_buf.resize(info_txt_length, '\0');
 	copy_n(info_txt.begin(), min(info_txt.size(), size_t(info_txt_length)-1) , info_txt_buf.begin());
-	buf_stream.seekp(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.write(reinterpret_cast<char*>(info_txt_buf.data()), sizeof(char)*info_txt_buf.size());
-	buf_stream.write(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.write(reinterpret_cast<const char*>(&model_pars[0]), model_pars.size()*sizeof(double));
+	std::streamoff pos = get_stream_pos(run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
+	pos += sizeof(r_status);
+	write_bytes(pos, info_txt_buf.data(), sizeof(char)*info_txt_buf.size());
+	pos += sizeof(char)*info_txt_buf.size();
+	write_bytes(pos, &info_value, sizeof(double));
+	pos += sizeof(double);
+	write_bytes(pos, &model_pars[0], model_pars.size()*sizeof(double));
 	//add flag for double buffering
 	std::int8_t buf_status = 0;
 	int end_of_runs = get_nruns();
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 	return run_id;
  }
 
  int RunStorage::add_run(const Eigen::VectorXd &model_pars, const string &info_txt, double info_value)
  {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	std::int8_t r_status = 0;
 	int run_id = increment_nruns() - 1;
 	vector<char> info_txt_buf;
 	info_txt_buf.resize(info_txt_length, '\0');
 	copy_n(info_txt.begin(), min(info_txt.size(), size_t(info_txt_length)-1) , info_txt_buf.begin());
-	buf_stream.seekp(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.write(reinterpret_cast<char*>(info_txt_buf.data()), sizeof(char)*info_txt_buf.size());
-	buf_stream.write(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.write(reinterpret_cast<const char*>(&model_pars(0)), model_pars.size()*sizeof(model_pars(0)));
+	std::streamoff pos = get_stream_pos(run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
+	pos += sizeof(r_status);
+	write_bytes(pos, info_txt_buf.data(), sizeof(char)*info_txt_buf.size());
+	pos += sizeof(char)*info_txt_buf.size();
+	write_bytes(pos, &info_value, sizeof(double));
+	pos += sizeof(double);
+	write_bytes(pos, &model_pars(0), model_pars.size()*sizeof(model_pars(0)));
 	//add flag for double buffering
 	std::int8_t buf_status = 0;
 	int end_of_runs = get_nruns();
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 	return run_id;
  }
 
@@ -283,177 +577,265 @@ int RunStorage::add_run(const Parameters &pars, const string &info_txt, double i
 
 void RunStorage::copy(const RunStorage &rhs_rs)
 {
-	if (buf_stream.is_open())
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	std::lock_guard<std::recursive_mutex> rhs_stor_lock(rhs_rs.stor_mutex);
+	open_stor(true);
+
+	// copy rhs runstorage information
+	if (rhs_rs.use_mmap)
 	{
-		buf_stream.close();
+		write_bytes(0, rhs_rs.mmap_file.data(), rhs_rs.mmap_used_bytes);
 	}
-	// std::ofstream::trunc will delete the file if it already exist
-	// a file needs to exist before it can be opened it with read and write
-	// permission.   So open it with write permission to create it, close
-	// and then reopen it with read and write permisssion.
-	buf_stream.open(filename.c_str(), ios_base::out | ios_base::binary | std::ofstream::trunc);
-	buf_stream.close();
-	buf_stream.open(filename.c_str(), ios_base::out | ios_base::in | ios_base::binary);
-	assert(buf_stream.good() == true);
-	if (!buf_stream.good())
+	else
 	{
-		throw PestFileError(filename);
+		std::streampos rhs_initial_pos = rhs_rs.buf_stream.tellg();
+		rhs_rs.buf_stream.seekg(0, ios_base::beg);
+		if (use_mmap)
+		{
+			stringstream ss;
+			ss << rhs_rs.buf_stream.rdbuf();
+			string rhs_bytes = ss.str();
+			write_bytes(0, rhs_bytes.data(), rhs_bytes.size());
+		}
+		else
+		{
+			buf_stream << rhs_rs.buf_stream.rdbuf();
+		}
+		rhs_rs.buf_stream.seekg(rhs_initial_pos);
 	}
-
-	// copy rhs runstorage information
-	std::streampos rhs_initial_pos = rhs_rs.buf_stream.tellg();
-	rhs_rs.buf_stream.seekg(0, ios_base::beg);
-	buf_stream << rhs_rs.buf_stream.rdbuf();
-	rhs_rs.buf_stream.seekg(rhs_initial_pos);
 	beg_run0 = rhs_rs.beg_run0;
 	run_byte_size = rhs_rs.run_byte_size;
 	run_par_byte_size = rhs_rs.run_par_byte_size;
-	run_data_byte_size = rhs_rs.run_par_byte_size;
+	run_data_byte_size = rhs_rs.run_data_byte_size;
+	single_precision_obs = rhs_rs.single_precision_obs;
 	par_names = rhs_rs.par_names;
 	obs_names = rhs_rs.obs_names;
+	// runs still queued in rhs_rs have not been written to its file yet
+	for (auto &ipend : rhs_rs.pending_updates)
+	{
+		std::streamoff pos = get_stream_pos(ipend.first);
+		write_bytes(pos, &ipend.second.status, sizeof(ipend.second.status));
+		pos += sizeof(std::int8_t) + sizeof(char)*info_txt_length + sizeof(double);
+		if (!ipend.second.has_pars)
+		{
+			pos += run_par_byte_size;
+		}
+		write_bytes(pos, ipend.second.data.data(), ipend.second.data.size());
+	}
+	flush_stor();
 }
 
 void RunStorage::update_run(int run_id, const Parameters &pars, const Observations &obs)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	//set run status flage to complete
 	std::int8_t r_status = 1;
 	check_rec_id(run_id);
 	vector<double> par_data(pars.get_data_vec(par_names));
-	vector<double> obs_data(obs.get_data_vec(obs_names));
+	vector<char> obs_bytes(pack_obs(obs.get_data_vec(obs_names)));
+	if (write_behind)
+	{
+		vector<char> serial_data(run_data_byte_size);
+		memcpy(serial_data.data(), par_data.data(), par_data.size() * sizeof(double));
+		memcpy(serial_data.data() + run_par_byte_size, obs_bytes.data(), obs_bytes.size());
+		queue_update(run_id, r_status, true, serial_data.data(), serial_data.size());
+		return;
+	}
 	//write data to buffer at end of file and set buffer flag to 1
 	std::int8_t buf_status = 0;
 	std::int32_t buf_run_id = run_id;
 	int end_of_runs = get_nruns();
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.write(reinterpret_cast<char*>(&buf_run_id), sizeof(buf_run_id));
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.write(reinterpret_cast<char*>(par_data.data()), par_data.size() * sizeof(double));
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
+	std::streamoff pos = get_stream_pos(end_of_runs);
+	write_bytes(pos, &buf_status, sizeof(buf_status));
+	pos += sizeof(buf_status);
+	write_bytes(pos, &buf_run_id, sizeof(buf_run_id));
+	pos += sizeof(buf_run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
+	pos += sizeof(r_status);
+	write_bytes(pos, par_data.data(), par_data.size() * sizeof(double));
+	pos += par_data.size() * sizeof(double);
+	write_bytes(pos, obs_bytes.data(), obs_bytes.size());
 	buf_status = 1;
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 	//write data
-	buf_stream.seekp(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
+	pos = get_stream_pos(run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
 	//skip over info_txt and info_value fields
-	buf_stream.seekp(sizeof(char)*info_txt_length+sizeof(double), ios_base::cur);
-	buf_stream.write(reinterpret_cast<char*>(par_data.data()), par_data.size() * sizeof(double));
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
-	buf_stream.flush();
+	pos += sizeof(r_status) + sizeof(char)*info_txt_length + sizeof(double);
+	write_bytes(pos, par_data.data(), par_data.size() * sizeof(double));
+	pos += par_data.size() * sizeof(double);
+	write_bytes(pos, obs_bytes.data(), obs_bytes.size());
+	flush_stor();
 	//reset flag for buffer at end of file to 0 to signal it is no longer relavent
 	buf_status = 0;
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 }
 
 
 void RunStorage::update_run(int run_id, const Observations &obs)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	//set run status flage to complete
 	std::int8_t r_status = 1;
 	check_rec_id(run_id);
-	vector<double> obs_data(obs.get_data_vec(obs_names));
+	vector<char> obs_bytes(pack_obs(obs.get_data_vec(obs_names)));
 	size_t n_pars = par_names.size();
+	if (write_behind)
+	{
+		queue_update(run_id, r_status, false, obs_bytes.data(), obs_bytes.size());
+		return;
+	}
 
 	//write data to buffer at end of file and set buffer flag to 1
 	std::int8_t buf_status = 0;
 	std::int32_t buf_run_id = run_id;
 	int end_of_runs = get_nruns();
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.write(reinterpret_cast<char*>(&buf_run_id), sizeof(buf_run_id));
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
+	std::streamoff pos = get_stream_pos(end_of_runs);
+	write_bytes(pos, &buf_status, sizeof(buf_status));
+	pos += sizeof(buf_status);
+	write_bytes(pos, &buf_run_id, sizeof(buf_run_id));
+	pos += sizeof(buf_run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
+	pos += sizeof(r_status);
 	//skip over parameter section
-	buf_stream.seekp(n_pars * sizeof(double), ios_base::cur);
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
+	pos += n_pars * sizeof(double);
+	write_bytes(pos, obs_bytes.data(), obs_bytes.size());
 	buf_status = 1;
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 
 	//write data to main part of file
-	buf_stream.seekp(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
+	pos = get_stream_pos(run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
 	//skip over info_txt and info_value fields
-	buf_stream.seekp(sizeof(char)*info_txt_length + sizeof(double), ios_base::cur);
+	pos += sizeof(r_status) + sizeof(char)*info_txt_length + sizeof(double);
 	//skip over parameter section
-	buf_stream.seekp(n_pars * sizeof(double), ios_base::cur);
-	buf_stream.write(reinterpret_cast<char*>(obs_data.data()), obs_data.size() * sizeof(double));
-	buf_stream.flush();
+	pos += n_pars * sizeof(double);
+	write_bytes(pos, obs_bytes.data(), obs_bytes.size());
+	flush_stor();
 	//reset flag for buffer at end of file to 0 to signal it is no longer relavent
 	buf_status = 0;
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 }
 
 void RunStorage::update_run(int run_id, const vector<char> serial_data)
 {
+	update_run(run_id, serial_data.data(), serial_data.size());
+}
+
+void RunStorage::update_run(int run_id, const char *serial_data, size_t n_bytes)
+{
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	//set run status flage to complete
 	std::int8_t r_status = 1;
-	check_rec_size(serial_data);
+	vector<char> conv_data;
+	size_t n_obs = obs_names.size();
+	size_t n_other_bytes = run_par_byte_size + n_obs * (single_precision_obs ? sizeof(double) : sizeof(float));
+	if ((n_obs > 0) && (n_bytes != (size_t)run_data_byte_size) && (n_bytes == n_other_bytes))
+	{
+		// the observation values were sent in the other precision.  Convert them to the storage precision
+		conv_data.resize(run_data_byte_size);
+		memcpy(conv_data.data(), serial_data, run_par_byte_size);
+		const char *src = serial_data + run_par_byte_size;
+		char *dest = conv_data.data() + run_par_byte_size;
+		for (size_t i = 0; i < n_obs; ++i)
+		{
+			if (single_precision_obs)
+			{
+				double val;
+				memcpy(&val, src + i * sizeof(double), sizeof(double));
+				float fval = (float)val;
+				memcpy(dest + i * sizeof(float), &fval, sizeof(float));
+			}
+			else
+			{
+				float fval;
+				memcpy(&fval, src + i * sizeof(float), sizeof(float));
+				double val = fval;
+				memcpy(dest + i * sizeof(double), &val, sizeof(double));
+			}
+		}
+		serial_data = conv_data.data();
+		n_bytes = conv_data.size();
+	}
+	check_rec_size(n_bytes);
 	check_rec_id(run_id);
+	if (write_behind)
+	{
+		queue_update(run_id, r_status, true, serial_data, n_bytes);
+		return;
+	}
 	//write data to buffer at end of file and set buffer flag to 2
 	std::int8_t buf_status = 0;
 	std::int32_t buf_run_id = run_id;
 	int end_of_runs = get_nruns();
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.write(reinterpret_cast<char*>(&buf_run_id), sizeof(buf_run_id));
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.write(serial_data.data(), serial_data.size());
+	std::streamoff pos = get_stream_pos(end_of_runs);
+	write_bytes(pos, &buf_status, sizeof(buf_status));
+	pos += sizeof(buf_status);
+	write_bytes(pos, &buf_run_id, sizeof(buf_run_id));
+	pos += sizeof(buf_run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
+	pos += sizeof(r_status);
+	write_bytes(pos, serial_data, n_bytes);
 	buf_status = 2;
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 	//write data
-	buf_stream.seekp(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
+	pos = get_stream_pos(run_id);
+	write_bytes(pos, &r_status, sizeof(r_status));
 	//skip over info_txt and info_value fields
-	buf_stream.seekp(sizeof(char)*info_txt_length+sizeof(double), ios_base::cur);
-	buf_stream.write(serial_data.data(), serial_data.size());
-	buf_stream.flush();
+	pos += sizeof(r_status) + sizeof(char)*info_txt_length + sizeof(double);
+	write_bytes(pos, serial_data, n_bytes);
+	flush_stor();
 	//reset flag for buffer at end of file to 0 to signal it is no longer relavent
 	buf_status = 0;
-	buf_stream.seekp(get_stream_pos(end_of_runs), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&buf_status), sizeof(buf_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(end_of_runs), &buf_status, sizeof(buf_status));
+	flush_stor();
 }
 
 
 void RunStorage::update_run_failed(int run_id)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	std::int8_t r_status = get_run_status_native(run_id);
 	if (r_status < 1)
 	{
 		--r_status;
 		check_rec_id(run_id);
 		//update run status flag
-		buf_stream.seekp(get_stream_pos(run_id), ios_base::beg);
-		buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-		buf_stream.flush();
+		write_bytes(get_stream_pos(run_id), &r_status, sizeof(r_status));
+		flush_stor();
 	}
 }
 
 void RunStorage::set_run_nfailed(int run_id, int nfail)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	std::int8_t r_status = -nfail;
 	check_rec_id(run_id);
+	if (pending_updates.count(run_id) > 0)
+	{
+		write_pending();
+	}
 	//update run status flag
-	buf_stream.seekp(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.write(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.flush();
+	write_bytes(get_stream_pos(run_id), &r_status, sizeof(r_status));
+	flush_stor();
 }
 
 std::int8_t RunStorage::get_run_status_native(int run_id)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	std::int8_t  r_status;
 	check_rec_id(run_id);
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
+	read_bytes(get_stream_pos(run_id), &r_status, sizeof(r_status));
+	auto it = pending_updates.find(run_id);
+	if (it != pending_updates.end())
+	{
+		r_status = it->second.status;
+	}
 	return r_status;
 }
 
@@ -465,14 +847,22 @@ int RunStorage::get_run_status(int run_id)
 
 void RunStorage::get_info(int run_id, int &run_status, string &info_txt, double &info_value)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	std::int8_t  r_status;
 	vector<char> info_txt_buf;
 	info_txt_buf.resize(info_txt_length, '\0');
 
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
-	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
+	std::streamoff pos = get_stream_pos(run_id);
+	read_bytes(pos, &r_status, sizeof(r_status));
+	pos += sizeof(r_status);
+	read_bytes(pos, &info_txt_buf[0], sizeof(char)*info_txt_length);
+	pos += sizeof(char)*info_txt_length;
+	read_bytes(pos, &info_value, sizeof(double));
+	auto it = pending_updates.find(run_id);
+	if (it != pending_updates.end())
+	{
+		r_status = it->second.status;
+	}
 
 	run_status = r_status;
 	info_txt = info_txt_buf.data();
@@ -506,12 +896,7 @@ int RunStorage::get_run(int run_id, Parameters &pars, Observations &obs, bool cl
 
 int RunStorage::get_run(int run_id, double *pars, size_t npars, double *obs, size_t nobs, string &info_txt, double &info_value)
 {
-	std::int8_t r_status;
-	vector<char> info_txt_buf;
-	info_txt_buf.resize(info_txt_length, '\0');
-
-	check_rec_id(run_id);
-
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	size_t p_size = par_names.size();
 	size_t o_size = obs_names.size();
 
@@ -527,40 +912,29 @@ int RunStorage::get_run(int run_id, double *pars, size_t npars, double *obs, siz
 
 	p_size = min(p_size, npars);
 	o_size = min(o_size, nobs);
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
-	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.read(reinterpret_cast<char*>(pars), p_size * sizeof(double));
-	buf_stream.read(reinterpret_cast<char*>(obs), o_size * sizeof(double));
-	int status = r_status;
-	info_txt = info_txt_buf.data();
-	return status;
+	RunView view = get_run_view(run_id);
+	memcpy(pars, view.pars, p_size * sizeof(double));
+	memcpy(obs, view.obs, o_size * sizeof(double));
+	info_value = view.info_value;
+	info_txt = view.info_txt;
+	return view.status;
 }
 
 int RunStorage::get_run(int run_id, vector<double> &pars_vec, vector<double> &obs_vec, string &info_txt, double &info_value)
 {
-	std::int8_t  r_status;
-	vector<char> info_txt_buf;
-	info_txt_buf.resize(info_txt_length, '\0');
-
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	size_t n_par = par_names.size();
 	size_t n_obs = obs_names.size();
 
 	pars_vec.resize(n_par);
 	obs_vec.resize(n_obs);
 
-	check_rec_id(run_id);
-
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
-	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.read(reinterpret_cast<char*>(&pars_vec[0]), n_par * sizeof(double));
-	buf_stream.read(reinterpret_cast<char*>(&obs_vec[0]), n_obs * sizeof(double));
-	int status = r_status;
-	info_txt = info_txt_buf.data();
-	return status;
+	RunView view = get_run_view(run_id);
+	memcpy(pars_vec.data(), view.pars, n_par * sizeof(double));
+	memcpy(obs_vec.data(), view.obs, n_obs * sizeof(double));
+	info_value = view.info_value;
+	info_txt = view.info_txt;
+	return view.status;
 }
 
 int RunStorage::get_run(int run_id, vector<double> &pars_vec, vector<double> &obs_vec)
@@ -577,101 +951,124 @@ int RunStorage::get_run(int run_id, double *pars, size_t npars, double *obs, siz
 	return get_run(run_id, pars, npars, obs, nobs, info_txt, info_value);
 }
 
-vector<char> RunStorage::get_serial_pars(int run_id)
+RunStorage::RunView RunStorage::get_run_view(int run_id)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	check_rec_id(run_id);
-	std::int8_t r_status;
+	std::streamoff pos = get_stream_pos(run_id);
+	std::streamoff rec_size = sizeof(std::int8_t) + sizeof(char)*info_txt_length + sizeof(double) + run_data_byte_size;
+	const char *rec_ptr;
+	if (use_mmap && pending_updates.count(run_id) == 0)
+	{
+		rec_ptr = mmap_file.data() + pos;
+	}
+	else
+	{
+		view_buf.resize(rec_size);
+		read_bytes(pos, view_buf.data(), rec_size);
+		apply_pending(run_id, view_buf.data());
+		rec_ptr = view_buf.data();
+	}
+	RunView view;
+	view.status = *reinterpret_cast<const std::int8_t*>(rec_ptr);
+	rec_ptr += sizeof(std::int8_t);
+	view.info_txt = rec_ptr;
+	rec_ptr += sizeof(char)*info_txt_length;
+	memcpy(&view.info_value, rec_ptr, sizeof(double));
+	rec_ptr += sizeof(double);
+	view.npars = par_names.size();
+	view.pars = reinterpret_cast<const double*>(rec_ptr);
+	rec_ptr += run_par_byte_size;
+	view.nobs = obs_names.size();
+	if (single_precision_obs)
+	{
+		view_obs_buf.resize(view.nobs);
+		for (size_t i = 0; i < view.nobs; ++i)
+		{
+			float fval;
+			memcpy(&fval, rec_ptr + i * sizeof(float), sizeof(float));
+			view_obs_buf[i] = fval;
+		}
+		view.obs = view_obs_buf.data();
+	}
+	else
+	{
+		view.obs = reinterpret_cast<const double*>(rec_ptr);
+	}
+	return view;
+}
 
-	vector<char> serial_data;
-	serial_data.resize(run_par_byte_size);
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.seekg(sizeof(r_status)+sizeof(char)*info_txt_length+sizeof(double), ios_base::cur);
-	buf_stream.read(serial_data.data(), serial_data.size());
+vector<char> RunStorage::get_serial_pars(int run_id)
+{
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	RunView view = get_run_view(run_id);
+	const char *par_ptr = reinterpret_cast<const char*>(view.pars);
+	vector<char> serial_data(par_ptr, par_ptr + run_par_byte_size);
 	return serial_data;
 }
 
 int  RunStorage::get_parameters(int run_id, Parameters &pars)
 {
-	std::int8_t r_status;
-	vector<char> info_txt_buf;
-	info_txt_buf.resize(info_txt_length, '\0');
-	double info_value;
-
-	check_rec_id(run_id);
-
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	size_t n_par = par_names.size();
-	vector<double> par_data;
-	par_data.resize(n_par);
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
-	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-
-	buf_stream.read(reinterpret_cast<char*>(par_data.data()), n_par*sizeof(double));
+	RunView view = get_run_view(run_id);
+	vector<double> par_data(view.pars, view.pars + n_par);
 	pars.update(par_names, par_data);
-	int status = r_status;
-	return status;
+	return view.status;
 }
 
 
 int  RunStorage::get_observations(int run_id, Observations &obs)
 {
-	std::int8_t r_status;
-	vector<char> info_txt_buf;
-	info_txt_buf.resize(info_txt_length, '\0');
-	double info_value;
-
-	check_rec_id(run_id);
-
-	size_t n_par = par_names.size();
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	size_t n_obs = obs_names.size();
-	vector<double> obs_data;
-	obs_data.resize(n_obs);
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
-	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.seekg(n_par*sizeof(double), ios_base::cur);
-	buf_stream.read(reinterpret_cast<char*>(obs_data.data()), n_obs*sizeof(double));
-	int status = r_status;
+	RunView view = get_run_view(run_id);
+	vector<double> obs_data(view.obs, view.obs + n_obs);
 	obs.update(obs_names, obs_data);
-	return status;
+	return view.status;
 }
 
 
 int  RunStorage::get_observations_vec(int run_id, vector<double> &obs_data)
 {
-	std::int8_t r_status;
-	vector<char> info_txt_buf;
-	info_txt_buf.resize(info_txt_length, '\0');
-	double info_value;
-
-	check_rec_id(run_id);
-
-	size_t n_par = par_names.size();
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	size_t n_obs = obs_names.size();
+	RunView view = get_run_view(run_id);
 	obs_data.resize(n_obs);
-	buf_stream.seekg(get_stream_pos(run_id), ios_base::beg);
-	buf_stream.read(reinterpret_cast<char*>(&r_status), sizeof(r_status));
-	buf_stream.read(reinterpret_cast<char*>(&info_txt_buf[0]), sizeof(char)*info_txt_length);
-	buf_stream.read(reinterpret_cast<char*>(&info_value), sizeof(double));
-	buf_stream.seekg(n_par*sizeof(double), ios_base::cur);
-	buf_stream.read(reinterpret_cast<char*>(obs_data.data()), n_obs*sizeof(double));
-	int status = r_status;
-	return status;
+	memcpy(obs_data.data(), view.obs, n_obs * sizeof(double));
+	return view.status;
 }
 
 void RunStorage::free_memory()
 {
-	if (buf_stream.is_open()) {
-		buf_stream.close();
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+	if (stor_is_open()) {
+		close_stor();
 		remove(filename.c_str());
 	}
 }
 
-void RunStorage::check_rec_size(const vector<char> &serial_data) const
+vector<char> RunStorage::pack_obs(const vector<double> &obs_data) const
+{
+	vector<char> obs_bytes(obs_data.size() * obs_value_size());
+	if (single_precision_obs)
+	{
+		for (size_t i = 0; i < obs_data.size(); ++i)
+		{
+			float fval = (float)obs_data[i];
+			memcpy(obs_bytes.data() + i * sizeof(float), &fval, sizeof(float));
+		}
+	}
+	else if (obs_data.size() > 0)
+	{
+		memcpy(obs_bytes.data(), obs_data.data(), obs_bytes.size());
+	}
+	return obs_bytes;
+}
+
+void RunStorage::check_rec_size(size_t n_bytes) const
 {
-	if (serial_data.size() != run_data_byte_size)
+	if (n_bytes != run_data_byte_size)
 	{
 		throw PestError("Error in RunStorage routine.  Size of serial data is different from what is expected");
 	}
@@ -679,6 +1076,7 @@ void RunStorage::check_rec_size(const vector<char> &serial_data) const
 
 void RunStorage::check_rec_id(int run_id)
 {
+	std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
 	int n_runs = get_nruns();
 	if ( run_id + 1 > n_runs)
 	{
@@ -794,4 +1192,7 @@ void RunStorage::export_diff_to_text_file(const std::string &in1_filename, const
 RunStorage::~RunStorage()
 {
   //free_memory();
+  stop_io_thread();
+  std::lock_guard<std::recursive_mutex> stor_lock(stor_mutex);
+  close_stor();
 }
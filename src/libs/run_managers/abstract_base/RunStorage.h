@@ -25,7 +25,13 @@
 #include <ostream>
 #include <vector>
 #include <cstdint>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <exception>
 #include <Eigen/Dense>
+#include "mapped_file.h"
 
 class Parameters;
 class Observations;
@@ -49,10 +55,50 @@ class RunStorage {
 	//                   depends on the type of model run being stored  )
 	//       parameter_values  (parameters values for model runs)                     double*number of parameters
 	//       observationn_values( observations results produced by the model run)     double*number of observations
+	//                           (float*number of observations in single precision mode)
+	//
+	// The file can either be accessed through a std::fstream (default) or through a memory mapping
+	// (set_use_mmap(true)).  Both modes use exactly the same file layout.  In mmap mode the file is grown
+	// in large extents and trimmed back to its logical size when the storage is closed.
+	//
+	// With set_write_behind(true) the update_run() calls only queue the completed run in memory and a
+	// background thread writes the queued runs to file in batches.  Reads of queued runs are served from
+	// the queue so the storage always looks up to date to the caller.  sync() writes out everything that
+	// is still queued and should be called at points where the file needs to be complete (e.g. the end
+	// of a run manager's run()).
+	//
+	// With set_single_precision_obs(true) the observation values are stored as 4 byte floats, which
+	// halves the size of the records of problems with many observations.  Parameter values are always
+	// stored in double precision.  The precision is fixed when the file is created by reset() and is
+	// recovered from the record size by init_restart(), so either kind of file is read back transparently.
+	// Values are always passed to and returned from the storage as doubles.
 
 public:
+	// Non-owning view of a single model run record.  In mmap mode the pointers reference the mapped
+	// file directly; otherwise they reference an internal buffer.  In single precision mode the
+	// observation values are always converted into an internal buffer.  Either way the view is only valid
+	// until the next call that modifies the storage.  Note that the record layout does not guarantee
+	// 8 byte alignment of the parameter and observation values.
+	struct RunView
+	{
+		int status;
+		const char *info_txt;
+		double info_value;
+		const double *pars;
+		size_t npars;
+		const double *obs;
+		size_t nobs;
+	};
 	static const double no_data;
-	RunStorage(const std::string &_filename);
+	RunStorage(const std::string &_filename, bool _use_mmap = false);
+	void set_use_mmap(bool _use_mmap);
+	bool get_use_mmap() const { return use_mmap; }
+	void set_write_behind(bool _write_behind);
+	bool get_write_behind() const { return write_behind; }
+	// takes effect the next time the file is created by reset()
+	void set_single_precision_obs(bool _single_precision_obs) { single_precision_obs = _single_precision_obs; }
+	bool get_single_precision_obs() const { return single_precision_obs; }
+	void sync();
 	void reset(const std::vector<std::string> &par_names, const std::vector<std::string> &obs_names, const std::string &_filename = std::string(""));
 	void init_restart(const std::string &_filename);
 	virtual int add_run(const std::vector<double> &model_pars, const std::string &info_txt="", double info_value=no_data);
@@ -62,6 +108,10 @@ public:
 	void update_run(int run_id, const Parameters &pars, const Observations &obs);
 	void update_run(int run_id, const Observations &obs);
 	void update_run(int run_id, const std::vector<char> serial_data);
+	// serial_data holds the parameter values followed by the observation values in the order of
+	// get_par_name_vec() and get_obs_name_vec().  The observation values can be either doubles or
+	// floats (identified by n_bytes) and are converted to the precision of the storage if needed
+	void update_run(int run_id, const char *serial_data, size_t n_bytes);
 	void update_run_failed(int run_id);
 	void set_run_nfailed(int run_id, int nfail);
 	int get_nruns();
@@ -82,6 +132,7 @@ public:
 	std::vector<char> get_serial_pars(int run_id);
 	int get_observations_vec(int run_id, std::vector<double> &data_vec);
 	int get_observations(int run_id, Observations &obs);
+	RunView get_run_view(int run_id);
 	static void export_diff_to_text_file(const std::string &in1_filename, const std::string &in2_filename, const std::string &out_filename);
 	void free_memory();
 	std::string get_filename() { return filename; }
@@ -89,18 +140,57 @@ public:
 	~RunStorage();
 private:
 	static const int info_txt_length = 41;
+	static const std::streamoff mmap_min_extent;
+	static const std::streamoff mmap_max_extent;
+	static const size_t write_behind_max_bytes;
+	static const int write_behind_delay_ms = 20;
+	struct PendingUpdate
+	{
+		std::int8_t status;
+		bool has_pars;
+		// parameter values (only if has_pars) followed by observation values
+		std::vector<char> data;
+	};
 	std::string filename;
+	bool use_mmap;
 	mutable std::fstream buf_stream;
+	MappedFile mmap_file;
+	std::streamoff mmap_used_bytes;
+	std::vector<char> view_buf;
+	std::vector<double> view_obs_buf;
+	bool single_precision_obs;
+	bool write_behind;
+	mutable std::recursive_mutex stor_mutex;
+	std::condition_variable_any io_cv;
+	std::thread io_thread;
+	bool io_stop;
+	std::exception_ptr io_error;
+	std::map<int, PendingUpdate> pending_updates;
+	size_t pending_bytes;
 	std::streamoff beg_run0;
 	std::streamoff run_byte_size;
 	std::streamoff run_par_byte_size;
 	std::streamoff run_data_byte_size;
 	std::vector<std::string> par_names;
 	std::vector<std::string> obs_names;
-	void check_rec_size(const std::vector<char> &serial_data) const;
+	void check_rec_size(size_t n_bytes) const;
+	size_t obs_value_size() const { return single_precision_obs ? sizeof(float) : sizeof(double); }
+	std::vector<char> pack_obs(const std::vector<double> &obs_data) const;
 	void check_rec_id(int run_id);
 	std::int8_t get_run_status_native(int run_id);
 	std::streamoff get_stream_pos(int run_id);
+	void open_stor(bool truncate);
+	bool stor_is_open() const;
+	void write_bytes(std::streamoff pos, const void *data, size_t n_bytes);
+	void read_bytes(std::streamoff pos, void *data, size_t n_bytes);
+	void flush_stor();
+	void reserve_mmap(std::streamoff end_pos);
+	void close_stor();
+	void queue_update(int run_id, std::int8_t r_status, bool has_pars, const char *data, size_t n_bytes);
+	void apply_pending(int run_id, char *rec_buf) const;
+	void write_pending();
+	void io_thread_main();
+	void stop_io_thread();
 };
 
 #endif //RUN_STORAGE_H_
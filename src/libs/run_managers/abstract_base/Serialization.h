@@ -36,7 +36,8 @@ public:
 	static std::vector<int8_t> serialize(const std::vector<const Transformable*> tr_vec);
 	static std::vector<int8_t> serialize(const std::vector<Transformable*> &tr_vec);
 	static std::vector<int8_t> serialize(const Parameters &pars, const Observations &obs);
-	static std::vector<int8_t> serialize(const Parameters &pars, const std::vector<std::string> &par_names_vec, const Observations &obs, const std::vector<std::string> &obs_names_vec, double run_time);
+	// the parameter values, observation values and run time.  The observation values are written as floats if single_precision_obs is true
+	static std::vector<int8_t> serialize(const Parameters &pars, const std::vector<std::string> &par_names_vec, const Observations &obs, const std::vector<std::string> &obs_names_vec, double run_time, bool single_precision_obs = false);
 	static std::vector<int8_t> serialize(const std::vector<std::string> &string_vec);
 	static std::vector<int8_t> serialize(const std::vector<std::vector<std::string> const*> &string_vec_vec);
 	static unsigned long unserialize(const std::vector<int8_t> &ser_data, int64_t &data, unsigned long start_loc = 0);
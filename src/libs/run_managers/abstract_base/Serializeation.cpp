@@ -122,7 +122,7 @@ vector<int8_t> Serialization::serialize(const Parameters &pars, const Observatio
 	 return serialize(tr_vec);
 }
 
-vector<int8_t> Serialization::serialize(const Parameters &pars, const vector<string> &par_names_vec, const Observations &obs, const vector<string> &obs_names_vec, double run_time)
+vector<int8_t> Serialization::serialize(const Parameters &pars, const vector<string> &par_names_vec, const Observations &obs, const vector<string> &obs_names_vec, double run_time, bool single_precision_obs)
 {
 
 	assert(pars.size() == par_names_vec.size());
@@ -131,7 +131,7 @@ vector<int8_t> Serialization::serialize(const Parameters &pars, const vector<str
 	size_t npar = par_names_vec.size();
 	size_t nobs = obs_names_vec.size();
 	size_t par_buf_sz = npar * sizeof(double);
-	size_t obs_buf_sz = nobs * sizeof(double);
+	size_t obs_buf_sz = nobs * (single_precision_obs ? sizeof(float) : sizeof(double));
 	size_t run_time_sz = sizeof(double);
 	serial_data.resize(par_buf_sz + obs_buf_sz + run_time_sz, Parameters::no_data);
 
@@ -141,7 +141,15 @@ vector<int8_t> Serialization::serialize(const Parameters &pars, const vector<str
 
 	vector<double> obs_data = obs.get_data_vec(obs_names_vec);
 
-	w_memcpy_s(buf+par_buf_sz, obs_buf_sz, &obs_data[0], obs_data.size() * sizeof(double));
+	if (single_precision_obs)
+	{
+		vector<float> obs_data_sp(obs_data.begin(), obs_data.end());
+		w_memcpy_s(buf + par_buf_sz, obs_buf_sz, &obs_data_sp[0], obs_data_sp.size() * sizeof(float));
+	}
+	else
+	{
+		w_memcpy_s(buf+par_buf_sz, obs_buf_sz, &obs_data[0], obs_data.size() * sizeof(double));
+	}
 	w_memcpy_s(buf + par_buf_sz + obs_buf_sz, run_time_sz, &run_time, sizeof(double));
 
 	return serial_data;
@@ -0,0 +1,811 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include "instruction_files.h"
+#include "mapped_file.h"
+#include "pest_error.h"
+#include "utilities.h"
+
+using namespace std;
+
+namespace
+{
+	// length of the character variable mio uses for observation names
+	const size_t fortran_word_len = 200;
+	const string errsub = "Error reading model output file(s):";
+
+	// filenames are quoted in messages if they contain a blank (mio_addquote)
+	string quote(const string &filename)
+	{
+		if (filename.find(' ') == string::npos)
+			return filename;
+		return "\"" + filename + "\"";
+	}
+
+	// Fortran I(n) read of the n characters at s with blanks ignored
+	bool read_fortran_integer(const char *s, size_t n, int &val)
+	{
+		size_t i = 0;
+		while ((i < n) && (s[i] == ' '))
+			++i;
+		if (i == n)
+		{
+			val = 0;
+			return true;
+		}
+		bool neg = false;
+		if ((s[i] == '+') || (s[i] == '-'))
+		{
+			neg = (s[i] == '-');
+			++i;
+		}
+		long long v = 0;
+		bool seen_digit = false;
+		for (; i < n; ++i)
+		{
+			if (s[i] == ' ')
+				continue;
+			if ((s[i] < '0') || (s[i] > '9'))
+				return false;
+			seen_digit = true;
+			v = v * 10 + (s[i] - '0');
+			if (v > (long long)numeric_limits<int>::max() + 1)
+				return false;
+		}
+		if (!seen_digit)
+			return false;
+		if (neg)
+			v = -v;
+		if ((v > numeric_limits<int>::max()) || (v < numeric_limits<int>::min()))
+			return false;
+		val = (int)v;
+		return true;
+	}
+
+	bool match_special(const char *s, size_t n, const char *word)
+	{
+		size_t len = strlen(word);
+		if (n < len)
+			return false;
+		for (size_t i = 0; i < len; ++i)
+		{
+			if (tolower((unsigned char)s[i]) != word[i])
+				return false;
+		}
+		return true;
+	}
+
+	class OutputFile
+	{
+		// sequential access to the lines of a memory mapped model output file.  Lines are returned
+		// as they would be by a Fortran formatted read into a max_line_len character variable
+		// followed by the tab expansion of the mio module, with trailing blanks removed
+	public:
+		OutputFile(const string &_filename) : filename(_filename), pos(0), line_num(0)
+		{
+			//the model may not have released the file yet
+			const int n_tries = 4;
+			for (int i = 0; i < n_tries; ++i)
+			{
+				try
+				{
+					file.open(filename);
+					return;
+				}
+				catch (PestFileError&)
+				{
+					this_thread::sleep_for(chrono::seconds(1));
+				}
+			}
+			throw PestError(errsub + " cannot open model output file " + quote(filename) + ".");
+		}
+		bool skip_line()
+		{
+			if (pos >= file.size())
+				return false;
+			const char *start = file.data() + pos;
+			const char *eol = (const char*)memchr(start, '\n', file.size() - pos);
+			pos = (eol == nullptr) ? file.size() : (eol - file.data()) + 1;
+			++line_num;
+			return true;
+		}
+		bool read_line(string &line)
+		{
+			if (pos >= file.size())
+				return false;
+			const char *start = file.data() + pos;
+			size_t len = file.size() - pos;
+			const char *eol = (const char*)memchr(start, '\n', len);
+			if (eol != nullptr)
+			{
+				len = eol - start;
+				pos += len + 1;
+			}
+			else
+				pos = file.size();
+			if ((len > 0) && (start[len - 1] == '\r'))
+				--len;
+			line.assign(start, min(len, InstructionFile::max_line_len));
+			if (line.find('\t') != string::npos)
+				expand_tabs(line);
+			size_t n = line.find_last_not_of(' ');
+			line.resize((n == string::npos) ? 0 : n + 1);
+			++line_num;
+			return true;
+		}
+		int get_line_num() const { return line_num; }
+		const string& get_filename() const { return filename; }
+	private:
+		string filename;
+		MappedFile file;
+		size_t pos;
+		int line_num;
+		// tab stops every 8 columns, as in mio_tabrep
+		static void expand_tabs(string &line)
+		{
+			string expanded;
+			expanded.reserve(line.size() + 64);
+			for (char c : line)
+			{
+				if (c == '\t')
+					expanded.append(8 - (expanded.size() % 8), ' ');
+				else
+					expanded.push_back(c);
+				if (expanded.size() >= InstructionFile::max_line_len)
+					break;
+			}
+			if (expanded.size() > InstructionFile::max_line_len)
+				expanded.resize(InstructionFile::max_line_len);
+			line.swap(expanded);
+		}
+	};
+
+	// the next instruction item, delimited by blanks or enclosed in marker delimiters
+	// (mio_getint).  Returns false at the end of the line and throws if a marker is not closed
+	bool next_item(const string &line, size_t &pos, char mrkdel, string &item)
+	{
+		size_t n1 = line.find_first_not_of(' ', pos);
+		if (n1 == string::npos)
+		{
+			pos = line.size();
+			return false;
+		}
+		size_t n2;
+		if (line[n1] == mrkdel)
+		{
+			n2 = line.find(mrkdel, n1 + 1);
+			if (n2 == string::npos)
+				throw PestError("missing marker delimiter");
+			++n2;
+		}
+		else
+		{
+			n2 = line.find(' ', n1);
+			if (n2 == string::npos)
+				n2 = line.size();
+		}
+		item = line.substr(n1, n2 - n1);
+		pos = n2;
+		return true;
+	}
+
+	// the position of the number spanning columns num1 to num2 (mio_gettot).  Columns are one based
+	bool number_extent(const string &dline, int &num1, int &num2)
+	{
+		int nblc = dline.size();
+		if ((num1 > nblc) || (num2 < 1))
+			return false;
+		if (num2 > nblc)
+			num2 = nblc;
+		if (dline[num2 - 1] == ' ')
+		{
+			int i;
+			for (i = num2; i >= num1; --i)
+			{
+				if (dline[i - 1] != ' ')
+					break;
+			}
+			if (i < num1)
+				return false;
+			num2 = i;
+		}
+		else if (num2 != nblc)
+		{
+			size_t i = dline.find(' ', num2 - 1);
+			num2 = (i == string::npos) ? nblc : i;
+		}
+		if (num1 != 1)
+		{
+			size_t i = dline.find_last_of(' ', num1 - 1);
+			num1 = (i == string::npos) ? 1 : i + 2;
+		}
+		return true;
+	}
+}
+
+const size_t InstructionFile::max_line_len;
+
+bool InstructionFile::read_fortran_real(const char *s, size_t n, double &val)
+{
+	static const double pow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+		1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	//gfortran rejects larger exponents
+	static const int max_exp = 9999;
+	const char *p = s;
+	const char *end = s + n;
+	while ((p < end) && (*p == ' '))
+		++p;
+	while ((end > p) && (end[-1] == ' '))
+		--end;
+	bool neg = false;
+	if ((p < end) && ((*p == '+') || (*p == '-')))
+	{
+		neg = (*p == '-');
+		++p;
+		while ((p < end) && (*p == ' '))
+			++p;
+	}
+	if ((p < end) && ((*p == 'i') || (*p == 'I') || (*p == 'n') || (*p == 'N')))
+	{
+		size_t len = end - p;
+		if (((len == 3) && match_special(p, len, "inf")) || ((len == 8) && match_special(p, len, "infinity")))
+		{
+			val = neg ? -numeric_limits<double>::infinity() : numeric_limits<double>::infinity();
+			return true;
+		}
+		if (((len == 3) && match_special(p, len, "nan")) ||
+			((len > 4) && match_special(p, len, "nan(") && (end[-1] == ')') && (find(p, end, ' ') == end)))
+		{
+			val = neg ? -numeric_limits<double>::quiet_NaN() : numeric_limits<double>::quiet_NaN();
+			return true;
+		}
+		return false;
+	}
+	//significant digits of the mantissa and the power of ten they are scaled by
+	const int max_digits = 30;
+	char digits[max_digits + 16];
+	int n_digits = 0;
+	int dec_exp = 0;
+	bool seen_dp = false;
+	bool empty = (p == end);
+	for (; p < end; ++p)
+	{
+		char c = *p;
+		if ((c >= '0') && (c <= '9'))
+		{
+			if ((n_digits == 0) && (c == '0'))
+			{
+				if (seen_dp)
+					--dec_exp;
+			}
+			else if (n_digits < max_digits)
+			{
+				digits[n_digits++] = c;
+				if (seen_dp)
+					--dec_exp;
+			}
+			else if (!seen_dp)
+				++dec_exp;
+		}
+		else if (c == '.')
+		{
+			if (seen_dp)
+				return false;
+			seen_dp = true;
+		}
+		else if (c != ' ')
+			break;
+	}
+	if (p < end)
+	{
+		//exponent: a letter followed by an optionally signed integer, or a signed integer
+		char c = *p;
+		if ((c == 'e') || (c == 'E') || (c == 'd') || (c == 'D') || (c == 'q') || (c == 'Q'))
+		{
+			++p;
+			while ((p < end) && (*p == ' '))
+				++p;
+			if ((p < end) && ((*p == '+') || (*p == '-')))
+				c = *p++;
+		}
+		else if ((c == '+') || (c == '-'))
+			++p;
+		else
+			return false;
+		int exp = 0;
+		bool seen_exp_digit = false;
+		for (; p < end; ++p)
+		{
+			if ((*p >= '0') && (*p <= '9'))
+			{
+				seen_exp_digit = true;
+				if (exp <= max_exp)
+					exp = exp * 10 + (*p - '0');
+			}
+			else if (*p != ' ')
+				return false;
+		}
+		if ((!seen_exp_digit) || (exp > max_exp))
+			return false;
+		dec_exp += (c == '-') ? -exp : exp;
+	}
+	if (n_digits == 0)
+	{
+		val = (neg && !empty) ? -0.0 : 0.0;
+		return true;
+	}
+	while ((n_digits > 1) && (digits[n_digits - 1] == '0'))
+	{
+		--n_digits;
+		++dec_exp;
+	}
+	if ((n_digits <= 15) && (dec_exp >= -22) && (dec_exp <= 22))
+	{
+		//the significand and the power of ten are exact so the single operation is correctly rounded
+		double m = 0.0;
+		for (int i = 0; i < n_digits; ++i)
+			m = m * 10.0 + (digits[i] - '0');
+		val = (dec_exp < 0) ? m / pow10[-dec_exp] : m * pow10[dec_exp];
+	}
+	else
+	{
+		snprintf(digits + n_digits, sizeof(digits) - n_digits, "e%d", dec_exp);
+		val = strtod(digits, nullptr);
+	}
+	if (neg)
+		val = -val;
+	return true;
+}
+
+
+InstructionFile::InstructionFile(const string &_ins_filename, const string &_out_filename)
+	: ins_filename(_ins_filename), out_filename(_out_filename)
+{
+}
+
+void InstructionFile::compile(const unordered_map<string, int> &obs_index, vector<bool> &obs_cited)
+{
+	ifstream fin(ins_filename, ios::binary);
+	if (!fin.good())
+	{
+		throw PestError("Cannot open instruction file " + quote(ins_filename) + ".");
+	}
+	ins_lines.clear();
+	//lines are read as by mio: truncated, tabs replaced with blanks and then left justified
+	auto read_ins_line = [&fin](string &line)
+	{
+		if (!getline(fin, line))
+			return false;
+		if ((!line.empty()) && (line.back() == '\r'))
+			line.pop_back();
+		if (line.size() > max_line_len)
+			line.resize(max_line_len);
+		if (line.find('\t') != string::npos)
+		{
+			replace(line.begin(), line.end(), '\t', ' ');
+			line.erase(0, min(line.find_first_not_of(' '), line.size()));
+		}
+		size_t n = line.find_last_not_of(' ');
+		line.resize((n == string::npos) ? 0 : n + 1);
+		return true;
+	};
+	string line;
+	if ((!read_ins_line(line)) || (line.size() < 5) || (line[4] == ' ') ||
+		((pest_utils::lower_cp(line.substr(0, 3)) != "pif") && (pest_utils::lower_cp(line.substr(0, 3)) != "jif")))
+	{
+		throw PestError("Header of \"pif\" or \"jif\" followed by space, followed by marker delimiter expected on first line of instruction file " + quote(ins_filename) + ".");
+	}
+	char mrkdel = tolower((unsigned char)line[4]);
+	int iline = 1;
+	int n_line_advance = 0;
+	while (read_ins_line(line))
+	{
+		++iline;
+		if (line.empty())
+			continue;
+		stringstream ss;
+		ss << "Error in instruction file " << quote(ins_filename) << " at line " << iline << ":";
+		string errline = ss.str();
+		InsLine ins_line;
+		ins_line.continuation = false;
+		size_t pos = 0;
+		string item;
+		bool first = true;
+		while (true)
+		{
+			try
+			{
+				if (!next_item(line, pos, mrkdel, item))
+					break;
+			}
+			catch (PestError&)
+			{
+				throw PestError(errline + " missing marker delimiter in user-supplied instruction.");
+			}
+			Instruction ins;
+			ins.num1 = 0;
+			ins.num2 = 0;
+			ins.obs_idx = -1;
+			char c = item[0];
+			if (first && (c != '&'))
+				n_line_advance = 0;
+			if ((c == 'l') || (c == 'L'))
+			{
+				// only one line advance is allowed per instruction line and its continuation lines
+				if (n_line_advance > 0)
+					throw PestError(errline + " line advance item can only occur at the beginning of an instruction line.");
+				++n_line_advance;
+				if ((item.size() < 2) || (!read_fortran_integer(item.c_str() + 1, item.size() - 1, ins.num1)))
+					throw PestError(errline + " cannot read line advance item from user-supplied instruction.");
+				ins.type = InsType::LINE_ADVANCE;
+			}
+			else if (c == mrkdel)
+			{
+				ins.type = InsType::MARKER;
+				ins.text = item.substr(1, item.size() - 2);
+			}
+			else if (c == '&')
+			{
+				if (!first)
+					throw PestError(errline + " if present, continuation character must be first instruction on an instruction line.");
+				if (ins_lines.empty())
+					throw PestError(errline + " first instruction line in instruction file cannot start with continuation character.");
+				ins_line.continuation = true;
+				first = false;
+				continue;
+			}
+			else if ((c == 'w') || (c == 'W'))
+			{
+				ins.type = InsType::WHITESPACE;
+			}
+			else if ((c == 't') || (c == 'T'))
+			{
+				if ((item.size() < 2) || (!read_fortran_integer(item.c_str() + 1, item.size() - 1, ins.num1)))
+					throw PestError(errline + " cannot read tab position from user-supplied instruction.");
+				ins.type = InsType::TAB;
+			}
+			else if ((c == '[') || (c == '('))
+			{
+				ins.type = (c == '[') ? InsType::FIXED_OBS : InsType::SEMI_FIXED_OBS;
+				size_t n3 = item.find((c == '[') ? ']' : ')');
+				if (n3 == string::npos)
+					throw PestError(errline + " missing \"]\" or \")\" character in instruction.");
+				ins.text = item.substr(1, n3 - 1);
+				size_t n4 = item.find(':', n3 + 1);
+				if ((n4 == string::npos) || (n4 == n3 + 1) || (n4 + 1 == item.size()) ||
+					(!read_fortran_integer(item.c_str() + n3 + 1, n4 - n3 - 1, ins.num1)) ||
+					(!read_fortran_integer(item.c_str() + n4 + 1, item.size() - n4 - 1, ins.num2)) ||
+					(ins.num1 < 1))
+					throw PestError(errline + " cannot interpret user-supplied instruction for reading model output file.");
+			}
+			else if (c == '!')
+			{
+				ins.type = InsType::NON_FIXED_OBS;
+				ins.text = (item.size() > 1) ? pest_utils::lower_cp(item.substr(1, item.size() - 2)) : "";
+				if ((item.size() == 5) && (ins.text == "dum"))
+					ins.obs_idx = -1;
+				else
+					ins.obs_idx = -2;
+			}
+			else
+			{
+				throw PestError(errline + " cannot interpret user-supplied instruction for reading model output file.");
+			}
+			if ((ins.type == InsType::FIXED_OBS) || (ins.type == InsType::SEMI_FIXED_OBS) ||
+				((ins.type == InsType::NON_FIXED_OBS) && (ins.obs_idx != -1)))
+			{
+				string name = ins.text.substr(0, fortran_word_len);
+				pest_utils::strip_ip(name);
+				pest_utils::lower_ip(name);
+				auto it = obs_index.find(name);
+				if (it == obs_index.end())
+					throw PestError(errline + " observation name \"" + name + "\" from user-supplied instruction set is not cited in main program input file.");
+				if (obs_cited[it->second])
+					throw PestError(errline + " observation \"" + name + "\" already cited in instruction set.");
+				obs_cited[it->second] = true;
+				ins.obs_idx = it->second;
+				ins.text = name;
+			}
+			ins_line.items.push_back(ins);
+			first = false;
+		}
+		ins_lines.push_back(ins_line);
+	}
+	if (fin.bad())
+	{
+		throw PestError("Unable to read instruction file " + quote(ins_filename) + ".");
+	}
+}
+
+void InstructionFile::read(vector<double> &obs_vals) const
+{
+	OutputFile fout(out_filename);
+	const string afile = quote(out_filename);
+	auto line_error = [&fout, &afile](const string &message)
+	{
+		stringstream ss;
+		ss << errsub << " " << message << " line " << fout.get_line_num() << " of model output file " << afile << ".";
+		return PestError(ss.str());
+	};
+	auto obs_error = [&line_error](const Instruction &ins, bool found)
+	{
+		if (found)
+			return line_error("cannot read observation \"" + ins.text + "\" from");
+		return line_error("cannot find observation \"" + ins.text + "\" on");
+	};
+	const PestError eof_error(errsub + " unexpected end to model output file " + afile + ".");
+	// the current line of the model output file; one based column j1 is the last character processed
+	string dline;
+	int j1 = 0;
+	// mrktyp is 0 until a line has been read for the current instruction line, almark is 1 while
+	// the instruction line has only had markers, and begins is set when a secondary marker was not
+	// found on a line reached by markers alone so the search resumes on the following lines
+	int mrktyp = 0;
+	int almark = 1;
+	bool begins = false;
+	size_t iins = 0;
+	while (iins < ins_lines.size())
+	{
+		const InsLine &ins_line = ins_lines[iins];
+		if (ins_line.continuation)
+		{
+			if (begins)
+			{
+				--iins;
+				continue;
+			}
+		}
+		else
+		{
+			mrktyp = 0;
+			almark = 1;
+			begins = false;
+		}
+		bool restart = false;
+		const vector<Instruction> &items = ins_line.items;
+		for (size_t k = 0; k < items.size(); ++k)
+		{
+			const Instruction &ins = items[k];
+			int nblc = dline.size();
+			switch (ins.type)
+			{
+			case InsType::LINE_ADVANCE:
+				almark = 0;
+				for (int i = 1; i < ins.num1; ++i)
+				{
+					if (!fout.skip_line())
+						throw eof_error;
+				}
+				if (!fout.read_line(dline))
+					throw eof_error;
+				mrktyp = 1;
+				j1 = 0;
+				break;
+			case InsType::MARKER:
+				if (mrktyp == 0)
+				{
+					//the marker may extend into the blanks that pad the Fortran line variable
+					bool pad = (!ins.text.empty()) && (ins.text.back() == ' ');
+					while (true)
+					{
+						if (!fout.read_line(dline))
+							throw eof_error;
+						size_t pos;
+						if (pad)
+						{
+							string padded = dline;
+							padded.append(min(ins.text.size(), max_line_len - dline.size()), ' ');
+							pos = padded.find(ins.text);
+						}
+						else
+							pos = dline.find(ins.text);
+						if (pos != string::npos)
+						{
+							j1 = pos + ins.text.size();
+							break;
+						}
+					}
+					mrktyp = 1;
+				}
+				else
+				{
+					size_t pos = (j1 >= nblc) ? string::npos : dline.find(ins.text, j1);
+					if (pos == string::npos)
+					{
+						if (almark == 1)
+						{
+							begins = true;
+							restart = true;
+							break;
+						}
+						throw line_error("unable to find secondary marker on");
+					}
+					j1 = pos + ins.text.size();
+				}
+				break;
+			case InsType::WHITESPACE:
+			{
+				almark = 0;
+				size_t pos = (j1 >= nblc) ? string::npos : dline.find(' ', j1);
+				if (pos == string::npos)
+					throw line_error("unable to find requested whitespace, or whitespace precedes end of line at");
+				pos = dline.find_first_not_of(' ', pos);
+				j1 = (pos == string::npos) ? nblc : pos;
+				break;
+			}
+			case InsType::TAB:
+				almark = 0;
+				if (ins.num1 < j1)
+					throw line_error("backwards move to tab position not allowed on");
+				j1 = ins.num1;
+				if (j1 > nblc)
+					throw line_error("tab position beyond end of line at");
+				break;
+			case InsType::FIXED_OBS:
+			case InsType::SEMI_FIXED_OBS:
+			{
+				almark = 0;
+				int num1 = ins.num1;
+				int num2 = ins.num2;
+				if (ins.type == InsType::SEMI_FIXED_OBS)
+				{
+					if (!number_extent(dline, num1, num2))
+						throw obs_error(ins, false);
+					if (num2 < num1)
+						throw obs_error(ins, true);
+				}
+				else
+				{
+					if (num1 > nblc)
+						throw obs_error(ins, false);
+					num2 = min(num2, nblc);
+					if ((num2 < num1) || (dline.find_first_not_of(' ', num1 - 1) >= (size_t)num2))
+						throw obs_error(ins, false);
+				}
+				if (!read_fortran_real(dline.data() + num1 - 1, num2 - num1 + 1, obs_vals[ins.obs_idx]))
+					throw obs_error(ins, true);
+				j1 = num2;
+				break;
+			}
+			case InsType::NON_FIXED_OBS:
+			{
+				almark = 0;
+				size_t pos = (j1 >= nblc) ? string::npos : dline.find_first_not_of(' ', j1);
+				if (pos == string::npos)
+					throw obs_error(ins, false);
+				int num1 = pos + 1;
+				pos = dline.find(' ', pos);
+				int num2 = (pos == string::npos) ? nblc : pos;
+				double val;
+				if (!read_fortran_real(dline.data() + num1 - 1, num2 - num1 + 1, val))
+				{
+					//the number may be followed directly by the next marker
+					if ((k + 1 == items.size()) || (items[k + 1].type != InsType::MARKER))
+						throw obs_error(ins, true);
+					pos = dline.find(items[k + 1].text, j1);
+					if (pos == string::npos)
+						throw obs_error(ins, true);
+					num2 = pos;
+					if ((num2 < num1) || (!read_fortran_real(dline.data() + num1 - 1, num2 - num1 + 1, val)))
+						throw obs_error(ins, true);
+				}
+				if (ins.obs_idx >= 0)
+					obs_vals[ins.obs_idx] = val;
+				j1 = num2;
+				break;
+			}
+			}
+			if (restart)
+				break;
+		}
+		if (!restart)
+			++iins;
+	}
+}
+
+
+InstructionFiles::InstructionFiles() : initialized(false), max_threads(0)
+{
+}
+
+InstructionFiles::InstructionFiles(const vector<string> &_insfile_vec, const vector<string> &_outfile_vec)
+	: initialized(false), max_threads(0), insfile_vec(_insfile_vec), outfile_vec(_outfile_vec)
+{
+}
+
+void InstructionFiles::initialize(const vector<string> &_obs_name_vec)
+{
+	if (insfile_vec.size() != outfile_vec.size())
+		throw PestError("InstructionFiles::initialize(): number of instruction files and model output files are not equal");
+	obs_name_vec = _obs_name_vec;
+	unordered_map<string, int> obs_index;
+	for (size_t i = 0; i < obs_name_vec.size(); ++i)
+	{
+		obs_index[pest_utils::lower_cp(obs_name_vec[i])] = i;
+	}
+	vector<bool> obs_cited(obs_name_vec.size(), false);
+	ins_files.clear();
+	for (size_t i = 0; i < insfile_vec.size(); ++i)
+	{
+		ins_files.push_back(InstructionFile(insfile_vec[i], outfile_vec[i]));
+		ins_files.back().compile(obs_index, obs_cited);
+	}
+	for (size_t i = 0; i < obs_name_vec.size(); ++i)
+	{
+		if (!obs_cited[i])
+			throw PestError(errsub + " observation \"" + pest_utils::lower_cp(obs_name_vec[i]) + "\" not referenced in the user-supplied instruction set.");
+	}
+	initialized = true;
+}
+
+void InstructionFiles::read_output_files(vector<double> &obs_vals) const
+{
+	if (!initialized)
+		throw PestError("InstructionFiles::read_output_files() called before initialize()");
+	obs_vals.resize(obs_name_vec.size());
+	int n_threads = (max_threads > 0) ? max_threads : thread::hardware_concurrency();
+	n_threads = min(n_threads, (int)ins_files.size());
+	if (n_threads <= 1)
+	{
+		for (auto &ins : ins_files)
+			ins.read(obs_vals);
+		return;
+	}
+	//each file writes to its own observations so the files can be read concurrently.  Errors are
+	//reported for the first file in the instruction set that failed
+	vector<exception_ptr> errors(ins_files.size());
+	atomic<size_t> next_file(0);
+	auto read_files = [this, &obs_vals, &errors, &next_file]()
+	{
+		size_t i;
+		while ((i = next_file++) < ins_files.size())
+		{
+			try
+			{
+				ins_files[i].read(obs_vals);
+			}
+			catch (...)
+			{
+				errors[i] = current_exception();
+			}
+		}
+	};
+	vector<thread> threads;
+	for (int i = 1; i < n_threads; ++i)
+		threads.push_back(thread(read_files));
+	read_files();
+	for (auto &t : threads)
+		t.join();
+	for (auto &e : errors)
+	{
+		if (e)
+			rethrow_exception(e);
+	}
+}
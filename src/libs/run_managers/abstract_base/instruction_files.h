@@ -0,0 +1,90 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef INSTRUCTION_FILES_H_
+#define INSTRUCTION_FILES_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class InstructionFile
+{
+	// A PEST instruction file compiled into the instructions of each instruction line so the model
+	// output file can be read without reinterpreting the instruction text on every run.  The model
+	// output file is memory mapped and the instructions are executed with the same semantics as the
+	// mio module (tab expansion, marker searches, whitespace and tab items, Fortran F(w).0 number
+	// reads), so the same observation values are read.
+public:
+	InstructionFile(const std::string &_ins_filename, const std::string &_out_filename);
+	// obs_index maps lower case observation names to their position in the observation vector.
+	// obs_cited flags the observations cited by the instruction file and is updated
+	void compile(const std::unordered_map<std::string, int> &obs_index, std::vector<bool> &obs_cited);
+	// read the observations cited by the instruction file into obs_vals
+	void read(std::vector<double> &obs_vals) const;
+	const std::string& get_ins_filename() const { return ins_filename; }
+	const std::string& get_out_filename() const { return out_filename; }
+	static const size_t max_line_len = 20000;
+	// Fortran F(n).0 read of the n characters at s with blanks ignored.  Returns false if the
+	// characters can not be read as a number
+	static bool read_fortran_real(const char *s, size_t n, double &val);
+private:
+	enum class InsType { LINE_ADVANCE, MARKER, WHITESPACE, TAB, FIXED_OBS, SEMI_FIXED_OBS, NON_FIXED_OBS };
+	struct Instruction
+	{
+		InsType type;
+		int num1;  // line advance count, tab position or first column of a fixed observation
+		int num2;  // last column of a fixed observation
+		int obs_idx;  // -1 for the "dum" observation
+		std::string text;  // marker text or observation name
+	};
+	struct InsLine
+	{
+		bool continuation;
+		std::vector<Instruction> items;
+	};
+	std::string ins_filename;
+	std::string out_filename;
+	std::vector<InsLine> ins_lines;
+};
+
+class InstructionFiles
+{
+	// C++ replacement for the instruction file processing of the mio module.  The instruction files
+	// are compiled once by initialize() and the model output files are read concurrently, one file
+	// per thread.
+public:
+	InstructionFiles();
+	InstructionFiles(const std::vector<std::string> &_insfile_vec, const std::vector<std::string> &_outfile_vec);
+	void initialize(const std::vector<std::string> &_obs_name_vec);
+	bool get_initialized() const { return initialized; }
+	// maximum number of threads used to read the model output files; 0 uses one per processor
+	void set_max_threads(int _max_threads) { max_threads = _max_threads; }
+	// read all model output files.  obs_vals is returned in the order of the observation names
+	// passed to initialize()
+	void read_output_files(std::vector<double> &obs_vals) const;
+private:
+	bool initialized;
+	int max_threads;
+	std::vector<std::string> insfile_vec;
+	std::vector<std::string> outfile_vec;
+	std::vector<std::string> obs_name_vec;
+	std::vector<InstructionFile> ins_files;
+};
+
+#endif /* INSTRUCTION_FILES_H_ */
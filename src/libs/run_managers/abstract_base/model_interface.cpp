@@ -8,10 +8,43 @@
 #include <cstring>
 #include <sstream>
 #include <thread>
+#include <mutex>
+#include <memory>
 #include "model_interface.h"
 
 using namespace std;
 
+namespace
+{
+	class RunDirGuard
+	{
+		// Holds the process wide working directory lock and switches into run_dir for the
+		// lifetime of the guard.  Does nothing if run_dir is empty.
+	public:
+		RunDirGuard(const string &_run_dir) : run_dir(_run_dir)
+		{
+			if (run_dir.empty())
+				return;
+			lock = unique_lock<mutex>(cwd_mutex);
+			org_dir = OperSys::getcwd();
+			OperSys::chdir(run_dir.c_str());
+		}
+		~RunDirGuard()
+		{
+			if (!run_dir.empty())
+				OperSys::chdir(org_dir.c_str());
+		}
+	private:
+		static mutex cwd_mutex;
+		unique_lock<mutex> lock;
+		string run_dir;
+		string org_dir;
+		RunDirGuard(const RunDirGuard &);
+		RunDirGuard& operator=(const RunDirGuard &);
+	};
+	mutex RunDirGuard::cwd_mutex;
+}
+
 extern "C"
 {
 	void mio_initialise_w_(int *, int *, int *, int *, int *);
@@ -101,6 +134,8 @@ void ModelInterface::set_files()
 ModelInterface::ModelInterface()
 {
 	initialized = false;
+	use_cpp_tpl_writer = false;
+	use_cpp_ins_reader = false;
 }
 
 ModelInterface::ModelInterface(vector<string> _tplfile_vec, vector<string> _inpfile_vec,
@@ -113,6 +148,8 @@ ModelInterface::ModelInterface(vector<string> _tplfile_vec, vector<string> _inpf
 	comline_vec = _comline_vec;
 
 	initialized = false;
+	use_cpp_tpl_writer = false;
+	use_cpp_ins_reader = false;
 }
 
 void ModelInterface::initialize(vector<string> _tplfile_vec, vector<string> _inpfile_vec,
@@ -149,12 +186,44 @@ void ModelInterface::initialize(vector<string> &_par_name_vec, vector<string> &_
 	set_files();
 
 	//check template files
-	mio_process_template_files_w_(&ifail, &npar, pest_utils::StringvecFortranCharArray(par_name_vec, 200, pest_utils::TO_LOWER).get_prt());
-	if (ifail != 0)throw_mio_error("error in template files");
+	if (use_cpp_tpl_writer)
+	{
+		tpl_files.reset(new TemplateFiles(tplfile_vec, inpfile_vec));
+		try
+		{
+			tpl_files->initialize(par_name_vec);
+		}
+		catch (exception &e)
+		{
+			finalize();
+			throw runtime_error("model input/output error:error in template files\n" + string(e.what()));
+		}
+	}
+	else
+	{
+		mio_process_template_files_w_(&ifail, &npar, pest_utils::StringvecFortranCharArray(par_name_vec, 200, pest_utils::TO_LOWER).get_prt());
+		if (ifail != 0)throw_mio_error("error in template files");
+	}
 
 	////build instruction set
-	mio_store_instruction_set_w_(&ifail);
-	if (ifail != 0) throw_mio_error("error building instruction set");
+	if (use_cpp_ins_reader)
+	{
+		ins_files.reset(new InstructionFiles(insfile_vec, outfile_vec));
+		try
+		{
+			ins_files->initialize(obs_name_vec);
+		}
+		catch (exception &e)
+		{
+			finalize();
+			throw runtime_error("model input/output error:error building instruction set\n" + string(e.what()));
+		}
+	}
+	else
+	{
+		mio_store_instruction_set_w_(&ifail);
+		if (ifail != 0) throw_mio_error("error building instruction set");
+	}
 
 	initialized = true;
 
@@ -195,20 +264,38 @@ void ModelInterface::run(Parameters* pars, Observations* obs)
 void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_flag* finished, pest_utils::thread_exceptions *shared_execptions,
 						Parameters* pars, Observations* obs)
 {
+	run(terminate, finished, shared_execptions, pars, obs, string());
+}
 
-
-
-	if (!initialized)
+void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_flag* finished, pest_utils::thread_exceptions *shared_execptions,
+						Parameters* pars, Observations* obs, const string &run_dir)
+{
+	vector<double> par_vals;
+	vector<double> obs_vals;
+	try
 	{
-		vector<string> pnames = pars->get_keys();
-		vector<string> onames = obs->get_keys();
-		initialize(pnames, onames);
+		RunDirGuard dir_guard(run_dir);
+		if (!initialized)
+		{
+			vector<string> pnames = pars->get_keys();
+			vector<string> onames = obs->get_keys();
+			initialize(pnames, onames);
+		}
+		//get par vals that are aligned with this::par_name_vec since the mio module was initialized with this::par_name_vec order
+		par_vals = pars->get_data_vec(par_name_vec);
+	}
+	catch (...)
+	{
+		if (run_dir.empty())
+			throw;
+		shared_execptions->add(current_exception());
+		finished->set(true);
+		return;
 	}
-	//get par vals that are aligned with this::par_name_vec since the mio module was initialized with this::par_name_vec order
-	par_vals = pars->get_data_vec(par_name_vec);
 
 	try
 	{
+		unique_ptr<RunDirGuard> dir_guard(new RunDirGuard(run_dir));
 		//first delete any existing input and output files
 		// This outer loop is a work around for a bug in windows.  Window can fail to release a file
 		// handle quick enough when the external run executes very quickly
@@ -282,18 +369,33 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 		// }
 
 		int npar = par_vals.size();
-		try
+		if (use_cpp_tpl_writer)
 		{
-			mio_write_model_input_files_w_(&ifail, &npar,
-				pest_utils::StringvecFortranCharArray(par_name_vec, 200, pest_utils::TO_LOWER).get_prt(),
-				&par_vals[0]);
+			try
+			{
+				tpl_files->write_input_files(par_vals);
+			}
+			catch (exception &e)
+			{
+				throw runtime_error("model input/output error:error writing model input files from template files\n" + string(e.what()));
+			}
 		}
-		catch (exception &e)
+		else
 		{
-			string emess = e.what();
-			throw_mio_error("uncaught error writing model input files from template files:" + emess);
+			try
+			{
+				mio_write_model_input_files_w_(&ifail, &npar,
+					pest_utils::StringvecFortranCharArray(par_name_vec, 200, pest_utils::TO_LOWER).get_prt(),
+					&par_vals[0]);
+			}
+			catch (exception &e)
+			{
+				string emess = e.what();
+				throw_mio_error("uncaught error writing model input files from template files:" + emess);
+			}
+			if (ifail != 0) throw_mio_error("error writing model input files from template files");
 		}
-		if (ifail != 0) throw_mio_error("error writing model input files from template files");
+		dir_guard.reset();
 
 
 #ifdef OS_WIN
@@ -314,6 +416,7 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 			PROCESS_INFORMATION pi;
 			try
 			{
+				RunDirGuard start_guard(run_dir);
 				pi = start(cmd_string);
 			}
 			catch (...)
@@ -369,7 +472,11 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 		for (auto &cmd_string : comline_vec)
 		{
 			//start the command
-			int command_pid = start(cmd_string);
+			int command_pid;
+			{
+				RunDirGuard start_guard(run_dir);
+				command_pid = start(cmd_string);
+			}
 			while (true)
 			{
 				//sleep
@@ -414,30 +521,46 @@ void ModelInterface::run(pest_utils::thread_flag* terminate, pest_utils::thread_
 		int nins = insfile_vec.size();
 		int nobs = obs_name_vec.size();
 		obs_vals.resize(nobs, -9999.00);
+		dir_guard.reset(new RunDirGuard(run_dir));
 		/*int nerr_len = 500;
 		char err_instruct[500];
 		for (int i = 0; i < 500; i++)
 			err_instruct[i] = '|';*/
-		try {
-			mio_read_model_output_files_w_(&ifail, &nobs,
-				pest_utils::StringvecFortranCharArray(obs_name_vec, 200, pest_utils::TO_LOWER).get_prt(),
-				&obs_vals[0]);
-		}
-		catch (exception &e)
+		if (use_cpp_ins_reader)
 		{
-			string emess = e.what();
-			throw_mio_error("uncaught error processing model output files:" + emess);
+			try
+			{
+				ins_files->read_output_files(obs_vals);
+			}
+			catch (exception &e)
+			{
+				throw runtime_error("model input/output error:error processing model output files\n" + string(e.what()));
+			}
 		}
-		if (ifail != 0)
+		else
 		{
-			/*int jfail;
-			mio_get_message_string_w_(&jfail, &nerr_len, err_instruct);
-			string err = string(err_instruct);
-			auto s_end = err.find_last_not_of(' ',500);
-			err = err.substr(0, s_end);*/
+			try {
+				mio_read_model_output_files_w_(&ifail, &nobs,
+					pest_utils::StringvecFortranCharArray(obs_name_vec, 200, pest_utils::TO_LOWER).get_prt(),
+					&obs_vals[0]);
+			}
+			catch (exception &e)
+			{
+				string emess = e.what();
+				throw_mio_error("uncaught error processing model output files:" + emess);
+			}
+			if (ifail != 0)
+			{
+				/*int jfail;
+				mio_get_message_string_w_(&jfail, &nerr_len, err_instruct);
+				string err = string(err_instruct);
+				auto s_end = err.find_last_not_of(' ',500);
+				err = err.substr(0, s_end);*/
 
-			throw_mio_error("error processing model output files");
+				throw_mio_error("error processing model output files");
+			}
 		}
+		dir_guard.reset();
 
 		// invalid.clear();
 		// for (int i = 0; i != par_name_vec.size(); i++)
@@ -3,8 +3,11 @@
 
 #include <vector>
 #include <string>
+#include <memory>
 #include "Transformable.h"
 #include "utilities.h"
+#include "template_files.h"
+#include "instruction_files.h"
 
 using namespace std;
 
@@ -21,6 +24,12 @@ public:
 	void run(pest_utils::thread_flag* terminate, pest_utils::thread_flag* finished,
 		pest_utils::thread_exceptions *shared_execptions,
 		Parameters* par, Observations* obs);
+	// run the model in run_dir.  Several threads can call this concurrently with different run
+	// directories; the model input/output processing and the start of the model commands are
+	// serialized since they depend on the process wide current working directory
+	void run(pest_utils::thread_flag* terminate, pest_utils::thread_flag* finished,
+		pest_utils::thread_exceptions *shared_execptions,
+		Parameters* par, Observations* obs, const string &run_dir);
 
 
 	void initialize(vector<string> &_par_name_vec, vector<string> &_obs_name_vec);
@@ -30,12 +39,22 @@ public:
 	void finalize();
 	~ModelInterface();
 	bool get_initialized(){ return initialized; }
+	// write the model input files with the C++ template writer (TemplateFiles) instead of the
+	// mio module.  Must be set before initialize()
+	void set_cpp_tpl_writer(bool _use_cpp_tpl_writer) { use_cpp_tpl_writer = _use_cpp_tpl_writer; }
+	bool get_cpp_tpl_writer() const { return use_cpp_tpl_writer; }
+	// read the model output files with the C++ instruction file reader (InstructionFiles) instead
+	// of the mio module.  Must be set before initialize()
+	void set_cpp_ins_reader(bool _use_cpp_ins_reader) { use_cpp_ins_reader = _use_cpp_ins_reader; }
+	bool get_cpp_ins_reader() const { return use_cpp_ins_reader; }
 private:
 
 	void set_files();
 	void check();
 
 	bool initialized;
+	bool use_cpp_tpl_writer;
+	bool use_cpp_ins_reader;
 	int ifail;
 	vector<string> par_name_vec;
 	vector<string> obs_name_vec;
@@ -44,9 +63,8 @@ private:
 	vector<string> outfile_vec;
 	vector<string> insfile_vec;
 	vector<string> comline_vec;
-
-	vector<double> par_vals;
-	vector<double> obs_vals;
+	unique_ptr<TemplateFiles> tpl_files;
+	unique_ptr<InstructionFiles> ins_files;
 
 };
 
@@ -0,0 +1,569 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include "template_files.h"
+#include "pest_error.h"
+#include "utilities.h"
+
+using namespace std;
+
+namespace
+{
+	// length of the character variables used by mio_wrtsig
+	const int fortran_word_len = 200;
+	// size of the buffers used for the numbers written with the E and F edit descriptors
+	const int num_buf_len = 64;
+
+	void fill_stars(char *out, int w)
+	{
+		memset(out, '*', w);
+		out[w] = '\0';
+	}
+
+	// right justify the sign and number in a field of width w
+	void justify(const char *num, int n, bool neg, int w, char *out)
+	{
+		int n_blank = w - n - (neg ? 1 : 0);
+		memset(out, ' ', n_blank);
+		if (neg)
+			out[n_blank++] = '-';
+		memcpy(out + n_blank, num, n);
+		out[w] = '\0';
+	}
+
+	// Fortran Fw.d edit descriptor as written by gfortran.  out must hold at least w + 1 characters
+	void fortran_f(double val, int w, int d, char *out)
+	{
+		char num[512];
+		int n = snprintf(num, sizeof(num), "%#.*f", d, fabs(val));
+		const char *start = num;
+		bool neg = signbit(val);
+		int n_sign = neg ? 1 : 0;
+		if ((n + n_sign > w) && (d > 0) && (num[0] == '0'))
+		{
+			//the leading zero is optional
+			++start;
+			--n;
+		}
+		if ((n < 0) || (n + n_sign > w))
+			fill_stars(out, w);
+		else
+			justify(start, n, neg, w, out);
+	}
+
+	// Fortran kPEw.dEe edit descriptor (k is the scale factor, 0 <= k <= d + 1) as written by
+	// gfortran.  out must hold at least w + 1 characters
+	void fortran_e(double val, int k, int w, int d, int e, char *out)
+	{
+		int n_sig = (k > 0) ? d + 1 : d;
+		if ((n_sig < 1) || (k > n_sig) || (n_sig + e + 5 > num_buf_len))
+		{
+			fill_stars(out, w);
+			return;
+		}
+		char buf[num_buf_len];
+		snprintf(buf, sizeof(buf), "%.*e", n_sig - 1, fabs(val));
+		char num[num_buf_len];
+		int n = 0;
+		if (k == 0)
+		{
+			num[n++] = '0';
+			num[n++] = '.';
+		}
+		int n_digits = 0;
+		const char *c = buf;
+		for (; *c != 'e'; ++c)
+		{
+			if (*c == '.')
+				continue;
+			if ((k > 0) && (n_digits == k))
+				num[n++] = '.';
+			num[n++] = *c;
+			++n_digits;
+		}
+		if ((k > 0) && (n_digits == k))
+			num[n++] = '.';
+		int print_exp = (val == 0.0) ? 0 : atoi(c + 1) + 1 - k;
+		int max_exp = 1;
+		for (int i = 0; i < e; ++i)
+			max_exp *= 10;
+		if (abs(print_exp) >= max_exp)
+		{
+			fill_stars(out, w);
+			return;
+		}
+		n += snprintf(num + n, sizeof(num) - n, "E%c%0*d", (print_exp < 0) ? '-' : '+', e, abs(print_exp));
+		bool neg = signbit(val);
+		int n_sign = neg ? 1 : 0;
+		const char *start = num;
+		if ((n + n_sign > w) && (k == 0))
+		{
+			++start;
+			--n;
+		}
+		if (n + n_sign > w)
+			fill_stars(out, w);
+		else
+			justify(start, n, neg, w, out);
+	}
+
+	size_t len_trim(const string &s)
+	{
+		size_t n = s.find_last_not_of(' ');
+		return (n == string::npos) ? 0 : n + 1;
+	}
+
+	// Fortran I edit descriptor input (blanks are ignored)
+	bool read_fortran_int(const char *s, int n, int &val)
+	{
+		int i = 0;
+		while ((i < n) && (s[i] == ' '))
+			++i;
+		bool neg = false;
+		if ((i < n) && ((s[i] == '+') || (s[i] == '-')))
+		{
+			neg = (s[i] == '-');
+			++i;
+		}
+		val = 0;
+		for (; i < n; ++i)
+		{
+			if (s[i] == ' ')
+				continue;
+			if ((s[i] < '0') || (s[i] > '9'))
+				return false;
+			val = val * 10 + (s[i] - '0');
+		}
+		if (neg)
+			val = -val;
+		return true;
+	}
+
+	int wrtsig_exponent_form(double val, int lw, int pos, int jexp, string &word)
+	{
+		// label 80 of mio_wrtsig: exponential form with as many significant figures as fit in lw
+		int epos = (jexp < 0) ? 0 : 1;
+		int lexp = 0;
+		int iflag = 0;
+		int p = 1;
+		int d = lw - 7;
+		if (pos == 1) d++;
+		if (epos == 1) d++;
+		if (abs(jexp) < 100) d++;
+		if (abs(jexp) < 10) d++;
+		if ((jexp >= 100) && (jexp - (d - 1) < 100))
+		{
+			p = 1 + (jexp - 99);
+			d++;
+			lexp = 99;
+		}
+		else if ((jexp >= 10) && (jexp - (d - 1) < 10))
+		{
+			p = 1 + (jexp - 9);
+			d++;
+			lexp = 9;
+		}
+		else if ((jexp == -10) || (jexp == -100))
+		{
+			iflag = 1;
+			d++;
+		}
+		int inc = 0;
+		char tword[num_buf_len];
+		while (true)
+		{
+			if (d <= 0)
+				return 3;
+			if (d + 8 >= num_buf_len)
+				return -2;
+			if (iflag == 0)
+				fortran_e(val, p, d + 7, d - 1, 3, tword);
+			else
+				fortran_e(val, 0, d + 8, d, 3, tword);
+			if (iflag == 1)
+				break;
+			int kexp;
+			if (!read_fortran_int(tword + d + 3, 4, kexp))
+				return -2;
+			if (((kexp == 10) && ((jexp == 9) || (lexp == 9))) ||
+				((kexp == 100) && ((jexp == 99) || (lexp == 99))))
+			{
+				if (inc == 0)
+				{
+					if (lexp == 0)
+					{
+						if (d - 1 == 0)
+							d--;
+						else
+							p++;
+					}
+					else if (lexp == 9)
+					{
+						if (jexp - (d - 2) < 10)
+							p++;
+						else
+							d--;
+					}
+					else if (lexp == 99)
+					{
+						if (jexp - (d - 2) < 100)
+							p++;
+						else
+							d--;
+					}
+					inc++;
+					continue;
+				}
+			}
+			break;
+		}
+		//mantissa without the leading blank of positive values and an exponent without '+' or leading zeros
+		const char *e_ptr = strchr(tword, 'E');
+		if (e_ptr == nullptr)
+			return -1;
+		const char *m_ptr = (pos == 0) ? tword : tword + 1;
+		if ((iflag == 1) && (pos == 1))
+			++m_ptr;
+		word.assign(m_ptr, e_ptr);
+		if ((iflag == 1) && (pos == 0))
+			word.erase(1, 1);
+		word.push_back('E');
+		if (e_ptr[1] == '-')
+			word.push_back('-');
+		if (e_ptr[2] != '0')
+			word.append(e_ptr + 2, 2);
+		else if (e_ptr[3] != '0')
+			word.push_back(e_ptr[3]);
+		word.push_back(e_ptr[4]);
+		return 0;
+	}
+}
+
+int TemplateFiles::format_par_value(double val, int nw, string &word, double &written_val)
+{
+	// port of mio_wrtsig for the double precision and decimal point protocols used by PEST++.  Unlike
+	// mio_wrtsig, negative zero is written as zero and spaces wider than 99 characters are supported
+	// (the number is padded to at most fortran_word_len characters)
+	if (std::isnan(val) || std::isinf(val))
+		return -1;
+	if (val == 0.0)
+		val = 0.0;
+	nw = min(nw, fortran_word_len);
+	word.clear();
+	int pos = (val < 0.0) ? 0 : 1;
+	char tword[num_buf_len];
+	fortran_e(val, 1, 23, 15, 3, tword);
+	int jexp;
+	if (!read_fortran_int(tword + 19, 4, jexp))
+		return -1;
+	if (abs(jexp) > 275)
+		return 2;
+	int lw = min(23, nw);
+	if ((pos == 1) && (lw >= 22))
+	{
+		fortran_e(val, 1, 22, 15, 3, tword);
+		word.assign(tword);
+		if ((lw != 22) && (nw >= lw))
+		{
+			//pad with leading zeros
+			word.erase(0, word.find_first_not_of(' '));
+			word.insert(0, nw - lw + 1, '0');
+		}
+	}
+	else if ((pos == 0) && (lw >= 23))
+	{
+		if (nw > lw)
+		{
+			//pad with leading zeros
+			fortran_e(fabs(val), 1, 22, 15, 3, tword);
+			word.assign(tword);
+			word.erase(0, word.find_first_not_of(' '));
+			word.insert(0, nw - lw, '0');
+			word.insert(0, 1, '-');
+		}
+		else
+		{
+			fortran_e(val, 1, 23, 15, 3, tword);
+			word.assign(tword);
+		}
+	}
+	else
+	{
+		//try a fixed point number first
+		bool use_exp = true;
+		int d = min(lw - 2 + pos, lw - jexp - 3 + pos);
+		while (d >= 0)
+		{
+			fortran_f(val, lw, d, tword);
+			if (strchr(tword, '*') == nullptr)
+				break;
+			d--;
+		}
+		if (d >= 0)
+		{
+			const char *point = strchr(tword, '.');
+			if (point == nullptr)
+				return -1;
+			int k = point - tword;
+			use_exp = false;
+			if ((k == 0) || ((pos == 0) && (k == 1)))
+			{
+				//no leading digit: make sure the number is represented with at least some precision
+				use_exp = true;
+				for (int j = 1; j <= 3; ++j)
+				{
+					if (k + j + 1 > lw)
+						return 3;
+					if (tword[k + j] != '0')
+					{
+						use_exp = false;
+						break;
+					}
+				}
+			}
+		}
+		if (use_exp)
+		{
+			int jfail = wrtsig_exponent_form(val, lw, pos, jexp, word);
+			if (jfail != 0)
+				return jfail;
+		}
+		else
+		{
+			word.assign(tword);
+		}
+	}
+	word.resize(len_trim(word));
+	if ((int)word.size() > nw)
+		return -2;
+	//the value as it will be read by the model
+	char *end;
+	written_val = strtod(word.c_str(), &end);
+	if ((end == word.c_str()) || (*end != '\0'))
+		return -3;
+	return 0;
+}
+
+
+TemplateFile::TemplateFile(const string &_tpl_filename, const string &_in_filename)
+	: tpl_filename(_tpl_filename), in_filename(_in_filename)
+{
+}
+
+void TemplateFile::process(const unordered_map<string, int> &par_index, vector<int> &min_widths)
+{
+	ifstream fin(tpl_filename, ios::binary);
+	if (!fin.good())
+	{
+		throw PestError("Cannot open template file \"" + tpl_filename + "\".");
+	}
+	text.clear();
+	spaces.clear();
+	string line;
+	if (!getline(fin, line))
+	{
+		throw PestError("\"ptf\" or \"jtf\" header, followed by space, followed by parameter delimiter expected on first line of template file \"" + tpl_filename + "\".");
+	}
+	if ((!line.empty()) && (line.back() == '\r'))
+		line.pop_back();
+	string header = pest_utils::lower_cp(line.substr(0, 3));
+	if (((header != "ptf") && (header != "jtf")) || (line.size() < 5) || (line[4] == ' '))
+	{
+		throw PestError("\"ptf\" or \"jtf\" header, followed by space, followed by parameter delimiter expected on first line of template file \"" + tpl_filename + "\".");
+	}
+	char pardel = line[4];
+	int iline = 1;
+	while (getline(fin, line))
+	{
+		++iline;
+		if ((!line.empty()) && (line.back() == '\r'))
+			line.pop_back();
+		if (line.size() > max_line_len)
+			line.resize(max_line_len);
+		line.resize(len_trim(line));
+		size_t pos = 0;
+		while (pos < line.size())
+		{
+			size_t j1 = line.find(pardel, pos);
+			if (j1 == string::npos)
+				break;
+			size_t j2 = line.find(pardel, j1 + 1);
+			if (j2 == string::npos)
+			{
+				stringstream ss;
+				ss << "Unbalanced parameter delimiters at line " << iline << " of template file \"" << tpl_filename << "\".";
+				throw PestError(ss.str());
+			}
+			if (j2 - j1 <= 1)
+			{
+				stringstream ss;
+				ss << "Parameter space less than three characters wide at line " << iline << " of file \"" << tpl_filename << "\".";
+				throw PestError(ss.str());
+			}
+			size_t i = line.find_first_not_of(' ', j1 + 1);
+			if (i >= j2)
+			{
+				stringstream ss;
+				ss << "Blank parameter space at line " << iline << " of file \"" << tpl_filename << "\".";
+				throw PestError(ss.str());
+			}
+			string name = line.substr(i, min((size_t)fortran_word_len, j2 - i));
+			pest_utils::strip_ip(name);
+			pest_utils::lower_ip(name);
+			auto it = par_index.find(name);
+			if (it == par_index.end())
+			{
+				stringstream ss;
+				ss << "Parameter \"" << name << "\" cited on line " << iline << " of template file \"" << tpl_filename << "\" has not been supplied with a value.";
+				throw PestError(ss.str());
+			}
+			text.append(line, pos, j1 - pos);
+			ParSpace space;
+			space.text_pos = text.size();
+			space.width = j2 - j1 + 1;
+			space.par_idx = it->second;
+			spaces.push_back(space);
+			min_widths[space.par_idx] = min(min_widths[space.par_idx], space.width);
+			pos = j2 + 1;
+		}
+		if (pos < line.size())
+			text.append(line, pos, string::npos);
+		text.push_back('\n');
+	}
+	if (fin.bad())
+	{
+		throw PestError("Unable to read template file \"" + tpl_filename + "\".");
+	}
+}
+
+void TemplateFile::write(const vector<string> &par_words) const
+{
+	string out;
+	size_t n_chars = text.size();
+	for (auto &space : spaces)
+		n_chars += space.width;
+	out.reserve(n_chars);
+	size_t pos = 0;
+	for (auto &space : spaces)
+	{
+		out.append(text, pos, space.text_pos - pos);
+		const string &word = par_words[space.par_idx];
+		//right justify the parameter value in its space
+		out.append(space.width - word.size(), ' ');
+		out.append(word);
+		pos = space.text_pos;
+	}
+	out.append(text, pos, string::npos);
+
+	ofstream fout(in_filename);
+	if (!fout.good())
+	{
+		throw PestError("Error writing parameters to model input file(s): cannot open model input file \"" +
+			in_filename + "\" to write updated parameter values prior to running model.");
+	}
+	fout.write(out.data(), out.size());
+	fout.close();
+	if (fout.fail())
+	{
+		throw PestError("Error writing parameters to model input file(s): cannot write to model input file \"" + in_filename + "\".");
+	}
+}
+
+
+TemplateFiles::TemplateFiles() : initialized(false)
+{
+}
+
+TemplateFiles::TemplateFiles(const vector<string> &_tplfile_vec, const vector<string> &_inpfile_vec)
+	: initialized(false), tplfile_vec(_tplfile_vec), inpfile_vec(_inpfile_vec)
+{
+}
+
+void TemplateFiles::initialize(const vector<string> &_par_name_vec)
+{
+	if (tplfile_vec.size() != inpfile_vec.size())
+		throw PestError("TemplateFiles::initialize(): number of template files and model input files are not equal");
+	par_name_vec = _par_name_vec;
+	unordered_map<string, int> par_index;
+	for (size_t i = 0; i < par_name_vec.size(); ++i)
+	{
+		par_index[pest_utils::lower_cp(par_name_vec[i])] = i;
+	}
+	const int not_cited = 1000;
+	par_widths.assign(par_name_vec.size(), not_cited);
+	tpl_files.clear();
+	for (size_t i = 0; i < tplfile_vec.size(); ++i)
+	{
+		tpl_files.push_back(TemplateFile(tplfile_vec[i], inpfile_vec[i]));
+		tpl_files.back().process(par_index, par_widths);
+	}
+	for (size_t i = 0; i < par_name_vec.size(); ++i)
+	{
+		if (par_widths[i] == not_cited)
+			throw PestError("Parameter \"" + pest_utils::lower_cp(par_name_vec[i]) + "\" is not cited on any template file.");
+	}
+	lock_guard<mutex> cache_lock(cache_mutex);
+	cached.assign(par_name_vec.size(), false);
+	cached_vals.assign(par_name_vec.size(), 0.0);
+	cached_written_vals.assign(par_name_vec.size(), 0.0);
+	cached_words.assign(par_name_vec.size(), string());
+	initialized = true;
+}
+
+void TemplateFiles::write_input_files(vector<double> &par_vals) const
+{
+	if (!initialized)
+		throw PestError("TemplateFiles::write_input_files() called before initialize()");
+	if (par_vals.size() != par_name_vec.size())
+		throw PestError("TemplateFiles::write_input_files(): number of parameter values does not match the number of parameters");
+	const string errsub = "Error writing parameters to model input file(s):";
+	lock_guard<mutex> cache_lock(cache_mutex);
+	for (size_t i = 0; i < par_vals.size(); ++i)
+	{
+		if (cached[i] && (par_vals[i] == cached_vals[i]))
+		{
+			par_vals[i] = cached_written_vals[i];
+			continue;
+		}
+		double written_val;
+		cached[i] = false;
+		int jfail = format_par_value(par_vals[i], par_widths[i], cached_words[i], written_val);
+		if (jfail < 0)
+			throw PestError("Internal error condition has arisen while attempting to write current value of parameter \"" +
+				par_name_vec[i] + "\" to model input file.");
+		else if (jfail == 2)
+			throw PestError(errsub + " exponent of parameter \"" + par_name_vec[i] + "\" is too large or too small for double precision protocol.");
+		else if (jfail == 3)
+			throw PestError(errsub + " field width of parameter \"" + par_name_vec[i] + "\" on at least one template file is too small to represent current parameter value. The number is too large to fit, or too small to be represented with any precision.");
+		else if (jfail != 0)
+			throw PestError(errsub + " unable to write parameter \"" + par_name_vec[i] + "\"");
+		cached[i] = true;
+		cached_vals[i] = par_vals[i];
+		cached_written_vals[i] = written_val;
+		par_vals[i] = written_val;
+	}
+	for (auto &tpl : tpl_files)
+		tpl.write(cached_words);
+}
@@ -0,0 +1,87 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef TEMPLATE_FILES_H_
+#define TEMPLATE_FILES_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+class TemplateFile
+{
+	// A model input template file compiled into its literal text and the parameter spaces between
+	// the text so model input files can be written without rescanning the template.  Lines are
+	// handled the same way as in the mio module: trailing blanks are dropped and lines longer than
+	// max_line_len characters are truncated.
+public:
+	TemplateFile(const std::string &_tpl_filename, const std::string &_in_filename);
+	// par_index maps lower case parameter names to their position in the parameter vector.
+	// min_widths holds the width of the narrowest space of each parameter and is updated
+	void process(const std::unordered_map<std::string, int> &par_index, std::vector<int> &min_widths);
+	void write(const std::vector<std::string> &par_words) const;
+	const std::string& get_tpl_filename() const { return tpl_filename; }
+	const std::string& get_in_filename() const { return in_filename; }
+private:
+	struct ParSpace
+	{
+		size_t text_pos;  // position in text where the parameter space was
+		int width;
+		int par_idx;
+	};
+	static const size_t max_line_len = 20000;
+	std::string tpl_filename;
+	std::string in_filename;
+	std::string text;
+	std::vector<ParSpace> spaces;
+};
+
+class TemplateFiles
+{
+	// C++ replacement for the template file processing of the mio module.  The template files are
+	// parsed once by initialize() and each parameter value is written with the same number formatting
+	// as PEST (the mio_wrtsig routine): as many significant figures as fit in the narrowest space the
+	// parameter has on any template file.
+public:
+	TemplateFiles();
+	TemplateFiles(const std::vector<std::string> &_tplfile_vec, const std::vector<std::string> &_inpfile_vec);
+	void initialize(const std::vector<std::string> &_par_name_vec);
+	bool get_initialized() const { return initialized; }
+	// write all model input files.  par_vals must be in the order of the parameter names passed to
+	// initialize() and are replaced with the values as they were written to the model input files
+	void write_input_files(std::vector<double> &par_vals) const;
+	// format val into at most width characters.  Returns 0 on success and the mio_wrtsig error
+	// code otherwise; written_val is the value represented by word
+	static int format_par_value(double val, int width, std::string &word, double &written_val);
+private:
+	bool initialized;
+	std::vector<std::string> tplfile_vec;
+	std::vector<std::string> inpfile_vec;
+	std::vector<std::string> par_name_vec;
+	std::vector<int> par_widths;
+	std::vector<TemplateFile> tpl_files;
+	// the words of the previous write are reused for parameters whose value has not changed
+	mutable std::mutex cache_mutex;
+	mutable std::vector<bool> cached;
+	mutable std::vector<double> cached_vals;
+	mutable std::vector<double> cached_written_vals;
+	mutable std::vector<std::string> cached_words;
+};
+
+#endif /* TEMPLATE_FILES_H_ */
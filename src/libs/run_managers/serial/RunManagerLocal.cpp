@@ -0,0 +1,295 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#include "RunManagerLocal.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "system_variables.h"
+#include "Transformable.h"
+#include "utilities.h"
+#include "model_interface.h"
+
+using namespace std;
+using namespace pest_utils;
+
+const string RunManagerLocal::worker_dir_prefix = "local_worker_";
+const int RunManagerLocal::poll_interval_ms;
+
+RunManagerLocal::RunManagerLocal(const vector<string> _comline_vec,
+	const vector<string> _tplfile_vec, const vector<string> _inpfile_vec,
+	const vector<string> _insfile_vec, const vector<string> _outfile_vec,
+	const string &stor_filename, const string &_run_dir, int _num_workers, int _max_run_fail)
+	: RunManagerAbstract(_comline_vec, _tplfile_vec, _inpfile_vec,
+	_insfile_vec, _outfile_vec, stor_filename, _max_run_fail),
+	mi(_tplfile_vec, _inpfile_vec, _insfile_vec, _outfile_vec, _comline_vec),
+	run_dir(_run_dir), num_workers(_num_workers), stop_workers(false)
+{
+	if (num_workers <= 0)
+		num_workers = max((int)thread::hardware_concurrency(), 1);
+	cout << "              starting local run manager with " << num_workers << " workers ..." << endl << endl;
+
+	// the worker directories are copied before any model runs are made so they only hold the
+	// model files.  They are absolute paths so that every worker, including worker 0, switches the
+	// working directory through the model interface lock
+	OperSys::chdir(run_dir.c_str());
+	string cwd = OperSys::getcwd();
+	vector<string> skip_prefixes;
+	skip_prefixes.push_back(worker_dir_prefix);
+	skip_prefixes.push_back(get_filename(stor_filename));
+	worker_dirs.push_back(cwd);
+	for (int i = 1; i < num_workers; ++i)
+	{
+		stringstream ss;
+		ss << cwd << OperSys::DIR_SEP << worker_dir_prefix << i;
+		string worker_dir = ss.str();
+		cout << "              preparing local worker " << i << " in: " << worker_dir << endl;
+		make_dir(worker_dir);
+		copy_dir_contents(cwd, worker_dir, skip_prefixes);
+		worker_dirs.push_back(worker_dir);
+	}
+	cout << endl;
+}
+
+void RunManagerLocal::init_workers()
+{
+	if (!workers.empty())
+		return;
+	// the model interface is shared by the workers so it is initialized before any of them start
+	if (!mi.get_initialized())
+	{
+		vector<string> par_names = file_stor.get_par_name_vec();
+		vector<string> obs_names = file_stor.get_obs_name_vec();
+		mi.initialize(par_names, obs_names);
+	}
+	stop_workers = false;
+	for (int i = 0; i < num_workers; ++i)
+	{
+		worker_terminate.emplace_back(new thread_flag(false));
+		workers.push_back(thread(&RunManagerLocal::worker_main, this, i));
+	}
+}
+
+void RunManagerLocal::worker_main(int i_worker)
+{
+	unique_lock<mutex> lock(queue_mutex);
+	while (true)
+	{
+		work_cv.wait(lock, [this]() { return stop_workers || !queued_runs.empty(); });
+		if (stop_workers)
+			return;
+		LocalRun local_run = std::move(queued_runs.front());
+		queued_runs.pop_front();
+		lock.unlock();
+
+		thread_flag finished(false);
+		thread_exceptions shared_exceptions;
+		try
+		{
+			mi.run(worker_terminate[i_worker].get(), &finished, &shared_exceptions,
+				&local_run.pars, &local_run.obs, worker_dirs[i_worker]);
+		}
+		catch (...)
+		{
+			shared_exceptions.add(current_exception());
+		}
+		local_run.success = false;
+		if (shared_exceptions.size() > 0)
+		{
+			try
+			{
+				shared_exceptions.rethrow();
+			}
+			catch (const std::exception& ex)
+			{
+				local_run.err_msg = ex.what();
+			}
+			catch (...)
+			{
+				local_run.err_msg = "Error running model";
+			}
+		}
+		else if (!finished.get())
+		{
+			local_run.err_msg = "model run terminated";
+		}
+		else
+		{
+			local_run.success = true;
+		}
+
+		lock.lock();
+		finished_runs.push_back(std::move(local_run));
+		done_cv.notify_one();
+	}
+}
+
+int RunManagerLocal::store_finished_runs(vector<LocalRun> &runs)
+{
+	int n_success = 0;
+	for (auto &local_run : runs)
+	{
+		if (local_run.success)
+		{
+			file_stor.update_run(local_run.run_id, local_run.pars, local_run.obs);
+			++n_success;
+		}
+		else
+		{
+			update_run_failed(local_run.run_id);
+			cerr << endl;
+			cerr << "  " << local_run.err_msg << endl;
+			cerr << "  Aborting model run " << local_run.run_id << endl << endl;
+		}
+	}
+	runs.clear();
+	return n_success;
+}
+
+void RunManagerLocal::run()
+{
+	run_until(RUN_UNTIL_COND::NORMAL);
+}
+
+RunManagerAbstract::RUN_UNTIL_COND RunManagerLocal::run_until(RUN_UNTIL_COND condition, int max_no_ops, double max_time_sec)
+{
+	RUN_UNTIL_COND terminate_reason = RUN_UNTIL_COND::NORMAL;
+	init_workers();
+
+	const vector<string> &obs_name_vec = file_stor.get_obs_name_vec();
+	const vector<double> no_data_vec(obs_name_vec.size(), RunStorage::no_data);
+	vector<int> run_id_vec = get_outstanding_run_ids();
+	deque<int> waiting_runs(run_id_vec.begin(), run_id_vec.end());
+	int nruns = run_id_vec.size();
+	cout << "    running model " << nruns << " times" << endl;
+
+	int success_runs = 0;
+	int n_in_flight = 0;
+	int n_no_ops = 0;
+	stringstream message;
+	vector<LocalRun> batch;
+	chrono::system_clock::time_point start_time = chrono::system_clock::now();
+	while (true)
+	{
+		if (terminate_reason == RUN_UNTIL_COND::NORMAL)
+		{
+			if (waiting_runs.empty() && n_in_flight == 0)
+			{
+				//runs that failed fewer than max_run_fail times are tried again
+				run_id_vec = get_outstanding_run_ids();
+				if (run_id_vec.empty())
+					break;
+				waiting_runs.assign(run_id_vec.begin(), run_id_vec.end());
+			}
+			//only keep one run per worker queued so the parameters are read from the run storage
+			//file as they are needed
+			while ((!waiting_runs.empty()) && (n_in_flight < 2 * num_workers))
+			{
+				LocalRun local_run;
+				local_run.run_id = waiting_runs.front();
+				waiting_runs.pop_front();
+				file_stor.get_parameters(local_run.run_id, local_run.pars);
+				local_run.obs.insert(obs_name_vec, no_data_vec);
+				{
+					lock_guard<mutex> lock(queue_mutex);
+					queued_runs.push_back(std::move(local_run));
+				}
+				work_cv.notify_one();
+				++n_in_flight;
+			}
+		}
+		else if (n_in_flight == 0)
+		{
+			break;
+		}
+
+		{
+			unique_lock<mutex> lock(queue_mutex);
+			done_cv.wait_for(lock, chrono::milliseconds(poll_interval_ms), [this]() { return !finished_runs.empty(); });
+			batch.swap(finished_runs);
+		}
+		if (batch.empty())
+		{
+			++n_no_ops;
+		}
+		else
+		{
+			n_no_ops = 0;
+			n_in_flight -= batch.size();
+			success_runs += store_finished_runs(batch);
+			std::cout << string(message.str().size(), '\b');
+			message.str("");
+			message << "(" << success_runs << "/" << nruns << " runs complete)";
+			std::cout << message.str();
+		}
+
+		if (terminate_reason != RUN_UNTIL_COND::NORMAL)
+			continue;
+		if ((condition == RUN_UNTIL_COND::NO_OPS || condition == RUN_UNTIL_COND::NO_OPS_OR_TIME) && n_no_ops >= max_no_ops)
+		{
+			terminate_reason = RUN_UNTIL_COND::NO_OPS;
+		}
+		if ((condition == RUN_UNTIL_COND::TIME || condition == RUN_UNTIL_COND::NO_OPS_OR_TIME) && get_duration_sec(start_time) >= max_time_sec)
+		{
+			terminate_reason = RUN_UNTIL_COND::TIME;
+		}
+		if (terminate_reason != RUN_UNTIL_COND::NORMAL)
+		{
+			//runs that have not been started are left for the next call
+			lock_guard<mutex> lock(queue_mutex);
+			n_in_flight -= queued_runs.size();
+			queued_runs.clear();
+		}
+	}
+	//make sure all completed runs are in the run storage file
+	file_stor.sync();
+	total_runs += success_runs;
+	std::cout << string(message.str().size(), '\b');
+	message.str("");
+	message << "(" << success_runs << "/" << nruns << " runs complete)";
+	std::cout << message.str();
+	if ((terminate_reason == RUN_UNTIL_COND::NORMAL) && (success_runs < nruns))
+	{
+		cout << endl << endl;
+		cout << "WARNING: " << nruns - success_runs << " out of " << nruns << " runs failed" << endl << endl;
+	}
+	std::cout << endl << endl;
+	if ((terminate_reason == RUN_UNTIL_COND::NORMAL) && (init_sim.size() == 0))
+	{
+		vector<double> pars;
+		file_stor.get_run(0, pars, init_sim);
+	}
+	return terminate_reason;
+}
+
+RunManagerLocal::~RunManagerLocal(void)
+{
+	{
+		lock_guard<mutex> lock(queue_mutex);
+		stop_workers = true;
+		queued_runs.clear();
+	}
+	for (auto &flag : worker_terminate)
+		flag->set(true);
+	work_cv.notify_all();
+	for (auto &worker : workers)
+		worker.join();
+}
@@ -0,0 +1,83 @@
+/*
+
+
+	This file is part of PEST++.
+
+	PEST++ is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+
+	PEST++ is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
+*/
+#ifndef RUNMANAGERLOCAL_H
+#define RUNMANAGERLOCAL_H
+
+#include "RunManagerAbstract.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "model_interface.h"
+
+class RunManagerLocal : public RunManagerAbstract
+{
+	// Runs the model on this machine with num_workers concurrent model runs.  Worker 0 runs in the
+	// run directory and every other worker runs in its own copy of the run directory.  The runs are
+	// executed by a pool of worker threads sharing one ModelInterface and the results are written to
+	// the run storage file by the calling thread in batches.  num_workers <= 0 uses one worker per
+	// processor.
+public:
+	RunManagerLocal(const std::vector<std::string> _comline_vec,
+		const std::vector<std::string> _tplfile_vec, const std::vector<std::string> _inpfile_vec,
+		const std::vector<std::string> _insfile_vec, const std::vector<std::string> _outfile_vec,
+		const std::string &stor_filename, const std::string &run_dir, int _num_workers, int _max_run_fail = 1);
+	virtual void run();
+	// NO_OPS counts consecutive poll intervals without a finished run.  Once the condition is met no
+	// further runs are started; the runs already started are completed and stored before returning
+	// and the remaining runs are made by the next call
+	virtual RunManagerAbstract::RUN_UNTIL_COND run_until(RUN_UNTIL_COND condition, int max_no_ops = 0, double max_time_sec = 0.0);
+	virtual void set_cpp_tpl_writer(bool use_cpp_tpl_writer) { mi.set_cpp_tpl_writer(use_cpp_tpl_writer); }
+	virtual void set_cpp_ins_reader(bool use_cpp_ins_reader) { mi.set_cpp_ins_reader(use_cpp_ins_reader); }
+	int get_num_workers() const { return num_workers; }
+	~RunManagerLocal(void);
+private:
+	struct LocalRun
+	{
+		int run_id;
+		bool success;
+		Parameters pars;
+		Observations obs;
+		std::string err_msg;
+	};
+	static const std::string worker_dir_prefix;
+	static const int poll_interval_ms = 1000;
+
+	ModelInterface mi;
+	std::string run_dir;
+	int num_workers;
+	std::vector<std::string> worker_dirs;
+	std::vector<std::thread> workers;
+	std::vector<std::unique_ptr<pest_utils::thread_flag>> worker_terminate;
+	std::mutex queue_mutex;
+	std::condition_variable work_cv;
+	std::condition_variable done_cv;
+	std::deque<LocalRun> queued_runs;
+	std::vector<LocalRun> finished_runs;
+	bool stop_workers;
+
+	void init_workers();
+	void worker_main(int i_worker);
+	int store_finished_runs(std::vector<LocalRun> &runs);
+};
+
+#endif /* RUNMANAGERLOCAL_H */
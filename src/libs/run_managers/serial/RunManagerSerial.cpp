@@ -98,6 +98,8 @@ void RunManagerSerial::run()
 			}
 		}
 	}
+	//make sure all completed runs are in the run storage file
+	file_stor.sync();
 	total_runs += success_runs;
 	std::cout << string(message.str().size(), '\b');
 	message.str("");
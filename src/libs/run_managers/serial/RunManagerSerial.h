@@ -31,6 +31,8 @@ public:
 		const std::vector<std::string> _insfile_vec, const std::vector<std::string> _outfile_vec,
 		const std::string &stor_filename, const std::string &run_dir, int _max_run_fail=1);
 	virtual void run();
+	virtual void set_cpp_tpl_writer(bool use_cpp_tpl_writer) { mi.set_cpp_tpl_writer(use_cpp_tpl_writer); }
+	virtual void set_cpp_ins_reader(bool use_cpp_ins_reader) { mi.set_cpp_ins_reader(use_cpp_ins_reader); }
 	void throw_mio_error(std::string base_message);
 	~RunManagerSerial(void);
 private:
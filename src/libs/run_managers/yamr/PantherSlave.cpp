@@ -14,11 +14,22 @@ using namespace pest_utils;
 
 int  linpack_wrap(void);
 
-PANTHERSlave::PANTHERSlave() :mi()
+namespace
+{
+	const string slot_dir_prefix = "panther_slot_";
+}
+
+PANTHERSlave::PANTHERSlave() : n_slots(1), single_precision_obs(false), mi()
 {
 
 }
 
+PANTHERSlave::RunSlot::RunSlot(const string &_run_dir, int _group_id, int _run_id) : run_dir(_run_dir),
+	group_id(_group_id), run_id(_run_id), killed(false), f_terminate(false), f_finished(false), f_done(false),
+	start_time(chrono::system_clock::now())
+{
+}
+
 void PANTHERSlave::init_network(const string &host, const string &port)
 {
 	w_init();
@@ -159,6 +170,10 @@ void PANTHERSlave::process_ctl_file(const string &ctl_filename)
 	fin.close();
 
 	poll_interval_seconds = 1;
+	n_slots = 1;
+	single_precision_obs = false;
+	mi.set_cpp_tpl_writer(false);
+	mi.set_cpp_ins_reader(false);
 	for (auto &line : pestpp_lines)
 	{
 		string key;
@@ -186,6 +201,29 @@ void PANTHERSlave::process_ctl_file(const string &ctl_filename)
 				convert_ip(value, poll_interval_seconds);
 
 			}
+			else if (key == "PANTHER_AGENT_SLOTS") {
+				convert_ip(value, n_slots);
+				if (n_slots < 1)
+					throw PestError("PANTHER_AGENT_SLOTS must be greater than zero");
+			}
+			else if (key == "TPL_WRITER") {
+				strip_ip(value);
+				if ((value != "MIO") && (value != "CPP"))
+					throw PestError("TPL_WRITER must be 'mio' or 'cpp'");
+				mi.set_cpp_tpl_writer(value == "CPP");
+			}
+			else if (key == "INS_READER") {
+				strip_ip(value);
+				if ((value != "MIO") && (value != "CPP"))
+					throw PestError("INS_READER must be 'mio' or 'cpp'");
+				mi.set_cpp_ins_reader(value == "CPP");
+			}
+			else if (key == "OBS_STORAGE_PRECISION") {
+				strip_ip(value);
+				if ((value != "DOUBLE") && (value != "SINGLE"))
+					throw PestError("OBS_STORAGE_PRECISION must be 'double' or 'single'");
+				single_precision_obs = (value == "SINGLE");
+			}
 		}
 	}
 }
@@ -287,6 +325,10 @@ void PANTHERSlave::process_panther_ctl_file(const string &ctl_filename)
 
 	fin.close();
 	poll_interval_seconds = 1;
+	n_slots = 1;
+	single_precision_obs = false;
+	mi.set_cpp_tpl_writer(false);
+	mi.set_cpp_ins_reader(false);
 	for (auto &line : pestpp_lines)
 	{
 		string key;
@@ -314,6 +356,29 @@ void PANTHERSlave::process_panther_ctl_file(const string &ctl_filename)
 				convert_ip(value, poll_interval_seconds);
 
 			}
+			else if (key == "PANTHER_AGENT_SLOTS") {
+				convert_ip(value, n_slots);
+				if (n_slots < 1)
+					throw PestError("PANTHER_AGENT_SLOTS must be greater than zero");
+			}
+			else if (key == "TPL_WRITER") {
+				strip_ip(value);
+				if ((value != "MIO") && (value != "CPP"))
+					throw PestError("TPL_WRITER must be 'mio' or 'cpp'");
+				mi.set_cpp_tpl_writer(value == "CPP");
+			}
+			else if (key == "INS_READER") {
+				strip_ip(value);
+				if ((value != "MIO") && (value != "CPP"))
+					throw PestError("INS_READER must be 'mio' or 'cpp'");
+				mi.set_cpp_ins_reader(value == "CPP");
+			}
+			else if (key == "OBS_STORAGE_PRECISION") {
+				strip_ip(value);
+				if ((value != "DOUBLE") && (value != "SINGLE"))
+					throw PestError("OBS_STORAGE_PRECISION must be 'double' or 'single'");
+				single_precision_obs = (value == "SINGLE");
+			}
 		}
 	}
 
@@ -426,6 +491,8 @@ NetPackage::PackType PANTHERSlave::run_model(Parameters &pars, Observations &obs
 	NetPackage::PackType final_run_status = NetPackage::PackType::RUN_FAILED;
 	bool done = false;
 	int err = 0;
+	int group_id = net_pack.get_group_id();
+	int run_id = net_pack.get_run_id();
 
 	if (!mi.get_initialized())
 	{
@@ -493,6 +560,22 @@ NetPackage::PackType PANTHERSlave::run_model(Parameters &pars, Observations &obs
 				}
 				//cout << "ping response sent" << endl;
 			}
+			else if (net_pack.get_type() == NetPackage::PackType::START_RUN)
+			{
+				//the master sent the next run ahead of time.  It is started once this run is finished
+				cout << "queueing run (group id = " << net_pack.get_group_id() << ", run id = " << net_pack.get_run_id() << ")" << endl;
+				queued_runs.push_back(net_pack);
+			}
+			else if (net_pack.get_type() == NetPackage::PackType::REQ_KILL
+				&& net_pack.get_group_id() != 0
+				&& (net_pack.get_group_id() != group_id || net_pack.get_run_id() != run_id))
+			{
+				//kill request for a queued run or for a run that has already finished
+				if (!remove_queued_run(net_pack.get_group_id(), net_pack.get_run_id()))
+				{
+					cout << "received kill request from master. run already finished" << endl;
+				}
+			}
 			else if (net_pack.get_type() == NetPackage::PackType::REQ_KILL)
 			{
 				cout << "received kill request signal from master" << endl;
@@ -512,7 +595,7 @@ NetPackage::PackType PANTHERSlave::run_model(Parameters &pars, Observations &obs
 			}
 			else
 			{
-				cerr << "Received unsupported message from master, only PING REQ_KILL or TERMINATE can be sent during model run" << endl;
+				cerr << "Received unsupported message from master, only PING START_RUN REQ_KILL or TERMINATE can be sent during model run" << endl;
 				cerr << static_cast<int>(net_pack.get_type()) << endl;
 				cerr << "something is wrong...exiting" << endl;
 				f_terminate.set(true);
@@ -554,6 +637,234 @@ void PANTHERSlave::run_async(pest_utils::thread_flag* terminate, pest_utils::thr
 }
 
 
+bool PANTHERSlave::remove_queued_run(int group_id, int run_id)
+{
+	for (auto it = queued_runs.begin(); it != queued_runs.end(); ++it)
+	{
+		if (it->get_group_id() == group_id && it->get_run_id() == run_id)
+		{
+			queued_runs.erase(it);
+			cout << "removed queued run (group id = " << group_id << ", run id = " << run_id << ") at request of master" << endl;
+			NetPackage net_pack(NetPackage::PackType::RUN_KILLED, group_id, run_id, "");
+			char data;
+			int err = send_message(net_pack, &data, 0);
+			if (err != 1)
+			{
+				exit(-1);
+			}
+			net_pack.reset(NetPackage::PackType::READY, group_id, run_id, "");
+			err = send_message(net_pack, &data, 0);
+			if (err != 1)
+			{
+				exit(-1);
+			}
+			return true;
+		}
+	}
+	return false;
+}
+
+
+void PANTHERSlave::send_run_started(int group_id, int run_id)
+{
+	// lets the master time the run from when it actually starts rather than from when it was sent
+	NetPackage net_pack(NetPackage::PackType::RUN_STARTED, group_id, run_id, "");
+	char data;
+	int err = send_message(net_pack, &data, 0);
+	if (err != 1)
+	{
+		exit(-1);
+	}
+}
+
+
+void PANTHERSlave::run_slot_async(RunSlot *slot)
+{
+	mi.run(&slot->f_terminate, &slot->f_finished, &slot->shared_execptions, &slot->pars, &slot->obs, slot->run_dir);
+	//sleep here just to give the os a chance to cleanup any remaining file handles
+	w_sleep(poll_interval_seconds * 1000);
+	slot->f_done.set(true);
+}
+
+
+void PANTHERSlave::init_slot_dirs()
+{
+	// slot 0 runs in the current directory.  The other slots each get their own copy of the
+	// current directory so concurrent model runs do not overwrite each other's files
+	string cwd = OperSys::getcwd();
+	slot_dirs.clear();
+	slot_dirs.push_back(cwd);
+	for (int i = 1; i < n_slots; ++i)
+	{
+		stringstream ss;
+		ss << cwd << OperSys::DIR_SEP << slot_dir_prefix << i;
+		string slot_dir = ss.str();
+		cout << "preparing run slot " << i << " in: " << slot_dir << endl;
+		make_dir(slot_dir);
+		copy_dir_contents(cwd, slot_dir, vector<string>(1, slot_dir_prefix));
+		slot_dirs.push_back(slot_dir);
+	}
+	slots.clear();
+	slots.resize(n_slots);
+}
+
+
+void PANTHERSlave::start_slot_run(NetPackage &net_pack)
+{
+	int group_id = net_pack.get_group_id();
+	int run_id = net_pack.get_run_id();
+	cout << "received parameters (group id = " << group_id << ", run id = " << run_id << ")" << endl;
+
+	int i_slot = 0;
+	while (i_slot < n_slots && slots[i_slot])
+		++i_slot;
+	if (i_slot == n_slots)
+	{
+		//the master sent this run ahead of time.  It is started when the next slot becomes free
+		cout << "all run slots are busy, queueing run" << endl;
+		queued_runs.push_back(net_pack);
+		return;
+	}
+
+	if (!mi.get_initialized())
+	{
+		//initialize the model interface.  No other slot is running at this point so this is done
+		//in the current directory
+		mi.initialize(tplfile_vec, inpfile_vec, insfile_vec,
+			outfile_vec, comline_vec, par_name_vec, obs_name_vec);
+	}
+	slots[i_slot].reset(new RunSlot(slot_dirs[i_slot], group_id, run_id));
+	RunSlot *slot = slots[i_slot].get();
+	Serialization::unserialize(net_pack.get_data(), slot->pars, par_name_vec);
+	cout << "starting model run in slot " << i_slot << "..." << endl;
+	slot->run_thread = thread(&PANTHERSlave::run_slot_async, this, slot);
+	send_run_started(group_id, run_id);
+}
+
+
+void PANTHERSlave::report_finished_slots(NetPackage &net_pack)
+{
+	for (int i_slot = 0; i_slot < n_slots; ++i_slot)
+	{
+		if ((!slots[i_slot]) || (!slots[i_slot]->f_done.get()))
+			continue;
+		unique_ptr<RunSlot> slot(std::move(slots[i_slot]));
+		slot->run_thread.join();
+		//start the next queued run before reporting back so the slot does not sit idle
+		if (!queued_runs.empty())
+		{
+			NetPackage queued_pack = queued_runs.front();
+			queued_runs.pop_front();
+			start_slot_run(queued_pack);
+		}
+		int group_id = slot->group_id;
+		int run_id = slot->run_id;
+		int err;
+		char data;
+		NetPackage::PackType final_run_status = NetPackage::PackType::RUN_FAILED;
+		if (slot->killed)
+		{
+			final_run_status = NetPackage::PackType::RUN_KILLED;
+		}
+		else if (slot->shared_execptions.size() > 0)
+		{
+			try
+			{
+				slot->shared_execptions.rethrow();
+			}
+			catch (const std::exception& ex)
+			{
+				cerr << endl;
+				cerr << "   " << ex.what() << endl;
+				cerr << "   Aborting model run" << endl << endl;
+			}
+			catch (...)
+			{
+				cerr << "   Error running model" << endl;
+				cerr << "   Aborting model run" << endl;
+			}
+		}
+		else if (slot->f_finished.get())
+		{
+			final_run_status = NetPackage::PackType::RUN_FINISHED;
+		}
+
+		if (final_run_status == NetPackage::PackType::RUN_FINISHED)
+		{
+			double run_time = pest_utils::get_duration_sec(slot->start_time);
+			cout << "run complete in slot " << i_slot << endl;
+			cout << "sending results to master (group id = " << group_id << ", run id = " << run_id << ")..." << endl;
+			vector<int8_t> serialized_data = Serialization::serialize(slot->pars, par_name_vec, slot->obs, obs_name_vec, run_time, single_precision_obs);
+			net_pack.reset(NetPackage::PackType::RUN_FINISHED, group_id, run_id, "");
+			err = send_message(net_pack, serialized_data.data(), serialized_data.size());
+			cout << "results sent" << endl << endl;
+		}
+		else
+		{
+			if (final_run_status == NetPackage::PackType::RUN_KILLED)
+				cout << "run killed in slot " << i_slot << endl;
+			else
+				cout << "run failed in slot " << i_slot << endl;
+			net_pack.reset(final_run_status, group_id, run_id, "");
+			err = send_message(net_pack, &data, 0);
+		}
+		if (err != 1)
+		{
+			exit(-1);
+		}
+
+		// the group and run id tell the master which of this agent's slots is free again
+		cout << "sending ready signal to master" << endl;
+		net_pack.reset(NetPackage::PackType::READY, group_id, run_id, "");
+		err = send_message(net_pack, &data, 0);
+		if (err != 1)
+		{
+			exit(-1);
+		}
+	}
+}
+
+
+void PANTHERSlave::kill_slot_run(int group_id, int run_id)
+{
+	if (group_id != 0 && remove_queued_run(group_id, run_id))
+		return;
+	bool found = false;
+	for (auto &slot : slots)
+	{
+		//masters that do not know about run slots send kill requests without a group id
+		bool match = (group_id == 0) || (slot && slot->group_id == group_id && slot->run_id == run_id);
+		if (slot && match && !slot->f_done.get())
+		{
+			cout << "received kill request signal from master (group id = " << group_id << ", run id = " << run_id << ")" << endl;
+			cout << "sending terminate signal to run thread" << endl;
+			slot->killed = true;
+			slot->f_terminate.set(true);
+			found = true;
+		}
+	}
+	if (!found)
+	{
+		cout << "received kill request from master. run already finished" << endl;
+	}
+}
+
+
+void PANTHERSlave::terminate_slots()
+{
+	queued_runs.clear();
+	for (auto &slot : slots)
+	{
+		if (!slot)
+			continue;
+		slot->f_terminate.set(true);
+		if (slot->run_thread.joinable())
+			slot->run_thread.join();
+		slot.reset();
+	}
+}
+
+
 void PANTHERSlave::check_io()
 {
 	vector<string> inaccessible_files;
@@ -585,20 +896,44 @@ void PANTHERSlave::start(const string &host, const string &port)
 
 	//class attribute - can be modified in run_model()
 	terminate = false;
+	if (n_slots > 1)
+	{
+		init_slot_dirs();
+	}
 	init_network(host, port);
 	while (!terminate)
 	{
 		//get message from master
-		err = recv_message(net_pack);
+		if (n_slots == 1 && !queued_runs.empty())
+		{
+			//start the run that the master sent while the previous run was executing
+			net_pack = queued_runs.front();
+			queued_runs.pop_front();
+			err = 1;
+		}
+		else if (n_slots > 1)
+		{
+			//poll so the results of finished slots can be sent back while other slots are running
+			err = recv_message(net_pack, 0, 100000);
+		}
+		else
+		{
+			err = recv_message(net_pack);
+		}
 		if (err < 0)
 		{
 			terminate = true;
 		}
+		else if (err == 2)
+		{
+			//no message received
+		}
 		else if(net_pack.get_type() == NetPackage::PackType::REQ_RUNDIR)
 		{
 			// Send Master the local run directory.  This information is only used by the master
 			// for reporting purposes
-			net_pack.reset(NetPackage::PackType::RUNDIR, 0, 0,"");
+			// The group id field is used to tell the master how many runs this agent can execute concurrently
+			net_pack.reset(NetPackage::PackType::RUNDIR, n_slots, 0,"");
 			string cwd =  OperSys::getcwd();
 			err = send_message(net_pack, cwd.c_str(), cwd.size());
 			if (err != 1)
@@ -647,6 +982,10 @@ void PANTHERSlave::start(const string &host, const string &port)
 				exit(-1);
 			}
 		}
+		else if (net_pack.get_type() == NetPackage::PackType::START_RUN && n_slots > 1)
+		{
+			start_slot_run(net_pack);
+		}
 		else if(net_pack.get_type() == NetPackage::PackType::START_RUN)
 		{
 			Serialization::unserialize(net_pack.get_data(), pars, par_name_vec);
@@ -656,6 +995,7 @@ void PANTHERSlave::start(const string &host, const string &port)
 			
 			cout << "received parameters (group id = " << group_id << ", run id = " << run_id << ")" << endl;
 			cout << "starting model run..." << endl;
+			send_run_started(group_id, run_id);
 
 			std::chrono::system_clock::time_point start_time = chrono::system_clock::now();
 			NetPackage::PackType final_run_status = run_model(pars, obs, net_pack);
@@ -666,7 +1006,7 @@ void PANTHERSlave::start(const string &host, const string &port)
 				cout << "run complete" << endl;
 				cout << "sending results to master (group id = " << group_id << ", run id = " << run_id << ")..." << endl;
 				cout << "results sent" << endl << endl;
-				serialized_data = Serialization::serialize(pars, par_name_vec, obs, obs_name_vec, run_time);
+				serialized_data = Serialization::serialize(pars, par_name_vec, obs, obs_name_vec, run_time, single_precision_obs);
 				net_pack.reset(NetPackage::PackType::RUN_FINISHED, group_id, run_id, "");
 				err = send_message(net_pack, serialized_data.data(), serialized_data.size());
 				if (err != 1)
@@ -704,9 +1044,10 @@ void PANTHERSlave::start(const string &host, const string &port)
 
 			if (!terminate)
 			{
-				// Send READY Message to master
+				// Send READY Message to master.  The group and run id identify the finished run if
+				// the master has sent further runs ahead of time
 				cout << "sending ready signal to master" << endl;
-				net_pack.reset(NetPackage::PackType::READY, 0, 0, "");
+				net_pack.reset(NetPackage::PackType::READY, group_id, run_id, "");
 				char data;
 				err = send_message(net_pack, &data, 0);
 				if (err != 1)
@@ -720,6 +1061,10 @@ void PANTHERSlave::start(const string &host, const string &port)
 			cout << "terminated requested" << endl;
 			terminate = true;
 		}
+		else if (net_pack.get_type() == NetPackage::PackType::REQ_KILL && n_slots > 1)
+		{
+			kill_slot_run(net_pack.get_group_id(), net_pack.get_run_id());
+		}
 		else if (net_pack.get_type() == NetPackage::PackType::REQ_KILL)
 		{
 			cout << "received kill request from master. run already finished" << endl;
@@ -740,8 +1085,16 @@ void PANTHERSlave::start(const string &host, const string &port)
 		{
 			cout << "received unsupported messaged type: " << int(net_pack.get_type()) << endl;
 		}
-		//w_sleep(100);
-		this_thread::sleep_for(chrono::milliseconds(100));
+		if (n_slots > 1)
+		{
+			report_finished_slots(net_pack);
+		}
+		else
+		{
+			//w_sleep(100);
+			this_thread::sleep_for(chrono::milliseconds(100));
+		}
 	}
+	terminate_slots();
 }
 
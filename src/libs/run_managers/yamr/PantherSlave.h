@@ -26,6 +26,9 @@
 #include <iostream>
 #include <fstream>
 #include <memory>
+#include <deque>
+#include <thread>
+#include <chrono>
 #include "utilities.h"
 #include "pest_error.h"
 #include "network_package.h"
@@ -56,6 +59,11 @@ private:
 	int fdmax;
 	double run_time;
 	int poll_interval_seconds;
+	// number of model runs this agent executes concurrently (++panther_agent_slots).  Slot 0 runs
+	// in the agent's working directory and slot k in a copy of it named panther_slot_k
+	int n_slots;
+	// send the observation values as floats (++obs_storage_precision(single))
+	bool single_precision_obs;
 #ifdef _DEBUG
 	static const int max_recv_fails = 100;
 	static const int max_send_fails = 100;
@@ -79,6 +87,36 @@ private:
 		pest_utils::thread_exceptions *shared_execptions,
 		Parameters* pars, Observations* obs);
 
+	class RunSlot
+	{
+	public:
+		RunSlot(const std::string &_run_dir, int _group_id, int _run_id);
+		std::string run_dir;
+		int group_id;
+		int run_id;
+		bool killed;
+		pest_utils::thread_flag f_terminate;
+		pest_utils::thread_flag f_finished;
+		pest_utils::thread_flag f_done;
+		pest_utils::thread_exceptions shared_execptions;
+		Parameters pars;
+		Observations obs;
+		std::thread run_thread;
+		std::chrono::system_clock::time_point start_time;
+	};
+	// START_RUN messages the master sent ahead of time (prefetched) while all slots were busy
+	std::deque<NetPackage> queued_runs;
+	bool remove_queued_run(int group_id, int run_id);
+	void send_run_started(int group_id, int run_id);
+	std::vector<std::string> slot_dirs;
+	std::vector<std::unique_ptr<RunSlot>> slots;
+	void init_slot_dirs();
+	void start_slot_run(NetPackage &net_pack);
+	void run_slot_async(RunSlot *slot);
+	void report_finished_slots(NetPackage &net_pack);
+	void kill_slot_run(int group_id, int run_id);
+	void terminate_slots();
+
 };
 
 #endif /* PANTHERSLAVE_H_ */
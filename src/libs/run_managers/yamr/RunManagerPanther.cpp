@@ -21,6 +21,7 @@
 #include "RunManagerPanther.h"
 #include <chrono>
 #include <ctime>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -39,12 +40,18 @@
 #include "Transformable.h"
 #include "utilities.h"
 #include "Serialization.h"
+#ifdef OS_LINUX
+#include <sys/epoll.h>
+#endif
 
 
 using namespace std;
 using namespace pest_utils;
 
-const int RunManagerPanther::BACKLOG = 10;
+const int RunManagerPanther::BACKLOG = SOMAXCONN;
+#ifdef OS_LINUX
+const int RunManagerPanther::MAX_EPOLL_EVENTS = 1024;
+#endif
 const int RunManagerPanther::MAX_FAILED_PINGS = 60;
 const int RunManagerPanther::N_PINGS_UNRESPONSIVE = 3;
 const int RunManagerPanther::PING_INTERVAL_SECS = 5;
@@ -65,6 +72,9 @@ SlaveInfoRec::SlaveInfoRec(int _socket_fd)
 	last_ping_time = std::chrono::system_clock::now();
 	ping = false;
 	failed_pings = 0;
+	n_slots = 1;
+	can_queue_runs = false;
+	run_started = false;
 }
 
 bool SlaveInfoRec::CompareTimes::operator() (const SlaveInfoRec &a, const SlaveInfoRec &b)
@@ -158,6 +168,36 @@ string SlaveInfoRec::get_work_dir() const
 	return work_dir;
 }
 
+int SlaveInfoRec::get_n_slots() const
+{
+	return n_slots;
+}
+
+void SlaveInfoRec::set_n_slots(int _n_slots)
+{
+	n_slots = max(1, _n_slots);
+}
+
+bool SlaveInfoRec::get_can_queue_runs() const
+{
+	return can_queue_runs;
+}
+
+void SlaveInfoRec::set_can_queue_runs(bool _can_queue_runs)
+{
+	can_queue_runs = _can_queue_runs;
+}
+
+bool SlaveInfoRec::get_run_started() const
+{
+	return run_started;
+}
+
+void SlaveInfoRec::set_run_started(bool _run_started)
+{
+	run_started = _run_started;
+}
+
 void SlaveInfoRec::start_timer()
 {
 	start_time = std::chrono::system_clock::now();
@@ -257,12 +297,135 @@ int SlaveInfoRec::seconds_since_last_ping_time() const
 }
 
 
+const double RunCostModel::smoothing = 0.3;
+const size_t RunCostModel::max_ratios = 1000;
+
+RunCostModel::RunCostModel() : mean_cost(0.0), n_obs(0), cached_q(-1.0), cached_quantile(1.0)
+{
+}
+
+void RunCostModel::add_run(int run_id, const string &cost_key)
+{
+	if (run_id < 0)
+		return;
+	// use the same key as the info_txt stored in the run storage file
+	string key = cost_key.substr(0, 40);
+	int key_id;
+	auto iter = key_ids.find(key);
+	if (iter == key_ids.end())
+	{
+		key_id = key_costs.size();
+		key_ids[key] = key_id;
+		key_costs.push_back(-1.0);
+	}
+	else
+	{
+		key_id = iter->second;
+	}
+	if (run_id >= run_key_ids.size())
+		run_key_ids.resize(run_id + 1, -1);
+	run_key_ids[run_id] = key_id;
+}
+
+void RunCostModel::clear_runs()
+{
+	run_key_ids.clear();
+}
+
+int RunCostModel::get_key_id(int run_id) const
+{
+	if (run_id < 0 || run_id >= run_key_ids.size())
+		return -1;
+	return run_key_ids[run_id];
+}
+
+void RunCostModel::add_observation(int run_id, int socket_fd, double runtime_sec)
+{
+	if (runtime_sec <= 0.0)
+		return;
+	int key_id = get_key_id(run_id);
+	double speed = get_speed(socket_fd);
+	double predicted = predict(run_id, socket_fd);
+	if (predicted > 0.0)
+	{
+		ratios.push_back(runtime_sec / predicted);
+		if (ratios.size() > max_ratios)
+			ratios.pop_front();
+		cached_q = -1.0;
+	}
+	double key_cost = (key_id >= 0) ? key_costs[key_id] : -1.0;
+	// the slave speed is only updated from runs with a known cost so differences between the
+	// cost keys are not attributed to the slave
+	if (key_cost > 0.0)
+	{
+		slave_speeds[socket_fd] = (1.0 - smoothing) * speed + smoothing * (runtime_sec / key_cost);
+	}
+	double cost = runtime_sec / speed;
+	if (key_id >= 0)
+	{
+		key_costs[key_id] = (key_cost > 0.0) ? (1.0 - smoothing) * key_cost + smoothing * cost : cost;
+	}
+	++n_obs;
+	mean_cost += (cost - mean_cost) / min(n_obs, 100);
+}
+
+void RunCostModel::remove_slave(int socket_fd)
+{
+	slave_speeds.erase(socket_fd);
+}
+
+double RunCostModel::predict(int run_id) const
+{
+	int key_id = get_key_id(run_id);
+	if (key_id >= 0 && key_costs[key_id] > 0.0)
+		return key_costs[key_id];
+	if (n_obs > 0)
+		return mean_cost;
+	return -1.0;
+}
+
+double RunCostModel::predict(int run_id, int socket_fd) const
+{
+	double cost = predict(run_id);
+	if (cost <= 0.0)
+		return cost;
+	return cost * get_speed(socket_fd);
+}
+
+double RunCostModel::get_speed(int socket_fd) const
+{
+	auto iter = slave_speeds.find(socket_fd);
+	if (iter == slave_speeds.end())
+		return 1.0;
+	return iter->second;
+}
+
+double RunCostModel::get_ratio_quantile(double q) const
+{
+	if (ratios.empty())
+		return 1.0;
+	if (q != cached_q)
+	{
+		vector<double> ratio_vec(ratios.begin(), ratios.end());
+		size_t k = (size_t)ceil(q * ratio_vec.size());
+		k = min(max(k, size_t(1)), ratio_vec.size()) - 1;
+		nth_element(ratio_vec.begin(), ratio_vec.begin() + k, ratio_vec.end());
+		cached_quantile = ratio_vec[k];
+		cached_q = q;
+	}
+	return cached_quantile;
+}
+
+
 RunManagerPanther::RunManagerPanther(const string &stor_filename, const string &_port, ofstream &_f_rmr, int _max_n_failure,
-	double _overdue_reched_fac, double _overdue_giveup_fac, double _overdue_giveup_minutes)
+	double _overdue_reched_fac, double _overdue_giveup_fac, double _overdue_giveup_minutes, int _prefetch_depth,
+	bool _cost_scheduling, double _overdue_quantile)
 	: RunManagerAbstract(vector<string>(), vector<string>(), vector<string>(),
 	vector<string>(), vector<string>(), stor_filename, _max_n_failure),
 	overdue_reched_fac(_overdue_reched_fac), overdue_giveup_fac(_overdue_giveup_fac),
-	port(_port), f_rmr(_f_rmr), n_no_ops(0), overdue_giveup_minutes(_overdue_giveup_minutes)
+	port(_port), f_rmr(_f_rmr), n_no_ops(0), overdue_giveup_minutes(_overdue_giveup_minutes),
+	prefetch_depth(max(0, _prefetch_depth)), cost_scheduling(_cost_scheduling), overdue_quantile(_overdue_quantile),
+	resume_run_until(false)
 {
 	max_concurrent_runs = max(MAX_CONCURRENT_RUNS_LOWER_LIMIT, _max_n_failure);
 	w_init();
@@ -297,9 +460,18 @@ RunManagerPanther::RunManagerPanther(const string &stor_filename, const string &
 	w_listen(listener, BACKLOG);
 	//free servinfo
 	freeaddrinfo(servinfo);
+#ifdef OS_WIN
 	fdmax = listener;
 	FD_ZERO(&master);
-	FD_SET(listener, &master);
+#endif
+#ifdef OS_LINUX
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd == -1)
+	{
+		throw(PestError("Error: unable to create epoll instance for PANTHER master: " + w_get_error_msg()));
+	}
+#endif
+	watch_socket(listener);
 	return;
 }
 
@@ -331,10 +503,52 @@ list<SlaveInfoRec>::iterator RunManagerPanther::get_active_run_iter(int socket)
 	}
 }
 
+list<SlaveInfoRec>::iterator RunManagerPanther::get_slot_iter(int socket, int group_id, int run_id)
+{
+	// find the slot of the slave that a run message refers to
+	auto slots_iter = socket_to_slots_map.find(socket);
+	if (slots_iter == socket_to_slots_map.end())
+	{
+		return get_active_run_iter(socket);
+	}
+	for (auto &slot_iter : slots_iter->second)
+	{
+		if (slot_iter->get_state() != SlaveInfoRec::State::WAITING
+			&& slot_iter->get_group_id() == group_id
+			&& slot_iter->get_run_id() == run_id)
+		{
+			return slot_iter;
+		}
+	}
+	return slave_info_set.end();
+}
+
+bool RunManagerPanther::slave_has_run(list<SlaveInfoRec>::iterator slave_info_iter, int run_id)
+{
+	// check if another slot of the same slave is still busy with (or reporting) this run
+	auto slots_iter = socket_to_slots_map.find(slave_info_iter->get_socket_fd());
+	if (slots_iter == socket_to_slots_map.end())
+	{
+		return false;
+	}
+	for (auto &slot_iter : slots_iter->second)
+	{
+		if (slot_iter != slave_info_iter
+			&& slot_iter->get_state() != SlaveInfoRec::State::WAITING
+			&& slot_iter->get_group_id() == cur_group_id
+			&& slot_iter->get_run_id() == run_id)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
 
 void RunManagerPanther::initialize(const Parameters &model_pars, const Observations &obs, const string &_filename)
 {
 	RunManagerAbstract::initialize(model_pars, obs, _filename);
+	cost_model.clear_runs();
 	cur_group_id = NetPackage::get_new_group_id();
 }
 
@@ -346,6 +560,14 @@ void RunManagerPanther::initialize_restart(const std::string &_filename)
 	for (int &id : waiting_run_id_vec)
 	{
 		waiting_runs.push_back(id);
+		if (cost_scheduling)
+		{
+			int status;
+			string info_txt;
+			double info_value;
+			file_stor.get_info(id, status, info_txt, info_value);
+			cost_model.add_run(id, info_txt);
+		}
 	}
 }
 
@@ -358,16 +580,19 @@ void RunManagerPanther::reinitialize(const std::string &_filename)
 
 void  RunManagerPanther::free_memory()
 {
+	resume_run_until = false;
 	waiting_runs.clear();
 	model_runs_done = 0;
 	failure_map.clear();
 	active_runid_to_iterset_map.clear();
+	cost_model.clear_runs();
 }
 
 int RunManagerPanther::add_run(const Parameters &model_pars, const string &info_txt, double info_value)
 {
 	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
 	waiting_runs.push_back(run_id);
+	if (cost_scheduling) cost_model.add_run(run_id, info_txt);
 	return run_id;
 }
 
@@ -375,6 +600,7 @@ int RunManagerPanther::add_run(const std::vector<double> &model_pars, const stri
 {
 	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
 	waiting_runs.push_back(run_id);
+	if (cost_scheduling) cost_model.add_run(run_id, info_txt);
 	return run_id;
 }
 
@@ -382,6 +608,7 @@ int RunManagerPanther::add_run(const Eigen::VectorXd &model_pars, const string &
 {
 	int run_id = file_stor.add_run(model_pars, info_txt, info_value);
 	waiting_runs.push_back(run_id);
+	if (cost_scheduling) cost_model.add_run(run_id, info_txt);
 	return run_id;
 }
 
@@ -405,6 +632,13 @@ void RunManagerPanther::update_run(int run_id, const Parameters &pars, const Obs
 	kill_runs(run_id, false, "run not required");
 }
 
+void RunManagerPanther::cancel_run(int run_id)
+{
+	RunManagerAbstract::cancel_run(run_id);
+	waiting_runs.erase(remove(waiting_runs.begin(), waiting_runs.end(), run_id), waiting_runs.end());
+	kill_runs(run_id, false, "run canceled");
+}
+
 void RunManagerPanther::run()
 {
 	run_until(RUN_UNTIL_COND::NORMAL);
@@ -416,31 +650,34 @@ RunManagerAbstract::RUN_UNTIL_COND RunManagerPanther::run_until(RUN_UNTIL_COND c
 	stringstream message;
 	NetPackage net_pack;
 
-	model_runs_done = 0;
-	model_runs_failed = 0;
-	model_runs_timed_out = 0;
-	failure_map.clear();
-	active_runid_to_iterset_map.clear();
-	int num_runs = waiting_runs.size();
-	cout << "    running model " << num_runs << " times" << endl;
-	f_rmr << "running model " << num_runs << " times" << endl;
-	if (slave_info_set.size() == 0) // first entry is the listener, slave apears after this
-	{
-		cout << endl << "      waiting for slaves to appear..." << endl << endl;
-		f_rmr << endl << "    waiting for slaves to appear..." << endl << endl;
-	}
-	else
+	if (!resume_run_until)
 	{
-		for (auto &si : slave_info_set)
-			si.reset_runtime();
-	}
-	cout << endl;
-	f_rmr << endl;
+		model_runs_done = 0;
+		model_runs_failed = 0;
+		model_runs_timed_out = 0;
+		failure_map.clear();
+		active_runid_to_iterset_map.clear();
+		int num_runs = waiting_runs.size();
+		cout << "    running model " << num_runs << " times" << endl;
+		f_rmr << "running model " << num_runs << " times" << endl;
+		if (slave_info_set.size() == 0) // first entry is the listener, slave apears after this
+		{
+			cout << endl << "      waiting for slaves to appear..." << endl << endl;
+			f_rmr << endl << "    waiting for slaves to appear..." << endl << endl;
+		}
+		else
+		{
+			for (auto &si : slave_info_set)
+				si.reset_runtime();
+		}
+		cout << endl;
+		f_rmr << endl;
 
-	cout << "PANTHER progress" << endl;
-	cout << "   runs(C = completed | F = failed | T = timed out)" << endl;
-	cout << "   slaves(R = running | W = waiting | U = unavailable)" << endl;
-	cout << "------------------------------------------------------------------------------" << endl;
+		cout << "PANTHER progress" << endl;
+		cout << "   runs(C = completed | F = failed | T = timed out)" << endl;
+		cout << "   slaves(R = running | W = waiting | U = unavailable)" << endl;
+		cout << "------------------------------------------------------------------------------" << endl;
+	}
 
 	std::chrono::system_clock::time_point start_time = std::chrono::system_clock::now();
 	double run_time_sec = 0.0;
@@ -476,6 +713,7 @@ RunManagerAbstract::RUN_UNTIL_COND RunManagerPanther::run_until(RUN_UNTIL_COND c
 		}
 
 	}
+	resume_run_until = (terminate_reason != RUN_UNTIL_COND::NORMAL);
 	if (terminate_reason == RUN_UNTIL_COND::NORMAL)
 	{
 		echo();
@@ -501,6 +739,11 @@ RunManagerAbstract::RUN_UNTIL_COND RunManagerPanther::run_until(RUN_UNTIL_COND c
 				f_rmr << " " << fid << "(" << failure_map.count(fid) << ")";
 		}
 		f_rmr << endl << endl;
+		if (cost_scheduling)
+		{
+			f_rmr << "  cost scheduling: " << cost_model.get_n_keys() << " run cost keys, " << overdue_quantile <<
+				" quantile of observed/predicted run time: " << cost_model.get_ratio_quantile(overdue_quantile) << endl << endl;
+		}
 			
 
 		if (init_sim.size() == 0)
@@ -509,6 +752,8 @@ RunManagerAbstract::RUN_UNTIL_COND RunManagerPanther::run_until(RUN_UNTIL_COND c
 			int status = file_stor.get_run(0, pars, init_sim);
 		}
 	}
+	//make sure all completed runs are in the run storage file before returning
+	file_stor.sync();
 	return terminate_reason;
 }
 
@@ -539,9 +784,8 @@ bool RunManagerPanther::ping(int i_sock)
 	}
 
 	string sock_hostname = slave_info_iter->get_hostname();
-	fd_set read_fds = master;
 	//if the slave hasn't communicated since the last ping request
-	if ((!FD_ISSET(i_sock, &read_fds)) && slave_info_iter->get_ping())
+	if ((!is_watched_socket(i_sock)) && slave_info_iter->get_ping())
 	{
 		int fails = slave_info_iter->add_failed_ping();
 		report("failed to receive ping response from slave: " + sock_hostname + "$" + slave_info_iter->get_work_dir(), false);
@@ -582,46 +826,124 @@ bool RunManagerPanther::ping(int i_sock)
 }
 
 
+void RunManagerPanther::watch_socket(int sock_id)
+{
+#ifdef OS_WIN
+	FD_SET(sock_id, &master); // add to master set
+	if (sock_id > fdmax) { // keep track of the max
+		fdmax = sock_id;
+	}
+#endif
+#ifdef OS_LINUX
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = sock_id;
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock_id, &ev) == -1)
+	{
+		report("unable to add socket to epoll set: " + w_get_error_msg(), true);
+	}
+#endif
+}
+
+void RunManagerPanther::unwatch_socket(int sock_id)
+{
+#ifdef OS_WIN
+	FD_CLR(sock_id, &master); // remove from master set
+#endif
+#ifdef OS_LINUX
+	epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock_id, &ev);
+#endif
+}
+
+bool RunManagerPanther::is_watched_socket(int sock_id)
+{
+#ifdef OS_WIN
+	return FD_ISSET(sock_id, &master) != 0;
+#endif
+#ifdef OS_LINUX
+	return sock_id == listener || socket_to_iter_map.count(sock_id) > 0;
+#endif
+}
+
+int RunManagerPanther::wait_for_sockets(vector<int> &ready_sockets, int timeout_ms)
+{
+	// returns the number of sockets with data to read or -1 on error
+	ready_sockets.clear();
+#ifdef OS_WIN
+	fd_set read_fds = master; // temp file descriptor list for select()
+	timeval tv;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+	if (w_select(fdmax + 1, &read_fds, NULL, NULL, &tv) == -1)
+	{
+		return -1;
+	}
+	for (int i = 0; i <= fdmax; i++)
+	{
+		if (FD_ISSET(i, &read_fds))
+		{
+			ready_sockets.push_back(i);
+		}
+	}
+#endif
+#ifdef OS_LINUX
+	vector<epoll_event> events(MAX_EPOLL_EVENTS);
+	int n = epoll_wait(epoll_fd, events.data(), events.size(), timeout_ms);
+	if (n == -1)
+	{
+		if (errno != EINTR)
+		{
+			cerr << "epoll_wait error: " << w_get_error_msg() << endl;
+		}
+		return -1;
+	}
+	for (int i = 0; i < n; ++i)
+	{
+		ready_sockets.push_back(events[i].data.fd);
+	}
+	// process the sockets in the same order as select() would report them
+	sort(ready_sockets.begin(), ready_sockets.end());
+#endif
+	return ready_sockets.size();
+}
+
 bool RunManagerPanther::listen()
 {
 	bool got_message = false;
 	struct sockaddr_storage remote_addr;
-	fd_set read_fds; // temp file descriptor list for select()
 	socklen_t addr_len;
-	timeval tv;
-	tv.tv_sec = 1;
-	tv.tv_usec = 0;
-	read_fds = master; // copy it
-	if (w_select(fdmax+1, &read_fds, NULL, NULL, &tv) == -1)
+	vector<int> ready_sockets;
+	if (wait_for_sockets(ready_sockets, 1000) == -1)
 	{
 		// there are no slaves available.  W need to keep listening until at least one appears
 		got_message = true;
 		return got_message;
 	}
-	// run through the existing connections looking for data to read
-	for(int i = 0; i <= fdmax; i++) {
-		if (FD_ISSET(i, &read_fds)) { // we got one!!
-			got_message = true;
-			if (i == listener)  // handle new connections
+	// run through the connections that have data to read
+	for (int i : ready_sockets) {
+		got_message = true;
+		if (i == listener)  // handle new connections
+		{
+			int newfd;
+			addr_len = sizeof remote_addr;
+			newfd = w_accept(listener,(struct sockaddr *)&remote_addr, &addr_len);
+			if (newfd == -1) {}
+			else
 			{
-				int newfd;
-				addr_len = sizeof remote_addr;
-				newfd = w_accept(listener,(struct sockaddr *)&remote_addr, &addr_len);
-				if (newfd == -1) {}
-				else
-				{
-					add_slave(newfd);
-				}
+				add_slave(newfd);
 			}
-			else  // handle data from a client
-			{
-				//set the ping flag since the slave sent something back
-				list<SlaveInfoRec>::iterator iter = socket_to_iter_map.at(i);
-				iter->set_ping(false);
-				process_message(i);
-			} // END handle data from client
-		} // END got new incoming connection
-	} // END looping through file descriptors
+		}
+		else if (socket_to_iter_map.count(i) > 0) // handle data from a client
+		{
+			//set the ping flag since the slave sent something back
+			list<SlaveInfoRec>::iterator iter = socket_to_iter_map.at(i);
+			iter->set_ping(false);
+			process_message(i);
+		} // END handle data from client
+	} // END looping through ready sockets
 	return got_message;
 }
 
@@ -646,32 +968,44 @@ void RunManagerPanther::close_slaves()
 	}
 }
 
-void RunManagerPanther::close_slave(int i_sock)
+void RunManagerPanther::close_slave(list<SlaveInfoRec>::iterator slave_info_iter)
 {
-	list<SlaveInfoRec>::iterator slave_info_iter = socket_to_iter_map.at(i_sock);
-	close_slave(slave_info_iter);
+	close_slave(slave_info_iter->get_socket_fd());
 }
 
-void RunManagerPanther::close_slave(list<SlaveInfoRec>::iterator slave_info_iter)
+void RunManagerPanther::close_slave(int i_sock)
 {
-	int i_sock = slave_info_iter->get_socket_fd();
-	int run_id = slave_info_iter->get_run_id();
-	SlaveInfoRec::State state = slave_info_iter->get_state();
+	vector<list<SlaveInfoRec>::iterator> slot_iters;
+	auto slots_iter = socket_to_slots_map.find(i_sock);
+	if (slots_iter != socket_to_slots_map.end())
+	{
+		slot_iters = slots_iter->second;
+		socket_to_slots_map.erase(slots_iter);
+	}
+	else
+	{
+		slot_iters.push_back(socket_to_iter_map.at(i_sock));
+	}
 
-	string socket_name = slave_info_iter->get_socket_name();
+	string socket_name = slot_iters.front()->get_socket_name();
+	cost_model.remove_slave(i_sock);
+	unwatch_socket(i_sock);
 	w_close(i_sock); // bye!
-	FD_CLR(i_sock, &master); // remove from master set
-	// remove run from active_runid_to_iterset_map
-	unschedule_run(slave_info_iter);
-
-	// check if this run needs to be returned to the waiting queue
-	int n_concurr = get_n_concurrent(run_id);
-	if (run_id != SlaveInfoRec::UNKNOWN_ID &&  slave_info_iter->get_state() == SlaveInfoRec::State::ACTIVE && n_concurr == 0)
+	for (auto &slave_info_iter : slot_iters)
 	{
-		waiting_runs.push_front(run_id);
-	}
+		int run_id = slave_info_iter->get_run_id();
+		// remove run from active_runid_to_iterset_map
+		unschedule_run(slave_info_iter);
+
+		// check if this run needs to be returned to the waiting queue
+		int n_concurr = get_n_concurrent(run_id);
+		if (run_id != SlaveInfoRec::UNKNOWN_ID &&  slave_info_iter->get_state() == SlaveInfoRec::State::ACTIVE && n_concurr == 0)
+		{
+			waiting_runs.push_front(run_id);
+		}
 
-	slave_info_set.erase(slave_info_iter);
+		slave_info_set.erase(slave_info_iter);
+	}
 	socket_to_iter_map.erase(i_sock);
 
 	stringstream ss;
@@ -686,6 +1020,10 @@ void RunManagerPanther::schedule_runs()
 
 	std::list<list<SlaveInfoRec>::iterator> free_slave_list = get_free_slave_list();
 	int n_responsive_slaves = get_n_responsive_slaves();
+	if (cost_scheduling && !free_slave_list.empty())
+	{
+		sort_waiting_runs();
+	}
 	//first try to schedule waiting runs
 	for (auto it_run = waiting_runs.begin(); !free_slave_list.empty() && it_run != waiting_runs.end();)
 	{
@@ -703,6 +1041,8 @@ void RunManagerPanther::schedule_runs()
 	//check for overdue runs if there are no runs waiting to be processed
 	if (n_no_ops > 0)
 	{
+		//overdue runs are only rescheduled on slaves that can start them immediately
+		free_slave_list = get_free_slave_list(false);
 		try
 		{
 			double duration, avg_runtime;
@@ -714,7 +1054,8 @@ void RunManagerPanther::schedule_runs()
 				it_slave != iter_e; ++it_slave)
 			{
 				SlaveInfoRec::State state = it_slave->get_state();
-				if (state == SlaveInfoRec::State::ACTIVE)
+				// runs that are still queued on a slave can not be overdue
+				if (state == SlaveInfoRec::State::ACTIVE && it_slave->get_run_started())
 				{
 					should_schedule = false;
 					int run_id = it_slave->get_run_id();
@@ -722,7 +1063,8 @@ void RunManagerPanther::schedule_runs()
 					int n_concur = get_n_concurrent(run_id);
 
 					duration = it_slave->get_duration_minute();
-					avg_runtime = it_slave->get_runtime_minute();
+					avg_runtime = get_expected_runtime_minute(it_slave);
+					if (avg_runtime <= 0) avg_runtime = it_slave->get_runtime_minute();
 					if (avg_runtime <= 0) avg_runtime = global_avg_runtime;
 					if (avg_runtime <= 0) avg_runtime = 1.0E+10;
 					vector<int> overdue_kill_runs_vec = get_overdue_runs_over_kill_threshold(run_id);
@@ -829,6 +1171,7 @@ int RunManagerPanther::schedule_run(int run_id, std::list<list<SlaveInfoRec>::it
 	{
 		// schedule a run on a slave
 		it_slave = free_slave_list.begin();
+		while (it_slave != free_slave_list.end() && slave_has_run(*it_slave, run_id)) ++it_slave;
 		scheduled = -1;
 	}
 	else if (failure_map.count(run_id) + n_concurrent >= n_responsive_slaves)
@@ -836,12 +1179,14 @@ int RunManagerPanther::schedule_run(int run_id, std::list<list<SlaveInfoRec>::it
 		// enough enough slaves to make all failed runs on different slaves
 		// schedule a run on a slave
 		it_slave = free_slave_list.begin();
+		while (it_slave != free_slave_list.end() && slave_has_run(*it_slave, run_id)) ++it_slave;
 		scheduled = -1;
 	}
 	else if (failure_map.count(run_id) > 0)
 	{
 		for (it_slave = free_slave_list.begin(); it_slave != free_slave_list.end(); ++it_slave)
 		{
+			if (slave_has_run(*it_slave, run_id)) continue;
 			int socket_fd = (*it_slave)->get_socket_fd();
 			auto fail_iter_pair = failure_map.equal_range(run_id);
 
@@ -868,6 +1213,8 @@ int RunManagerPanther::schedule_run(int run_id, std::list<list<SlaveInfoRec>::it
 		if (err > 0)
 		{
 			(*it_slave)->set_state(SlaveInfoRec::State::ACTIVE, run_id, cur_group_id);
+			//slaves that can queue runs report when the run actually starts (RUN_STARTED)
+			(*it_slave)->set_run_started(!(*it_slave)->get_can_queue_runs());
 			//start run timer
 			(*it_slave)->start_timer();
 			//reset the last ping time so we don't ping immediately after run is started
@@ -955,6 +1302,18 @@ void RunManagerPanther::process_message(int i_sock)
 		}
 		close_slave(i_sock);
 	}
+	else if ((net_pack.get_type() == NetPackage::PackType::RUN_FINISHED
+		|| net_pack.get_type() == NetPackage::PackType::RUN_FAILED
+		|| net_pack.get_type() == NetPackage::PackType::RUN_KILLED
+		|| net_pack.get_type() == NetPackage::PackType::RUN_STARTED
+		|| net_pack.get_type() == NetPackage::PackType::READY)
+		&& (slave_info_iter = get_slot_iter(i_sock, net_pack.get_group_id(), net_pack.get_run_id())) == slave_info_set.end())
+	{
+		stringstream ss;
+		ss << "received message for unknown run slot from slave: " << host_name << "  (group id:" << net_pack.get_group_id()
+			<< ", run id:" << net_pack.get_run_id() << ") - ignoring message";
+		report(ss.str(), false);
+	}
 	else if (net_pack.get_type() == NetPackage::PackType::CORRUPT_MESG)
 	{
 		report("Slave reporting corrupt message: " + host_name + "$" + slave_info_iter->get_work_dir() + " - terminating slave", false);
@@ -966,8 +1325,14 @@ void RunManagerPanther::process_message(int i_sock)
 		if (good_work_dir)
 		{
 			string work_dir = NetPackage::extract_string(net_pack.get_data(), 0, net_pack.get_data().size());
+			// slaves that can run several models concurrently report the number of run slots in the group id.
+			// Older slaves send 0 and can not queue prefetched runs
+			slave_info_iter->set_n_slots(net_pack.get_group_id());
+			slave_info_iter->set_can_queue_runs(net_pack.get_group_id() > 0);
 			stringstream ss;
 			ss << "initializing new slave connection from: " << socket_name << ", number of slaves: " << socket_to_iter_map.size() << ", working dir: " << work_dir;
+			if (slave_info_iter->get_n_slots() > 1)
+				ss << ", run slots: " << slave_info_iter->get_n_slots();
 			report(ss.str(), false);
 			slave_info_iter->set_work_dir(work_dir);
 			slave_info_iter->set_state(SlaveInfoRec::State::CWD_RCV);
@@ -991,6 +1356,16 @@ void RunManagerPanther::process_message(int i_sock)
 		// ready message received from slave
 		slave_info_iter->set_state(SlaveInfoRec::State::WAITING);
 	}
+	else if (net_pack.get_type() == NetPackage::PackType::RUN_STARTED)
+	{
+		// the slave started a run that it had queued.  Time the run from here so the overdue
+		// checks and run time averages do not include the time spent in the slave's queue
+		if (net_pack.get_group_id() == cur_group_id && slave_info_iter->get_state() == SlaveInfoRec::State::ACTIVE)
+		{
+			slave_info_iter->start_timer();
+			slave_info_iter->set_run_started(true);
+		}
+	}
 
 	else if ( (net_pack.get_type() == NetPackage::PackType::RUN_FINISHED
 		|| net_pack.get_type() == NetPackage::PackType::RUN_FAILED
@@ -1022,13 +1397,17 @@ void RunManagerPanther::process_message(int i_sock)
 		else
 		{
 			// keep track of model run time
+			double run_sec = slave_info_iter->get_duration_sec();
 			slave_info_iter->end_run();
 			stringstream ss;
 			ss << "run " << run_id << " received from: " << host_name << "$" << slave_info_iter->get_work_dir() <<
 				"  (run time:" << slave_info_iter->get_runtime_minute() << " min, avg run time:" << get_global_runtime_minute() << " min, group id:" << group_id <<
 				", run id: " << run_id << " concurrent:" << get_n_concurrent(run_id) << ")";
 			report(ss.str(), false);
-			process_model_run(i_sock, net_pack);
+			if (process_model_run(slave_info_iter, net_pack) && cost_scheduling)
+			{
+				cost_model.add_observation(run_id, i_sock, run_sec);
+			}
 		}
 
 
@@ -1047,8 +1426,7 @@ void RunManagerPanther::process_message(int i_sock)
 			report(ss.str(), false);
 			model_runs_failed++;
 			update_run_failed(run_id, i_sock);
-			auto it = get_active_run_iter(i_sock);
-			unschedule_run(it);
+			unschedule_run(slave_info_iter);
 			n_concur = get_n_concurrent(run_id);
 			if (n_concur == 0 && (failure_map.count(run_id) < max_n_failure))
 			{
@@ -1062,8 +1440,7 @@ void RunManagerPanther::process_message(int i_sock)
 		int run_id = net_pack.get_run_id();
 		int group_id = net_pack.get_group_id();
 		int n_concur = get_n_concurrent(run_id);
-		auto it = get_active_run_iter(i_sock);
-		unschedule_run(it);
+		unschedule_run(slave_info_iter);
 		stringstream ss;
 		ss << "Run " << run_id << " killed on slave: " << host_name << "$" << slave_info_iter->get_work_dir() << ", run id:" << run_id << " concurrent: " << n_concur;
 		report(ss.str(), false);
@@ -1088,20 +1465,45 @@ void RunManagerPanther::process_message(int i_sock)
 	}
 }
 
-bool RunManagerPanther::process_model_run(int sock_id, NetPackage &net_pack)
+bool RunManagerPanther::process_model_run(list<SlaveInfoRec>::iterator slave_info_iter, NetPackage &net_pack)
 {
-	list<SlaveInfoRec>::iterator slave_info_iter = socket_to_iter_map.at(sock_id);
+	int sock_id = slave_info_iter->get_socket_fd();
 	bool use_run = false;
 	int run_id = net_pack.get_run_id();
 
 	//check if another instance of this model run has already completed
 	if (!run_finished(run_id))
 	{
-		Parameters pars;
-		Observations obs;
-		double run_time = 0;
-		Serialization::unserialize(net_pack.get_data(), pars, get_par_name_vec(), obs, get_obs_name_vec(), run_time);
-		file_stor.update_run(run_id, pars, obs);
+		// The run results are sent as the parameter values followed by the observation values (in the
+		// order of the PAR_NAMES and OBS_NAMES messages) and the run time.  This is the same layout that
+		// is used in the run storage file so the values can be stored without building Parameters and
+		// Observations.  Agents running with OBS_STORAGE_PRECISION(single) send the observation values
+		// as floats; the run storage converts them to its own precision if needed.
+		const vector<int8_t> &run_data = net_pack.get_data();
+		size_t n_par_bytes = get_par_name_vec().size() * sizeof(double);
+		size_t n_data_bytes = n_par_bytes + get_obs_name_vec().size() * sizeof(double);
+		size_t n_single_data_bytes = n_par_bytes + get_obs_name_vec().size() * sizeof(float);
+		if (run_data.size() == n_data_bytes + sizeof(double) || run_data.size() == n_single_data_bytes + sizeof(double))
+		{
+			file_stor.update_run(run_id, reinterpret_cast<const char*>(run_data.data()), run_data.size() - sizeof(double));
+		}
+		else
+		{
+			// the results do not match the parameters and observations of this run.  Treat it as a failed run
+			stringstream ss;
+			ss << "run results of unexpected size received from slave: " << slave_info_iter->get_hostname() << "$" << slave_info_iter->get_work_dir()
+				<< " (run id:" << run_id << ", expected " << n_data_bytes + sizeof(double) << " bytes, received " << run_data.size() << " bytes)";
+			report(ss.str(), true);
+			model_runs_failed++;
+			update_run_failed(run_id, sock_id);
+			unschedule_run(slave_info_iter);
+			if (get_n_concurrent(run_id) == 0 && (failure_map.count(run_id) < max_n_failure))
+			{
+				//put model run back into the waiting queue
+				waiting_runs.push_front(run_id);
+			}
+			return use_run;
+		}
 		slave_info_iter->set_state(SlaveInfoRec::State::COMPLETE);
 		//slave_info_iter->set_state(SlaveInfoRec::State::WAITING);
 		use_run = true;
@@ -1109,8 +1511,7 @@ bool RunManagerPanther::process_model_run(int sock_id, NetPackage &net_pack)
 
 	}
 	// remove currently completed run from the active list
-	auto it = get_active_run_iter(sock_id);
-	unschedule_run(it);
+	unschedule_run(slave_info_iter);
 	kill_runs(run_id, false, "completed on alternative node");
 	return use_run;
 }
@@ -1130,7 +1531,7 @@ void RunManagerPanther::kill_run(list<SlaveInfoRec>::iterator slave_info_iter, c
 		ss << "sending kill request. reason: " << reason << ", run id:" << run_id;
 		ss<< ",  num previous fails:" << failure_map.count(run_id) << ", slave: " << host_name << "$" << slave_info_iter->get_work_dir();
 		report(ss.str(), false);
-		NetPackage net_pack(NetPackage::PackType::REQ_KILL, 0, 0, "");
+		NetPackage net_pack(NetPackage::PackType::REQ_KILL, slave_info_iter->get_group_id(), run_id, "");
 		char data = '\0';
 		int err = net_pack.send(socket_id, &data, sizeof(data));
 		if (err == 1)
@@ -1161,7 +1562,8 @@ void RunManagerPanther::kill_runs(int run_id, bool update_failure_map, const str
 	for (auto &iter : kill_list)
 	{
 		kill_run(iter, reason);
-		if (update_failure_map) update_run_failed(run_id, iter->get_socket_fd());
+		// runs that were still queued on the slave have not failed
+		if (update_failure_map && iter->get_run_started()) update_run_failed(run_id, iter->get_socket_fd());
 	}
 }
 
@@ -1192,6 +1594,7 @@ void RunManagerPanther::kill_all_active_runs()
 
  void RunManagerPanther::init_slaves()
  {
+	 vector<int> new_slot_socks;
 	 for (auto &i_slv : slave_info_set)
 	 {
 		int i_sock = i_slv.get_socket_fd();
@@ -1241,8 +1644,13 @@ void RunManagerPanther::kill_all_active_runs()
 		else if (cur_state == SlaveInfoRec::State::LINPACK_RCV)
 		{
 			i_slv.set_state(SlaveInfoRec::State::WAITING);
+			new_slot_socks.push_back(i_sock);
 		}
 	}
+	for (int i_sock : new_slot_socks)
+	{
+		add_slave_slots(i_sock);
+	}
  }
 
  vector<int> RunManagerPanther::get_overdue_runs_over_kill_threshold(int run_id)
@@ -1253,10 +1661,11 @@ void RunManagerPanther::kill_all_active_runs()
 	 double duration;
 	 for (auto &i = range_pair.first; i != range_pair.second; ++i)
 	 {
-		 if (i->second->get_state() == SlaveInfoRec::State::ACTIVE)
+		 if (i->second->get_state() == SlaveInfoRec::State::ACTIVE && i->second->get_run_started())
 		 {
-			 double avg_runtime = i->second->get_runtime_minute();
-			 if (avg_runtime <= 0) avg_runtime = get_global_runtime_minute();;
+			 double avg_runtime = get_expected_runtime_minute(i->second);
+			 if (avg_runtime <= 0) avg_runtime = i->second->get_runtime_minute();
+			 if (avg_runtime <= 0) avg_runtime = get_global_runtime_minute();
 			 if (avg_runtime <= 0) avg_runtime = 1.0E+10;
 			 duration = i->second->get_duration_minute();
 			 if ((duration > overdue_giveup_minutes) || (duration >= avg_runtime*overdue_giveup_fac))
@@ -1292,10 +1701,14 @@ void RunManagerPanther::kill_all_active_runs()
 	 stringstream ss;
 	 ss << "new connection from: " << w_getnameinfo_string(sock_id);
 	 report(ss.str(), false);
-	 FD_SET(sock_id, &master); // add to master set
-	 if (sock_id > fdmax) { // keep track of the max
-		 fdmax = sock_id;
-	 }
+#ifdef OS_LINUX
+	 // do not let a slave that stops reading block the master indefinitely
+	 timeval send_tv;
+	 send_tv.tv_sec = 60;
+	 send_tv.tv_usec = 0;
+	 setsockopt(sock_id, SOL_SOCKET, SO_SNDTIMEO, &send_tv, sizeof(send_tv));
+#endif
+	 watch_socket(sock_id);
 
 	 //list<SlaveInfoRec>::iterator
 	slave_info_set.push_back(SlaveInfoRec(sock_id));
@@ -1304,6 +1717,74 @@ void RunManagerPanther::kill_all_active_runs()
 	return iter;
  }
 
+ void RunManagerPanther::add_slave_slots(int sock_id)
+ {
+	 // add a SlaveInfoRec for each additional run slot of the slave.  Runs are scheduled on the
+	 // slots independently and the slave reports back the group and run id of the slot that finished
+	 // Prefetched runs also get a SlaveInfoRec of their own
+	 list<SlaveInfoRec>::iterator first_slot = socket_to_iter_map.at(sock_id);
+	 int n_slots = first_slot->get_n_slots();
+	 int n_recs = n_slots;
+	 if (first_slot->get_can_queue_runs())
+		 n_recs += prefetch_depth;
+	 if (n_recs <= 1)
+		 return;
+	 vector<list<SlaveInfoRec>::iterator> &slot_iters = socket_to_slots_map[sock_id];
+	 slot_iters.clear();
+	 slot_iters.push_back(first_slot);
+	 string work_dir = first_slot->get_work_dir();
+	 for (int i = 1; i < n_recs; ++i)
+	 {
+		 slave_info_set.push_back(*first_slot);
+		 list<SlaveInfoRec>::iterator iter = std::prev(slave_info_set.end());
+		 stringstream ss;
+		 if (i < n_slots)
+			 ss << work_dir << "[slot " << i << "]";
+		 else
+			 ss << work_dir << "[prefetch " << i - n_slots + 1 << "]";
+		 iter->set_work_dir(ss.str());
+		 iter->set_state(SlaveInfoRec::State::WAITING);
+		 slot_iters.push_back(iter);
+	 }
+	 stringstream ss;
+	 ss << "slave " << first_slot->get_socket_name() << "$" << work_dir << " ready with " << n_slots << " run slots";
+	 if (n_recs > n_slots)
+		 ss << " and a prefetch depth of " << n_recs - n_slots;
+	 report(ss.str(), false);
+ }
+
+ double RunManagerPanther::get_expected_runtime_minute(list<SlaveInfoRec>::iterator slave_info_iter)
+ {
+	 // predicted run time of the slave's current run scaled by the requested quantile of the ratio of
+	 // observed to predicted run times.  Returns -1 if cost scheduling is off or nothing is known yet
+	 if (!cost_scheduling)
+		 return -1.0;
+	 double predicted = cost_model.predict(slave_info_iter->get_run_id(), slave_info_iter->get_socket_fd());
+	 if (predicted <= 0.0)
+		 return -1.0;
+	 return predicted * cost_model.get_ratio_quantile(overdue_quantile) / 60.0;
+ }
+
+ void RunManagerPanther::sort_waiting_runs()
+ {
+	 // longest processing time first: start the runs that are expected to take the longest first so
+	 // they do not end up in the tail of the run group.  Runs with the same cost keep their order
+	 if (cost_model.empty())
+		 return;
+	 vector<pair<double, int> > cost_vec;
+	 cost_vec.reserve(waiting_runs.size());
+	 for (int run_id : waiting_runs)
+	 {
+		 cost_vec.push_back(make_pair(cost_model.predict(run_id), run_id));
+	 }
+	 stable_sort(cost_vec.begin(), cost_vec.end(),
+		 [](const pair<double, int> &a, const pair<double, int> &b) { return a.first > b.first; });
+	 for (size_t i = 0; i < cost_vec.size(); ++i)
+	 {
+		 waiting_runs[i] = cost_vec[i].second;
+	 }
+ }
+
  double RunManagerPanther::get_global_runtime_minute() const
  {
 	 double global_runtime = 0;
@@ -1342,18 +1823,54 @@ void RunManagerPanther::kill_all_active_runs()
 	 }
  }
 
- list<list<SlaveInfoRec>::iterator> RunManagerPanther::get_free_slave_list()
+ list<list<SlaveInfoRec>::iterator> RunManagerPanther::get_free_slave_list(bool include_prefetch)
  {
+	 // slaves that have an idle run slot are listed first so runs are only
+	 // prefetched (queued on a busy slave) if there is no idle slave
 	 list<list<SlaveInfoRec>::iterator> iter_list;
+	 list<list<SlaveInfoRec>::iterator> prefetch_list;
+	 map<int, int> n_busy_map;
 	 list<SlaveInfoRec>::iterator iter_b, iter_e;
+	 for (iter_b = slave_info_set.begin(), iter_e = slave_info_set.end();
+		 iter_b != iter_e; ++iter_b)
+	 {
+		 if (iter_b->get_state() == SlaveInfoRec::State::ACTIVE)
+		 {
+			 ++n_busy_map[iter_b->get_socket_fd()];
+		 }
+	 }
 	 for (iter_b = slave_info_set.begin(), iter_e = slave_info_set.end();
 		 iter_b != iter_e; ++iter_b)
 	 {
 		 SlaveInfoRec::State cur_state = iter_b->get_state();
 		 if (cur_state == SlaveInfoRec::State::WAITING)
 		 {
-			 iter_list.push_back(iter_b);
+			 int &n_busy = n_busy_map[iter_b->get_socket_fd()];
+			 if (n_busy < iter_b->get_n_slots())
+			 {
+				 iter_list.push_back(iter_b);
+				 ++n_busy;
+			 }
+			 else
+			 {
+				 prefetch_list.push_back(iter_b);
+			 }
+		 }
+	 }
+	 if (cost_scheduling)
+	 {
+		 // fastest slaves first
+		 iter_list.sort([this](const list<SlaveInfoRec>::iterator &a, const list<SlaveInfoRec>::iterator &b)
+			 { return cost_model.get_speed(a->get_socket_fd()) < cost_model.get_speed(b->get_socket_fd()); });
+	 }
+	 if (include_prefetch)
+	 {
+		 if (cost_scheduling)
+		 {
+			 prefetch_list.sort([this](const list<SlaveInfoRec>::iterator &a, const list<SlaveInfoRec>::iterator &b)
+				 { return cost_model.get_speed(a->get_socket_fd()) < cost_model.get_speed(b->get_socket_fd()); });
 		 }
+		 iter_list.splice(iter_list.end(), prefetch_list);
 	 }
 	 return iter_list;
  }
@@ -1404,7 +1921,10 @@ void RunManagerPanther::kill_all_active_runs()
 	 int n = 0;
 	 for (const auto &i : slave_info_set)
 	 {
-		 if (i.get_failed_pings() < N_PINGS_UNRESPONSIVE) ++n;
+		 // only the first slot of a slave is pinged
+		 auto iter = socket_to_iter_map.find(i.get_socket_fd());
+		 int failed_pings = (iter != socket_to_iter_map.end()) ? iter->second->get_failed_pings() : i.get_failed_pings();
+		 if (failed_pings < N_PINGS_UNRESPONSIVE) ++n;
 	 }
 	 return n;
  }
@@ -1426,20 +1946,32 @@ RunManagerPanther::~RunManagerPanther(void)
 {
 	//close sockets and cleanup
 	int err;
+	unwatch_socket(listener);
 	err = w_close(listener);
-	FD_CLR(listener, &master);
 	// this is needed to ensure that the first slave closes properly
 	w_sleep(2000);
+	vector<int> sock_nums;
+#ifdef OS_WIN
 	for(int i = 0; i <= fdmax; i++) {
 		if (FD_ISSET(i, &master))
-		{
-			NetPackage netpack(NetPackage::PackType::TERMINATE, 0, 0,"");
-			char data;
-			netpack.send(i, &data, 0);
-			err = w_close(i);
-			FD_CLR(i, &master);
-		}
+			sock_nums.push_back(i);
 	}
+#endif
+#ifdef OS_LINUX
+	for (auto &si : socket_to_iter_map)
+		sock_nums.push_back(si.first);
+#endif
+	for (int i : sock_nums)
+	{
+		NetPackage netpack(NetPackage::PackType::TERMINATE, 0, 0,"");
+		char data;
+		netpack.send(i, &data, 0);
+		unwatch_socket(i);
+		err = w_close(i);
+	}
+#ifdef OS_LINUX
+	close(epoll_fd);
+#endif
 	w_cleanup();
 }
 
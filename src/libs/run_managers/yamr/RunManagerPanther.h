@@ -49,6 +49,12 @@ public:
 	void set_state(const State &_state, int run_id, int group_id);
 	void set_work_dir(const std::string & wkd);
 	std::string get_work_dir() const;
+	int get_n_slots() const;
+	void set_n_slots(int _n_slots);
+	bool get_can_queue_runs() const;
+	void set_can_queue_runs(bool _can_queue_runs);
+	bool get_run_started() const;
+	void set_run_started(bool _run_started);
 	void start_timer();
 	void end_run();
 	void end_linpack();
@@ -73,6 +79,9 @@ private:
 	int group_id;
 	bool ping;
 	int failed_pings;
+	int n_slots;
+	bool can_queue_runs;
+	bool run_started;
 	State state;
 	std::chrono::system_clock::duration linpack_time;
 	std::chrono::system_clock::duration run_time;
@@ -89,11 +98,49 @@ public:
 	};
 };
 
+class RunCostModel
+{
+	// Learns the expected run time of model runs from the runs that have completed.  Runs are grouped
+	// by a cost key (the info_txt of the run, e.g. the perturbed parameter of a jacobian run or the
+	// realization name of an ensemble run) and each slave has a relative speed factor (1.0 = average,
+	// larger = slower).  The predicted time of a run on a slave is the cost of its key times the speed
+	// factor of the slave.  Cost keys are kept across run groups so costs learned in one iteration are
+	// used in the next.
+public:
+	RunCostModel();
+	void add_run(int run_id, const std::string &cost_key);
+	void clear_runs();
+	void add_observation(int run_id, int socket_fd, double runtime_sec);
+	void remove_slave(int socket_fd);
+	// predicted run time in seconds independent of the slave or <= 0 if nothing is known yet
+	double predict(int run_id) const;
+	double predict(int run_id, int socket_fd) const;
+	double get_speed(int socket_fd) const;
+	// quantile of the ratio of observed to predicted run times or 1.0 if nothing is known yet
+	double get_ratio_quantile(double q) const;
+	int get_n_keys() const { return key_costs.size(); }
+	bool empty() const { return n_obs == 0; }
+private:
+	static const double smoothing;
+	static const size_t max_ratios;
+	std::unordered_map<std::string, int> key_ids;
+	std::vector<double> key_costs;
+	std::vector<int> run_key_ids;
+	std::unordered_map<int, double> slave_speeds;
+	std::deque<double> ratios;
+	double mean_cost;
+	int n_obs;
+	mutable double cached_q;
+	mutable double cached_quantile;
+	int get_key_id(int run_id) const;
+};
+
 class RunManagerPanther : public RunManagerAbstract
 {
 public:
 	RunManagerPanther(const std::string &stor_filename, const std::string &port, std::ofstream &_f_rmr, int _max_n_failure,
-		double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes);
+		double overdue_reched_fac, double overdue_giveup_fac, double overdue_giveup_minutes, int _prefetch_depth = 0,
+		bool _cost_scheduling = false, double _overdue_quantile = 0.9);
 	virtual void initialize(const Parameters &model_pars, const Observations &obs, const std::string &_filename = std::string(""));
 	virtual void initialize_restart(const std::string &_filename);
 	virtual void reinitialize(const std::string &_filename = std::string(""));
@@ -102,7 +149,10 @@ public:
 	virtual int add_run(const std::vector<double> &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
 	virtual int add_run(const Eigen::VectorXd &model_pars, const std::string &info_txt="", double info_valuee=RunStorage::no_data);
 	virtual void update_run(int run_id, const Parameters &pars, const Observations &obs);
+	virtual void cancel_run(int run_id);
 	virtual void run();
+	// when run_until() returns early the runs that are active on the slaves are left running and
+	// the next call picks up where this one stopped
 	virtual RunManagerAbstract::RUN_UNTIL_COND run_until(RUN_UNTIL_COND condition, int n_nops = 0, double sec = 0.0);
 	~RunManagerPanther(void);
 	int get_n_waiting_runs() { return waiting_runs.size(); }
@@ -121,16 +171,36 @@ private:
 	double overdue_reched_fac;
 	double overdue_giveup_fac;
 	double overdue_giveup_minutes;
+	// number of runs that are sent to a slave ahead of time and queued there while its run slots are busy
+	int prefetch_depth;
+	// with cost scheduling the longest expected runs are sent first to the fastest slaves and the
+	// overdue thresholds are based on the predicted run time and a quantile of the prediction error
+	bool cost_scheduling;
+	double overdue_quantile;
+	RunCostModel cost_model;
 	int max_concurrent_runs;
 	int n_no_ops;  //number of consecutive times tcp/ip has looked for slave communciations and not found any
 	int listener;
-	int fdmax;
 	int model_runs_done;
 	int model_runs_failed;
 	int model_runs_timed_out;
+	// true while a run group is being worked on by run_until() calls that returned early
+	bool resume_run_until;
+#ifdef OS_WIN
+	int fdmax;
 	fd_set master; // master file descriptor list
+#endif
+#ifdef OS_LINUX
+	// epoll is used on linux so the number of slaves is not limited by FD_SETSIZE and the cost
+	// of waiting for messages does not grow with the largest socket descriptor
+	int epoll_fd;
+	static const int MAX_EPOLL_EVENTS;
+#endif
 	list<SlaveInfoRec> slave_info_set;
 	map<int, list<SlaveInfoRec>::iterator> socket_to_iter_map;
+	// slaves that run several models concurrently have one SlaveInfoRec per run slot.  All the slots
+	// share the slave's socket; socket_to_iter_map points to the first slot which is also used for pings
+	map<int, vector<list<SlaveInfoRec>::iterator> > socket_to_slots_map;
 	multimap<int, list<SlaveInfoRec>::iterator> active_runid_to_iterset_map;
 	std::deque<int> waiting_runs;
 	std::unordered_multimap<int, int> failure_map;
@@ -145,11 +215,16 @@ private:
 
 	std::ofstream &f_rmr;
 	bool listen();
-	bool process_model_run(int sock_id, NetPackage &net_pack);
+	void watch_socket(int sock_id);
+	void unwatch_socket(int sock_id);
+	bool is_watched_socket(int sock_id);
+	int wait_for_sockets(std::vector<int> &ready_sockets, int timeout_ms);
+	bool process_model_run(list<SlaveInfoRec>::iterator slave_info_iter, NetPackage &net_pack);
 	void process_message(int i);
 	void schedule_runs();
 	void init_slaves();
 	list<SlaveInfoRec>::iterator add_slave(int sock_id);
+	void add_slave_slots(int sock_id);
 	void erase_slave(int sock_id);
 	bool ping(int i_sock);
 	bool ping();
@@ -160,8 +235,12 @@ private:
 	vector<int> get_overdue_runs_over_kill_threshold(int run_id);
 	bool all_runs_complete();
 	list<SlaveInfoRec>::iterator get_active_run_iter(int socket);
-	std::list<std::list<SlaveInfoRec>::iterator> get_free_slave_list();
+	list<SlaveInfoRec>::iterator get_slot_iter(int socket, int group_id, int run_id);
+	bool slave_has_run(list<SlaveInfoRec>::iterator slave_info_iter, int run_id);
+	std::list<std::list<SlaveInfoRec>::iterator> get_free_slave_list(bool include_prefetch = true);
 	double get_global_runtime_minute() const;
+	double get_expected_runtime_minute(list<SlaveInfoRec>::iterator slave_info_iter);
+	void sort_waiting_runs();
 	int get_n_concurrent(int run_id);
 	int get_n_unique_failures();
 	int get_n_responsive_slaves();
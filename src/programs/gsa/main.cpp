@@ -36,6 +36,7 @@
 #include "FileManager.h"
 #include "RunManagerGenie.h"
 #include "RunManagerSerial.h"
+#include "RunManagerLocal.h"
 #include "OutputFileWriter.h"
 #include "PantherSlave.h"
 #include "Serialization.h"
@@ -226,7 +227,10 @@ int main(int argc, char* argv[])
 			pest_scenario.get_pestpp_options().get_max_run_fail(),
 			pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
 			pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
-			pest_scenario.get_pestpp_options().get_overdue_giveup_minutes());
+			pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+			pest_scenario.get_pestpp_options().get_panther_prefetch_depth(),
+			pest_scenario.get_pestpp_options().get_panther_cost_scheduling(),
+			pest_scenario.get_pestpp_options().get_panther_overdue_quantile());
 	}
 	else if (run_manager_type == RunManagerType::GENIE)
 	{
@@ -240,9 +244,19 @@ int main(int argc, char* argv[])
 	else
 	{
 		const ModelExecInfo &exi = pest_scenario.get_model_exec_info();
-		run_manager_ptr = new RunManagerSerial(exi.comline_vec,
-		exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
-		file_manager.build_filename("rns"), pathname);
+		if (pest_scenario.get_pestpp_options().get_local_num_workers() != 1)
+		{
+			run_manager_ptr = new RunManagerLocal(exi.comline_vec,
+			exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+			file_manager.build_filename("rns"), pathname,
+			pest_scenario.get_pestpp_options().get_local_num_workers());
+		}
+		else
+		{
+			run_manager_ptr = new RunManagerSerial(exi.comline_vec,
+			exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+			file_manager.build_filename("rns"), pathname);
+		}
 	}
 
 	cout << endl;
@@ -419,6 +433,11 @@ int main(int argc, char* argv[])
 		gsa_method->set_seed(seed);
 	}
 
+	run_manager_ptr->set_run_storage_mmap(pest_scenario.get_pestpp_options().get_run_storage_mmap());
+	run_manager_ptr->set_run_storage_write_behind(pest_scenario.get_pestpp_options().get_run_storage_write_behind());
+	run_manager_ptr->set_run_storage_single_precision_obs(pest_scenario.get_pestpp_options().get_obs_storage_precision() == "single");
+	run_manager_ptr->set_cpp_tpl_writer(pest_scenario.get_pestpp_options().get_tpl_writer() == "cpp");
+	run_manager_ptr->set_cpp_ins_reader(pest_scenario.get_pestpp_options().get_ins_reader() == "cpp");
 	// make model runs
 	if (gsa_restart == GSA_RESTART::NONE)
 	{
@@ -36,6 +36,7 @@
 #include "TerminationController.h"
 #include "RunManagerGenie.h"
 #include "RunManagerSerial.h"
+#include "RunManagerLocal.h"
 #include "RunManagerExternal.h"
 #include "SVD_PROPACK.h"
 #include "OutputFileWriter.h"
@@ -325,7 +326,10 @@ int main(int argc, char* argv[])
 					pest_scenario.get_pestpp_options().get_max_run_fail(),
 					pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
 					pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
-					pest_scenario.get_pestpp_options().get_overdue_giveup_minutes());
+					pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+					pest_scenario.get_pestpp_options().get_panther_prefetch_depth(),
+					pest_scenario.get_pestpp_options().get_panther_cost_scheduling(),
+					pest_scenario.get_pestpp_options().get_panther_overdue_quantile());
 			}
 		}
 		else if (run_manager_type == RunManagerType::GENIE)
@@ -353,10 +357,21 @@ int main(int argc, char* argv[])
 			performance_log.log_event("finished basic model IO error checking");
 			cout << "done" << endl;
 			const ModelExecInfo &exi = pest_scenario.get_model_exec_info();
-			run_manager_ptr = new RunManagerSerial(exi.comline_vec,
-				exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
-				file_manager.build_filename("rns"), pathname,
-				pest_scenario.get_pestpp_options().get_max_run_fail());
+			if (pest_scenario.get_pestpp_options().get_local_num_workers() != 1)
+			{
+				run_manager_ptr = new RunManagerLocal(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					file_manager.build_filename("rns"), pathname,
+					pest_scenario.get_pestpp_options().get_local_num_workers(),
+					pest_scenario.get_pestpp_options().get_max_run_fail());
+			}
+			else
+			{
+				run_manager_ptr = new RunManagerSerial(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					file_manager.build_filename("rns"), pathname,
+					pest_scenario.get_pestpp_options().get_max_run_fail());
+			}
 		}
 
 		//setup the parcov, if needed
@@ -422,6 +437,11 @@ int main(int argc, char* argv[])
 		//Allocates Space for Run Manager.  This initializes the model parameter names and observations names.
 		//Neither of these will change over the course of the simulation
 
+		run_manager_ptr->set_run_storage_mmap(pest_scenario.get_pestpp_options().get_run_storage_mmap());
+		run_manager_ptr->set_run_storage_write_behind(pest_scenario.get_pestpp_options().get_run_storage_write_behind());
+		run_manager_ptr->set_run_storage_single_precision_obs(pest_scenario.get_pestpp_options().get_obs_storage_precision() == "single");
+		run_manager_ptr->set_cpp_tpl_writer(pest_scenario.get_pestpp_options().get_tpl_writer() == "cpp");
+		run_manager_ptr->set_cpp_ins_reader(pest_scenario.get_pestpp_options().get_ins_reader() == "cpp");
 		if (restart_ctl.get_restart_option() == RestartController::RestartOption::RESUME_JACOBIAN_RUNS)
 		{
 			run_manager_ptr->initialize_restart(file_manager.build_filename("rnj"));
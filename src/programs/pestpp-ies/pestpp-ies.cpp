@@ -17,6 +17,7 @@
 #include "ModelRunPP.h"
 #include "FileManager.h"
 #include "RunManagerSerial.h"
+#include "RunManagerLocal.h"
 #include "OutputFileWriter.h"
 #include "PantherSlave.h"
 #include "Serialization.h"
@@ -291,7 +292,10 @@ int main(int argc, char* argv[])
 				pest_scenario.get_pestpp_options().get_max_run_fail(),
 				pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
 				pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
-				pest_scenario.get_pestpp_options().get_overdue_giveup_minutes());
+				pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+				pest_scenario.get_pestpp_options().get_panther_prefetch_depth(),
+				pest_scenario.get_pestpp_options().get_panther_cost_scheduling(),
+				pest_scenario.get_pestpp_options().get_panther_overdue_quantile());
 		}
 		else
 		{
@@ -302,10 +306,21 @@ int main(int argc, char* argv[])
 			performance_log.log_event("finished basic model IO error checking");
 			cout << "done" << endl;
 			const ModelExecInfo &exi = pest_scenario.get_model_exec_info();
-			run_manager_ptr = new RunManagerSerial(exi.comline_vec,
-				exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
-				rns_file, pathname,
-				pest_scenario.get_pestpp_options().get_max_run_fail());
+			if (pest_scenario.get_pestpp_options().get_local_num_workers() != 1)
+			{
+				run_manager_ptr = new RunManagerLocal(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					rns_file, pathname,
+					pest_scenario.get_pestpp_options().get_local_num_workers(),
+					pest_scenario.get_pestpp_options().get_max_run_fail());
+			}
+			else
+			{
+				run_manager_ptr = new RunManagerSerial(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					rns_file, pathname,
+					pest_scenario.get_pestpp_options().get_max_run_fail());
+			}
 		}
 
 
@@ -317,6 +332,11 @@ int main(int argc, char* argv[])
 		//Neither of these will change over the course of the simulation
 
 
+		run_manager_ptr->set_run_storage_mmap(pest_scenario.get_pestpp_options().get_run_storage_mmap());
+		run_manager_ptr->set_run_storage_write_behind(pest_scenario.get_pestpp_options().get_run_storage_write_behind());
+		run_manager_ptr->set_run_storage_single_precision_obs(pest_scenario.get_pestpp_options().get_obs_storage_precision() == "single");
+		run_manager_ptr->set_cpp_tpl_writer(pest_scenario.get_pestpp_options().get_tpl_writer() == "cpp");
+		run_manager_ptr->set_cpp_ins_reader(pest_scenario.get_pestpp_options().get_ins_reader() == "cpp");
 		run_manager_ptr->initialize(base_trans_seq.ctl2model_cp(cur_ctl_parameters), pest_scenario.get_ctl_observations());
 
 		IterEnsembleSmoother ies(pest_scenario, file_manager, output_file_writer, &performance_log, run_manager_ptr);
@@ -23,6 +23,7 @@ along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
 #include <fstream>
 #include <algorithm>
 #include <iterator>
+#include <memory>
 #include "config_os.h"
 #include "Pest.h"
 #include "Transformable.h"
@@ -33,6 +34,7 @@ along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
 #include "ModelRunPP.h"
 #include "FileManager.h"
 #include "RunManagerSerial.h"
+#include "RunManagerLocal.h"
 #include "OutputFileWriter.h"
 #include "PantherSlave.h"
 #include "Serialization.h"
@@ -43,6 +45,7 @@ along with PEST++.  If not, see<http://www.gnu.org/licenses/>.
 #include "debug.h"
 #include "logger.h"
 #include "Jacobian.h"
+#include "dense_binary.h"
 
 
 using namespace std;
@@ -522,7 +525,10 @@ int main(int argc, char* argv[])
 				pest_scenario.get_pestpp_options().get_max_run_fail(),
 				pest_scenario.get_pestpp_options().get_overdue_reched_fac(),
 				pest_scenario.get_pestpp_options().get_overdue_giveup_fac(),
-				pest_scenario.get_pestpp_options().get_overdue_giveup_minutes());
+				pest_scenario.get_pestpp_options().get_overdue_giveup_minutes(),
+				pest_scenario.get_pestpp_options().get_panther_prefetch_depth(),
+				pest_scenario.get_pestpp_options().get_panther_cost_scheduling(),
+				pest_scenario.get_pestpp_options().get_panther_overdue_quantile());
 		}
 		else
 		{
@@ -533,10 +539,21 @@ int main(int argc, char* argv[])
 			performance_log.log_event("finished basic model IO error checking");
 			cout << "done" << endl;
 			const ModelExecInfo &exi = pest_scenario.get_model_exec_info();
-			run_manager_ptr = new RunManagerSerial(exi.comline_vec,
-				exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
-				file_manager.build_filename("rns"), pathname,
-				pest_scenario.get_pestpp_options().get_max_run_fail());
+			if (pest_scenario.get_pestpp_options().get_local_num_workers() != 1)
+			{
+				run_manager_ptr = new RunManagerLocal(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					file_manager.build_filename("rns"), pathname,
+					pest_scenario.get_pestpp_options().get_local_num_workers(),
+					pest_scenario.get_pestpp_options().get_max_run_fail());
+			}
+			else
+			{
+				run_manager_ptr = new RunManagerSerial(exi.comline_vec,
+					exi.tplfile_vec, exi.inpfile_vec, exi.insfile_vec, exi.outfile_vec,
+					file_manager.build_filename("rns"), pathname,
+					pest_scenario.get_pestpp_options().get_max_run_fail());
+			}
 		}
 
 
@@ -547,6 +564,11 @@ int main(int argc, char* argv[])
 		//Allocates Space for Run Manager.  This initializes the model parameter names and observations names.
 		//Neither of these will change over the course of the simulation
 
+		run_manager_ptr->set_run_storage_mmap(pest_scenario.get_pestpp_options().get_run_storage_mmap());
+		run_manager_ptr->set_run_storage_write_behind(pest_scenario.get_pestpp_options().get_run_storage_write_behind());
+		run_manager_ptr->set_run_storage_single_precision_obs(pest_scenario.get_pestpp_options().get_obs_storage_precision() == "single");
+		run_manager_ptr->set_cpp_tpl_writer(pest_scenario.get_pestpp_options().get_tpl_writer() == "cpp");
+		run_manager_ptr->set_cpp_ins_reader(pest_scenario.get_pestpp_options().get_ins_reader() == "cpp");
 		if (restart_ctl.get_restart_option() == RestartController::RestartOption::RESUME_JACOBIAN_RUNS)
 		{
 			run_manager_ptr->initialize_restart(file_manager.build_filename("rnj"));
@@ -564,6 +586,9 @@ int main(int argc, char* argv[])
 		Eigen::MatrixXd jco_mat;
 		bool use_jco = false;
 		vector<string> jco_col_names;
+		unique_ptr<DenseBinaryFile> dense_file;
+		vector<int> dense_cols;
+		vector<string> dense_par_names;
 		if ((par_ext.compare("jcb") == 0) || (par_ext.compare("jco") == 0))
 		{
 			cout << "  ---  binary jco-type file detected for par_csv" << endl;
@@ -591,6 +616,38 @@ int main(int argc, char* argv[])
 			cout << "  --- converting sparse JCO matrix to dense" << endl;
 			jco_mat = jco.get_matrix(jco.get_sim_obs_names(), pest_scenario.get_ctl_ordered_par_names()).toDense();
 		}
+		else if (par_ext.compare("bin") == 0)
+		{
+			cout << "  ---  dense binary file detected for par_csv" << endl;
+			dense_file.reset(new DenseBinaryFile(par_csv_file));
+			cout << dense_file->rows() << " runs found in dense binary file" << endl;
+			//only the columns of control file parameters are read from the file as each chunk is run
+			map<string, int> file_cols;
+			for (int j = 0; j < dense_file->get_col_names().size(); j++)
+				file_cols[upper_cp(strip_cp(dense_file->get_col_names()[j]))] = j;
+			vector<string> missing_names;
+			for (auto &pname : pest_scenario.get_ctl_ordered_par_names())
+			{
+				auto found = file_cols.find(pname);
+				if (found == file_cols.end())
+				{
+					missing_names.push_back(pname);
+					continue;
+				}
+				dense_par_names.push_back(pname);
+				dense_cols.push_back(found->second);
+			}
+			if (missing_names.size() > 0)
+			{
+				stringstream ss;
+				ss << " the following pest control file parameter names were not found in the dense binary file:" << endl;
+				for (auto &n : missing_names) ss << n << endl;
+				if (!pest_scenario.get_pestpp_options().get_sweep_forgive())
+					throw runtime_error(ss.str());
+				else
+					cout << ss.str() << endl << "continuing anyway..." << endl;
+			}
+		}
 
 		else
 		{
@@ -637,6 +694,22 @@ int main(int argc, char* argv[])
 				sweep_par_info = pair<vector<string>, vector<Parameters>>(run_ids, pars);
 
 			}
+			else if (dense_file)
+			{
+				//use the row names of the file as the run ids
+				Parameters par = pest_scenario.get_ctl_parameters();
+				vector<Parameters> pars;
+				vector<string> run_ids;
+				int n_chunk = max(min((int64_t)chunk, dense_file->rows() - total_runs_done), (int64_t)0);
+				Eigen::MatrixXd chunk_vals = dense_file->read_rows(total_runs_done, n_chunk, dense_cols);
+				for (int i = 0; i < n_chunk; i++)
+				{
+					par.update_without_clear(dense_par_names, chunk_vals.row(i));
+					pars.push_back(par);
+					run_ids.push_back(dense_file->get_row_names()[total_runs_done + i]);
+				}
+				sweep_par_info = pair<vector<string>, vector<Parameters>>(run_ids, pars);
+			}
 			else
 			{
 				try {